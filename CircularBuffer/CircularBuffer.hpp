@@ -3,7 +3,10 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <type_traits>
 
 namespace Alectryon {
 
@@ -15,6 +18,16 @@ template <class T, bool C>
 class CircularBufferIterator;
 #endif /* CIRCULAR_BUFFER_ITERATOR */
 
+/**
+ * @brief Marks types whose equality is the same as bitwise equality
+ * @details CircularBuffer compares these with memcmp().
+ * Floating point types are not included (0.0 == -0.0, NaN != NaN).
+ * Specialize for your own padding-free types to enable the fast path.
+ */
+template <class T>
+struct CircularBufferBitwiseComparable : std::integral_constant<bool,
+	std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> { };
+
 template <class T>
 class CircularBuffer {
 
@@ -45,6 +58,16 @@ public:
 	 */
 	void copy(const CircularBuffer<T>& other);
 
+	/**
+	 * @brief Copies the count elements nearest the front of other
+	 * @details doesn't change the capacity of current buffer.
+	 * count is clamped to other.num() and capacity().
+	 * When the buffer is fed with pushFront(), these are the newest elements.
+	 * @param other buffer to copy from
+	 * @param count maximum number of elements to copy
+	 */
+	void copy(const CircularBuffer<T>& other, size_t count);
+
 	/**
 	 * @brief Add a value to back of buffer
 	 * @details value will be copied
@@ -113,6 +136,18 @@ public:
 	T readBackCopy(size_t idx) const;
 	T readFrontCopy(size_t idx) const;
 
+	/**
+	 * @brief Gets count elements starting offset from the back
+	 * as at most two contiguous arrays
+	 * @details elements are ordered from back to front, first then second.
+	 * secondNum is 0 if the elements don't wrap around the end of the array.
+	 * offset + count must be <= num()
+	 * @param offset offset from back of buffer of the first element
+	 * @param count number of elements
+	 */
+	void segments(size_t offset, size_t count,
+		const T*& first, size_t& firstNum, const T*& second, size_t& secondNum) const;
+
 	/**
 	 * @brief Clears the buffer of all elements
 	 */
@@ -155,6 +190,23 @@ protected:
 
 	inline size_t incrementIdx(size_t idx) const;
 	inline size_t decrementIdx(size_t idx) const;
+
+	/**
+	 * @brief Returns the array index of the element offset from the back
+	 */
+	inline size_t arrayIdx(size_t offset) const;
+
+	/**
+	 * @brief Replaces contents with count elements of other,
+	 * starting offset elements from the back of other
+	 * @details at most two contiguous block copies
+	 */
+	void copyRange(const CircularBuffer<T>& other, size_t offset, size_t count);
+
+	static void copyBlock(T* dest, const T* src, size_t n, std::true_type);
+	static void copyBlock(T* dest, const T* src, size_t n, std::false_type);
+	static bool equalBlock(const T* a, const T* b, size_t n, std::true_type);
+	static bool equalBlock(const T* a, const T* b, size_t n, std::false_type);
 };
 
 template <class T>
@@ -170,7 +222,11 @@ CircularBuffer<T>::CircularBuffer(size_t capacity) :
 
 template <class T>
 CircularBuffer<T>::CircularBuffer(const CircularBuffer<T>& other) :
-	_capacity(other._capacity){
+	_arr(nullptr),
+	_num(0),
+	_frontIdx(0),
+	_backIdx(0),
+	_capacity(other._capacity) {
 	_arr = (T*) malloc(_capacity * sizeof(T));
 	copy(other);
 }
@@ -188,9 +244,14 @@ CircularBuffer<T>::CircularBuffer(CircularBuffer<T>&& other) :
 
 template <class T>
 CircularBuffer<T>& CircularBuffer<T>::operator=(const CircularBuffer<T>& other) {
+	// check for self assignment, copy would memcpy the buffer onto itself
+	if (&other == this) {
+		return *this;
+	}
+
 	if (_capacity != other._capacity) {
 		_capacity = other._capacity;
-		delete[] _arr;
+		free(_arr);
 		_arr = (T*) malloc(_capacity * sizeof(T));
 	}
 	copy(other);
@@ -213,29 +274,28 @@ CircularBuffer<T>& CircularBuffer<T>::operator=(CircularBuffer<T>&& other) {
 template <class T>
 CircularBuffer<T>::~CircularBuffer() {
 	if (_arr != nullptr) {
-		delete[] _arr;
+		free(_arr);
 	}
 }
 
 template <class T>
 void CircularBuffer<T>::copy(const CircularBuffer<T>& other) {
-	_num = other._num;
-	if (_num > _capacity) {
-		_num = _capacity;
+	size_t count = other._num;
+	if (count > _capacity) {
+		count = _capacity;
 	}
-	_backIdx = 0;
+	copyRange(other, 0, count);
+}
 
-	size_t thisIdx = _backIdx;
-	size_t otherIdx = other._backIdx;
-	for (size_t i = 0; i < _num; i++) {
-		_arr[thisIdx] = other._arr[otherIdx];
-		thisIdx = this->incrementIdx(thisIdx);
-		otherIdx = other.incrementIdx(otherIdx);
+template <class T>
+void CircularBuffer<T>::copy(const CircularBuffer<T>& other, size_t count) {
+	if (count > other._num) {
+		count = other._num;
 	}
-	_frontIdx = thisIdx;
-	if (_frontIdx >= _capacity) {
-		_frontIdx = 0;
+	if (count > _capacity) {
+		count = _capacity;
 	}
+	copyRange(other, other._num - count, count);
 }
 
 template <class T>
@@ -325,22 +385,22 @@ T& CircularBuffer<T>::readFront(size_t idx) {
 
 template <class T>
 const T& CircularBuffer<T>::readBack() const {
-	return readBack();
+	return const_cast<CircularBuffer<T>*>(this)->readBack();
 }
 
 template <class T>
 const T& CircularBuffer<T>::readFront() const {
-	return readFront();
+	return const_cast<CircularBuffer<T>*>(this)->readFront();
 }
 
 template <class T>
 const T& CircularBuffer<T>::readBack(size_t idx) const {
-	return readBack(idx);
+	return const_cast<CircularBuffer<T>*>(this)->readBack(idx);
 }
 
 template <class T>
 const T& CircularBuffer<T>::readFront(size_t idx) const {
-	return readFront(idx);
+	return const_cast<CircularBuffer<T>*>(this)->readFront(idx);
 }
 
 template <class T>
@@ -363,6 +423,18 @@ T CircularBuffer<T>::readFrontCopy(size_t idx) const {
 	return readFront(idx);
 }
 
+template <class T>
+void CircularBuffer<T>::segments(size_t offset, size_t count,
+	const T*& first, size_t& firstNum, const T*& second, size_t& secondNum) const {
+	assert(offset + count <= _num);
+
+	size_t start = (count > 0) ? arrayIdx(offset) : 0;
+	first = _arr + start;
+	firstNum = std::min(count, _capacity - start);
+	second = _arr;
+	secondNum = count - firstNum;
+}
+
 template <class T>
 void CircularBuffer<T>::clear() {
 	_num = 0;
@@ -393,15 +465,23 @@ template <class T>
 bool CircularBuffer<T>::operator==(const CircularBuffer<T>& other) const {
 	if (_num != other._num) return false;
 
+	// each buffer is at most two contiguous segments,
+	// so this compares at most three blocks
 	size_t idx1 = _backIdx;
 	size_t idx2 = other._backIdx;
-	for (size_t i = 0; i < _num; i++) {
-		if (_arr[idx1] != other._arr[idx2]) {
+	size_t remaining = _num;
+	while (remaining > 0) {
+		size_t run = std::min(remaining, std::min(_capacity - idx1, other._capacity - idx2));
+		if (!equalBlock(_arr + idx1, other._arr + idx2, run,
+			CircularBufferBitwiseComparable<T>())) {
 			return false;
 		}
 
-		idx1 = incrementIdx(idx1);
-		idx2 = incrementIdx(idx2);
+		idx1 += run;
+		if (idx1 == _capacity) idx1 = 0;
+		idx2 += run;
+		if (idx2 == other._capacity) idx2 = 0;
+		remaining -= run;
 	}
 
 	return true;
@@ -452,6 +532,61 @@ inline size_t CircularBuffer<T>::decrementIdx(size_t idx) const {
 	}
 }
 
+template <class T>
+inline size_t CircularBuffer<T>::arrayIdx(size_t offset) const {
+	size_t idx = _backIdx + offset;
+	if (idx >= _capacity) {
+		idx -= _capacity;
+	}
+	return idx;
+}
+
+template <class T>
+void CircularBuffer<T>::copyRange(const CircularBuffer<T>& other, size_t offset, size_t count) {
+	assert(count <= _capacity);
+
+	// copying from itself, keep the range where it is instead of copying it over itself
+	if (&other == this) {
+		_frontIdx = arrayIdx(offset + count);
+		_backIdx = arrayIdx(offset);
+		_num = count;
+		return;
+	}
+
+	const T* first;
+	const T* second;
+	size_t firstNum, secondNum;
+	other.segments(offset, count, first, firstNum, second, secondNum);
+	copyBlock(_arr, first, firstNum, std::is_trivially_copyable<T>());
+	copyBlock(_arr + firstNum, second, secondNum, std::is_trivially_copyable<T>());
+
+	_num = count;
+	_backIdx = 0;
+	_frontIdx = (count == _capacity) ? 0 : count;
+}
+
+template <class T>
+void CircularBuffer<T>::copyBlock(T* dest, const T* src, size_t n, std::true_type) {
+	if (n > 0) {
+		memcpy(dest, src, n * sizeof(T));
+	}
+}
+
+template <class T>
+void CircularBuffer<T>::copyBlock(T* dest, const T* src, size_t n, std::false_type) {
+	std::copy(src, src + n, dest);
+}
+
+template <class T>
+bool CircularBuffer<T>::equalBlock(const T* a, const T* b, size_t n, std::true_type) {
+	return n == 0 || memcmp(a, b, n * sizeof(T)) == 0;
+}
+
+template <class T>
+bool CircularBuffer<T>::equalBlock(const T* a, const T* b, size_t n, std::false_type) {
+	return std::equal(a, a + n, b);
+}
+
 #ifdef CIRCULAR_BUFFER_ITERATOR
 
 template <class T, bool C>
@@ -0,0 +1,367 @@
+#ifndef _SHARDED_QUEUE_HPP
+#define _SHARDED_QUEUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "CircularBuffer.hpp"
+
+namespace Alectryon {
+
+const size_t ShardedQueueCacheLine = 64;
+
+/**
+ * @brief Single producer, single consumer ring
+ * @details Uses the storage of a CircularBuffer, but keeps its own
+ * atomic indices so that one producer thread and one consumer thread
+ * can use it concurrently. The producer and consumer indices live on
+ * separate cache lines.
+ */
+template <class T>
+class ShardBuffer : protected CircularBuffer<T> {
+public:
+	/**
+	 * @param capacity maximum number of elements the shard can hold
+	 */
+	ShardBuffer(size_t capacity);
+
+	ShardBuffer(const ShardBuffer<T>& other) = delete;
+	ShardBuffer<T>& operator=(const ShardBuffer<T>& other) = delete;
+
+	/**
+	 * @brief Add a value to the shard, producer thread only
+	 * @return true, if added successfully. false if the shard is full
+	 */
+	bool push(const T& val);
+
+	/**
+	 * @brief Gets pointer to the oldest value, consumer thread only
+	 * @return nullptr if the shard is empty
+	 */
+	const T* peek();
+
+	/**
+	 * @brief Removes the oldest value and copies it into val, consumer thread only
+	 * @return true, if a value was removed
+	 */
+	bool pop(T& val);
+
+	/**
+	 * @brief Removes the oldest value, consumer thread only
+	 * @details should only be called after peek() returned non-null
+	 */
+	void discard();
+
+	/**
+	 * @brief Returns maximum number of elements the shard can hold
+	 */
+	size_t capacity() const;
+
+	/**
+	 * @brief Approximate number of elements in the shard
+	 * @details exact if neither thread is modifying the shard
+	 */
+	size_t num() const;
+
+protected:
+	// written by the producer
+	alignas(ShardedQueueCacheLine) std::atomic<size_t> _head;
+	size_t _tailCache;
+
+	// written by the consumer
+	alignas(ShardedQueueCacheLine) std::atomic<size_t> _tail;
+	size_t _headCache;
+};
+
+/**
+ * @brief Multi producer, single consumer queue made from one ShardBuffer per producer
+ * @details Each producer owns one shard and is the only thread writing to it,
+ * so producers never contend with each other. A single consumer thread
+ * drains the shards either round robin or merged in key (e.g. timestamp) order.
+ * Elements from the same shard always come out in the order they were pushed.
+ */
+template <class T>
+class ShardedQueue {
+public:
+	/**
+	 * @param numShards number of shards, usually the number of producers
+	 * @param shardCapacity capacity of each shard
+	 * @details throws std::bad_alloc if the shards can't be allocated
+	 */
+	ShardedQueue(size_t numShards, size_t shardCapacity);
+
+	ShardedQueue(const ShardedQueue<T>& other) = delete;
+	ShardedQueue<T>& operator=(const ShardedQueue<T>& other) = delete;
+
+	~ShardedQueue();
+
+	/**
+	 * @brief Add a value to a shard
+	 * @details only one thread may push to a given shard
+	 * @return true, if added successfully. false if that shard is full
+	 */
+	bool push(size_t shard, const T& val);
+
+	/**
+	 * @brief Gets the shard a producer writes to directly
+	 */
+	ShardBuffer<T>& shard(size_t shard);
+
+	/**
+	 * @brief Removes one value, visiting the shards round robin
+	 * @details consumer thread only
+	 * @return true, if a value was removed
+	 */
+	bool pop(T& val);
+
+	/**
+	 * @brief Removes values round robin, at most maxPerShard
+	 * from each shard, passing each to out(const T&)
+	 * @details consumer thread only
+	 * @return number of values removed
+	 */
+	template <class Fn>
+	size_t drain(Fn out, size_t maxPerShard = SIZE_MAX);
+
+	/**
+	 * @brief Removes values merged in increasing key(const T&) order,
+	 * passing each to out(const T&)
+	 * @details consumer thread only. Does a k-way merge over the shards
+	 * with a heap of the shard fronts. Keys within a shard must be non-decreasing.
+	 * If strict is true, stops as soon as any shard runs empty,
+	 * since that producer might still push a smaller key. Otherwise merges
+	 * whatever is currently in the shards.
+	 * @param max maximum number of values to remove
+	 * @return number of values removed
+	 */
+	template <class Fn, class KeyFn>
+	size_t drainOrdered(Fn out, KeyFn key, bool strict = true, size_t max = SIZE_MAX);
+
+	/**
+	 * @brief Returns number of shards
+	 */
+	size_t numShards() const;
+
+	/**
+	 * @brief Approximate total number of elements in all shards
+	 */
+	size_t num() const;
+
+protected:
+	ShardBuffer<T>* _shards;
+	size_t _numShards;
+	size_t _nextShard;
+};
+
+template <class T>
+ShardBuffer<T>::ShardBuffer(size_t capacity) :
+	// one slot is always left empty to tell a full ring from an empty one
+	CircularBuffer<T>(capacity + 1),
+	_head(0),
+	_tailCache(0),
+	_tail(0),
+	_headCache(0) {
+	if (this->_arr == nullptr) {
+		throw std::bad_alloc();
+	}
+}
+
+template <class T>
+bool ShardBuffer<T>::push(const T& val) {
+	size_t head = _head.load(std::memory_order_relaxed);
+	size_t next = this->incrementIdx(head);
+	if (next == _tailCache) {
+		_tailCache = _tail.load(std::memory_order_acquire);
+		if (next == _tailCache) {
+			return false;
+		}
+	}
+
+	this->_arr[head] = val;
+	_head.store(next, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+const T* ShardBuffer<T>::peek() {
+	size_t tail = _tail.load(std::memory_order_relaxed);
+	if (tail == _headCache) {
+		_headCache = _head.load(std::memory_order_acquire);
+		if (tail == _headCache) {
+			return nullptr;
+		}
+	}
+	return &this->_arr[tail];
+}
+
+template <class T>
+bool ShardBuffer<T>::pop(T& val) {
+	const T* front = peek();
+	if (front == nullptr) {
+		return false;
+	}
+	val = *front;
+	discard();
+	return true;
+}
+
+template <class T>
+void ShardBuffer<T>::discard() {
+	size_t tail = _tail.load(std::memory_order_relaxed);
+	_tail.store(this->incrementIdx(tail), std::memory_order_release);
+}
+
+template <class T>
+size_t ShardBuffer<T>::capacity() const {
+	return this->_capacity - 1;
+}
+
+template <class T>
+size_t ShardBuffer<T>::num() const {
+	size_t head = _head.load(std::memory_order_acquire);
+	size_t tail = _tail.load(std::memory_order_acquire);
+	return (head >= tail) ? head - tail : head + this->_capacity - tail;
+}
+
+template <class T>
+ShardedQueue<T>::ShardedQueue(size_t numShards, size_t shardCapacity) :
+	_shards(nullptr),
+	_numShards(numShards),
+	_nextShard(0) {
+	assert(numShards > 0);
+
+	// new doesn't have to respect the cache line alignment of ShardBuffer before c++17
+	void* mem = nullptr;
+	if (posix_memalign(&mem, ShardedQueueCacheLine, _numShards * sizeof(ShardBuffer<T>)) != 0) {
+		throw std::bad_alloc();
+	}
+	_shards = (ShardBuffer<T>*) mem;
+	size_t constructed = 0;
+	try {
+		for (; constructed < _numShards; constructed++) {
+			new (&_shards[constructed]) ShardBuffer<T>(shardCapacity);
+		}
+	} catch (...) {
+		// the destructor won't run, undo the shards built so far
+		for (size_t i = 0; i < constructed; i++) {
+			_shards[i].~ShardBuffer<T>();
+		}
+		free(_shards);
+		throw;
+	}
+}
+
+template <class T>
+ShardedQueue<T>::~ShardedQueue() {
+	for (size_t i = 0; i < _numShards; i++) {
+		_shards[i].~ShardBuffer<T>();
+	}
+	free(_shards);
+}
+
+template <class T>
+bool ShardedQueue<T>::push(size_t shard, const T& val) {
+	assert(shard < _numShards);
+	return _shards[shard].push(val);
+}
+
+template <class T>
+ShardBuffer<T>& ShardedQueue<T>::shard(size_t shard) {
+	assert(shard < _numShards);
+	return _shards[shard];
+}
+
+template <class T>
+bool ShardedQueue<T>::pop(T& val) {
+	for (size_t i = 0; i < _numShards; i++) {
+		size_t idx = _nextShard;
+		_nextShard = (_nextShard + 1 == _numShards) ? 0 : _nextShard + 1;
+		if (_shards[idx].pop(val)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <class T>
+template <class Fn>
+size_t ShardedQueue<T>::drain(Fn out, size_t maxPerShard) {
+	size_t count = 0;
+	for (size_t i = 0; i < _numShards; i++) {
+		ShardBuffer<T>& shard = _shards[i];
+		const T* front;
+		for (size_t j = 0; j < maxPerShard && (front = shard.peek()) != nullptr; j++) {
+			out(*front);
+			shard.discard();
+			count++;
+		}
+	}
+	return count;
+}
+
+template <class T>
+template <class Fn, class KeyFn>
+size_t ShardedQueue<T>::drainOrdered(Fn out, KeyFn key, bool strict, size_t max) {
+	typedef decltype(key(std::declval<const T&>())) KeyType;
+	typedef std::pair<KeyType, size_t> HeapEntry;
+
+	// min heap of (key of shard front, shard index)
+	std::vector<HeapEntry> heap;
+	heap.reserve(_numShards);
+	for (size_t i = 0; i < _numShards; i++) {
+		const T* front = _shards[i].peek();
+		if (front != nullptr) {
+			heap.push_back(HeapEntry(key(*front), i));
+		} else if (strict) {
+			return 0;
+		}
+	}
+	auto greater = [](const HeapEntry& a, const HeapEntry& b) {
+		return b.first < a.first || (!(a.first < b.first) && b.second < a.second);
+	};
+	std::make_heap(heap.begin(), heap.end(), greater);
+
+	size_t count = 0;
+	while (!heap.empty() && count < max) {
+		std::pop_heap(heap.begin(), heap.end(), greater);
+		size_t idx = heap.back().second;
+		heap.pop_back();
+
+		ShardBuffer<T>& shard = _shards[idx];
+		out(*shard.peek());
+		shard.discard();
+		count++;
+
+		const T* front = shard.peek();
+		if (front != nullptr) {
+			heap.push_back(HeapEntry(key(*front), idx));
+			std::push_heap(heap.begin(), heap.end(), greater);
+		} else if (strict) {
+			break;
+		}
+	}
+	return count;
+}
+
+template <class T>
+size_t ShardedQueue<T>::numShards() const {
+	return _numShards;
+}
+
+template <class T>
+size_t ShardedQueue<T>::num() const {
+	size_t total = 0;
+	for (size_t i = 0; i < _numShards; i++) {
+		total += _shards[i].num();
+	}
+	return total;
+}
+
+}
+
+#endif /* _SHARDED_QUEUE_HPP */
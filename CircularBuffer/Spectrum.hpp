@@ -0,0 +1,494 @@
+#ifndef _SPECTRUM_HPP
+#define _SPECTRUM_HPP
+
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+#include "CircularBuffer.hpp"
+
+namespace Alectryon {
+
+/**
+ * @brief Radix-2 FFT of real valued input
+ * @details Twiddle factors and the bit reversal table are computed once
+ * in the constructor. A real input of size N is transformed with one
+ * complex FFT of size N/2, so only the N/2 + 1 non-redundant bins are produced.
+ */
+template <class T>
+class RealFFT {
+public:
+	/**
+	 * @param size number of input samples, must be a power of two and >= 2
+	 */
+	RealFFT(size_t size);
+
+	/**
+	 * @brief Returns number of input samples
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Returns number of output bins, size() / 2 + 1
+	 */
+	size_t numBins() const;
+
+	/**
+	 * @brief Transforms size() samples
+	 *
+	 * @param in input samples
+	 * @param out array of numBins() bins
+	 */
+	void forward(const T* in, std::complex<T>* out);
+
+	/**
+	 * @brief Transforms size() samples split across two arrays,
+	 * such as the segments of a CircularBuffer
+	 * @details input sample n is first[n] for n < firstNum,
+	 * otherwise second[n - firstNum]. firstNum + secondNum must be size()
+	 *
+	 * @param window size() window coefficients to multiply the input by, can be nullptr
+	 * @param out array of numBins() bins
+	 */
+	void forward(const T* first, size_t firstNum, const T* second, size_t secondNum,
+		const T* window, std::complex<T>* out);
+
+protected:
+	size_t _size;
+	// exp(-2 pi i k / size) for k < size / 2
+	std::vector<std::complex<T>> _twiddles;
+	std::vector<size_t> _bitReverse;
+	std::vector<std::complex<T>> _scratch;
+
+	/**
+	 * @brief packs pairs of real samples as complex values in bit reversed order
+	 */
+	void pack(const T* in, size_t num, size_t start, const T* window);
+
+	/**
+	 * @brief runs the in place complex FFT on _scratch and unpacks the real spectrum
+	 */
+	void transform(std::complex<T>* out);
+};
+
+/**
+ * @brief Short time Fourier transform over the newest samples of a CircularBuffer
+ * @details The buffer is expected to be fed with pushFront(), so the front holds
+ * the newest sample. Each frame is the newest frameSize samples, windowed and
+ * read straight out of the two segments of the buffer.
+ */
+template <class T>
+class ShortTimeFourierTransform {
+public:
+	enum WindowType { RECTANGULAR, HANN, HAMMING, BLACKMAN };
+
+	/**
+	 * @param frameSize number of samples per frame, must be a power of two
+	 * @param hop number of new samples between frames
+	 * @param window window function applied to each frame
+	 */
+	ShortTimeFourierTransform(size_t frameSize, size_t hop, WindowType window = HANN);
+
+	/**
+	 * @brief Computes the spectrum of the newest frame once hop new samples have arrived
+	 * @details if more than one hop has accumulated, only the newest frame is computed
+	 *
+	 * @param buff buffer holding the samples
+	 * @param newSamples number of samples pushed since the last call
+	 * @param out array of numBins() bins
+	 * @return true, if a frame was computed
+	 */
+	bool process(const CircularBuffer<T>& buff, size_t newSamples, std::complex<T>* out);
+
+	/**
+	 * @brief Computes the spectrum of the newest frame right away
+	 * @details buff must hold at least frameSize() samples
+	 */
+	void compute(const CircularBuffer<T>& buff, std::complex<T>* out);
+
+	size_t frameSize() const;
+	size_t hop() const;
+	size_t numBins() const;
+
+	/**
+	 * @brief Gets the window coefficients
+	 */
+	const T* window() const;
+
+protected:
+	RealFFT<T> _fft;
+	size_t _hop;
+	size_t _pending;
+	bool _primed;
+	std::vector<T> _window;
+};
+
+/**
+ * @brief Sliding DFT of a small set of bins over the newest samples of a CircularBuffer
+ * @details Each new sample updates each tracked bin in O(1), so a hop of H samples
+ * costs O(H * bins) instead of a full FFT. The bins are recomputed directly once
+ * every frameSize samples so rounding errors don't accumulate.
+ * A Hann window is applied in the frequency domain from the neighbouring bins.
+ */
+template <class T>
+class SlidingDFT {
+public:
+	/**
+	 * @param frameSize number of samples in the window
+	 * @param bins indices of bins to track, each must be <= frameSize / 2
+	 * @param hann true to apply a Hann window, otherwise rectangular
+	 */
+	SlidingDFT(size_t frameSize, const std::vector<size_t>& bins, bool hann = false);
+
+	/**
+	 * @brief Computes the bins directly from the newest frameSize samples of buff
+	 */
+	void reset(const CircularBuffer<T>& buff);
+
+	/**
+	 * @brief Slides the window over the samples pushed since the last update
+	 * @details buff must still hold the samples that leave the window,
+	 * so buff.num() must be at least frameSize + newSamples
+	 */
+	void update(const CircularBuffer<T>& buff, size_t newSamples);
+
+	/**
+	 * @brief Gets the value of the idx'th tracked bin
+	 */
+	std::complex<T> bin(size_t idx) const;
+
+	size_t numBins() const;
+
+protected:
+	size_t _frameSize;
+	bool _hann;
+	size_t _sinceReset;
+	std::vector<size_t> _bins;
+	// rectangular window DFT of every bin needed, with its rotation factor
+	std::vector<int64_t> _stateBins;
+	std::vector<std::complex<double>> _state;
+	std::vector<std::complex<double>> _rotation;
+	// index into _state of bins k - 1, k, k + 1 for each tracked bin
+	std::vector<size_t> _lower;
+	std::vector<size_t> _center;
+	std::vector<size_t> _upper;
+
+	size_t stateIdx(int64_t bin);
+};
+
+template <class T>
+RealFFT<T>::RealFFT(size_t size) :
+	_size(size),
+	_twiddles(size / 2),
+	_bitReverse(size / 2),
+	_scratch(size / 2) {
+	assert(size >= 2);
+	assert((size & (size - 1)) == 0);
+
+	const double pi = 3.14159265358979323846;
+	for (size_t k = 0; k < size / 2; k++) {
+		double angle = -2.0 * pi * (double) k / (double) size;
+		_twiddles[k] = std::complex<T>((T) std::cos(angle), (T) std::sin(angle));
+	}
+
+	size_t half = size / 2;
+	size_t bits = 0;
+	while (((size_t) 1 << bits) < half) {
+		bits++;
+	}
+	for (size_t i = 0; i < half; i++) {
+		size_t rev = 0;
+		for (size_t b = 0; b < bits; b++) {
+			rev |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		_bitReverse[i] = rev;
+	}
+}
+
+template <class T>
+size_t RealFFT<T>::size() const {
+	return _size;
+}
+
+template <class T>
+size_t RealFFT<T>::numBins() const {
+	return _size / 2 + 1;
+}
+
+template <class T>
+void RealFFT<T>::forward(const T* in, std::complex<T>* out) {
+	pack(in, _size, 0, nullptr);
+	transform(out);
+}
+
+template <class T>
+void RealFFT<T>::forward(const T* first, size_t firstNum, const T* second, size_t secondNum,
+	const T* window, std::complex<T>* out) {
+	assert(firstNum + secondNum == _size);
+
+	if ((firstNum & 1) == 0) {
+		pack(first, firstNum, 0, window);
+		pack(second, secondNum, firstNum, window);
+	} else {
+		// one pair straddles the two arrays
+		pack(first, firstNum - 1, 0, window);
+		T a = first[firstNum - 1];
+		T b = second[0];
+		if (window != nullptr) {
+			a *= window[firstNum - 1];
+			b *= window[firstNum];
+		}
+		_scratch[_bitReverse[firstNum / 2]] = std::complex<T>(a, b);
+		pack(second + 1, secondNum - 1, firstNum + 1, window);
+	}
+	transform(out);
+}
+
+template <class T>
+void RealFFT<T>::pack(const T* in, size_t num, size_t start, const T* window) {
+	assert((start & 1) == 0);
+	assert((num & 1) == 0);
+
+	size_t pair = start / 2;
+	if (window == nullptr) {
+		for (size_t n = 0; n < num; n += 2) {
+			_scratch[_bitReverse[pair++]] = std::complex<T>(in[n], in[n + 1]);
+		}
+	} else {
+		const T* w = window + start;
+		for (size_t n = 0; n < num; n += 2) {
+			_scratch[_bitReverse[pair++]] = std::complex<T>(in[n] * w[n], in[n + 1] * w[n + 1]);
+		}
+	}
+}
+
+template <class T>
+void RealFFT<T>::transform(std::complex<T>* out) {
+	size_t half = _size / 2;
+	std::complex<T>* z = _scratch.data();
+
+	// iterative decimation in time butterflies, input is already bit reversed
+	for (size_t len = 2; len <= half; len <<= 1) {
+		size_t step = _size / len;
+		size_t span = len / 2;
+		for (size_t start = 0; start < half; start += len) {
+			for (size_t j = 0; j < span; j++) {
+				std::complex<T> t = _twiddles[j * step] * z[start + j + span];
+				std::complex<T> u = z[start + j];
+				z[start + j] = u + t;
+				z[start + j + span] = u - t;
+			}
+		}
+	}
+
+	// split the N / 2 point complex spectrum into the N point real spectrum
+	out[0] = std::complex<T>(z[0].real() + z[0].imag(), 0);
+	out[half] = std::complex<T>(z[0].real() - z[0].imag(), 0);
+	for (size_t k = 1; k < half; k++) {
+		std::complex<T> a = z[k];
+		std::complex<T> b = std::conj(z[half - k]);
+		std::complex<T> even = (a + b) * (T) 0.5;
+		std::complex<T> odd = (a - b) * std::complex<T>(0, (T) -0.5);
+		out[k] = even + _twiddles[k] * odd;
+	}
+}
+
+template <class T>
+ShortTimeFourierTransform<T>::ShortTimeFourierTransform(size_t frameSize, size_t hop, WindowType window) :
+	_fft(frameSize),
+	_hop(hop),
+	_pending(0),
+	_primed(false),
+	_window(frameSize) {
+	assert(hop > 0);
+
+	// periodic windows, which overlap-add cleanly at the usual hops
+	const double pi = 3.14159265358979323846;
+	for (size_t n = 0; n < frameSize; n++) {
+		double phase = 2.0 * pi * (double) n / (double) frameSize;
+		double w;
+		switch (window) {
+			case HANN:
+				w = 0.5 - 0.5 * std::cos(phase);
+				break;
+			case HAMMING:
+				w = 0.54 - 0.46 * std::cos(phase);
+				break;
+			case BLACKMAN:
+				w = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2 * phase);
+				break;
+			default:
+				w = 1.0;
+		}
+		_window[n] = (T) w;
+	}
+}
+
+template <class T>
+bool ShortTimeFourierTransform<T>::process(const CircularBuffer<T>& buff, size_t newSamples, std::complex<T>* out) {
+	// the first frame is computed as soon as the buffer holds enough samples,
+	// later ones every hop samples
+	_pending += newSamples;
+	if (buff.num() < frameSize()) {
+		_primed = false;
+		return false;
+	}
+	if (_primed && _pending < _hop) {
+		return false;
+	}
+
+	_pending = _primed ? _pending % _hop : 0;
+	_primed = true;
+	compute(buff, out);
+	return true;
+}
+
+template <class T>
+void ShortTimeFourierTransform<T>::compute(const CircularBuffer<T>& buff, std::complex<T>* out) {
+	assert(buff.num() >= frameSize());
+
+	const T* first;
+	const T* second;
+	size_t firstNum, secondNum;
+	buff.segments(buff.num() - frameSize(), frameSize(), first, firstNum, second, secondNum);
+	_fft.forward(first, firstNum, second, secondNum, _window.data(), out);
+}
+
+template <class T>
+size_t ShortTimeFourierTransform<T>::frameSize() const {
+	return _fft.size();
+}
+
+template <class T>
+size_t ShortTimeFourierTransform<T>::hop() const {
+	return _hop;
+}
+
+template <class T>
+size_t ShortTimeFourierTransform<T>::numBins() const {
+	return _fft.numBins();
+}
+
+template <class T>
+const T* ShortTimeFourierTransform<T>::window() const {
+	return _window.data();
+}
+
+template <class T>
+SlidingDFT<T>::SlidingDFT(size_t frameSize, const std::vector<size_t>& bins, bool hann) :
+	_frameSize(frameSize),
+	_hann(hann),
+	_sinceReset(0),
+	_bins(bins) {
+	assert(frameSize > 0);
+
+	for (size_t i = 0; i < _bins.size(); i++) {
+		assert(_bins[i] <= frameSize / 2);
+		int64_t k = (int64_t) _bins[i];
+		_center.push_back(stateIdx(k));
+		if (_hann) {
+			_lower.push_back(stateIdx(k - 1));
+			_upper.push_back(stateIdx(k + 1));
+		}
+	}
+
+	const double pi = 3.14159265358979323846;
+	for (size_t i = 0; i < _stateBins.size(); i++) {
+		double angle = 2.0 * pi * (double) _stateBins[i] / (double) _frameSize;
+		_rotation.push_back(std::complex<double>(std::cos(angle), std::sin(angle)));
+	}
+	_state.assign(_stateBins.size(), std::complex<double>(0, 0));
+}
+
+template <class T>
+size_t SlidingDFT<T>::stateIdx(int64_t bin) {
+	for (size_t i = 0; i < _stateBins.size(); i++) {
+		if (_stateBins[i] == bin) {
+			return i;
+		}
+	}
+	_stateBins.push_back(bin);
+	return _stateBins.size() - 1;
+}
+
+template <class T>
+void SlidingDFT<T>::reset(const CircularBuffer<T>& buff) {
+	assert(buff.num() >= _frameSize);
+
+	const T* first;
+	const T* second;
+	size_t firstNum, secondNum;
+	buff.segments(buff.num() - _frameSize, _frameSize, first, firstNum, second, secondNum);
+
+	const double pi = 3.14159265358979323846;
+	for (size_t i = 0; i < _state.size(); i++) {
+		// X_k = sum x[n] exp(-2 pi i k n / N), with exp(-2 pi i k / N) applied incrementally
+		double angle = -2.0 * pi * (double) _stateBins[i] / (double) _frameSize;
+		std::complex<double> step(std::cos(angle), std::sin(angle));
+		std::complex<double> phase(1, 0);
+		std::complex<double> sum(0, 0);
+		for (size_t n = 0; n < firstNum; n++) {
+			sum += (double) first[n] * phase;
+			phase *= step;
+		}
+		for (size_t n = 0; n < secondNum; n++) {
+			sum += (double) second[n] * phase;
+			phase *= step;
+		}
+		_state[i] = sum;
+	}
+	_sinceReset = 0;
+}
+
+template <class T>
+void SlidingDFT<T>::update(const CircularBuffer<T>& buff, size_t newSamples) {
+	assert(buff.num() >= _frameSize + newSamples);
+
+	if (_sinceReset + newSamples >= _frameSize) {
+		reset(buff);
+		return;
+	}
+
+	// samples leaving the window, and the ones replacing them
+	const T* oldFirst;
+	const T* oldSecond;
+	const T* newFirst;
+	const T* newSecond;
+	size_t oldFirstNum, oldSecondNum, newFirstNum, newSecondNum;
+	buff.segments(buff.num() - _frameSize - newSamples, newSamples,
+		oldFirst, oldFirstNum, oldSecond, oldSecondNum);
+	buff.segments(buff.num() - newSamples, newSamples,
+		newFirst, newFirstNum, newSecond, newSecondNum);
+
+	for (size_t n = 0; n < newSamples; n++) {
+		T oldVal = (n < oldFirstNum) ? oldFirst[n] : oldSecond[n - oldFirstNum];
+		T newVal = (n < newFirstNum) ? newFirst[n] : newSecond[n - newFirstNum];
+		double delta = (double) newVal - (double) oldVal;
+		for (size_t i = 0; i < _state.size(); i++) {
+			_state[i] = (_state[i] + delta) * _rotation[i];
+		}
+	}
+	_sinceReset += newSamples;
+}
+
+template <class T>
+std::complex<T> SlidingDFT<T>::bin(size_t idx) const {
+	assert(idx < _bins.size());
+
+	std::complex<double> val = _state[_center[idx]];
+	if (_hann) {
+		// the Hann window is a three tap kernel in the frequency domain
+		val = 0.5 * val - 0.25 * (_state[_lower[idx]] + _state[_upper[idx]]);
+	}
+	return std::complex<T>((T) val.real(), (T) val.imag());
+}
+
+template <class T>
+size_t SlidingDFT<T>::numBins() const {
+	return _bins.size();
+}
+
+}
+
+#endif /* _SPECTRUM_HPP */
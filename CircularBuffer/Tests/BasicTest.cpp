@@ -174,6 +174,14 @@ BOOST_AUTO_TEST_CASE(ctors_and_copy) {
 	newBuff3.popBack();
 
 	BOOST_CHECK(newBuff3 != newBuff2);
+
+	// testing self assignment of a wrapped buffer
+	CircularBuffer<int>& alias = newBuff2;
+	newBuff2 = alias;
+	BOOST_CHECK(newBuff2.num() == buffSize);
+	for (size_t i = 0; i < newBuff2.num(); i++) {
+		BOOST_CHECK(newBuff2.readBack(i) == (int) i);
+	}
 }
 
 BOOST_AUTO_TEST_CASE(iterator) {
@@ -245,3 +253,70 @@ BOOST_AUTO_TEST_CASE(iterator) {
 	}
 }
 
+
+BOOST_AUTO_TEST_CASE(block_copy_and_compare) {
+	const int buffSize = 10;
+	CircularBuffer<int> buff(buffSize);
+
+	// wrap the buffer around the end of the array
+	for (int i = 0; i < 6; i++) {
+		buff.pushFront(-1);
+	}
+	for (int i = 0; i < 6; i++) {
+		buff.popBack();
+	}
+	for (int i = 0; i < buffSize; i++) {
+		buff.pushFront(i);
+	}
+
+	// copying only the newest elements
+	CircularBuffer<int> newest(buffSize);
+	newest.copy(buff, 4);
+	BOOST_CHECK(newest.num() == 4);
+	for (int i = 0; i < 4; i++) {
+		BOOST_CHECK(newest.readFront(i) == buffSize - 1 - i);
+	}
+	newest.copy(buff, 100);
+	BOOST_CHECK(newest == buff);
+
+	// smaller destination keeps the oldest elements
+	CircularBuffer<int> small(3);
+	small.copy(buff);
+	BOOST_CHECK(small.num() == 3);
+	for (int i = 0; i < 3; i++) {
+		BOOST_CHECK(small.readBack(i) == i);
+	}
+
+	// comparing buffers of different capacity and wrap position
+	CircularBuffer<int> other(buffSize + 5);
+	for (int i = 0; i < buffSize; i++) {
+		other.pushFront(i);
+	}
+	BOOST_CHECK(other == buff);
+	other.readFront(3) = -7;
+	BOOST_CHECK(other != buff);
+
+	// copying a wrapped buffer from itself
+	buff.copy(buff);
+	BOOST_CHECK(buff.num() == buffSize);
+	for (int i = 0; i < buffSize; i++) {
+		BOOST_CHECK(buff.readBack(i) == i);
+	}
+	buff.copy(buff, 4);
+	BOOST_CHECK(buff.num() == 4);
+	for (int i = 0; i < 4; i++) {
+		BOOST_CHECK(buff.readFront(i) == buffSize - 1 - i);
+	}
+	BOOST_CHECK(buff.pushFront(buffSize));
+	BOOST_CHECK(buff.readFront() == buffSize);
+	BOOST_CHECK(buff.readBack() == buffSize - 4);
+
+	// floating point uses element comparison
+	CircularBuffer<float> f1(4);
+	CircularBuffer<float> f2(4);
+	f1.pushFront(0.0f);
+	f2.pushFront(-0.0f);
+	BOOST_CHECK(f1 == f2);
+	f2 = f1;
+	BOOST_CHECK(f1 == f2);
+}
@@ -0,0 +1,117 @@
+#define BOOST_TEST_MODULE ShardedQueueTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <thread>
+#include <vector>
+#include "ShardedQueue.hpp"
+
+using namespace Alectryon;
+
+struct Sample {
+	uint32_t producer;
+	uint32_t seq;
+	uint64_t timestamp;
+};
+
+BOOST_AUTO_TEST_CASE(single_thread) {
+	ShardedQueue<int> queue(3, 4);
+	BOOST_CHECK(queue.numShards() == 3);
+	BOOST_CHECK(queue.shard(0).capacity() == 4);
+
+	for (int i = 0; i < 4; i++) {
+		BOOST_CHECK(queue.push(1, i));
+	}
+	BOOST_CHECK(!queue.push(1, 4));
+	BOOST_CHECK(queue.push(2, 10));
+	BOOST_CHECK(queue.num() == 5);
+
+	// round robin alternates between shards
+	int val;
+	BOOST_CHECK(queue.pop(val) && val == 0);
+	BOOST_CHECK(queue.pop(val) && val == 10);
+	BOOST_CHECK(queue.pop(val) && val == 1);
+	BOOST_CHECK(queue.pop(val) && val == 2);
+
+	std::vector<int> out;
+	size_t count = queue.drain([&](const int& v) { out.push_back(v); });
+	BOOST_CHECK(count == 1);
+	BOOST_CHECK(out.size() == 1 && out[0] == 3);
+	BOOST_CHECK(!queue.pop(val));
+}
+
+BOOST_AUTO_TEST_CASE(allocation_failure) {
+	// far more than can be allocated, the constructor cleans up and throws
+	BOOST_CHECK_THROW(ShardedQueue<int>(2, SIZE_MAX / 16), std::bad_alloc);
+}
+
+BOOST_AUTO_TEST_CASE(ordered_merge) {
+	ShardedQueue<int> queue(3, 8);
+	int vals[3][3] = {{1, 4, 7}, {2, 5, 8}, {0, 3, 6}};
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			queue.push(i, vals[i][j]);
+		}
+	}
+
+	std::vector<int> out;
+	auto key = [](const int& v) { return v; };
+	auto collect = [&](const int& v) { out.push_back(v); };
+
+	// strict merge stops once a shard runs dry
+	queue.drainOrdered(collect, key);
+	BOOST_CHECK(out.size() == 7);
+	for (size_t i = 0; i < out.size(); i++) {
+		BOOST_CHECK(out[i] == (int) i);
+	}
+
+	queue.drainOrdered(collect, key, false);
+	BOOST_CHECK(out.size() == 9);
+	BOOST_CHECK(out[7] == 7 && out[8] == 8);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_producers) {
+	const uint32_t numProducers = 4;
+	const uint32_t perProducer = 20000;
+	ShardedQueue<Sample> queue(numProducers, 64);
+
+	std::vector<std::thread> producers;
+	for (uint32_t p = 0; p < numProducers; p++) {
+		producers.push_back(std::thread([&queue, p]() {
+			for (uint32_t i = 0; i < perProducer; i++) {
+				Sample s = {p, i, (uint64_t) i * numProducers + p};
+				while (!queue.push(p, s)) {
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	std::vector<uint32_t> nextSeq(numProducers, 0);
+	size_t received = 0;
+	bool inSequence = true;
+	while (received < numProducers * perProducer) {
+		size_t count = queue.drainOrdered([&](const Sample& s) {
+			inSequence = inSequence && (s.seq == nextSeq[s.producer]);
+			nextSeq[s.producer]++;
+		}, [](const Sample& s) { return s.timestamp; });
+
+		if (count == 0) {
+			// some producer is idle or finished, fall back to round robin
+			Sample s;
+			if (queue.pop(s)) {
+				inSequence = inSequence && (s.seq == nextSeq[s.producer]);
+				nextSeq[s.producer]++;
+				count = 1;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		received += count;
+	}
+
+	for (size_t i = 0; i < producers.size(); i++) {
+		producers[i].join();
+	}
+	BOOST_CHECK(inSequence);
+	BOOST_CHECK(queue.num() == 0);
+}
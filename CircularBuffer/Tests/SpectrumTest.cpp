@@ -0,0 +1,116 @@
+#define BOOST_TEST_MODULE SpectrumTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "Spectrum.hpp"
+
+using namespace Alectryon;
+
+// direct O(N^2) DFT of x[0..N) with an optional window
+static std::complex<double> directDFT(const std::vector<double>& x, const double* window, size_t k) {
+	const double pi = 3.14159265358979323846;
+	std::complex<double> sum(0, 0);
+	for (size_t n = 0; n < x.size(); n++) {
+		double angle = -2.0 * pi * (double) (k * n) / (double) x.size();
+		double w = (window == nullptr) ? 1.0 : window[n];
+		sum += x[n] * w * std::complex<double>(std::cos(angle), std::sin(angle));
+	}
+	return sum;
+}
+
+static double signal(size_t n) {
+	return std::sin(0.3 * n) + 0.5 * std::cos(1.7 * n + 0.2) + 0.01 * (double) (n % 7);
+}
+
+BOOST_AUTO_TEST_CASE(real_fft) {
+	const size_t sizes[] = {2, 4, 16, 64};
+	for (size_t s = 0; s < 4; s++) {
+		size_t N = sizes[s];
+		std::vector<double> x(N);
+		for (size_t n = 0; n < N; n++) {
+			x[n] = signal(n);
+		}
+
+		RealFFT<double> fft(N);
+		BOOST_CHECK(fft.numBins() == N / 2 + 1);
+		std::vector<std::complex<double>> out(fft.numBins());
+		fft.forward(x.data(), out.data());
+		for (size_t k = 0; k < fft.numBins(); k++) {
+			BOOST_CHECK(std::abs(out[k] - directDFT(x, nullptr, k)) < 1e-9);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(stft_wrapped_buffer) {
+	const size_t N = 32;
+	const size_t hop = 5;
+	CircularBuffer<double> buff(N + 7);
+	ShortTimeFourierTransform<double> stft(N, hop);
+	std::vector<std::complex<double>> out(stft.numBins());
+
+	size_t frames = 0;
+	size_t lastFrame = 0;
+	for (size_t n = 0; n < 200; n++) {
+		if (buff.full()) {
+			buff.popBack();
+		}
+		buff.pushFront(signal(n));
+
+		if (stft.process(buff, 1, out.data())) {
+			// frames follow each other by exactly one hop
+			BOOST_CHECK(frames == 0 || n - lastFrame == hop);
+			lastFrame = n;
+			frames++;
+			// newest N samples, oldest first
+			std::vector<double> frame(N);
+			for (size_t i = 0; i < N; i++) {
+				frame[i] = signal(n + 1 - N + i);
+			}
+			for (size_t k = 0; k < stft.numBins(); k++) {
+				BOOST_CHECK(std::abs(out[k] - directDFT(frame, stft.window(), k)) < 1e-9);
+			}
+		}
+	}
+	BOOST_CHECK(frames > (200 - N) / hop - 1);
+}
+
+BOOST_AUTO_TEST_CASE(sliding_dft) {
+	const size_t N = 64;
+	const size_t hop = 3;
+	std::vector<size_t> bins = {0, 5, 12, 32};
+	CircularBuffer<float> buff(N + hop);
+	SlidingDFT<float> rect(N, bins);
+	SlidingDFT<float> hann(N, bins, true);
+	ShortTimeFourierTransform<double> ref(N, hop);
+
+	size_t n = 0;
+	for (; n < N; n++) {
+		buff.pushFront((float) signal(n));
+	}
+	rect.reset(buff);
+	hann.reset(buff);
+
+	for (int h = 0; h < 100; h++) {
+		for (size_t i = 0; i < hop; i++, n++) {
+			if (buff.full()) {
+				buff.popBack();
+			}
+			buff.pushFront((float) signal(n));
+		}
+		rect.update(buff, hop);
+		hann.update(buff, hop);
+
+		std::vector<double> frame(N);
+		for (size_t i = 0; i < N; i++) {
+			frame[i] = (float) signal(n - N + i);
+		}
+		for (size_t b = 0; b < bins.size(); b++) {
+			std::complex<double> r = rect.bin(b);
+			std::complex<double> w = hann.bin(b);
+			BOOST_CHECK(std::abs(r - directDFT(frame, nullptr, bins[b])) < 1e-3);
+			BOOST_CHECK(std::abs(w - directDFT(frame, ref.window(), bins[b])) < 1e-3);
+		}
+	}
+}
@@ -0,0 +1,287 @@
+#ifndef _CHOLESKY_FACTORIZATION_HPP
+#define _CHOLESKY_FACTORIZATION_HPP
+
+/**
+ * Cholesky factorization of symmetric matrices, A = L * L^T or A = L * D * L^T
+ * Only the lower triangle of A is read, so the upper triangle can hold anything.
+ * Half the work of LUFactorization for symmetric positive definite systems
+ * such as covariances and normal equations.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+enum CholeskyType {
+	CHOLESKY_LLT, // A = L * L^T, A must be positive definite
+	CHOLESKY_LDLT // A = L * D * L^T with unit L, no square roots, A can be indefinite
+};
+
+template <class T>
+class CholeskyFactorization {
+public:
+	/**
+	 * @brief columns factored at a time before the trailing matrix is
+	 * updated with gemm
+	 */
+	static const int32_t BlockSize = 64;
+
+	/**
+	 * @brief Factors the lower triangle of A
+	 * @details A must be square and symmetric
+	 */
+	explicit CholeskyFactorization(const Matrix<T>& A, CholeskyType type = CHOLESKY_LLT);
+
+	/**
+	 * @brief Factors a new matrix
+	 * @details storage is reused if A is the same size as the last one
+	 */
+	void factor(const Matrix<T>& A);
+
+	CholeskyType type() const;
+
+	/**
+	 * @brief returns number of rows (and columns) of the factored matrix
+	 */
+	int32_t size() const;
+
+	/**
+	 * @brief returns true if the factorization succeeded
+	 * @details false if A is not positive definite (CHOLESKY_LLT)
+	 * or a zero pivot was found (CHOLESKY_LDLT).
+	 * solve(), inverse() and logDeterminant() are undefined if it failed
+	 */
+	bool success() const;
+
+	/**
+	 * @brief Solves A * x = b
+	 * @details b and x are size() x k, every column is a right hand side.
+	 * x can be the same matrix as b
+	 */
+	void solve(const Matrix<T>& b, Matrix<T>& x) const;
+
+	/**
+	 * @brief Solves A * x = b, overwriting b with x
+	 */
+	void solveInPlace(Matrix<T>& b) const;
+
+	/**
+	 * @brief stores the inverse of A into dest
+	 */
+	void inverse(Matrix<T>& dest) const;
+
+	/**
+	 * @brief returns log(|det(A)|)
+	 * @details doesn't overflow like the determinant does for large matrices
+	 */
+	T logDeterminant() const;
+
+	/**
+	 * @brief returns the factor, zero above the diagonal
+	 * @details for CHOLESKY_LDLT the diagonal holds D, the unit diagonal of L
+	 * is not stored
+	 */
+	const Matrix<T>& packed() const;
+
+private:
+	Matrix<T> _L;
+	CholeskyType _type;
+	bool _success;
+
+	// d_p * L(i, p) for the trailing update
+	std::vector<T> _work;
+
+	/**
+	 * @brief factors _L in place as L * D * L^T, with D on the diagonal
+	 */
+	void decompose();
+};
+
+template <class T>
+CholeskyFactorization<T>::CholeskyFactorization(const Matrix<T>& A, CholeskyType type) :
+	_L(A), _type(type), _success(false) {
+	assert(A.rows() == A.cols());
+	decompose();
+}
+
+template <class T>
+void CholeskyFactorization<T>::factor(const Matrix<T>& A) {
+	assert(A.rows() == A.cols());
+
+	_L = A;
+	decompose();
+}
+
+template <class T>
+void CholeskyFactorization<T>::decompose() {
+	const int32_t n = _L.rows();
+	const int32_t ld = _L.ld();
+	T* data = _L.data();
+	_success = true;
+
+	for (int32_t k = 0; k < n; k += BlockSize) {
+		int32_t nb = (n - k < BlockSize) ? n - k : BlockSize;
+		int32_t end = k + nb;
+
+		// factor the block column, earlier blocks are already subtracted out
+		T scaled[BlockSize];
+		for (int32_t j = k; j < end; ++j) {
+			const T* rowJ = data + (int64_t) j * ld;
+			T d = rowJ[j];
+			for (int32_t p = k; p < j; ++p) {
+				scaled[p - k] = rowJ[p] * data[(int64_t) p * ld + p];
+				d -= rowJ[p] * scaled[p - k];
+			}
+
+			if ((_type == CHOLESKY_LLT && !(d > T(0))) || d == T(0)) {
+				_success = false;
+				return;
+			}
+			data[(int64_t) j * ld + j] = d;
+
+			T invD = T(1) / d;
+			for (int32_t i = j + 1; i < n; ++i) {
+				T* rowI = data + (int64_t) i * ld;
+				T sum = rowI[j];
+				for (int32_t p = k; p < j; ++p) {
+					sum -= rowI[p] * scaled[p - k];
+				}
+				rowI[j] = sum * invD;
+			}
+		}
+
+		int32_t rest = n - end;
+		if (rest == 0) {
+			continue;
+		}
+
+		// A22 -= L21 * D1 * L21^T, only blocks on or below the diagonal
+		_work.resize((size_t) nb * rest);
+		for (int32_t p = 0; p < nb; ++p) {
+			T d = data[(int64_t) (k + p) * ld + k + p];
+			T* row = _work.data() + (int64_t) p * rest;
+			for (int32_t c = 0; c < rest; ++c) {
+				row[c] = d * data[(int64_t) (end + c) * ld + k + p];
+			}
+		}
+		for (int32_t ib = end; ib < n; ib += BlockSize) {
+			int32_t mb = (n - ib < BlockSize) ? n - ib : BlockSize;
+			MatrixKernels::gemm(mb, ib + mb - end, nb, T(-1),
+				data + (int64_t) ib * ld + k, ld,
+				_work.data(), rest,
+				T(1), data + (int64_t) ib * ld + end, ld);
+		}
+	}
+
+	for (int32_t i = 0; i < n; ++i) {
+		T* row = data + (int64_t) i * ld;
+		for (int32_t j = i + 1; j < n; ++j) {
+			row[j] = 0;
+		}
+	}
+
+	if (_type == CHOLESKY_LLT) {
+		// L * D * L^T = (L * sqrt(D)) * (L * sqrt(D))^T
+		std::vector<T> root(n);
+		for (int32_t j = 0; j < n; ++j) {
+			root[j] = std::sqrt(data[(int64_t) j * ld + j]);
+		}
+		for (int32_t i = 0; i < n; ++i) {
+			T* row = data + (int64_t) i * ld;
+			for (int32_t j = 0; j < i; ++j) {
+				row[j] *= root[j];
+			}
+			row[i] = root[i];
+		}
+	}
+}
+
+template <class T>
+CholeskyType CholeskyFactorization<T>::type() const {
+	return _type;
+}
+
+template <class T>
+int32_t CholeskyFactorization<T>::size() const {
+	return _L.rows();
+}
+
+template <class T>
+bool CholeskyFactorization<T>::success() const {
+	return _success;
+}
+
+template <class T>
+void CholeskyFactorization<T>::solve(const Matrix<T>& b, Matrix<T>& x) const {
+	if (&x != &b) {
+		x = b;
+	}
+	solveInPlace(x);
+}
+
+template <class T>
+void CholeskyFactorization<T>::solveInPlace(Matrix<T>& b) const {
+	assert(b.rows() == size());
+
+	const int32_t n = size();
+	const int32_t k = b.cols();
+	const int32_t ldb = b.ld();
+	const bool unit = (_type == CHOLESKY_LDLT);
+	T* data = b.data();
+
+	// L * y = b
+	MatrixKernels::trsmLower(n, k, _L.data(), _L.ld(), unit, data, ldb);
+
+	// D * z = y
+	if (unit) {
+		for (int32_t i = 0; i < n; ++i) {
+			T* row = data + (int64_t) i * ldb;
+			MatrixKernels::vectorScale(k, row, T(1) / _L(i, i), row);
+		}
+	}
+
+	// L^T * x = z, going up the rows of L
+	for (int32_t i = n - 1; i >= 0; --i) {
+		T* row = data + (int64_t) i * ldb;
+		if (!unit) {
+			MatrixKernels::vectorScale(k, row, T(1) / _L(i, i), row);
+		}
+		for (int32_t p = 0; p < i; ++p) {
+			T l = _L(i, p);
+			if (l != T(0)) {
+				MatrixKernels::vectorAxpy(k, -l, row, data + (int64_t) p * ldb);
+			}
+		}
+	}
+}
+
+template <class T>
+void CholeskyFactorization<T>::inverse(Matrix<T>& dest) const {
+	assert(dest.rows() == size());
+	assert(dest.cols() == size());
+
+	dest.identity();
+	solveInPlace(dest);
+}
+
+template <class T>
+T CholeskyFactorization<T>::logDeterminant() const {
+	T logDet = 0;
+	for (int32_t i = 0; i < size(); ++i) {
+		logDet += std::log(std::abs(_L(i, i)));
+	}
+	return (_type == CHOLESKY_LLT) ? 2 * logDet : logDet;
+}
+
+template <class T>
+const Matrix<T>& CholeskyFactorization<T>::packed() const {
+	return _L;
+}
+
+} // namespace Alectryon
+
+#endif /* _CHOLESKY_FACTORIZATION_HPP */
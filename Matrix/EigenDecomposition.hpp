@@ -0,0 +1,540 @@
+#ifndef _EIGEN_DECOMPOSITION_HPP
+#define _EIGEN_DECOMPOSITION_HPP
+
+/**
+ * Eigendecomposition of symmetric matrices, A = V * diag(values) * V^T
+ * A is reduced to tridiagonal form with Householder reflectors, then the
+ * tridiagonal matrix is diagonalized with implicitly shifted QL.
+ * When only the top few eigenvectors are wanted (PCA), they are found by
+ * inverse iteration on the tridiagonal matrix instead, which skips
+ * accumulating the O(n^3) rotations.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class EigenDecomposition {
+public:
+	/**
+	 * @brief pass as vectors to compute every eigenvector
+	 */
+	static const int32_t AllVectors = -1;
+
+	/**
+	 * @brief Decomposes the symmetric matrix A
+	 * @details only the lower triangle of A is read.
+	 * vectors is how many eigenvectors to compute, for the largest eigenvalues.
+	 * 0 computes eigenvalues only
+	 */
+	explicit EigenDecomposition(const Matrix<T>& A, int32_t vectors = AllVectors);
+
+	/**
+	 * @brief Decomposes a new matrix
+	 */
+	void compute(const Matrix<T>& A, int32_t vectors = AllVectors);
+
+	/**
+	 * @brief returns number of rows (and columns) of the decomposed matrix
+	 */
+	int32_t size() const;
+
+	/**
+	 * @brief returns false if the QL iteration did not converge
+	 * @details values() and vectors() are undefined if it failed
+	 */
+	bool success() const;
+
+	/**
+	 * @brief returns the eigenvalues, size() x 1, largest first
+	 */
+	const Matrix<T>& values() const;
+
+	/**
+	 * @brief returns number of eigenvectors computed
+	 */
+	int32_t vectorCount() const;
+
+	/**
+	 * @brief returns the eigenvectors, size() x vectorCount()
+	 * @details column j is the unit eigenvector for values()(j, 0).
+	 * vectorCount() must not be 0
+	 */
+	const Matrix<T>& vectors() const;
+
+private:
+	Matrix<T> _values;
+	Matrix<T> _vectors;
+	int32_t _vectorCount;
+	bool _success;
+
+	// A reduced in place: Householder vectors below the subdiagonal
+	Matrix<T> _work;
+	std::vector<T> _tau;
+	// diagonal and subdiagonal of the tridiagonal matrix
+	std::vector<T> _diag;
+	std::vector<T> _sub;
+
+	/**
+	 * @brief reduces _work to tridiagonal form Q^T * A * Q
+	 */
+	void tridiagonalize();
+
+	/**
+	 * @brief diagonalizes the tridiagonal matrix with implicit QL
+	 * @details if Zt isn't nullptr, its rows are rotated along, so row j ends
+	 * as the eigenvector of the tridiagonal matrix for _diag[j]
+	 */
+	bool diagonalize(std::vector<T>& diag, std::vector<T>& sub, Matrix<T>* Zt);
+
+	/**
+	 * @brief computes Z(:, c) for eigenvalue values[c] of the tridiagonal
+	 * matrix with inverse iteration
+	 * @details values are sorted largest first
+	 */
+	void inverseIteration(const std::vector<T>& values, Matrix<T>& Z) const;
+
+	/**
+	 * @brief computes Z = Q * Z with the reflectors from tridiagonalize()
+	 */
+	void backTransform(Matrix<T>& Z) const;
+};
+
+template <class T>
+EigenDecomposition<T>::EigenDecomposition(const Matrix<T>& A, int32_t vectors) :
+	_values(A.rows(), 1), _vectors(A.rows(), 1), _vectorCount(0), _success(false),
+	_work(A.rows(), A.cols()) {
+	assert(A.rows() == A.cols());
+	compute(A, vectors);
+}
+
+template <class T>
+void EigenDecomposition<T>::compute(const Matrix<T>& A, int32_t vectors) {
+	assert(A.rows() == A.cols());
+	const int32_t n = A.rows();
+	if (vectors < 0 || vectors > n) {
+		vectors = n;
+	}
+
+	_work = A;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = i + 1; j < n; ++j) {
+			_work(i, j) = _work(j, i);
+		}
+	}
+	tridiagonalize();
+
+	std::vector<T> diag = _diag;
+	std::vector<T> sub = _sub;
+	Matrix<T> Zt(vectors == n ? n : 1, n);
+	if (vectors == n) {
+		Zt.fill(T(0));
+		for (int32_t i = 0; i < n; ++i) {
+			Zt(i, i) = T(1);
+		}
+	}
+	_vectorCount = 0;
+	_success = diagonalize(diag, sub, vectors == n ? &Zt : nullptr);
+	if (!_success) {
+		return;
+	}
+
+	std::vector<int32_t> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) { return diag[a] > diag[b]; });
+
+	_values = Matrix<T>(n, 1);
+	std::vector<T> sorted(n);
+	for (int32_t i = 0; i < n; ++i) {
+		sorted[i] = diag[order[i]];
+		_values(i, 0) = sorted[i];
+	}
+
+	if (vectors == 0) {
+		return;
+	}
+
+	_vectorCount = vectors;
+	_vectors = Matrix<T>(n, vectors);
+	if (vectors == n) {
+		for (int32_t c = 0; c < vectors; ++c) {
+			const T* row = Zt.data() + (int64_t) order[c] * Zt.ld();
+			for (int32_t i = 0; i < n; ++i) {
+				_vectors(i, c) = row[i];
+			}
+		}
+	} else {
+		sorted.resize(vectors);
+		inverseIteration(sorted, _vectors);
+	}
+	backTransform(_vectors);
+}
+
+template <class T>
+int32_t EigenDecomposition<T>::size() const {
+	return _values.rows();
+}
+
+template <class T>
+bool EigenDecomposition<T>::success() const {
+	return _success;
+}
+
+template <class T>
+const Matrix<T>& EigenDecomposition<T>::values() const {
+	return _values;
+}
+
+template <class T>
+int32_t EigenDecomposition<T>::vectorCount() const {
+	return _vectorCount;
+}
+
+template <class T>
+const Matrix<T>& EigenDecomposition<T>::vectors() const {
+	assert(_vectorCount > 0);
+	return _vectors;
+}
+
+template <class T>
+void EigenDecomposition<T>::tridiagonalize() {
+	const int32_t n = _work.rows();
+	const int32_t ld = _work.ld();
+	T* data = _work.data();
+	_diag.assign(n, T(0));
+	_sub.assign(n > 1 ? n - 1 : 0, T(0));
+	_tau.assign(n > 2 ? n - 2 : 0, T(0));
+	std::vector<T> v(n);
+	std::vector<T> w(n);
+
+	for (int32_t k = 0; k + 2 < n; ++k) {
+		// reflector zeroing A(k + 2 :, k)
+		const int32_t m = n - k - 1;
+		T alpha = data[(int64_t) (k + 1) * ld + k];
+		T norm2 = 0;
+		for (int32_t i = k + 2; i < n; ++i) {
+			T value = data[(int64_t) i * ld + k];
+			norm2 += value * value;
+		}
+		_diag[k] = data[(int64_t) k * ld + k];
+		if (norm2 == T(0)) {
+			_sub[k] = alpha;
+			continue;
+		}
+
+		T beta = std::sqrt(alpha * alpha + norm2);
+		beta = (alpha > T(0)) ? -beta : beta;
+		T tau = (beta - alpha) / beta;
+		T scale = T(1) / (alpha - beta);
+		v[0] = T(1);
+		for (int32_t i = k + 2; i < n; ++i) {
+			T& value = data[(int64_t) i * ld + k];
+			value *= scale;
+			v[i - k - 1] = value;
+		}
+		_sub[k] = beta;
+		_tau[k] = tau;
+
+		// p = tau * A22 * v, then w = p - (tau / 2) * (p^T v) * v
+		T* A22 = data + (int64_t) (k + 1) * ld + k + 1;
+		MatrixParallel::run(0, m, (int64_t) m * m, [&](int64_t lo, int64_t hi) {
+			for (int64_t i = lo; i < hi; ++i) {
+				const T* row = A22 + i * ld;
+				T sum = 0;
+				for (int32_t j = 0; j < m; ++j) {
+					sum += row[j] * v[j];
+				}
+				w[i] = tau * sum;
+			}
+		}, 16);
+		T dot = 0;
+		for (int32_t i = 0; i < m; ++i) {
+			dot += w[i] * v[i];
+		}
+		T K = T(0.5) * tau * dot;
+		for (int32_t i = 0; i < m; ++i) {
+			w[i] -= K * v[i];
+		}
+
+		// A22 -= v * w^T + w * v^T
+		MatrixParallel::run(0, m, (int64_t) m * m, [&](int64_t lo, int64_t hi) {
+			for (int64_t i = lo; i < hi; ++i) {
+				T* row = A22 + i * ld;
+				MatrixKernels::vectorAxpy(m, -v[i], w.data(), row);
+				MatrixKernels::vectorAxpy(m, -w[i], v.data(), row);
+			}
+		}, 16);
+	}
+
+	if (n >= 2) {
+		_diag[n - 2] = data[(int64_t) (n - 2) * ld + n - 2];
+		_sub[n - 2] = data[(int64_t) (n - 1) * ld + n - 2];
+	}
+	if (n >= 1) {
+		_diag[n - 1] = data[(int64_t) (n - 1) * ld + n - 1];
+	}
+}
+
+template <class T>
+bool EigenDecomposition<T>::diagonalize(std::vector<T>& diag, std::vector<T>& sub, Matrix<T>* Zt) {
+	const int32_t n = (int32_t) diag.size();
+	const T eps = std::numeric_limits<T>::epsilon();
+	// sub[i] couples i and i + 1, with a zero at the end
+	std::vector<T> e(n, T(0));
+	std::copy(sub.begin(), sub.end(), e.begin());
+	std::vector<T> cosines(n);
+	std::vector<T> sines(n);
+
+	for (int32_t l = 0; l < n; ++l) {
+		int32_t iterations = 0;
+		int32_t m;
+		do {
+			// find a negligible subdiagonal element to split at
+			for (m = l; m < n - 1; ++m) {
+				T dd = std::fabs(diag[m]) + std::fabs(diag[m + 1]);
+				if (std::fabs(e[m]) <= eps * dd) {
+					break;
+				}
+			}
+			if (m == l) {
+				break;
+			}
+			if (iterations++ == 30) {
+				return false;
+			}
+
+			// Wilkinson shift from the leading 2 x 2 block
+			T g = (diag[l + 1] - diag[l]) / (T(2) * e[l]);
+			T r = std::hypot(g, T(1));
+			g = diag[m] - diag[l] + e[l] / (g + (g >= T(0) ? r : -r));
+			T s = 1;
+			T c = 1;
+			T p = 0;
+			int32_t i;
+			int32_t first = m;
+			for (i = m - 1; i >= l; --i) {
+				T f = s * e[i];
+				T b = c * e[i];
+				r = std::hypot(f, g);
+				e[i + 1] = r;
+				if (r == T(0)) {
+					// deflated early, the rotations so far still apply
+					diag[i + 1] -= p;
+					e[m] = 0;
+					break;
+				}
+				s = f / r;
+				c = g / r;
+				g = diag[i + 1] - p;
+				r = (diag[i] - g) * s + T(2) * c * b;
+				p = s * r;
+				diag[i + 1] = g + p;
+				g = c * r - b;
+				cosines[i] = c;
+				sines[i] = s;
+				first = i;
+			}
+
+			if (Zt != nullptr && first < m) {
+				// the sweep's rotations, applied to column chunks of Zt in parallel
+				T* z = Zt->data();
+				const int32_t ld = Zt->ld();
+				MatrixParallel::run(0, n, (int64_t) (m - first) * n * 6, [&](int64_t lo, int64_t hi) {
+					for (int32_t j = m - 1; j >= first; --j) {
+						T* row0 = z + (int64_t) j * ld;
+						T* row1 = row0 + ld;
+						T cj = cosines[j];
+						T sj = sines[j];
+						for (int64_t k = lo; k < hi; ++k) {
+							T f = row1[k];
+							row1[k] = sj * row0[k] + cj * f;
+							row0[k] = cj * row0[k] - sj * f;
+						}
+					}
+				}, 64);
+			}
+
+			if (r == T(0) && i >= l) {
+				continue;
+			}
+			diag[l] -= p;
+			e[l] = g;
+			e[m] = 0;
+		} while (m != l);
+	}
+	return true;
+}
+
+template <class T>
+void EigenDecomposition<T>::inverseIteration(const std::vector<T>& values, Matrix<T>& Z) const {
+	const int32_t n = (int32_t) _diag.size();
+	const int32_t k = (int32_t) values.size();
+	const T eps = std::numeric_limits<T>::epsilon();
+
+	T norm = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		T row = std::fabs(_diag[i]);
+		row += (i > 0) ? std::fabs(_sub[i - 1]) : T(0);
+		row += (i < n - 1) ? std::fabs(_sub[i]) : T(0);
+		norm = std::max(norm, row);
+	}
+	if (norm == T(0)) {
+		norm = T(1);
+	}
+	// eigenvalues closer than this get their vectors orthogonalized
+	const T clusterGap = T(1e-3) * norm;
+	const T tiny = eps * norm;
+
+	// LU of (T - lambda * I) with partial pivoting, U has two superdiagonals
+	std::vector<T> U0(n);
+	std::vector<T> U1(n);
+	std::vector<T> U2(n);
+	std::vector<T> L(n);
+	std::vector<char> swapped(n);
+	std::vector<T> x(n);
+
+	int32_t clusterStart = 0;
+	T shift = 0;
+	for (int32_t c = 0; c < k; ++c) {
+		T lambda = values[c];
+		if (c > 0 && values[c - 1] - lambda > clusterGap) {
+			clusterStart = c;
+		}
+		// equal eigenvalues would give the same vector back
+		if (c > 0 && shift - lambda < T(10) * eps * std::fabs(lambda)) {
+			lambda = shift - T(10) * eps * std::max(std::fabs(lambda), tiny);
+		}
+		shift = lambda;
+
+		T current = _diag[0] - lambda;
+		T currentUp = (n > 1) ? _sub[0] : T(0);
+		for (int32_t i = 0; i + 1 < n; ++i) {
+			T below = _sub[i];
+			T nextDiag = _diag[i + 1] - lambda;
+			T nextUp = (i + 2 < n) ? _sub[i + 1] : T(0);
+			if (std::fabs(current) >= std::fabs(below)) {
+				swapped[i] = 0;
+				if (current == T(0)) {
+					current = tiny;
+				}
+				L[i] = below / current;
+				U0[i] = current;
+				U1[i] = currentUp;
+				U2[i] = 0;
+				current = nextDiag - L[i] * currentUp;
+				currentUp = nextUp;
+			} else {
+				swapped[i] = 1;
+				L[i] = current / below;
+				U0[i] = below;
+				U1[i] = nextDiag;
+				U2[i] = nextUp;
+				current = currentUp - L[i] * nextDiag;
+				currentUp = -L[i] * nextUp;
+			}
+		}
+		U0[n - 1] = (std::fabs(current) < tiny) ? tiny : current;
+
+		// deterministic start that is unlikely to be orthogonal to the answer
+		uint32_t seed = 12345u + 977u * (uint32_t) c;
+		for (int32_t i = 0; i < n; ++i) {
+			seed = seed * 1664525u + 1013904223u;
+			x[i] = T(1) + (T) (seed >> 8) / (T) (1u << 24);
+		}
+
+		for (int32_t iteration = 0; iteration < 4; ++iteration) {
+			for (int32_t i = 0; i + 1 < n; ++i) {
+				if (swapped[i]) {
+					std::swap(x[i], x[i + 1]);
+				}
+				x[i + 1] -= L[i] * x[i];
+			}
+			for (int32_t i = n - 1; i >= 0; --i) {
+				T sum = x[i];
+				if (i + 1 < n) {
+					sum -= U1[i] * x[i + 1];
+				}
+				if (i + 2 < n) {
+					sum -= U2[i] * x[i + 2];
+				}
+				T pivot = (std::fabs(U0[i]) < tiny) ? tiny : U0[i];
+				x[i] = sum / pivot;
+			}
+
+			for (int32_t p = clusterStart; p < c; ++p) {
+				T dot = 0;
+				for (int32_t i = 0; i < n; ++i) {
+					dot += x[i] * Z(i, p);
+				}
+				for (int32_t i = 0; i < n; ++i) {
+					x[i] -= dot * Z(i, p);
+				}
+			}
+
+			T largest = 0;
+			for (int32_t i = 0; i < n; ++i) {
+				largest = std::max(largest, std::fabs(x[i]));
+			}
+			T sum = 0;
+			for (int32_t i = 0; i < n; ++i) {
+				x[i] /= largest;
+				sum += x[i] * x[i];
+			}
+			T scale = T(1) / std::sqrt(sum);
+			for (int32_t i = 0; i < n; ++i) {
+				x[i] *= scale;
+			}
+		}
+
+		for (int32_t i = 0; i < n; ++i) {
+			Z(i, c) = x[i];
+		}
+	}
+}
+
+template <class T>
+void EigenDecomposition<T>::backTransform(Matrix<T>& Z) const {
+	const int32_t n = _work.rows();
+	const int32_t k = Z.cols();
+	const int32_t ld = _work.ld();
+	const T* data = _work.data();
+	std::vector<T> v(n);
+
+	// Q = H_0 * H_1 * ... so the last reflector is applied first
+	for (int32_t r = (int32_t) _tau.size() - 1; r >= 0; --r) {
+		T tau = _tau[r];
+		if (tau == T(0)) {
+			continue;
+		}
+		const int32_t m = n - r - 1;
+		v[0] = T(1);
+		for (int32_t i = 1; i < m; ++i) {
+			v[i] = data[(int64_t) (r + 1 + i) * ld + r];
+		}
+
+		// Z(r + 1 :, :) -= tau * v * (v^T * Z(r + 1 :, :)), in column chunks
+		T* rows = Z.data() + (int64_t) (r + 1) * Z.ld();
+		const int32_t ldz = Z.ld();
+		MatrixParallel::run(0, k, (int64_t) m * k * 4, [&](int64_t lo, int64_t hi) {
+			std::vector<T> w(hi - lo, T(0));
+			for (int32_t i = 0; i < m; ++i) {
+				MatrixKernels::vectorAxpy(hi - lo, v[i], rows + (int64_t) i * ldz + lo, w.data());
+			}
+			for (int32_t i = 0; i < m; ++i) {
+				MatrixKernels::vectorAxpy(hi - lo, -tau * v[i], w.data(), rows + (int64_t) i * ldz + lo);
+			}
+		}, 16);
+	}
+}
+
+} // namespace Alectryon
+
+#endif /* _EIGEN_DECOMPOSITION_HPP */
@@ -0,0 +1,530 @@
+#ifndef _FIXED_MATRIX_HPP
+#define _FIXED_MATRIX_HPP
+
+/**
+ * Statically sized matrix for small problems (2x2 up to about 12x12)
+ * Storage is inline, sizes are checked at compile time and every
+ * operation has constant trip counts, so the compiler unrolls it.
+ * Operations are constexpr and can be used in constant expressions.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+/**
+ * @brief true if every type in Args converts to T
+ */
+template <class T, class... Args>
+struct FixedMatrixConvertible : std::true_type { };
+
+template <class T, class A, class... Args>
+struct FixedMatrixConvertible<T, A, Args...> :
+	std::integral_constant<bool, std::is_convertible<A, T>::value &&
+		FixedMatrixConvertible<T, Args...>::value> { };
+
+template <class T, int32_t R, int32_t C>
+class FixedMatrix {
+	static_assert(R > 0 && C > 0, "FixedMatrix dimensions must be > 0");
+
+private:
+	T _data[R * C];
+
+public:
+	///////////////////////////////////
+	// CONSTRUCTORS
+	///////////////////////////////////
+
+	/**
+	 * @brief Constructs a matrix of zeros
+	 */
+	constexpr FixedMatrix() : _data{} { }
+
+	/**
+	 * @brief Constructs from R * C values in row first format
+	 * @details passing the wrong number of values does not compile
+	 * Ex: FixedMatrix<double, 2, 2> A(1, 2,
+	 *                                 3, 4);
+	 */
+	template <class... Args, class = typename std::enable_if<
+		sizeof...(Args) == R * C && FixedMatrixConvertible<T, Args...>::value>::type>
+	constexpr FixedMatrix(Args... values) : _data{ T(values)... } { }
+
+	/**
+	 * @brief Copies a dynamically sized matrix
+	 * @details mat must be R x C
+	 */
+	explicit FixedMatrix(const Matrix<T>& mat) : _data{} {
+		assert(mat.rows() == R);
+		assert(mat.cols() == C);
+		for (int32_t i = 0; i < R; ++i) {
+			for (int32_t j = 0; j < C; ++j) {
+				(*this)(i, j) = mat(i, j);
+			}
+		}
+	}
+
+	/**
+	 * @brief returns an identity matrix, must be square
+	 */
+	static constexpr FixedMatrix<T, R, C> identity() {
+		static_assert(R == C, "identity() needs a square matrix");
+		FixedMatrix<T, R, C> ret;
+		for (int32_t i = 0; i < R; ++i) {
+			ret(i, i) = 1;
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief returns a matrix with every element set to value
+	 */
+	static constexpr FixedMatrix<T, R, C> filled(T value) {
+		FixedMatrix<T, R, C> ret;
+		ret.fill(value);
+		return ret;
+	}
+
+	/**
+	 * @brief copies into a dynamically sized matrix
+	 */
+	Matrix<T> toMatrix() const {
+		Matrix<T> ret(R, C);
+		for (int32_t i = 0; i < R; ++i) {
+			for (int32_t j = 0; j < C; ++j) {
+				ret(i, j) = (*this)(i, j);
+			}
+		}
+		return ret;
+	}
+
+	///////////////////////////////////
+	// BASIC AND ARITHMATIC OPERATIONS
+	///////////////////////////////////
+
+	static constexpr int32_t rows() { return R; }
+	static constexpr int32_t cols() { return C; }
+
+	/**
+	 * @brief gets reference to an element
+	 */
+	constexpr T& operator()(int32_t row, int32_t col) {
+		return _data[row * C + col];
+	}
+
+	/**
+	 * @brief gets copy of an element
+	 */
+	constexpr T operator()(int32_t row, int32_t col) const {
+		return _data[row * C + col];
+	}
+
+	/**
+	 * @brief returns pointer to the row first data
+	 */
+	constexpr T* data() { return _data; }
+	constexpr const T* data() const { return _data; }
+
+	constexpr void fill(T value) {
+		for (int32_t i = 0; i < R * C; ++i) {
+			_data[i] = value;
+		}
+	}
+
+	constexpr bool operator==(const FixedMatrix<T, R, C>& other) const {
+		for (int32_t i = 0; i < R * C; ++i) {
+			if (_data[i] != other._data[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr bool operator!=(const FixedMatrix<T, R, C>& other) const {
+		return !(*this == other);
+	}
+
+	constexpr FixedMatrix<T, R, C>& operator+=(const FixedMatrix<T, R, C>& A) {
+		for (int32_t i = 0; i < R * C; ++i) {
+			_data[i] += A._data[i];
+		}
+		return *this;
+	}
+
+	constexpr FixedMatrix<T, R, C>& operator-=(const FixedMatrix<T, R, C>& A) {
+		for (int32_t i = 0; i < R * C; ++i) {
+			_data[i] -= A._data[i];
+		}
+		return *this;
+	}
+
+	constexpr FixedMatrix<T, R, C>& operator+=(T scalar) {
+		for (int32_t i = 0; i < R * C; ++i) {
+			_data[i] += scalar;
+		}
+		return *this;
+	}
+
+	constexpr FixedMatrix<T, R, C>& operator-=(T scalar) {
+		return *this += -scalar;
+	}
+
+	constexpr FixedMatrix<T, R, C>& operator*=(T scalar) {
+		for (int32_t i = 0; i < R * C; ++i) {
+			_data[i] *= scalar;
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief right multiplies by a square matrix: *this = *this * A
+	 */
+	constexpr FixedMatrix<T, R, C>& operator*=(const FixedMatrix<T, C, C>& A) {
+		*this = *this * A;
+		return *this;
+	}
+
+	///////////////////////////////////
+	// MATRIX OPERATIONS
+	///////////////////////////////////
+
+	constexpr FixedMatrix<T, C, R> transpose() const {
+		FixedMatrix<T, C, R> ret;
+		for (int32_t i = 0; i < R; ++i) {
+			for (int32_t j = 0; j < C; ++j) {
+				ret(j, i) = (*this)(i, j);
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief returns the determinant, must be square
+	 * @details closed form up to 4x4, LU with partial pivoting above
+	 */
+	constexpr T determinant() const;
+
+	/**
+	 * @brief returns the inverse, must be square
+	 * @details closed form up to 4x4, LU with partial pivoting above
+	 * NOTE: undefined behavior if matrix is singular
+	 */
+	constexpr FixedMatrix<T, R, C> inverse() const;
+
+	/**
+	 * @brief solves *this * x = b, must be square
+	 * @details LU with partial pivoting, b can have several columns
+	 * NOTE: undefined behavior if matrix is singular
+	 */
+	template <int32_t M>
+	constexpr FixedMatrix<T, R, M> solve(const FixedMatrix<T, R, M>& b) const;
+};
+
+///////////////////////////////////
+// OPERATORS
+///////////////////////////////////
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator+(FixedMatrix<T, R, C> A, const FixedMatrix<T, R, C>& B) {
+	return A += B;
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator-(FixedMatrix<T, R, C> A, const FixedMatrix<T, R, C>& B) {
+	return A -= B;
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator-(FixedMatrix<T, R, C> A) {
+	return A *= T(-1);
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator+(FixedMatrix<T, R, C> A, typename MatrixScalarArg<T>::type scalar) {
+	return A += scalar;
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator-(FixedMatrix<T, R, C> A, typename MatrixScalarArg<T>::type scalar) {
+	return A -= scalar;
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator*(FixedMatrix<T, R, C> A, typename MatrixScalarArg<T>::type scalar) {
+	return A *= scalar;
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> operator*(typename MatrixScalarArg<T>::type scalar, FixedMatrix<T, R, C> A) {
+	return A *= scalar;
+}
+
+/**
+ * @brief matrix product, inner dimensions are checked at compile time
+ */
+template <class T, int32_t R, int32_t K, int32_t C>
+constexpr FixedMatrix<T, R, C> operator*(const FixedMatrix<T, R, K>& A, const FixedMatrix<T, K, C>& B) {
+	FixedMatrix<T, R, C> ret;
+	for (int32_t i = 0; i < R; ++i) {
+		for (int32_t k = 0; k < K; ++k) {
+			T a = A(i, k);
+			for (int32_t j = 0; j < C; ++j) {
+				ret(i, j) += a * B(k, j);
+			}
+		}
+	}
+	return ret;
+}
+
+///////////////////////////////////
+// SQUARE MATRIX ROUTINES
+///////////////////////////////////
+
+namespace FixedMatrixDetail {
+
+template <class T>
+constexpr T abs(T value) {
+	return value < T(0) ? -value : value;
+}
+
+/**
+ * @brief in place LU decomposition with partial pivoting
+ * @details afterwards A holds U on and above the diagonal and the
+ * multipliers of L below it, perm[i] is the original row of row i.
+ * returns the sign of the permutation
+ */
+template <class T, int32_t N>
+constexpr T decompLU(FixedMatrix<T, N, N>& A, int32_t (&perm)[N]) {
+	T sign = 1;
+	for (int32_t i = 0; i < N; ++i) {
+		perm[i] = i;
+	}
+	for (int32_t k = 0; k < N; ++k) {
+		int32_t pivot = k;
+		for (int32_t i = k + 1; i < N; ++i) {
+			if (abs(A(i, k)) > abs(A(pivot, k))) {
+				pivot = i;
+			}
+		}
+		if (pivot != k) {
+			for (int32_t j = 0; j < N; ++j) {
+				T temp = A(k, j);
+				A(k, j) = A(pivot, j);
+				A(pivot, j) = temp;
+			}
+			int32_t temp = perm[k];
+			perm[k] = perm[pivot];
+			perm[pivot] = temp;
+			sign = -sign;
+		}
+		if (A(k, k) == T(0)) {
+			continue;
+		}
+		for (int32_t i = k + 1; i < N; ++i) {
+			T factor = A(i, k) / A(k, k);
+			A(i, k) = factor;
+			for (int32_t j = k + 1; j < N; ++j) {
+				A(i, j) -= factor * A(k, j);
+			}
+		}
+	}
+	return sign;
+}
+
+/**
+ * @brief solves A * x = b given the output of decompLU
+ */
+template <class T, int32_t N, int32_t M>
+constexpr FixedMatrix<T, N, M> solveLU(const FixedMatrix<T, N, N>& LU, const int32_t (&perm)[N],
+	const FixedMatrix<T, N, M>& b) {
+	FixedMatrix<T, N, M> x;
+	for (int32_t i = 0; i < N; ++i) {
+		for (int32_t j = 0; j < M; ++j) {
+			x(i, j) = b(perm[i], j);
+		}
+	}
+	// forward substitution with unit lower L
+	for (int32_t i = 1; i < N; ++i) {
+		for (int32_t k = 0; k < i; ++k) {
+			T l = LU(i, k);
+			for (int32_t j = 0; j < M; ++j) {
+				x(i, j) -= l * x(k, j);
+			}
+		}
+	}
+	// back substitution with U
+	for (int32_t i = N - 1; i >= 0; --i) {
+		for (int32_t k = i + 1; k < N; ++k) {
+			T u = LU(i, k);
+			for (int32_t j = 0; j < M; ++j) {
+				x(i, j) -= u * x(k, j);
+			}
+		}
+		T invDiag = T(1) / LU(i, i);
+		for (int32_t j = 0; j < M; ++j) {
+			x(i, j) *= invDiag;
+		}
+	}
+	return x;
+}
+
+template <class T, int32_t N>
+struct Square {
+	static constexpr T determinant(const FixedMatrix<T, N, N>& A) {
+		FixedMatrix<T, N, N> LU = A;
+		int32_t perm[N] = {};
+		T det = decompLU(LU, perm);
+		for (int32_t i = 0; i < N; ++i) {
+			det *= LU(i, i);
+		}
+		return det;
+	}
+
+	static constexpr FixedMatrix<T, N, N> inverse(const FixedMatrix<T, N, N>& A) {
+		FixedMatrix<T, N, N> LU = A;
+		int32_t perm[N] = {};
+		decompLU(LU, perm);
+		return solveLU(LU, perm, FixedMatrix<T, N, N>::identity());
+	}
+};
+
+template <class T>
+struct Square<T, 1> {
+	static constexpr T determinant(const FixedMatrix<T, 1, 1>& A) {
+		return A(0, 0);
+	}
+
+	static constexpr FixedMatrix<T, 1, 1> inverse(const FixedMatrix<T, 1, 1>& A) {
+		return FixedMatrix<T, 1, 1>(T(1) / A(0, 0));
+	}
+};
+
+template <class T>
+struct Square<T, 2> {
+	static constexpr T determinant(const FixedMatrix<T, 2, 2>& A) {
+		return A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0);
+	}
+
+	static constexpr FixedMatrix<T, 2, 2> inverse(const FixedMatrix<T, 2, 2>& A) {
+		T invDet = T(1) / determinant(A);
+		return FixedMatrix<T, 2, 2>(
+			A(1, 1) * invDet, -A(0, 1) * invDet,
+			-A(1, 0) * invDet, A(0, 0) * invDet);
+	}
+};
+
+template <class T>
+struct Square<T, 3> {
+	static constexpr T determinant(const FixedMatrix<T, 3, 3>& A) {
+		return A(0, 0) * (A(1, 1) * A(2, 2) - A(1, 2) * A(2, 1)) -
+			A(0, 1) * (A(1, 0) * A(2, 2) - A(1, 2) * A(2, 0)) +
+			A(0, 2) * (A(1, 0) * A(2, 1) - A(1, 1) * A(2, 0));
+	}
+
+	static constexpr FixedMatrix<T, 3, 3> inverse(const FixedMatrix<T, 3, 3>& A) {
+		// cofactors of the first row give the determinant
+		T c00 = A(1, 1) * A(2, 2) - A(1, 2) * A(2, 1);
+		T c01 = A(1, 2) * A(2, 0) - A(1, 0) * A(2, 2);
+		T c02 = A(1, 0) * A(2, 1) - A(1, 1) * A(2, 0);
+		T invDet = T(1) / (A(0, 0) * c00 + A(0, 1) * c01 + A(0, 2) * c02);
+		return FixedMatrix<T, 3, 3>(
+			c00 * invDet,
+			(A(0, 2) * A(2, 1) - A(0, 1) * A(2, 2)) * invDet,
+			(A(0, 1) * A(1, 2) - A(0, 2) * A(1, 1)) * invDet,
+			c01 * invDet,
+			(A(0, 0) * A(2, 2) - A(0, 2) * A(2, 0)) * invDet,
+			(A(0, 2) * A(1, 0) - A(0, 0) * A(1, 2)) * invDet,
+			c02 * invDet,
+			(A(0, 1) * A(2, 0) - A(0, 0) * A(2, 1)) * invDet,
+			(A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0)) * invDet);
+	}
+};
+
+template <class T>
+struct Square<T, 4> {
+	static constexpr T determinant(const FixedMatrix<T, 4, 4>& A) {
+		T s0 = A(0, 0) * A(1, 1) - A(1, 0) * A(0, 1);
+		T s1 = A(0, 0) * A(1, 2) - A(1, 0) * A(0, 2);
+		T s2 = A(0, 0) * A(1, 3) - A(1, 0) * A(0, 3);
+		T s3 = A(0, 1) * A(1, 2) - A(1, 1) * A(0, 2);
+		T s4 = A(0, 1) * A(1, 3) - A(1, 1) * A(0, 3);
+		T s5 = A(0, 2) * A(1, 3) - A(1, 2) * A(0, 3);
+		T c0 = A(2, 0) * A(3, 1) - A(3, 0) * A(2, 1);
+		T c1 = A(2, 0) * A(3, 2) - A(3, 0) * A(2, 2);
+		T c2 = A(2, 0) * A(3, 3) - A(3, 0) * A(2, 3);
+		T c3 = A(2, 1) * A(3, 2) - A(3, 1) * A(2, 2);
+		T c4 = A(2, 1) * A(3, 3) - A(3, 1) * A(2, 3);
+		T c5 = A(2, 2) * A(3, 3) - A(3, 2) * A(2, 3);
+		return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	}
+
+	static constexpr FixedMatrix<T, 4, 4> inverse(const FixedMatrix<T, 4, 4>& A) {
+		// 2x2 minors of the top two rows (s) and bottom two rows (c)
+		T s0 = A(0, 0) * A(1, 1) - A(1, 0) * A(0, 1);
+		T s1 = A(0, 0) * A(1, 2) - A(1, 0) * A(0, 2);
+		T s2 = A(0, 0) * A(1, 3) - A(1, 0) * A(0, 3);
+		T s3 = A(0, 1) * A(1, 2) - A(1, 1) * A(0, 2);
+		T s4 = A(0, 1) * A(1, 3) - A(1, 1) * A(0, 3);
+		T s5 = A(0, 2) * A(1, 3) - A(1, 2) * A(0, 3);
+
+		T c0 = A(2, 0) * A(3, 1) - A(3, 0) * A(2, 1);
+		T c1 = A(2, 0) * A(3, 2) - A(3, 0) * A(2, 2);
+		T c2 = A(2, 0) * A(3, 3) - A(3, 0) * A(2, 3);
+		T c3 = A(2, 1) * A(3, 2) - A(3, 1) * A(2, 2);
+		T c4 = A(2, 1) * A(3, 3) - A(3, 1) * A(2, 3);
+		T c5 = A(2, 2) * A(3, 3) - A(3, 2) * A(2, 3);
+
+		T invDet = T(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+		return FixedMatrix<T, 4, 4>(
+			(A(1, 1) * c5 - A(1, 2) * c4 + A(1, 3) * c3) * invDet,
+			(-A(0, 1) * c5 + A(0, 2) * c4 - A(0, 3) * c3) * invDet,
+			(A(3, 1) * s5 - A(3, 2) * s4 + A(3, 3) * s3) * invDet,
+			(-A(2, 1) * s5 + A(2, 2) * s4 - A(2, 3) * s3) * invDet,
+
+			(-A(1, 0) * c5 + A(1, 2) * c2 - A(1, 3) * c1) * invDet,
+			(A(0, 0) * c5 - A(0, 2) * c2 + A(0, 3) * c1) * invDet,
+			(-A(3, 0) * s5 + A(3, 2) * s2 - A(3, 3) * s1) * invDet,
+			(A(2, 0) * s5 - A(2, 2) * s2 + A(2, 3) * s1) * invDet,
+
+			(A(1, 0) * c4 - A(1, 1) * c2 + A(1, 3) * c0) * invDet,
+			(-A(0, 0) * c4 + A(0, 1) * c2 - A(0, 3) * c0) * invDet,
+			(A(3, 0) * s4 - A(3, 1) * s2 + A(3, 3) * s0) * invDet,
+			(-A(2, 0) * s4 + A(2, 1) * s2 - A(2, 3) * s0) * invDet,
+
+			(-A(1, 0) * c3 + A(1, 1) * c1 - A(1, 2) * c0) * invDet,
+			(A(0, 0) * c3 - A(0, 1) * c1 + A(0, 2) * c0) * invDet,
+			(-A(3, 0) * s3 + A(3, 1) * s1 - A(3, 2) * s0) * invDet,
+			(A(2, 0) * s3 - A(2, 1) * s1 + A(2, 2) * s0) * invDet);
+	}
+};
+
+} // namespace FixedMatrixDetail
+
+template <class T, int32_t R, int32_t C>
+constexpr T FixedMatrix<T, R, C>::determinant() const {
+	static_assert(R == C, "determinant() needs a square matrix");
+	return FixedMatrixDetail::Square<T, R>::determinant(*this);
+}
+
+template <class T, int32_t R, int32_t C>
+constexpr FixedMatrix<T, R, C> FixedMatrix<T, R, C>::inverse() const {
+	static_assert(R == C, "inverse() needs a square matrix");
+	return FixedMatrixDetail::Square<T, R>::inverse(*this);
+}
+
+template <class T, int32_t R, int32_t C>
+template <int32_t M>
+constexpr FixedMatrix<T, R, M> FixedMatrix<T, R, C>::solve(const FixedMatrix<T, R, M>& b) const {
+	static_assert(R == C, "solve() needs a square matrix");
+	FixedMatrix<T, R, R> LU = *this;
+	int32_t perm[R] = {};
+	FixedMatrixDetail::decompLU(LU, perm);
+	return FixedMatrixDetail::solveLU(LU, perm, b);
+}
+
+} // namespace Alectryon
+
+#endif /* _FIXED_MATRIX_HPP */
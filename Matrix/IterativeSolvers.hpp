@@ -0,0 +1,543 @@
+#ifndef _ITERATIVE_SOLVERS_HPP
+#define _ITERATIVE_SOLVERS_HPP
+
+/**
+ * Krylov solvers for large systems A * x = b: conjugate gradient for
+ * symmetric positive definite A, BiCGSTAB and restarted GMRES for
+ * general A. Each iteration costs one or two products with A, so sparse
+ * systems take O(nonzeros * iterations) instead of O(n^3).
+ *
+ * A can be a Matrix, a SparseMatrix, or any callable op(x, y) that stores
+ * A * x into y, both n x 1 matrices. b and x are n x 1, x holds the
+ * initial guess on entry.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+
+namespace Alectryon {
+
+/**
+ * @brief stopping criteria for the iterative solvers
+ */
+template <class T>
+struct SolverControl {
+	// stop once ||b - A * x|| <= tolerance * ||b||
+	T tolerance;
+	int32_t maxIterations;
+	// GMRES restarts after this many iterations
+	int32_t restart;
+
+	SolverControl(T tolerance = T(1.0e-8), int32_t maxIterations = 1000, int32_t restart = 30) :
+		tolerance(tolerance), maxIterations(maxIterations), restart(restart) { }
+};
+
+/**
+ * @brief returned by the iterative solvers
+ */
+template <class T>
+struct SolverResult {
+	bool converged;
+	int32_t iterations;
+	// last ||b - A * x|| / ||b||
+	T residual;
+	// residual after every iteration
+	std::vector<T> history;
+};
+
+/**
+ * @brief preconditioner that does nothing
+ */
+template <class T>
+class IdentityPreconditioner {
+public:
+	void apply(const Matrix<T>& r, Matrix<T>& z) const {
+		z = r;
+	}
+};
+
+/**
+ * @brief divides by the diagonal of A
+ * @details cheap and parallel friendly, helps when the rows are badly scaled
+ */
+template <class T>
+class JacobiPreconditioner {
+public:
+	explicit JacobiPreconditioner(const Matrix<T>& A);
+	explicit JacobiPreconditioner(const SparseMatrix<T>& A);
+
+	void apply(const Matrix<T>& r, Matrix<T>& z) const;
+
+private:
+	std::vector<T> _inverseDiagonal;
+};
+
+/**
+ * @brief incomplete LU factorization with no fill in
+ * @details L and U keep the sparsity pattern of A, so it costs about one
+ * product with A to apply. every diagonal element of A must be stored
+ */
+template <class T>
+class ILU0Preconditioner {
+public:
+	explicit ILU0Preconditioner(const SparseMatrix<T>& A);
+
+	void apply(const Matrix<T>& r, Matrix<T>& z) const;
+
+	/**
+	 * @brief returns L (unit diagonal, not stored) and U packed in CSR
+	 */
+	const SparseMatrix<T>& packed() const;
+
+private:
+	SparseMatrix<T> _LU;
+};
+
+/**
+ * @brief preconditioned conjugate gradient
+ * @details A and M must be symmetric positive definite
+ */
+template <class T, class Op, class Precond>
+SolverResult<T> conjugateGradient(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const Precond& M, const SolverControl<T>& control = SolverControl<T>());
+
+template <class T, class Op>
+SolverResult<T> conjugateGradient(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const SolverControl<T>& control = SolverControl<T>());
+
+/**
+ * @brief right preconditioned BiCGSTAB
+ * @details two products with A per iteration, constant memory
+ */
+template <class T, class Op, class Precond>
+SolverResult<T> biCGStab(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const Precond& M, const SolverControl<T>& control = SolverControl<T>());
+
+template <class T, class Op>
+SolverResult<T> biCGStab(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const SolverControl<T>& control = SolverControl<T>());
+
+/**
+ * @brief right preconditioned GMRES, restarted every control.restart iterations
+ * @details keeps control.restart + 1 basis vectors. the residual never grows
+ */
+template <class T, class Op, class Precond>
+SolverResult<T> gmres(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const Precond& M, const SolverControl<T>& control = SolverControl<T>());
+
+template <class T, class Op>
+SolverResult<T> gmres(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+	const SolverControl<T>& control = SolverControl<T>());
+
+namespace IterativeDetail {
+
+template <class T>
+void applyOperator(const Matrix<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+	Matrix<T>::multiply(y, A, x);
+}
+
+template <class T>
+void applyOperator(const SparseMatrix<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+	SparseMatrix<T>::multiply(y, A, x);
+}
+
+template <class Op, class T>
+void applyOperator(const Op& A, const Matrix<T>& x, Matrix<T>& y) {
+	A(x, y);
+}
+
+template <class T>
+T dot(const Matrix<T>& x, const Matrix<T>& y) {
+	const T* a = x.data();
+	const T* b = y.data();
+	T sum = 0;
+	for (int32_t i = 0; i < x.rows(); ++i) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+template <class T>
+T norm(const Matrix<T>& x) {
+	return std::sqrt(dot(x, x));
+}
+
+/**
+ * @brief y += alpha * x
+ */
+template <class T>
+void axpy(T alpha, const Matrix<T>& x, Matrix<T>& y) {
+	MatrixKernels::vectorAxpy(x.rows(), alpha, x.data(), y.data());
+}
+
+/**
+ * @brief r = b - A * x, returns ||r||
+ */
+template <class T, class Op>
+T residual(const Op& A, const Matrix<T>& b, const Matrix<T>& x, Matrix<T>& r) {
+	applyOperator(A, x, r);
+	MatrixKernels::vectorSubtract(b.rows(), b.data(), r.data(), r.data());
+	return norm(r);
+}
+
+/**
+ * @brief records the relative residual, returns true once it is small enough
+ */
+template <class T>
+bool record(SolverResult<T>& result, T relative, const SolverControl<T>& control) {
+	result.residual = relative;
+	result.history.push_back(relative);
+	result.converged = relative <= control.tolerance;
+	return result.converged;
+}
+
+/**
+ * @brief checks the sizes and starts a result, returns ||b||
+ */
+template <class T>
+T start(const Matrix<T>& b, Matrix<T>& x, SolverResult<T>& result) {
+	assert(b.cols() == 1);
+	assert(x.rows() == b.rows());
+	assert(x.cols() == 1);
+
+	result.converged = false;
+	result.iterations = 0;
+	result.residual = 0;
+	T normB = norm(b);
+	if (normB == T(0)) {
+		// the solution of A * x = 0
+		x.fill(0);
+		result.converged = true;
+	}
+	return normB;
+}
+
+} // namespace IterativeDetail
+
+template <class T>
+JacobiPreconditioner<T>::JacobiPreconditioner(const Matrix<T>& A) :
+	_inverseDiagonal(A.rows()) {
+	assert(A.rows() == A.cols());
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		assert(A(i, i) != T(0));
+		_inverseDiagonal[i] = T(1) / A(i, i);
+	}
+}
+
+template <class T>
+JacobiPreconditioner<T>::JacobiPreconditioner(const SparseMatrix<T>& A) :
+	_inverseDiagonal(A.rows()) {
+	assert(A.rows() == A.cols());
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		T diag = A.coeff(i, i);
+		assert(diag != T(0));
+		_inverseDiagonal[i] = T(1) / diag;
+	}
+}
+
+template <class T>
+void JacobiPreconditioner<T>::apply(const Matrix<T>& r, Matrix<T>& z) const {
+	assert(r.rows() == (int32_t) _inverseDiagonal.size());
+	const T* in = r.data();
+	T* out = z.data();
+	for (int32_t i = 0; i < r.rows(); ++i) {
+		out[i] = in[i] * _inverseDiagonal[i];
+	}
+}
+
+template <class T>
+ILU0Preconditioner<T>::ILU0Preconditioner(const SparseMatrix<T>& A) :
+	_LU(A.rows(), A.cols()) {
+	assert(A.rows() == A.cols());
+	SparseMatrix<T>::convert(_LU, A, SPARSE_CSR);
+
+	const int32_t n = A.rows();
+	const std::vector<int64_t>& offsets = _LU.offsets();
+	const std::vector<int32_t>& indices = _LU.indices();
+	std::vector<T>& values = _LU.values();
+
+	std::vector<int64_t> diagonal(n, -1);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int64_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+			if (indices[p] == i) {
+				diagonal[i] = p;
+			}
+		}
+		assert(diagonal[i] >= 0);
+	}
+
+	// Gaussian elimination row by row, dropping everything outside the pattern
+	std::vector<int64_t> position(n, -1);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int64_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+			position[indices[p]] = p;
+		}
+		for (int64_t p = offsets[i]; p < offsets[i + 1] && indices[p] < i; ++p) {
+			int32_t k = indices[p];
+			T factor = values[p] / values[diagonal[k]];
+			values[p] = factor;
+			for (int64_t q = diagonal[k] + 1; q < offsets[k + 1]; ++q) {
+				int64_t target = position[indices[q]];
+				if (target >= 0) {
+					values[target] -= factor * values[q];
+				}
+			}
+		}
+		for (int64_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+			position[indices[p]] = -1;
+		}
+	}
+}
+
+template <class T>
+void ILU0Preconditioner<T>::apply(const Matrix<T>& r, Matrix<T>& z) const {
+	if (&z != &r) {
+		z = r;
+	}
+	_LU.solveLower(z, true);
+	_LU.solveUpper(z);
+}
+
+template <class T>
+const SparseMatrix<T>& ILU0Preconditioner<T>::packed() const {
+	return _LU;
+}
+
+template <class T, class Op, class Precond>
+SolverResult<T> conjugateGradient(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const Precond& M, const SolverControl<T>& control) {
+	using namespace IterativeDetail;
+
+	SolverResult<T> result;
+	T normB = start(b, x, result);
+	if (result.converged) {
+		return result;
+	}
+
+	const int32_t n = b.rows();
+	Matrix<T> r(n, 1), z(n, 1), p(n, 1), Ap(n, 1);
+	if (record(result, residual(A, b, x, r) / normB, control)) {
+		return result;
+	}
+	M.apply(r, z);
+	p = z;
+	T rz = dot(r, z);
+
+	while (result.iterations < control.maxIterations) {
+		applyOperator(A, p, Ap);
+		T pAp = dot(p, Ap);
+		if (pAp == T(0)) {
+			break;
+		}
+		T alpha = rz / pAp;
+		axpy(alpha, p, x);
+		axpy(-alpha, Ap, r);
+		++result.iterations;
+		if (record(result, norm(r) / normB, control)) {
+			break;
+		}
+
+		M.apply(r, z);
+		T rzNext = dot(r, z);
+		T beta = rzNext / rz;
+		rz = rzNext;
+
+		// p = z + beta * p
+		MatrixKernels::vectorScale(n, p.data(), beta, p.data());
+		axpy(T(1), z, p);
+	}
+	return result;
+}
+
+template <class T, class Op>
+SolverResult<T> conjugateGradient(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const SolverControl<T>& control) {
+	return conjugateGradient(A, b, x, IdentityPreconditioner<T>(), control);
+}
+
+template <class T, class Op, class Precond>
+SolverResult<T> biCGStab(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const Precond& M, const SolverControl<T>& control) {
+	using namespace IterativeDetail;
+
+	SolverResult<T> result;
+	T normB = start(b, x, result);
+	if (result.converged) {
+		return result;
+	}
+
+	const int32_t n = b.rows();
+	Matrix<T> r(n, 1), shadow(n, 1), p(n, 1), v(n, 1);
+	Matrix<T> pHat(n, 1), s(n, 1), sHat(n, 1), t(n, 1);
+	if (record(result, residual(A, b, x, r) / normB, control)) {
+		return result;
+	}
+	shadow = r;
+	p.fill(0);
+	v.fill(0);
+	T rho = 1, alpha = 1, omega = 1;
+
+	while (result.iterations < control.maxIterations) {
+		T rhoNext = dot(shadow, r);
+		if (rhoNext == T(0)) {
+			// breakdown, the shadow residual is orthogonal to r
+			break;
+		}
+		T beta = (rhoNext / rho) * (alpha / omega);
+		rho = rhoNext;
+
+		// p = r + beta * (p - omega * v)
+		axpy(-omega, v, p);
+		MatrixKernels::vectorScale(n, p.data(), beta, p.data());
+		axpy(T(1), r, p);
+
+		M.apply(p, pHat);
+		applyOperator(A, pHat, v);
+		alpha = rho / dot(shadow, v);
+
+		// s = r - alpha * v
+		s = r;
+		axpy(-alpha, v, s);
+		++result.iterations;
+		T normS = norm(s);
+		if (normS / normB <= control.tolerance) {
+			axpy(alpha, pHat, x);
+			record(result, normS / normB, control);
+			break;
+		}
+
+		M.apply(s, sHat);
+		applyOperator(A, sHat, t);
+		T tt = dot(t, t);
+		omega = (tt == T(0)) ? T(0) : dot(t, s) / tt;
+		axpy(alpha, pHat, x);
+		axpy(omega, sHat, x);
+
+		// r = s - omega * t
+		r = s;
+		axpy(-omega, t, r);
+		if (record(result, norm(r) / normB, control) || omega == T(0)) {
+			break;
+		}
+	}
+	return result;
+}
+
+template <class T, class Op>
+SolverResult<T> biCGStab(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const SolverControl<T>& control) {
+	return biCGStab(A, b, x, IdentityPreconditioner<T>(), control);
+}
+
+template <class T, class Op, class Precond>
+SolverResult<T> gmres(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const Precond& M, const SolverControl<T>& control) {
+	using namespace IterativeDetail;
+	assert(control.restart > 0);
+
+	SolverResult<T> result;
+	T normB = start(b, x, result);
+	if (result.converged) {
+		return result;
+	}
+
+	const int32_t n = b.rows();
+	const int32_t m = control.restart;
+	std::vector<Matrix<T>> basis(m + 1, Matrix<T>(n, 1));
+	Matrix<T> r(n, 1), z(n, 1);
+
+	// Hessenberg matrix reduced to upper triangular by Givens rotations
+	Matrix<T> H(m + 1, m);
+	std::vector<T> cosines(m), sines(m), g(m + 1), y(m);
+
+	T beta = residual(A, b, x, r);
+	if (record(result, beta / normB, control)) {
+		return result;
+	}
+
+	while (result.iterations < control.maxIterations) {
+		MatrixKernels::vectorScale(n, r.data(), T(1) / beta, basis[0].data());
+		std::fill(g.begin(), g.end(), T(0));
+		g[0] = beta;
+
+		int32_t k = 0;
+		while (k < m && result.iterations < control.maxIterations) {
+			// w = A * M^-1 * v_k, orthogonalized with modified Gram-Schmidt
+			Matrix<T>& w = basis[k + 1];
+			M.apply(basis[k], z);
+			applyOperator(A, z, w);
+			for (int32_t i = 0; i <= k; ++i) {
+				H(i, k) = dot(w, basis[i]);
+				axpy(-H(i, k), basis[i], w);
+			}
+			T normW = norm(w);
+			H(k + 1, k) = normW;
+			if (normW != T(0)) {
+				MatrixKernels::vectorScale(n, w.data(), T(1) / normW, w.data());
+			}
+
+			for (int32_t i = 0; i < k; ++i) {
+				T upper = H(i, k);
+				T lower = H(i + 1, k);
+				H(i, k) = cosines[i] * upper + sines[i] * lower;
+				H(i + 1, k) = -sines[i] * upper + cosines[i] * lower;
+			}
+			T radius = std::sqrt(H(k, k) * H(k, k) + H(k + 1, k) * H(k + 1, k));
+			cosines[k] = (radius == T(0)) ? T(1) : H(k, k) / radius;
+			sines[k] = (radius == T(0)) ? T(0) : H(k + 1, k) / radius;
+			H(k, k) = radius;
+			H(k + 1, k) = 0;
+			g[k + 1] = -sines[k] * g[k];
+			g[k] = cosines[k] * g[k];
+
+			++k;
+			++result.iterations;
+			if (record(result, std::abs(g[k]) / normB, control) || normW == T(0)) {
+				break;
+			}
+		}
+
+		// x += M^-1 * V * y with H * y = g
+		for (int32_t i = k - 1; i >= 0; --i) {
+			T sum = g[i];
+			for (int32_t j = i + 1; j < k; ++j) {
+				sum -= H(i, j) * y[j];
+			}
+			y[i] = (H(i, i) == T(0)) ? T(0) : sum / H(i, i);
+		}
+		r.fill(0);
+		for (int32_t i = 0; i < k; ++i) {
+			axpy(y[i], basis[i], r);
+		}
+		M.apply(r, z);
+		axpy(T(1), z, x);
+
+		if (result.converged) {
+			break;
+		}
+
+		// the rotated residual drifts from the true one, so restart from it
+		beta = residual(A, b, x, r);
+		result.residual = beta / normB;
+		result.converged = result.residual <= control.tolerance;
+		if (result.converged || beta == T(0)) {
+			break;
+		}
+	}
+	return result;
+}
+
+template <class T, class Op>
+SolverResult<T> gmres(const Op& A, const Matrix<T>& b, Matrix<T>& x,
+		const SolverControl<T>& control) {
+	return gmres(A, b, x, IdentityPreconditioner<T>(), control);
+}
+
+} // namespace Alectryon
+
+#endif /* _ITERATIVE_SOLVERS_HPP */
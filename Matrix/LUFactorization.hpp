@@ -0,0 +1,319 @@
+#ifndef _LU_FACTORIZATION_HPP
+#define _LU_FACTORIZATION_HPP
+
+/**
+ * LU factorization with partial pivoting, P * A = L * U
+ * Factor a matrix once, then solve against it as many times as needed
+ * for O(n^2) per right hand side instead of O(n^3).
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class LUFactorization {
+public:
+	/**
+	 * @brief columns factored at a time before the trailing matrix is
+	 * updated with one gemm
+	 */
+	static const int32_t BlockSize = 64;
+
+	/**
+	 * @brief Factors A
+	 * @details A must be square
+	 */
+	explicit LUFactorization(const Matrix<T>& A);
+
+	/**
+	 * @brief Factors A in place of a copy
+	 */
+	explicit LUFactorization(Matrix<T>&& A);
+
+	/**
+	 * @brief Factors a new matrix
+	 * @details storage is reused if A is the same size as the last one
+	 */
+	void factor(const Matrix<T>& A);
+
+	/**
+	 * @brief returns number of rows (and columns) of the factored matrix
+	 */
+	int32_t size() const;
+
+	/**
+	 * @brief returns true if a zero pivot was found
+	 * @details solve() and inverse() are undefined if the matrix is singular
+	 */
+	bool singular() const;
+
+	/**
+	 * @brief Solves A * x = b
+	 * @details b and x are size() x k, every column is a right hand side.
+	 * x can be the same matrix as b.
+	 * the triangular solves are blocked, so many columns run mostly in gemm
+	 */
+	void solve(const Matrix<T>& b, Matrix<T>& x) const;
+
+	/**
+	 * @brief Solves A * x = b, overwriting b with x
+	 */
+	void solveInPlace(Matrix<T>& b) const;
+
+	/**
+	 * @brief Solves A * x = b, overwriting the viewed elements of b with x
+	 */
+	void solveInPlace(const MatrixView<T>& b) const;
+
+	/**
+	 * @brief returns the determinant of A
+	 */
+	T determinant() const;
+
+	/**
+	 * @brief stores the inverse of A into dest
+	 */
+	void inverse(Matrix<T>& dest) const;
+
+	/**
+	 * @brief returns L and U packed into one matrix
+	 * @details U is on and above the diagonal, L is below it
+	 * (its diagonal of ones is not stored)
+	 */
+	const Matrix<T>& packed() const;
+
+	/**
+	 * @brief returns the row interchanges, LAPACK style
+	 * @details row i was swapped with row pivots()[i], in order from i = 0
+	 */
+	const std::vector<int32_t>& pivots() const;
+
+	/**
+	 * @brief factors the square A in place, packed as in packed()
+	 * @details for callers that provide their own storage, nothing is allocated.
+	 * pivots must hold A.rows() elements
+	 * @return false if a zero pivot was found
+	 */
+	static bool factorInPlace(const MatrixView<T>& A, int32_t* pivots);
+
+	/**
+	 * @brief Solves A * x = b against factors from factorInPlace(), overwriting b with x
+	 */
+	static void solveFactored(const ConstMatrixView<T>& LU, const int32_t* pivots, const MatrixView<T>& b);
+
+private:
+	Matrix<T> _LU;
+	std::vector<int32_t> _pivots;
+	bool _singular;
+
+	/**
+	 * @brief unblocked factorization of columns [col, col + width)
+	 * @details rows are swapped across the whole matrix
+	 * @return false if a zero pivot was found
+	 */
+	static bool factorPanel(const MatrixView<T>& A, int32_t* pivots, int32_t col, int32_t width);
+
+	/**
+	 * @brief factors _LU in place
+	 */
+	void decompose();
+
+	/**
+	 * @brief applies the row interchanges to b
+	 */
+	static void permute(const int32_t* pivots, const MatrixView<T>& b);
+};
+
+template <class T>
+LUFactorization<T>::LUFactorization(const Matrix<T>& A) :
+	_LU(A), _pivots(A.rows()), _singular(false) {
+	assert(A.rows() == A.cols());
+	decompose();
+}
+
+template <class T>
+LUFactorization<T>::LUFactorization(Matrix<T>&& A) :
+	_LU(std::move(A)), _pivots(_LU.rows()), _singular(false) {
+	assert(_LU.rows() == _LU.cols());
+	decompose();
+}
+
+template <class T>
+void LUFactorization<T>::factor(const Matrix<T>& A) {
+	assert(A.rows() == A.cols());
+
+	_LU = A;
+	_pivots.resize(A.rows());
+	decompose();
+}
+
+template <class T>
+void LUFactorization<T>::decompose() {
+	_singular = !factorInPlace(_LU, _pivots.data());
+}
+
+template <class T>
+bool LUFactorization<T>::factorInPlace(const MatrixView<T>& A, int32_t* pivots) {
+	assert(A.rows() == A.cols());
+	const int32_t n = A.rows();
+	const int32_t ld = A.ld();
+	T* data = A.data();
+	bool success = true;
+
+	// right looking blocked factorization
+	for (int32_t k = 0; k < n; k += BlockSize) {
+		int32_t nb = (n - k < BlockSize) ? n - k : BlockSize;
+		success = factorPanel(A, pivots, k, nb) && success;
+
+		int32_t rest = n - k - nb;
+		if (rest == 0) {
+			continue;
+		}
+
+		// U12 = L11^-1 * A12, L11 is unit lower triangular
+		for (int32_t i = k + 1; i < k + nb; ++i) {
+			T* row = data + (int64_t) i * ld + k + nb;
+			for (int32_t p = k; p < i; ++p) {
+				MatrixKernels::vectorAxpy(rest, -A(i, p), data + (int64_t) p * ld + k + nb, row);
+			}
+		}
+
+		// A22 -= L21 * U12
+		MatrixKernels::gemm(rest, rest, nb, T(-1),
+			data + (int64_t) (k + nb) * ld + k, ld,
+			data + (int64_t) k * ld + k + nb, ld,
+			T(1), data + (int64_t) (k + nb) * ld + k + nb, ld);
+	}
+	return success;
+}
+
+template <class T>
+bool LUFactorization<T>::factorPanel(const MatrixView<T>& A, int32_t* pivots, int32_t col, int32_t width) {
+	const int32_t n = A.rows();
+	const int32_t end = col + width;
+	bool success = true;
+
+	for (int32_t j = col; j < end; ++j) {
+		// pivot on the largest magnitude in the column
+		int32_t pivot = j;
+		T largest = std::abs(A(j, j));
+		for (int32_t i = j + 1; i < n; ++i) {
+			T element = std::abs(A(i, j));
+			if (element > largest) {
+				largest = element;
+				pivot = i;
+			}
+		}
+		pivots[j] = pivot;
+		if (pivot != j) {
+			std::swap_ranges(&A(j, 0), &A(j, 0) + n, &A(pivot, 0));
+		}
+		if (largest == T(0)) {
+			success = false;
+			continue;
+		}
+
+		T scale = T(1) / A(j, j);
+		T* pivotRow = &A(j, j) + 1;
+		for (int32_t i = j + 1; i < n; ++i) {
+			T factor = A(i, j) * scale;
+			A(i, j) = factor;
+			if (factor != T(0)) {
+				MatrixKernels::vectorAxpy(end - j - 1, -factor, pivotRow, &A(i, j + 1));
+			}
+		}
+	}
+	return success;
+}
+
+template <class T>
+int32_t LUFactorization<T>::size() const {
+	return _LU.rows();
+}
+
+template <class T>
+bool LUFactorization<T>::singular() const {
+	return _singular;
+}
+
+template <class T>
+void LUFactorization<T>::permute(const int32_t* pivots, const MatrixView<T>& b) {
+	for (int32_t i = 0; i < b.rows(); ++i) {
+		if (pivots[i] != i) {
+			std::swap_ranges(&b(i, 0), &b(i, 0) + b.cols(), &b(pivots[i], 0));
+		}
+	}
+}
+
+template <class T>
+void LUFactorization<T>::solve(const Matrix<T>& b, Matrix<T>& x) const {
+	if (&x != &b) {
+		x = b;
+	}
+	solveInPlace(x);
+}
+
+template <class T>
+void LUFactorization<T>::solveInPlace(Matrix<T>& b) const {
+	solveInPlace(MatrixView<T>(b));
+}
+
+template <class T>
+void LUFactorization<T>::solveInPlace(const MatrixView<T>& b) const {
+	solveFactored(_LU, _pivots.data(), b);
+}
+
+template <class T>
+void LUFactorization<T>::solveFactored(const ConstMatrixView<T>& LU, const int32_t* pivots, const MatrixView<T>& b) {
+	assert(LU.rows() == LU.cols());
+	assert(b.rows() == LU.rows());
+
+	permute(pivots, b);
+
+	// L * y = P * b, then U * x = y
+	const int32_t n = LU.rows();
+	MatrixKernels::trsmLower(n, b.cols(), LU.data(), LU.ld(), true, b.data(), b.ld());
+	MatrixKernels::trsmUpper(n, b.cols(), LU.data(), LU.ld(), false, b.data(), b.ld());
+}
+
+template <class T>
+T LUFactorization<T>::determinant() const {
+	T det = 1;
+	for (int32_t i = 0; i < size(); ++i) {
+		det *= _LU(i, i);
+		if (_pivots[i] != i) {
+			det = -det;
+		}
+	}
+	return det;
+}
+
+template <class T>
+void LUFactorization<T>::inverse(Matrix<T>& dest) const {
+	assert(dest.rows() == size());
+	assert(dest.cols() == size());
+
+	dest.identity();
+	solveInPlace(dest);
+}
+
+template <class T>
+const Matrix<T>& LUFactorization<T>::packed() const {
+	return _LU;
+}
+
+template <class T>
+const std::vector<int32_t>& LUFactorization<T>::pivots() const {
+	return _pivots;
+}
+
+} // namespace Alectryon
+
+#endif /* _LU_FACTORIZATION_HPP */
@@ -0,0 +1,475 @@
+#ifndef _MAPPED_MATRIX_HPP
+#define _MAPPED_MATRIX_HPP
+
+/**
+ * Matrices stored in a binary file and memory mapped, so they can be larger
+ * than RAM. Pages are read on first touch and the kernel drops them again
+ * under memory pressure. Works with the MatrixView operations through view().
+ *
+ * File format, little endian as written by the machine:
+ * [MappedMatrixHeader, 64 bytes][zeros up to dataOffset][rows x ld elements]
+ * dataOffset is a multiple of the page size, so the data is page aligned.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+enum MappedMode {
+	MAPPED_READ_ONLY,
+	MAPPED_READ_WRITE
+};
+
+/**
+ * @brief the first 64 bytes of a matrix file
+ */
+struct MappedMatrixHeader {
+	char magic[8];        // "ALMATRIX"
+	uint32_t version;     // 1
+	uint32_t type;        // MappedMatrixType<T>::code
+	uint32_t elementSize; // sizeof(T)
+	uint32_t layout;      // 0, row major. the only layout so far
+	int64_t rows;
+	int64_t cols;
+	int64_t ld;           // elements between the starts of two rows
+	int64_t dataOffset;   // bytes from the start of the file to element (0, 0)
+	int64_t reserved;     // 0
+};
+
+static_assert(sizeof(MappedMatrixHeader) == 64, "MappedMatrixHeader must be 64 bytes");
+
+/**
+ * @brief type codes stored in the header, so a file is not read as the wrong type
+ */
+template <class T>
+struct MappedMatrixType;
+
+template <> struct MappedMatrixType<float> { static const uint32_t code = 1; };
+template <> struct MappedMatrixType<double> { static const uint32_t code = 2; };
+template <> struct MappedMatrixType<int8_t> { static const uint32_t code = 3; };
+template <> struct MappedMatrixType<int16_t> { static const uint32_t code = 4; };
+template <> struct MappedMatrixType<int32_t> { static const uint32_t code = 5; };
+template <> struct MappedMatrixType<int64_t> { static const uint32_t code = 6; };
+
+template <class T>
+class MappedMatrix {
+public:
+	/**
+	 * @brief Constructs a matrix with no file open
+	 */
+	MappedMatrix();
+
+	MappedMatrix(const MappedMatrix<T>& other) = delete;
+	MappedMatrix<T>& operator=(const MappedMatrix<T>& other) = delete;
+
+	MappedMatrix(MappedMatrix<T>&& other);
+	MappedMatrix<T>& operator=(MappedMatrix<T>&& other);
+
+	/**
+	 * @brief Destructor
+	 * @details unmaps the file, changes are written back by the kernel
+	 */
+	~MappedMatrix();
+
+	/**
+	 * @brief creates or replaces the file at path with a zeroed rows x cols
+	 * matrix and maps it read-write
+	 * @details rows are padded as set by MatrixLayout. the file is sparse,
+	 * disk is only used as elements are written
+	 * @return false if the file could not be created or mapped
+	 */
+	bool create(const std::string& path, int32_t rows, int32_t cols);
+
+	/**
+	 * @brief maps an existing file
+	 * @details nothing is read until elements are touched
+	 * @return false if the file can't be mapped or is not a matrix of T
+	 */
+	bool open(const std::string& path, MappedMode mode = MAPPED_READ_ONLY);
+
+	/**
+	 * @brief unmaps the file, does nothing if none is open
+	 */
+	void close();
+
+	bool isOpen() const;
+	bool writable() const;
+
+	int32_t rows() const;
+	int32_t cols() const;
+	int32_t ld() const;
+
+	/**
+	 * @brief returns pointer to element (0, 0), row i starts at data() + i * ld()
+	 * @details the non const version needs a writable mapping
+	 */
+	T* data();
+	const T* data() const;
+
+	T& operator()(int32_t row, int32_t col);
+	T operator()(int32_t row, int32_t col) const;
+
+	/**
+	 * @brief returns a view of the whole matrix, for the MatrixView operations
+	 * @details the non const version needs a writable mapping
+	 */
+	MatrixView<T> view();
+	ConstMatrixView<T> view() const;
+
+	/**
+	 * @brief copies the matrix into memory
+	 */
+	Matrix<T> load() const;
+
+	/**
+	 * @brief writes changed pages back to the file
+	 * @param wait if false, the writes are only scheduled
+	 */
+	void flush(bool wait = true);
+
+	/**
+	 * @brief hints that rows [row, row + count) will be needed soon,
+	 * so the kernel starts reading them in the background
+	 */
+	void prefetchRows(int32_t row, int32_t count) const;
+
+	/**
+	 * @brief hints that rows [row, row + count) are not needed for a while,
+	 * so their pages can be dropped. written pages are kept in the page cache
+	 */
+	void releaseRows(int32_t row, int32_t count) const;
+
+	/**
+	 * @brief computes dest = A * B, streaming tiles from the files
+	 * @details works on panels of rows of A and dest, and for each
+	 * panel streams B from start to end in bands of rows, prefetching the
+	 * next band while multiplying the current one. memoryBytes bounds
+	 * the size of the panels and bands that are resident at once.
+	 * dest must be writable and can NOT be the same as A or B
+	 */
+	static void multiply(MappedMatrix<T>& dest, const MappedMatrix<T>& A,
+		const MappedMatrix<T>& B, int64_t memoryBytes = (int64_t) 1 << 30);
+
+private:
+	int _fd;
+	void* _base;
+	size_t _length;
+	bool _writable;
+	int32_t _rows;
+	int32_t _cols;
+	int32_t _ld;
+	T* _data;
+
+	/**
+	 * @brief maps length bytes of _fd and reads the shape from the header
+	 */
+	bool map(size_t length, bool writable);
+
+	/**
+	 * @brief calls madvise over the pages of rows [row, row + count)
+	 */
+	void advise(int32_t row, int32_t count, int advice) const;
+};
+
+template <class T>
+MappedMatrix<T>::MappedMatrix() :
+	_fd(-1), _base(nullptr), _length(0), _writable(false),
+	_rows(0), _cols(0), _ld(0), _data(nullptr) { }
+
+template <class T>
+MappedMatrix<T>::MappedMatrix(MappedMatrix<T>&& other) :
+	_fd(other._fd), _base(other._base), _length(other._length), _writable(other._writable),
+	_rows(other._rows), _cols(other._cols), _ld(other._ld), _data(other._data) {
+	other._fd = -1;
+	other._base = nullptr;
+	other._data = nullptr;
+}
+
+template <class T>
+MappedMatrix<T>& MappedMatrix<T>::operator=(MappedMatrix<T>&& other) {
+	if (&other == this) {
+		return *this;
+	}
+	close();
+	_fd = other._fd;
+	_base = other._base;
+	_length = other._length;
+	_writable = other._writable;
+	_rows = other._rows;
+	_cols = other._cols;
+	_ld = other._ld;
+	_data = other._data;
+
+	other._fd = -1;
+	other._base = nullptr;
+	other._data = nullptr;
+	return *this;
+}
+
+template <class T>
+MappedMatrix<T>::~MappedMatrix() {
+	close();
+}
+
+template <class T>
+bool MappedMatrix<T>::create(const std::string& path, int32_t rows, int32_t cols) {
+	assert(rows > 0);
+	assert(cols > 0);
+	close();
+
+	MappedMatrixHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "ALMATRIX", 8);
+	header.version = 1;
+	header.type = MappedMatrixType<T>::code;
+	header.elementSize = sizeof(T);
+	header.layout = 0;
+	header.rows = rows;
+	header.cols = cols;
+	header.ld = MatrixLayout::leadingDimension<T>(cols);
+	header.dataOffset = sysconf(_SC_PAGESIZE);
+
+	_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (_fd < 0) {
+		return false;
+	}
+	size_t length = header.dataOffset + (size_t) header.rows * header.ld * sizeof(T);
+	if (ftruncate(_fd, length) != 0 ||
+		pwrite(_fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+		close();
+		return false;
+	}
+	return map(length, true);
+}
+
+template <class T>
+bool MappedMatrix<T>::open(const std::string& path, MappedMode mode) {
+	close();
+
+	bool writable = (mode == MAPPED_READ_WRITE);
+	_fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (_fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(_fd, &info) != 0 || (size_t) info.st_size < sizeof(MappedMatrixHeader)) {
+		close();
+		return false;
+	}
+	return map(info.st_size, writable);
+}
+
+template <class T>
+bool MappedMatrix<T>::map(size_t length, bool writable) {
+	int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+	void* base = mmap(nullptr, length, protection, MAP_SHARED, _fd, 0);
+	if (base == MAP_FAILED) {
+		close();
+		return false;
+	}
+	_base = base;
+	_length = length;
+	_writable = writable;
+
+	const MappedMatrixHeader* header = static_cast<const MappedMatrixHeader*>(_base);
+	bool valid = memcmp(header->magic, "ALMATRIX", 8) == 0 &&
+		header->version == 1 &&
+		header->type == MappedMatrixType<T>::code &&
+		header->elementSize == sizeof(T) &&
+		header->layout == 0 &&
+		header->rows > 0 && header->rows <= INT32_MAX &&
+		header->cols > 0 && header->cols <= header->ld && header->ld <= INT32_MAX &&
+		header->dataOffset >= (int64_t) sizeof(MappedMatrixHeader) &&
+		header->dataOffset % MatrixLayout::Alignment == 0 &&
+		(uint64_t) header->dataOffset <= length;
+	if (valid) {
+		// divide rather than multiply, a corrupt header must not overflow the size check
+		uint64_t elements = (length - (uint64_t) header->dataOffset) / sizeof(T);
+		valid = (uint64_t) header->ld <= elements &&
+			(uint64_t) header->rows <= elements / (uint64_t) header->ld;
+	}
+	if (!valid) {
+		close();
+		return false;
+	}
+
+	_rows = (int32_t) header->rows;
+	_cols = (int32_t) header->cols;
+	_ld = (int32_t) header->ld;
+	_data = reinterpret_cast<T*>(static_cast<char*>(_base) + header->dataOffset);
+	return true;
+}
+
+template <class T>
+void MappedMatrix<T>::close() {
+	if (_base != nullptr) {
+		munmap(_base, _length);
+	}
+	if (_fd >= 0) {
+		::close(_fd);
+	}
+	_fd = -1;
+	_base = nullptr;
+	_length = 0;
+	_writable = false;
+	_rows = 0;
+	_cols = 0;
+	_ld = 0;
+	_data = nullptr;
+}
+
+template <class T>
+bool MappedMatrix<T>::isOpen() const {
+	return _data != nullptr;
+}
+
+template <class T>
+bool MappedMatrix<T>::writable() const {
+	return _writable;
+}
+
+template <class T>
+int32_t MappedMatrix<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t MappedMatrix<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+int32_t MappedMatrix<T>::ld() const {
+	return _ld;
+}
+
+template <class T>
+T* MappedMatrix<T>::data() {
+	assert(_writable);
+	return _data;
+}
+
+template <class T>
+const T* MappedMatrix<T>::data() const {
+	return _data;
+}
+
+template <class T>
+T& MappedMatrix<T>::operator()(int32_t row, int32_t col) {
+	assert(_writable);
+	return _data[(int64_t) row * _ld + col];
+}
+
+template <class T>
+T MappedMatrix<T>::operator()(int32_t row, int32_t col) const {
+	return _data[(int64_t) row * _ld + col];
+}
+
+template <class T>
+MatrixView<T> MappedMatrix<T>::view() {
+	assert(isOpen());
+	return MatrixView<T>(data(), _rows, _cols, _ld);
+}
+
+template <class T>
+ConstMatrixView<T> MappedMatrix<T>::view() const {
+	assert(isOpen());
+	return ConstMatrixView<T>(_data, _rows, _cols, _ld);
+}
+
+template <class T>
+Matrix<T> MappedMatrix<T>::load() const {
+	return Matrix<T>(view());
+}
+
+template <class T>
+void MappedMatrix<T>::flush(bool wait) {
+	if (_base != nullptr && _writable) {
+		msync(_base, _length, wait ? MS_SYNC : MS_ASYNC);
+	}
+}
+
+template <class T>
+void MappedMatrix<T>::advise(int32_t row, int32_t count, int advice) const {
+	if (count <= 0) {
+		return;
+	}
+	assert(row >= 0 && row + count <= _rows);
+	const uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t begin = (uintptr_t) (_data + (int64_t) row * _ld);
+	uintptr_t end = (uintptr_t) (_data + (int64_t) (row + count - 1) * _ld + _cols);
+	begin -= begin % page;
+	end = (end + page - 1) / page * page;
+	madvise((void*) begin, end - begin, advice);
+}
+
+template <class T>
+void MappedMatrix<T>::prefetchRows(int32_t row, int32_t count) const {
+	advise(row, count, MADV_WILLNEED);
+}
+
+template <class T>
+void MappedMatrix<T>::releaseRows(int32_t row, int32_t count) const {
+	advise(row, count, MADV_DONTNEED);
+}
+
+template <class T>
+void MappedMatrix<T>::multiply(MappedMatrix<T>& dest, const MappedMatrix<T>& A,
+		const MappedMatrix<T>& B, int64_t memoryBytes) {
+	assert(A._cols == B._rows);
+	assert(dest._rows == A._rows);
+	assert(dest._cols == B._cols);
+	assert(dest._writable);
+	assert(&dest != &A && &dest != &B);
+
+	const int32_t m = A._rows;
+	const int32_t n = B._cols;
+	const int32_t k = A._cols;
+
+	// half the memory for the panels of A and dest,
+	// a quarter each for the band of B in use and the one being prefetched
+	int64_t panelBytes = (int64_t) (A._ld + dest._ld) * sizeof(T);
+	int64_t bandBytes = (int64_t) B._ld * sizeof(T);
+	int64_t mb = memoryBytes / 2 / panelBytes;
+	int64_t kb = memoryBytes / 4 / bandBytes;
+	mb = (mb < 1) ? 1 : ((mb > m) ? m : mb);
+	kb = (kb < 1) ? 1 : ((kb > k) ? k : kb);
+
+	T* C = dest.data();
+	for (int32_t i0 = 0; i0 < m; i0 += (int32_t) mb) {
+		int32_t rows = (m - i0 < mb) ? m - i0 : (int32_t) mb;
+		A.prefetchRows(i0, rows);
+		B.prefetchRows(0, (int32_t) kb);
+
+		for (int32_t p0 = 0; p0 < k; p0 += (int32_t) kb) {
+			int32_t depth = (k - p0 < kb) ? k - p0 : (int32_t) kb;
+			if (p0 + depth < k) {
+				B.prefetchRows(p0 + depth, (int32_t) std::min<int64_t>(kb, k - p0 - depth));
+			}
+
+			MatrixKernels::gemm(rows, n, depth, T(1),
+				A._data + (int64_t) i0 * A._ld + p0, A._ld,
+				B._data + (int64_t) p0 * B._ld, B._ld,
+				(p0 == 0) ? T(0) : T(1), C + (int64_t) i0 * dest._ld, dest._ld);
+
+			B.releaseRows(p0, depth);
+		}
+
+		// the finished panel stays in the page cache until the kernel writes it back
+		A.releaseRows(i0, rows);
+		dest.advise(i0, rows, MADV_DONTNEED);
+	}
+}
+
+} // namespace Alectryon
+
+#endif /* _MAPPED_MATRIX_HPP */
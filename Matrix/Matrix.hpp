@@ -12,14 +12,44 @@
 #include <cstring>
 #include <cstdint>
 #include <cmath>
+#include "MatrixGemm.hpp"
+#include "MatrixSimd.hpp"
+#include "MatrixTranspose.hpp"
+#include "MatrixStrassen.hpp"
+#include "MatrixBlas.hpp"
+#include "MatrixParallel.hpp"
+#include "MatrixLayout.hpp"
+#include "MatrixWorkspace.hpp"
+#include "MatrixExpression.hpp"
 
 namespace Alectryon {
 
+/**
+ * @brief minimum number of elements per thread for element-wise operations
+ */
+const int64_t MatrixElementwiseGrain = 1 << 14;
+
+template <class T>
+class LUFactorization;
+
+template <class T>
+class CholeskyFactorization;
+
+template <class T>
+class QRFactorization;
+
+template <class T>
+class MatrixView;
+
+template <class T>
+class ConstMatrixView;
+
 template <class T>
-class Matrix {
+class Matrix : public MatrixExpression<Matrix<T>, T> {
 private:
 	int32_t _rows;
 	int32_t _cols;
+	int32_t _ld;
 	T* _data;
 	T _threshold;
 
@@ -63,6 +93,18 @@ public:
 	 */
 	Matrix(Matrix<T>&& other);
 
+	/**
+	 * @brief Constructs a matrix from an expression
+	 * @details the expression is evaluated in one fused loop
+	 */
+	template <class E>
+	Matrix(const MatrixExpression<E, T>& expr);
+
+	/**
+	 * @brief Constructs a matrix with a copy of the viewed elements
+	 */
+	explicit Matrix(const ConstMatrixView<T>& view);
+
 	/**
 	 * @brief Destructor
 	 */
@@ -83,6 +125,14 @@ public:
 	 */
 	Matrix<T>& operator=(Matrix<T>&& other);
 
+	/**
+	 * @brief Assigns the result of an expression
+	 * @details evaluated in one fused loop, without temporaries.
+	 * products are computed with gemm straight into this matrix
+	 */
+	template <class E>
+	Matrix<T>& operator=(const MatrixExpression<E, T>& expr);
+
 	/**
 	 * @brief checks equality. elements and size must be the same
 	 */
@@ -124,62 +174,26 @@ public:
 
 	/**
 	 * @brief computes dest = A * B
-	 * @details dest can NOT be the same as A or B
+	 * @details dest can NOT be the same as A or B.
+	 * very large products use Strassen-Winograd if MatrixStrassen is turned on
 	 */
 	static void multiply(Matrix<T>& dest, const Matrix<T>& A, const Matrix<T>& B);
 
 	/**
-	 * @brief computes dest = src * scalar
-	 * @details dest can be the same as src
-	 */
-	static void multiply(Matrix<T>& dest, const Matrix<T>& src, T scalar);
-
-	/**
-	 * @brief overloaded addition operator
-	 */
-	Matrix<T> operator+(const Matrix<T>& other) const;
-
-	/**
-	 * @brief addition operator
-	 */
-	friend Matrix<T> operator+(const Matrix<T>& A, T scalar) {
-		Matrix<T> ret(A._rows, A._cols);
-		Matrix<T>::add(ret, A, scalar);
-		return ret;
-	}
-
-	/**
-	 * @brief addition operator
-	 */
-	friend Matrix<T> operator+(T scalar, const Matrix<T>& A) {
-		return A + scalar;
-	}
-
-	/**
-	 * @brief subtraction operator
-	 */
-	Matrix<T> operator-(const Matrix<T>& A);
-
-	/**
-	 * @brief subtraction operator
+	 * @brief computes dest = alpha * A * B + beta * dest
+	 * @details dest can NOT be the same as A or B
+	 * if beta is 0, dest doesn't have to be initialized
 	 */
-	friend Matrix<T>operator-(const Matrix<T>& A, T scalar)  {
-		return A + (-scalar);
-	}
+	static void multiplyAdd(Matrix<T>& dest, T alpha, const Matrix<T>& A, const Matrix<T>& B, T beta);
 
 	/**
-	 * @brief multiplication operator
-	 * does *this * A
+	 * @brief computes dest = src * scalar
+	 * @details dest can be the same as src
 	 */
-	Matrix<T> operator*(const Matrix<T>& A);
-
-	friend Matrix<T> operator*(const Matrix<T>& A, T scalar) {
-		return Matrix<T>(A) *= scalar;
-	}
+	static void multiply(Matrix<T>& dest, const Matrix<T>& src, T scalar);
 
-	friend Matrix<T> operator*(T scalar, const Matrix<T>& A) {
-		return A * scalar;
-	}
+	// the arithmetic operators +, - and * are in MatrixExpression.hpp.
+	// they return expressions that are evaluated on assignment
 
 	/**
 	Addition assignment operator
@@ -215,6 +229,29 @@ public:
 	 */
 	Matrix<T>& operator*=(T scalar);
 
+	/**
+	 * @brief addition assignment of an expression
+	 * @details *this += A * B is one gemm into *this
+	 */
+	template <class E>
+	Matrix<T>& operator+=(const MatrixExpression<E, T>& expr);
+
+	/**
+	 * @brief subtraction assignment of an expression
+	 */
+	template <class E>
+	Matrix<T>& operator-=(const MatrixExpression<E, T>& expr);
+
+	/**
+	 * @brief gets copy of an element, used by expressions
+	 */
+	T coeff(const int32_t row, const int32_t col) const;
+
+	/**
+	 * @brief does nothing, a matrix needs no evaluation before coeff()
+	 */
+	void prepare() const { }
+
 	/**
 	 * @brief returns number of rows in matrix
 	 */
@@ -225,6 +262,38 @@ public:
 	 */
 	int32_t cols() const;
 
+	/**
+	 * @brief returns the leading dimension, elements between the start of two rows
+	 * @details at least cols(), rows are padded as set by MatrixLayout
+	 */
+	int32_t ld() const;
+
+	/**
+	 * @brief returns pointer to the row first data
+	 * @details aligned to MatrixLayout::Alignment, row i starts at data() + i * ld()
+	 */
+	T* data();
+	const T* data() const;
+
+	/**
+	 * @brief returns a view of the rows x cols block starting at (row, col)
+	 * @details the view shares this matrix's data, no elements are copied
+	 */
+	MatrixView<T> block(int32_t row, int32_t col, int32_t rows, int32_t cols);
+	ConstMatrixView<T> block(int32_t row, int32_t col, int32_t rows, int32_t cols) const;
+
+	/**
+	 * @brief returns a 1 x cols() view of one row
+	 */
+	MatrixView<T> row(int32_t row);
+	ConstMatrixView<T> row(int32_t row) const;
+
+	/**
+	 * @brief returns a rows() x 1 view of one column
+	 */
+	MatrixView<T> col(int32_t col);
+	ConstMatrixView<T> col(int32_t col) const;
+
 	///////////////////////////////////
 	// ELEMENTARY ROW OPERATIONS
 	///////////////////////////////////
@@ -251,7 +320,7 @@ public:
 	 * @param row1 index of first row
 	 * @param row2 index of second row
 	 */
-	void rowSwap(int32_t row1, T row2);
+	void rowSwap(int32_t row1, int32_t row2);
 
 	/**
 	 * @brief swaps two columns
@@ -297,13 +366,21 @@ public:
 
 	/**
 	 * @brief takes the transpose of src and puts it into dest
-	 * @details src can not be the same matrix as dest
+	 * @details src can not be the same matrix as dest, use transposeInPlace()
 	 * 
 	 * @param dest matrix to store transpose
 	 * @param src matrix to take transpose of
 	 */
 	static void transpose(Matrix<T>& dest, const Matrix<T>& src);
 
+	/**
+	 * @brief transposes the matrix without a second buffer, swapping rows() and cols()
+	 * @details square matrices swap blocks across the diagonal and are about as
+	 * fast as transpose(). other shapes follow permutation cycles, which is
+	 * much slower but only needs one extra bit per element
+	 */
+	void transposeInPlace();
+
 	/**
 	 * @brief reduces current matrix to reduced row echelon form
 	 */
@@ -327,29 +404,68 @@ public:
 	 */
 	static void inverse(Matrix<T>& dest, const Matrix<T>& src, Matrix<T>& temp);
 
+	/**
+	 * @brief takes the inverse of src and stores into dest, using LU decomposition
+	 * @details scratch space comes from workspace, so nothing is allocated.
+	 * workspace needs solveWorkspaceSize(src.rows()) bytes
+	 */
+	static void inverse(Matrix<T>& dest, const Matrix<T>& src, MatrixWorkspace& workspace);
+
 	/**
 	 * @brief Solves A * x = b
-	 * @details matrices must be appropriately sized
+	 * @details b and x are A.rows() x k, every column is a right hand side.
+	 * A is factored once and all columns are solved together
+	 * with blocked triangular solves
 	 */
 	static void solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x);
 
 	/**
 	 * @brief Solves A * x = b
-	 * @details uses temp matrix for storage during calculation 
-	 * if called many times, is faster than solve(A, b, x)
+	 * @details uses temp matrix for storage during Gauss-Jordan elimination,
+	 * so nothing is allocated. b and x can have several columns.
 	 * temp must be of size (A.rows(), A.cols())
 	 */
 	static void solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, Matrix<T>& temp);
 
 	/**
 	 * @brief solves A * x = b using LU decomposition
+	 * @details b and x can have several columns.
+	 * use LUFactorization directly to solve many times against the same A
 	 */
 	static void solveLU(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x);
 
+	/**
+	 * @brief Solves A * x = b using LU decomposition, without allocating
+	 * @details scratch space comes from workspace, which needs
+	 * solveWorkspaceSize(A.rows()) bytes. x can be the same matrix as b
+	 */
+	static void solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace);
+	static void solveLU(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace);
+
+	/**
+	 * @brief returns the workspace bytes solve(), solveLU() and inverse() need for an n x n A
+	 */
+	static size_t solveWorkspaceSize(int32_t n);
+
 	/**
 	 * @brief solves least squares Ax = b
+	 * @details uses a Householder QR factorization of A, A must have
+	 * at least as many rows as columns and full column rank.
+	 * b and x can have several columns
 	 */
 	static void leastSquares(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x);
+
+	/**
+	 * @brief solves least squares Ax = b without allocating
+	 * @details scratch space comes from workspace, which needs
+	 * leastSquaresWorkspaceSize(A.rows(), A.cols(), b.cols()) bytes
+	 */
+	static void leastSquares(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace);
+
+	/**
+	 * @brief returns the workspace bytes leastSquares() needs for a rows x cols A and k right hand sides
+	 */
+	static size_t leastSquaresWorkspaceSize(int32_t rows, int32_t cols, int32_t k);
 	
 	/**
 	 * @brief takes LU decomposition of current matrix
@@ -383,6 +499,29 @@ private:
 	 * can be nullptr
 	 */
 	void rowReduceHigher(Matrix<T>* other);
+
+	/**
+	 * @brief allocates rows x cols with the current MatrixLayout,
+	 * and zeroes the padding between rows
+	 */
+	void allocate();
+
+	/**
+	 * @brief copies rows x cols elements from src, whose rows are lds apart
+	 */
+	void copyFrom(const T* src, int32_t lds);
+
+	/**
+	 * @brief returns number of elements from the first to the last one in use
+	 * @details element-wise operations on matrices with the same ld()
+	 * run over this many elements in one go, padding included
+	 */
+	int64_t span() const;
+
+	/**
+	 * @brief returns true if A and B have their rows the same distance apart
+	 */
+	static bool sameLayout(const Matrix<T>& A, const Matrix<T>& B);
 };
 
 template <class T>
@@ -391,7 +530,7 @@ Matrix<T>::Matrix(int32_t rows, int32_t cols, T threshold) :
 	assert(_rows > 0);
 	assert(_cols > 0);
 
-	_data = new T[rows * cols];
+	allocate();
 }
 
 template <class T>
@@ -400,37 +539,52 @@ Matrix<T>::Matrix(int32_t rows, int32_t cols, T* data, T threshold) :
 	assert(_rows > 0);
 	assert(_cols > 0);
 
-	_data = new T[rows * cols];
-	memcpy(_data, data, _rows * _cols * sizeof(T));
+	allocate();
+	copyFrom(data, _cols);
 }
 
 template <class T>
 Matrix<T>::Matrix(const Matrix<T>& other) :
-	_rows(other._rows), _cols(other._cols) {
+	_rows(other._rows), _cols(other._cols), _threshold(other._threshold) {
 	assert(_rows > 0);
 	assert(_cols > 0);
 
-	int32_t size = _rows * _cols;
-	_data = new T[size];
-	for (int32_t i = 0; i < size; ++i) {
-		_data[i] = (other._data)[i];
-	}
+	allocate();
+	copyFrom(other._data, other._ld);
 }
 
 template <class T>
 Matrix<T>::Matrix(Matrix<T>&& other) {
 	_rows = other._rows;
 	_cols = other._cols;
+	_ld = other._ld;
 	_data = other._data;
+	_threshold = other._threshold;
 
 	other._data = nullptr;
 }
 
+template <class T>
+template <class E>
+Matrix<T>::Matrix(const MatrixExpression<E, T>& expr) :
+	_rows(expr.derived().rows()), _cols(expr.derived().cols()), _threshold(1.0e-6) {
+	assert(_rows > 0);
+	assert(_cols > 0);
+
+	allocate();
+	expr.derived().evaluateInto(*this);
+}
+
+template <class T>
+Matrix<T>::Matrix(const ConstMatrixView<T>& view) :
+	_rows(view.rows()), _cols(view.cols()), _threshold(1.0e-6) {
+	allocate();
+	copyFrom(view.data(), view.ld());
+}
+
 template <class T>
 Matrix<T>::~Matrix() {
-	if (_data != nullptr) {
-		delete[] _data;
-	}
+	MatrixLayout::release(_data);
 }
 
 template <class T>
@@ -440,44 +594,66 @@ Matrix<T>& Matrix<T>::operator=(const Matrix<T>& other) {
 		return *this;
 	}
 
-	int32_t size = other._rows * other._cols;
-
 	// check if we need to allocate a new array
-	if ((int32_t)_rows * (int32_t)_cols != size) {
-		delete[] _data;
-		_data = new T[size];
-	}
-	_rows = other._rows;
-	_cols = other._cols;
-	for (int32_t i = 0; i < size; ++i) {
-		_data[i] = (other._data)[i];
+	if (_rows != other._rows || _cols != other._cols) {
+		MatrixLayout::release(_data);
+		_rows = other._rows;
+		_cols = other._cols;
+		allocate();
 	}
+	copyFrom(other._data, other._ld);
+	_threshold = other._threshold;
 	return *this;
 }
 
 template <class T>
 Matrix<T>& Matrix<T>::operator=(Matrix<T>&& other) {
+	// check for self assignment
+	if (&other == this) {
+		return *this;
+	}
+
 	// free old data
-	delete[] _data;
+	MatrixLayout::release(_data);
 
 	_rows = other._rows;
 	_cols = other._cols;
+	_ld = other._ld;
 	_data = other._data;
+	_threshold = other._threshold;
 	other._data = nullptr;
 
 	return *this;
 }
 
+template <class T>
+template <class E>
+Matrix<T>& Matrix<T>::operator=(const MatrixExpression<E, T>& expr) {
+	const E& e = expr.derived();
+	if (e.rows() != _rows || e.cols() != _cols) {
+		// evaluate first, the expression may read this matrix
+		Matrix<T> result(e);
+		result._threshold = _threshold;
+		*this = std::move(result);
+		return *this;
+	}
+	e.evaluateInto(*this);
+	return *this;
+}
+
 template <class T>
 bool Matrix<T>::operator==(const Matrix<T>& other) {
 	if (other._rows != _rows || other._cols != _cols) {
 		return false;
 	}
 
-	int32_t size = _rows * _cols;
-	for (int32_t i = 0; i < size; ++i) {
-		if (_data[i] != other._data[i]) {
-			return false;
+	for (int32_t i = 0; i < _rows; ++i) {
+		const T* row = _data + (int64_t) i * _ld;
+		const T* otherRow = other._data + (int64_t) i * other._ld;
+		for (int32_t j = 0; j < _cols; ++j) {
+			if (row[j] != otherRow[j]) {
+				return false;
+			}
 		}
 	}
 	return true;
@@ -485,12 +661,12 @@ bool Matrix<T>::operator==(const Matrix<T>& other) {
 
 template <class T>
 T& Matrix<T>::operator()(const int32_t row, const int32_t col) {
-	return _data[row * _cols + col];
+	return _data[(int64_t) row * _ld + col];
 }
 
 template <class T>
 T Matrix<T>::operator()(const int32_t row, const int32_t col) const {
-	return _data[row * _cols + col];
+	return _data[(int64_t) row * _ld + col];
 }
 
 template <class T>
@@ -500,21 +676,29 @@ void Matrix<T>::add(Matrix<T>& dest, const Matrix<T>& A, const Matrix<T>& B) {
 	assert(A._cols == B._cols);
 	assert(A._cols == dest._cols);
 
-	int32_t size = A._rows * A._cols;
-	for (int32_t i = 0; i < size; ++i) {
-		dest._data[i] = A._data[i] + B._data[i];
+	if (!sameLayout(dest, A) || !sameLayout(dest, B)) {
+		MatrixView<T>::add(dest, A, B);
+		return;
 	}
+	int64_t size = dest.span();
+	MatrixParallel::run(0, size, size, [&](int64_t lo, int64_t hi) {
+		MatrixKernels::vectorAdd(hi - lo, A._data + lo, B._data + lo, dest._data + lo);
+	}, MatrixElementwiseGrain);
 }
 
 template <class T>
 void Matrix<T>::add(Matrix<T>& dest, const Matrix<T>& src, T scalar) {
-	assert(dest._rows = src._rows);
-	assert(dest._cols = src._cols);
+	assert(dest._rows == src._rows);
+	assert(dest._cols == src._cols);
 
-	int32_t size = src._rows * src._cols;
-	for (int32_t i = 0; i < size; ++i) {
-		dest._data[i] = src._data[i] + scalar;
-	}		
+	if (!sameLayout(dest, src)) {
+		MatrixView<T>::add(dest, src, scalar);
+		return;
+	}
+	int64_t size = dest.span();
+	MatrixParallel::run(0, size, size, [&](int64_t lo, int64_t hi) {
+		MatrixKernels::vectorAddScalar(hi - lo, src._data + lo, scalar, dest._data + lo);
+	}, MatrixElementwiseGrain);
 }
 
 template <class T>
@@ -524,10 +708,14 @@ void Matrix<T>::subtract(Matrix<T>& dest, const Matrix<T>& A, const Matrix<T>& B
 	assert(A._cols == B._cols);
 	assert(A._cols == dest._cols);
 
-	int32_t size = A._rows * A._cols;
-	for (int32_t i = 0; i < size; ++i) {
-		dest._data[i] = A._data[i] - B._data[i];
+	if (!sameLayout(dest, A) || !sameLayout(dest, B)) {
+		MatrixView<T>::subtract(dest, A, B);
+		return;
 	}
+	int64_t size = dest.span();
+	MatrixParallel::run(0, size, size, [&](int64_t lo, int64_t hi) {
+		MatrixKernels::vectorSubtract(hi - lo, A._data + lo, B._data + lo, dest._data + lo);
+	}, MatrixElementwiseGrain);
 }
 
 template <class T>
@@ -539,38 +727,53 @@ void Matrix<T>::multiply(Matrix<T>& dest, const Matrix<T>& A, const Matrix<T>& B
 	assert(A._data != nullptr);
 	assert(B._data != nullptr);
 
-	float sum;
-	int32_t sum_index = 0;
-	int32_t row_index = 0;
-	int32_t col_index;
-	for (int32_t i = 0; i < dest._rows; ++i) {
-		for (int32_t j = 0; j < dest._cols; ++j) {
-			sum = 0;
-			col_index = j;
-			for (int32_t k = 0; k < A._cols; ++k) {
-				sum += A._data[row_index + k] * B._data[col_index];
-				col_index += dest._cols;
-			}
-			dest._data[sum_index++] = sum;
-		}
-		row_index += A._cols;
+	if (MatrixBlas::applies<T>((int64_t) A._rows * B._cols * A._cols)) {
+		MatrixBlas::gemm(A._rows, B._cols, A._cols, T(1), A._data, A._ld,
+			B._data, B._ld, T(0), dest._data, dest._ld);
+		return;
 	}
+	if (MatrixStrassen::applies<T>(A._rows, B._cols, A._cols)) {
+		T* scratch = MatrixLayout::allocate<T>(MatrixStrassen::scratchSize<T>(A._rows, B._cols, A._cols));
+		MatrixStrassen::multiply(A._rows, B._cols, A._cols, A._data, A._ld,
+			B._data, B._ld, dest._data, dest._ld, scratch);
+		MatrixLayout::release(scratch);
+		return;
+	}
+	MatrixKernels::gemm(A._rows, B._cols, A._cols, T(1), A._data, A._ld,
+		B._data, B._ld, T(0), dest._data, dest._ld);
 }
 
 template <class T>
-void Matrix<T>::multiply(Matrix<T>& dest, const Matrix<T>& src, T scalar) {
-	assert(dest._rows = src._rows);
-	assert(dest._cols = src._cols);
+void Matrix<T>::multiplyAdd(Matrix<T>& dest, T alpha, const Matrix<T>& A, const Matrix<T>& B, T beta) {
+	assert(A._cols == B._rows);
+	assert(dest._rows == A._rows);
+	assert(dest._cols == B._cols);
+	assert(dest._data != nullptr);
+	assert(A._data != nullptr);
+	assert(B._data != nullptr);
 
-	int32_t size = src._rows * src._cols;
-	for (int32_t i = 0; i < size; ++i) {
-		dest._data[i] = src._data[i] * scalar;
+	if (MatrixBlas::applies<T>((int64_t) A._rows * B._cols * A._cols)) {
+		MatrixBlas::gemm(A._rows, B._cols, A._cols, alpha, A._data, A._ld,
+			B._data, B._ld, beta, dest._data, dest._ld);
+		return;
 	}
+	MatrixKernels::gemm(A._rows, B._cols, A._cols, alpha, A._data, A._ld,
+		B._data, B._ld, beta, dest._data, dest._ld);
 }
 
 template <class T>
-Matrix<T> Matrix<T>::operator+(const Matrix<T>& other) const {
-	return Matrix<T>(*this) += other;
+void Matrix<T>::multiply(Matrix<T>& dest, const Matrix<T>& src, T scalar) {
+	assert(dest._rows == src._rows);
+	assert(dest._cols == src._cols);
+
+	if (!sameLayout(dest, src)) {
+		MatrixView<T>::multiply(dest, src, scalar);
+		return;
+	}
+	int64_t size = dest.span();
+	MatrixParallel::run(0, size, size, [&](int64_t lo, int64_t hi) {
+		MatrixKernels::vectorScale(hi - lo, src._data + lo, scalar, dest._data + lo);
+	}, MatrixElementwiseGrain);
 }
 
 template <class T>
@@ -601,7 +804,7 @@ template <class T>
 Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& A) {
 	Matrix<T> temp(*this);
 	multiply(*this, temp, A);
-	return this;
+	return *this;
 }
 
 template <class T>
@@ -610,6 +813,23 @@ Matrix<T>& Matrix<T>::operator*=(T scalar) {
 	return *this;
 }
 
+template <class T>
+template <class E>
+Matrix<T>& Matrix<T>::operator+=(const MatrixExpression<E, T>& expr) {
+	return *this = *this + expr.derived();
+}
+
+template <class T>
+template <class E>
+Matrix<T>& Matrix<T>::operator-=(const MatrixExpression<E, T>& expr) {
+	return *this = *this - expr.derived();
+}
+
+template <class T>
+T Matrix<T>::coeff(const int32_t row, const int32_t col) const {
+	return _data[(int64_t) row * _ld + col];
+}
+
 template <class T>
 int32_t Matrix<T>::rows() const {
 	return _rows;
@@ -621,17 +841,48 @@ int32_t Matrix<T>::cols() const {
 }
 
 template <class T>
-Matrix<T> Matrix<T>::operator-(const Matrix<T>& A) {
-	Matrix ret(A._rows, A._cols);
-	subtract(ret, *this, A);
-	return ret;
+int32_t Matrix<T>::ld() const {
+	return _ld;
+}
+
+template <class T>
+T* Matrix<T>::data() {
+	return _data;
+}
+
+template <class T>
+const T* Matrix<T>::data() const {
+	return _data;
+}
+
+template <class T>
+MatrixView<T> Matrix<T>::block(int32_t row, int32_t col, int32_t rows, int32_t cols) {
+	return MatrixView<T>(*this).block(row, col, rows, cols);
+}
+
+template <class T>
+ConstMatrixView<T> Matrix<T>::block(int32_t row, int32_t col, int32_t rows, int32_t cols) const {
+	return ConstMatrixView<T>(*this).block(row, col, rows, cols);
+}
+
+template <class T>
+MatrixView<T> Matrix<T>::row(int32_t row) {
+	return block(row, 0, 1, _cols);
 }
 
 template <class T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T>& A) {
-	Matrix ret(this->_rows, A._cols);
-	multiply(ret, *this, A);
-	return ret;
+ConstMatrixView<T> Matrix<T>::row(int32_t row) const {
+	return block(row, 0, 1, _cols);
+}
+
+template <class T>
+MatrixView<T> Matrix<T>::col(int32_t col) {
+	return block(0, col, _rows, 1);
+}
+
+template <class T>
+ConstMatrixView<T> Matrix<T>::col(int32_t col) const {
+	return block(0, col, _rows, 1);
 }
 
 template <class T>
@@ -639,11 +890,8 @@ void Matrix<T>::rowMultiply(int32_t row, T scalar) {
 	assert(row < _rows);
 	assert(_data != nullptr);
 
-	int32_t start = row * _cols;
-	int32_t end = start + _cols;
-	for (int32_t i = start; i < end; ++i) {
-		_data[i] *= scalar;
-	}
+	T* rowData = _data + (int64_t) row * _ld;
+	MatrixKernels::vectorScale(_cols, rowData, scalar, rowData);
 }
 
 template <class T>
@@ -651,21 +899,20 @@ void Matrix<T>::colMultiply(int32_t col, T scalar) {
 	assert(col < _cols);
 	assert(_data != nullptr);
 
-	int32_t start = col;
-	int32_t end = col + (_rows * _cols);
-	for (int32_t i = start; i < end; i += _cols) {
+	int64_t end = col + (int64_t) _rows * _ld;
+	for (int64_t i = col; i < end; i += _ld) {
 		_data[i] *= scalar;
 	}
 }
 
 template <class T>
-void Matrix<T>::rowSwap(int32_t row1, T row2) {
+void Matrix<T>::rowSwap(int32_t row1, int32_t row2) {
 	assert(row1 < _rows);
 	assert(row2 < _rows);
 	assert(_data != nullptr);
 
-	int32_t row1_end = row1 * _cols +_cols;
-	for (int32_t row1_index = row1 * _cols, row2_index = row2 * _cols; 
+	int64_t row1_end = (int64_t) row1 * _ld + _cols;
+	for (int64_t row1_index = (int64_t) row1 * _ld, row2_index = (int64_t) row2 * _ld;
 		row1_index < row1_end; ++row1_index) {
 		T temp = _data[row1_index];
 		_data[row1_index] = _data[row2_index];
@@ -680,7 +927,7 @@ void Matrix<T>::colSwap(int32_t col1, int32_t col2) {
 	assert(col2 < _cols);
 	assert(_data != nullptr);
 
-	for (int32_t rowOffset = 0; rowOffset <= _cols * (_rows - 1); rowOffset += _cols) {
+	for (int64_t rowOffset = 0; rowOffset <= (int64_t) _ld * (_rows - 1); rowOffset += _ld) {
 		T temp = _data[rowOffset + col1];
 		_data[rowOffset + col1] = _data[rowOffset + col2];
 		_data[rowOffset + col2] = temp;
@@ -693,12 +940,7 @@ void Matrix<T>::rowAdd(int32_t row1, int32_t row2, T scalar) {
 	assert(row2 < _rows);
 	assert(_data != nullptr);
 
-	int32_t row1_end = row1 * _cols +_cols;
-	for (int32_t row1_index = row1 * _cols, row2_index = row2 * _cols; 
-		row1_index < row1_end; ++row1_index) {
-		_data[row1_index] += scalar * _data[row2_index];
-		++row2_index;
-	}	
+	MatrixKernels::vectorAxpy(_cols, scalar, _data + (int64_t) row2 * _ld, _data + (int64_t) row1 * _ld);
 }
 
 template <class T>
@@ -706,15 +948,10 @@ void Matrix<T>::identity() {
 	assert(_rows == _cols);
 	assert(_data != nullptr);
 
-	int32_t size = _rows * _cols;
-	int32_t one_index = 0;
-	for (int32_t i = 0; i < size; ++i) {
-		if (i == one_index) {
-			_data[i] = 1;
-			one_index += _cols + 1;
-		} else {
-			_data[i] = 0;
-		}
+	for (int32_t i = 0; i < _rows; ++i) {
+		T* row = _data + (int64_t) i * _ld;
+		MatrixKernels::vectorFill(_cols, T(0), row);
+		row[i] = 1;
 	}
 }
 
@@ -722,10 +959,10 @@ template <class T>
 void Matrix<T>::fill(T value) {
 	assert(_data != nullptr);
 
-	int32_t size = _rows * _cols;
-	for (int32_t i = 0; i < size; ++i) {
-		_data[i] = value;
-	}
+	int64_t size = span();
+	MatrixParallel::run(0, size, size, [&](int64_t lo, int64_t hi) {
+		MatrixKernels::vectorFill(hi - lo, value, _data + lo);
+	}, MatrixElementwiseGrain);
 }
 
 template <class T>
@@ -736,6 +973,10 @@ void Matrix<T>::swap(Matrix<T>& A, Matrix<T>& B) {
 	T* temp = A._data;
 	A._data = B._data;
 	B._data = temp;
+
+	int32_t ld = A._ld;
+	A._ld = B._ld;
+	B._ld = ld;
 }
 
 template <class T>
@@ -743,11 +984,29 @@ void Matrix<T>::transpose(Matrix<T>& dest, const Matrix<T>& src) {
 	assert(src._rows == dest._cols);
 	assert(src._cols == dest._rows);
 
-	for (int32_t i = 0; i < src._rows; ++i) {
-		for (int32_t j = 0; j < src._cols; ++j) {
-			dest(j, i) = src(i, j);
-		}
+	assert(&dest != &src);
+
+	MatrixKernels::transpose(src._rows, src._cols, src._data, src._ld, dest._data, dest._ld);
+}
+
+template <class T>
+void Matrix<T>::transposeInPlace() {
+	if (_rows == _cols) {
+		MatrixKernels::transposeSquare(_rows, _data, _ld);
+		return;
 	}
+
+	// the cycles need packed rows, the result stays packed
+	// since the padded shape may not fit in the storage
+	for (int32_t i = 1; i < _rows && _ld != _cols; ++i) {
+		memmove(_data + (int64_t) i * _cols, _data + (int64_t) i * _ld, _cols * sizeof(T));
+	}
+	MatrixKernels::transposeInPlace(_rows, _cols, _data);
+
+	int32_t rows = _rows;
+	_rows = _cols;
+	_cols = rows;
+	_ld = _cols;
 }
 
 template <class T>
@@ -761,6 +1020,16 @@ void Matrix<T>::rowReduce() {
 
 template <class T>
 void Matrix<T>::inverse( Matrix<T>& dest, const Matrix<T>& src) {
+	int64_t n = src._rows;
+	if (MatrixBlas::applies<T>(n * n * n)) {
+		assert(src._rows == src._cols);
+		assert(dest._rows == src._rows);
+		assert(dest._cols == src._cols);
+		dest = src;
+		if (MatrixBlas::inverse(src._rows, dest._data, dest._ld)) {
+			return;
+		}
+	}
 	Matrix<T> temp(src._rows, src._rows);
 	inverse(dest, src, temp);
 }
@@ -781,10 +1050,25 @@ void Matrix<T>::inverse(Matrix<T>& dest, const Matrix<T>& src, Matrix<T>& temp)
 	temp.mirrorRowReduce(dest);
 }
 
+template <class T>
+void Matrix<T>::inverse(Matrix<T>& dest, const Matrix<T>& src, MatrixWorkspace& workspace) {
+	assert(src._rows == src._cols);
+	assert(dest._rows == src._rows);
+	assert(dest._cols == src._cols);
+
+	MatrixWorkspace::Frame frame(workspace);
+	MatrixView<T> LU = workspace.allocateMatrix<T>(src._rows, src._cols);
+	int32_t* pivots = workspace.allocate<int32_t>(src._rows);
+	LU.assign(src);
+	LUFactorization<T>::factorInPlace(LU, pivots);
+
+	dest.identity();
+	LUFactorization<T>::solveFactored(LU, pivots, dest);
+}
+
 template <class T>
 void Matrix<T>::solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x) {
-	Matrix temp(A._rows, A._cols);
-	solve(A, b, x, temp);
+	solveLU(A, b, x);
 }
 
 template <class T>
@@ -792,8 +1076,7 @@ void Matrix<T>::solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, Matr
 	assert(A._rows == A._cols);
 	assert(A._rows == b._rows);
 	assert(A._rows == x._rows);
-	assert(b._cols == 1);
-	assert(x._cols == 1);
+	assert(b._cols == x._cols);
 	assert(temp._rows == temp._cols);
 	assert(temp._rows == A._rows);
 	assert(b._data != nullptr);
@@ -811,34 +1094,99 @@ void Matrix<T>::solveLU(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x) {
 	assert(A._rows == A._cols);
 	assert(A._rows == b._rows);
 	assert(A._rows == x._rows);
-	assert(b._cols == 1);
-	assert(x._cols == 1);
+	assert(b._cols == x._cols);
 	assert(b._data != nullptr);
 	assert(A._data != nullptr);
 	assert(x._data != nullptr);
 
-	Matrix<T> lower(A._rows, A._rows);
-	Matrix<T> upper(A._rows, A._rows);
+	int64_t n = A._rows;
+	if (MatrixBlas::applies<T>(n * n * n)) {
+		Matrix<T> LU(A);
+		Matrix<T> work(b);
+		if (MatrixBlas::solve(A._rows, b._cols, LU._data, LU._ld, work._data, work._ld)) {
+			swap(x, work);
+			return;
+		}
+	}
+	LUFactorization<T> lu(A);
+	lu.solve(b, x);
+}
+
+template <class T>
+void Matrix<T>::solve(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace) {
+	solveLU(A, b, x, workspace);
+}
+
+template <class T>
+void Matrix<T>::solveLU(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace) {
+	assert(A._rows == A._cols);
+	assert(A._rows == b._rows);
+	assert(A._rows == x._rows);
+	assert(b._cols == x._cols);
 
-	// gets LU decomposition of A
-	A.decompLU(lower, upper);
+	MatrixWorkspace::Frame frame(workspace);
+	MatrixView<T> LU = workspace.allocateMatrix<T>(A._rows, A._cols);
+	int32_t* pivots = workspace.allocate<int32_t>(A._rows);
+	LU.assign(A);
+	LUFactorization<T>::factorInPlace(LU, pivots);
 
-	// solves L * y = b
-	Matrix y(b);
-	lower.rowReduceLower(&y);
+	if (&x != &b) {
+		MatrixView<T>(x).assign(b);
+	}
+	LUFactorization<T>::solveFactored(LU, pivots, x);
+}
 
-	// solves Ux = y
-	x = y;
-	upper.rowReduceHigher(&x);
+template <class T>
+size_t Matrix<T>::solveWorkspaceSize(int32_t n) {
+	return MatrixWorkspace::matrixBytes<T>(n, n) + MatrixWorkspace::arrayBytes<int32_t>(n);
 }
 
 template <class T>
 void Matrix<T>::leastSquares(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x) {
-	Matrix<T> AT(A._cols, A._rows);
-	Matrix<T>::transpose(AT, A);
-	Matrix<T> newA = AT * A;
-	Matrix<T> newB = AT * b;
-	solve(newA, newB, x);
+	if (MatrixBlas::applies<T>((int64_t) A._rows * A._cols * A._cols)) {
+		assert(A._rows >= A._cols);
+		assert(b._rows == A._rows);
+		assert(x._rows == A._cols);
+		assert(x._cols == b._cols);
+		Matrix<T> QR(A);
+		Matrix<T> work(b);
+		if (MatrixBlas::leastSquares(A._rows, A._cols, b._cols, QR._data, QR._ld, work._data, work._ld)) {
+			MatrixView<T>(x).assign(work.block(0, 0, A._cols, b._cols));
+			return;
+		}
+	}
+	QRFactorization<T> qr(A);
+	qr.solve(b, x);
+}
+
+template <class T>
+void Matrix<T>::leastSquares(const Matrix<T>& A, const Matrix<T>& b, Matrix<T>& x, MatrixWorkspace& workspace) {
+	assert(A._rows >= A._cols);
+	assert(b._rows == A._rows);
+	assert(x._rows == A._cols);
+	assert(x._cols == b._cols);
+
+	MatrixWorkspace::Frame frame(workspace);
+	MatrixView<T> QR = workspace.allocateMatrix<T>(A._rows, A._cols);
+	MatrixView<T> work = workspace.allocateMatrix<T>(b._rows, b._cols);
+	T* tau = workspace.allocate<T>(A._cols);
+	T* blockT = workspace.allocate<T>(QRFactorization<T>::blockTSize(A._cols));
+	T* scratch = workspace.allocate<T>(QRFactorization<T>::scratchSize(A._cols, b._cols));
+
+	QR.assign(A);
+	QRFactorization<T>::factorInPlace(QR, tau, blockT, scratch);
+	work.assign(b);
+	QRFactorization<T>::solveFactored(QR, blockT, work, scratch);
+	MatrixView<T>(x).assign(work.block(0, 0, A._cols, b._cols));
+}
+
+template <class T>
+size_t Matrix<T>::leastSquaresWorkspaceSize(int32_t rows, int32_t cols, int32_t k) {
+	return MatrixWorkspace::matrixBytes<T>(rows, cols) +
+		MatrixWorkspace::matrixBytes<T>(rows, k) +
+		MatrixWorkspace::arrayBytes<T>(cols) +
+		MatrixWorkspace::arrayBytes<T>(QRFactorization<T>::blockTSize(cols)) +
+		MatrixWorkspace::arrayBytes<T>(QRFactorization<T>::scratchSize(cols, k));
 }
 
 template <class T>
@@ -851,19 +1199,19 @@ void Matrix<T>::decompLU(Matrix& lower, Matrix& upper) const {
 	assert(lower._data != nullptr);
 	assert(upper._data != nullptr);
 
-	memcpy(upper._data, _data, _rows * _cols * sizeof(T));
+	upper.copyFrom(_data, _ld);
 
 	// following code is basically copied from rowReduceLower()
 	// with tiny modifications to save data to form the lower triangular matrix
 
 	// column the pivot is in 
-	uint8_t pivot = 0;
-	for (uint8_t i = 0; i < _cols; ++i) {
+	int32_t pivot = 0;
+	for (int32_t i = 0; i < _cols; ++i) {
 		bool zero_col = true;
-		for (uint8_t j = pivot; j < _rows; ++j) {
+		for (int32_t j = pivot; j < _rows; ++j) {
 			// searches down the column for first non-zero entry
 			// where non-zero means greater than threshold values
-			float element = std::fabs(upper(j, i));
+			T element = std::fabs(upper(j, i));
 			if (element > _threshold) {
 				if (pivot != j) {
 					// swap to make the pivot non-zero
@@ -883,7 +1231,7 @@ void Matrix<T>::decompLU(Matrix& lower, Matrix& upper) const {
 		}
 
 		// sets entries before pivot to 0
-		for (uint8_t k = 0; k < pivot; ++k) {
+		for (int32_t k = 0; k < pivot; ++k) {
 			lower(k, pivot) = 0;
 		}
 
@@ -893,7 +1241,7 @@ void Matrix<T>::decompLU(Matrix& lower, Matrix& upper) const {
 		upper.rowMultiply(pivot, 1.0 / upper(pivot, i));
 
 		// make all entries under the pivot = 0
-		for (uint8_t k = pivot + 1; k < _rows; ++k) {
+		for (int32_t k = pivot + 1; k < _rows; ++k) {
 			lower(k, pivot) = upper(k, i);
 			upper.rowAdd(k, pivot, -upper(k, i));
 		}
@@ -948,13 +1296,18 @@ void Matrix<T>::rowReduceLower(Matrix<T>* other) {
 		}
 
 		//make all entires under the pivot equal 0
-		for (int32_t k = pivot + 1; k < _rows; ++k) {
-			scale = -(*this)(k, i);
-			rowAdd(k, pivot, scale);
-			if (other != nullptr) {
-				other -> rowAdd(k, pivot, scale);
+		// the rows are independent, so large updates are split across threads
+		int64_t work = (int64_t) (_rows - pivot - 1) *
+			(_cols + ((other != nullptr) ? other->_cols : 0));
+		MatrixParallel::run(pivot + 1, _rows, work, [&](int64_t lo, int64_t hi) {
+			for (int32_t k = (int32_t) lo; k < (int32_t) hi; ++k) {
+				T rowScale = -(*this)(k, i);
+				rowAdd(k, pivot, rowScale);
+				if (other != nullptr) {
+					other -> rowAdd(k, pivot, rowScale);
+				}
 			}
-		}
+		});
 
 		++pivot;
 	}
@@ -962,7 +1315,6 @@ void Matrix<T>::rowReduceLower(Matrix<T>* other) {
 
 template <class T>
 void Matrix<T>::rowReduceHigher(Matrix<T>* other) {
-	T scale;
 	// column to keep track of leading ones
 	int32_t temp_col = 0;
 	for (int32_t i = 0; i < _rows; ++i) {
@@ -980,16 +1332,58 @@ void Matrix<T>::rowReduceHigher(Matrix<T>* other) {
 			// prevents k from wrapping around if int32_t is unsigned
 			continue;
 		}
-		for (int32_t k = i - 1; k >= 0; --k) {
-			scale = -(*this)(k, temp_col);
-			rowAdd(k, i, scale);
-			if (other != nullptr) {
-				other -> rowAdd(k, i, scale);
+		int64_t work = (int64_t) i * (_cols + ((other != nullptr) ? other->_cols : 0));
+		MatrixParallel::run(0, i, work, [&](int64_t lo, int64_t hi) {
+			for (int32_t k = (int32_t) lo; k < (int32_t) hi; ++k) {
+				T rowScale = -(*this)(k, temp_col);
+				rowAdd(k, i, rowScale);
+				if (other != nullptr) {
+					other -> rowAdd(k, i, rowScale);
+				}
 			}
+		});
+	}
+}
+
+template <class T>
+void Matrix<T>::allocate() {
+	_ld = MatrixLayout::leadingDimension<T>(_cols);
+	_data = MatrixLayout::allocate<T>((int64_t) _rows * _ld);
+	if (_ld != _cols) {
+		for (int32_t i = 0; i < _rows; ++i) {
+			MatrixKernels::vectorFill(_ld - _cols, T(0), _data + (int64_t) i * _ld + _cols);
 		}
 	}
 }
 
+template <class T>
+void Matrix<T>::copyFrom(const T* src, int32_t lds) {
+	if (lds == _ld) {
+		// padding between rows is copied too, it is initialized in both
+		memcpy(_data, src, span() * sizeof(T));
+		return;
+	}
+	for (int32_t i = 0; i < _rows; ++i) {
+		memcpy(_data + (int64_t) i * _ld, src + (int64_t) i * lds, _cols * sizeof(T));
+	}
 }
 
+template <class T>
+int64_t Matrix<T>::span() const {
+	return (int64_t) (_rows - 1) * _ld + _cols;
+}
+
+template <class T>
+bool Matrix<T>::sameLayout(const Matrix<T>& A, const Matrix<T>& B) {
+	return A._ld == B._ld;
+}
+
+}
+
+// the factorizations use Matrix, so they are included once Matrix is defined
+#include "LUFactorization.hpp"
+#include "CholeskyFactorization.hpp"
+#include "QRFactorization.hpp"
+#include "MatrixView.hpp"
+
 #endif /* _MATRIX_HPP */
@@ -0,0 +1,474 @@
+#ifndef _MATRIX_BATCH_HPP
+#define _MATRIX_BATCH_HPP
+
+/**
+ * Batches of small matrices of the same size (around 2x2 to 8x8)
+ * stored batch-interleaved: element (i, j) of every matrix in the batch is
+ * contiguous. The batched kernels loop over the batch innermost, so they
+ * vectorize across matrices instead of within one, and the batch is split
+ * into tiles that are spread across MatrixParallel threads.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class MatrixBatch {
+public:
+	/**
+	 * @brief matrices processed together by the batched kernels,
+	 * small enough for a tile of 8x8 matrices to stay in L1
+	 */
+	static const int32_t TileSize = 64;
+
+	/**
+	 * @brief Constructs count matrices of size rows x cols, set to zero
+	 */
+	MatrixBatch(int32_t count, int32_t rows, int32_t cols);
+
+	int32_t count() const;
+	int32_t rows() const;
+	int32_t cols() const;
+
+	/**
+	 * @brief gets reference to element (row, col) of one matrix
+	 */
+	T& operator()(int32_t matrix, int32_t row, int32_t col);
+
+	T operator()(int32_t matrix, int32_t row, int32_t col) const;
+
+	/**
+	 * @brief returns element (row, col) of every matrix, count() long
+	 */
+	T* element(int32_t row, int32_t col);
+	const T* element(int32_t row, int32_t col) const;
+
+	/**
+	 * @brief copies mat into one matrix of the batch
+	 */
+	void set(int32_t matrix, const Matrix<T>& mat);
+
+	/**
+	 * @brief copies one matrix of the batch into mat
+	 */
+	void get(int32_t matrix, Matrix<T>& mat) const;
+
+	/**
+	 * @brief computes dest = A * B for every matrix in the batch
+	 * @details dest can NOT be the same as A or B
+	 */
+	static void multiply(MatrixBatch<T>& dest, const MatrixBatch<T>& A, const MatrixBatch<T>& B);
+
+	/**
+	 * @brief solves A * x = b for every matrix in the batch
+	 * @details b and x can have several columns, x can be the same as b.
+	 * NOTE: undefined behavior for singular matrices
+	 */
+	static void solve(const MatrixBatch<T>& A, const MatrixBatch<T>& b, MatrixBatch<T>& x);
+
+	/**
+	 * @brief takes the inverse of every matrix in src
+	 * @details prefer solve() when the inverse is only multiplied with
+	 * NOTE: undefined behavior for singular matrices
+	 */
+	static void inverse(MatrixBatch<T>& dest, const MatrixBatch<T>& src);
+
+	/**
+	 * @brief calls fn(lo, hi) over tiles of matrices [lo, hi),
+	 * across threads when the batch is large
+	 * @param work rough cost of one matrix
+	 */
+	template <class Fn>
+	void forEachTile(int64_t work, const Fn& fn) const;
+
+private:
+	int32_t _count;
+	int32_t _rows;
+	int32_t _cols;
+	std::vector<T> _data;
+};
+
+/**
+ * @brief LU factorization with partial pivoting of every matrix in a batch
+ * @details each matrix pivots on its own largest element. rows are
+ * swapped with selects rather than branches so the batch stays vectorized
+ */
+template <class T>
+class MatrixBatchLU {
+public:
+	/**
+	 * @brief Factors every matrix of A
+	 * @details the matrices must be square
+	 */
+	explicit MatrixBatchLU(const MatrixBatch<T>& A);
+
+	/**
+	 * @brief Factors a new batch
+	 */
+	void factor(const MatrixBatch<T>& A);
+
+	/**
+	 * @brief returns true if the matrix had a zero pivot
+	 */
+	bool singular(int32_t matrix) const;
+
+	/**
+	 * @brief solves A * x = b for every matrix
+	 * @details x can be the same as b
+	 */
+	void solve(const MatrixBatch<T>& b, MatrixBatch<T>& x) const;
+
+	/**
+	 * @brief stores the inverse of every matrix into dest
+	 */
+	void inverse(MatrixBatch<T>& dest) const;
+
+	/**
+	 * @brief returns L and U packed like LUFactorization::packed()
+	 */
+	const MatrixBatch<T>& packed() const;
+
+private:
+	MatrixBatch<T> _LU;
+
+	// row swapped with row k of each matrix, element (k, matrix)
+	std::vector<int32_t> _pivots;
+
+	void decompose();
+	void factorTile(int32_t lo, int32_t hi);
+	void solveTile(MatrixBatch<T>& x, int32_t lo, int32_t hi) const;
+};
+
+template <class T>
+MatrixBatch<T>::MatrixBatch(int32_t count, int32_t rows, int32_t cols) :
+	_count(count), _rows(rows), _cols(cols),
+	_data((size_t) count * rows * cols, T(0)) {
+	assert(count > 0);
+	assert(rows > 0);
+	assert(cols > 0);
+}
+
+template <class T>
+int32_t MatrixBatch<T>::count() const {
+	return _count;
+}
+
+template <class T>
+int32_t MatrixBatch<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t MatrixBatch<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+T& MatrixBatch<T>::operator()(int32_t matrix, int32_t row, int32_t col) {
+	return element(row, col)[matrix];
+}
+
+template <class T>
+T MatrixBatch<T>::operator()(int32_t matrix, int32_t row, int32_t col) const {
+	return element(row, col)[matrix];
+}
+
+template <class T>
+T* MatrixBatch<T>::element(int32_t row, int32_t col) {
+	assert(row < _rows);
+	assert(col < _cols);
+	return _data.data() + ((int64_t) row * _cols + col) * _count;
+}
+
+template <class T>
+const T* MatrixBatch<T>::element(int32_t row, int32_t col) const {
+	assert(row < _rows);
+	assert(col < _cols);
+	return _data.data() + ((int64_t) row * _cols + col) * _count;
+}
+
+template <class T>
+void MatrixBatch<T>::set(int32_t matrix, const Matrix<T>& mat) {
+	assert(mat.rows() == _rows);
+	assert(mat.cols() == _cols);
+	for (int32_t i = 0; i < _rows; ++i) {
+		for (int32_t j = 0; j < _cols; ++j) {
+			(*this)(matrix, i, j) = mat(i, j);
+		}
+	}
+}
+
+template <class T>
+void MatrixBatch<T>::get(int32_t matrix, Matrix<T>& mat) const {
+	assert(mat.rows() == _rows);
+	assert(mat.cols() == _cols);
+	for (int32_t i = 0; i < _rows; ++i) {
+		for (int32_t j = 0; j < _cols; ++j) {
+			mat(i, j) = (*this)(matrix, i, j);
+		}
+	}
+}
+
+template <class T>
+template <class Fn>
+void MatrixBatch<T>::forEachTile(int64_t work, const Fn& fn) const {
+	int32_t tiles = (_count + TileSize - 1) / TileSize;
+	MatrixParallel::run(0, tiles, work * _count, [&](int64_t first, int64_t last) {
+		for (int64_t t = first; t < last; ++t) {
+			int32_t lo = (int32_t) t * TileSize;
+			int32_t hi = (lo + TileSize < _count) ? lo + TileSize : _count;
+			fn(lo, hi);
+		}
+	});
+}
+
+template <class T>
+void MatrixBatch<T>::multiply(MatrixBatch<T>& dest, const MatrixBatch<T>& A, const MatrixBatch<T>& B) {
+	assert(A._count == B._count);
+	assert(A._count == dest._count);
+	assert(A._cols == B._rows);
+	assert(dest._rows == A._rows);
+	assert(dest._cols == B._cols);
+	assert(&dest != &A);
+	assert(&dest != &B);
+
+	dest.forEachTile((int64_t) A._rows * A._cols * B._cols, [&](int32_t lo, int32_t hi) {
+		for (int32_t i = 0; i < dest._rows; ++i) {
+			for (int32_t j = 0; j < dest._cols; ++j) {
+				T* out = dest.element(i, j);
+				for (int32_t b = lo; b < hi; ++b) {
+					out[b] = 0;
+				}
+				for (int32_t k = 0; k < A._cols; ++k) {
+					const T* a = A.element(i, k);
+					const T* bk = B.element(k, j);
+					for (int32_t b = lo; b < hi; ++b) {
+						out[b] += a[b] * bk[b];
+					}
+				}
+			}
+		}
+	});
+}
+
+template <class T>
+void MatrixBatch<T>::solve(const MatrixBatch<T>& A, const MatrixBatch<T>& b, MatrixBatch<T>& x) {
+	MatrixBatchLU<T> lu(A);
+	lu.solve(b, x);
+}
+
+template <class T>
+void MatrixBatch<T>::inverse(MatrixBatch<T>& dest, const MatrixBatch<T>& src) {
+	MatrixBatchLU<T> lu(src);
+	lu.inverse(dest);
+}
+
+template <class T>
+MatrixBatchLU<T>::MatrixBatchLU(const MatrixBatch<T>& A) :
+	_LU(A) {
+	assert(A.rows() == A.cols());
+	decompose();
+}
+
+template <class T>
+void MatrixBatchLU<T>::factor(const MatrixBatch<T>& A) {
+	assert(A.rows() == A.cols());
+
+	_LU = A;
+	decompose();
+}
+
+template <class T>
+void MatrixBatchLU<T>::decompose() {
+	_pivots.resize((size_t) _LU.rows() * _LU.count());
+	int64_t n = _LU.rows();
+	_LU.forEachTile(n * n * n, [&](int32_t lo, int32_t hi) {
+		factorTile(lo, hi);
+	});
+}
+
+template <class T>
+void MatrixBatchLU<T>::factorTile(int32_t lo, int32_t hi) {
+	const int32_t n = _LU.rows();
+	const int32_t count = _LU.count();
+	const int32_t width = hi - lo;
+	T best[MatrixBatch<T>::TileSize];
+	T inv[MatrixBatch<T>::TileSize];
+	int32_t pivot[MatrixBatch<T>::TileSize];
+
+	for (int32_t k = 0; k < n; ++k) {
+		// largest magnitude in column k of each matrix
+		const T* diag = _LU.element(k, k) + lo;
+		for (int32_t b = 0; b < width; ++b) {
+			pivot[b] = k;
+			best[b] = std::abs(diag[b]);
+		}
+		for (int32_t r = k + 1; r < n; ++r) {
+			const T* col = _LU.element(r, k) + lo;
+			for (int32_t b = 0; b < width; ++b) {
+				T value = std::abs(col[b]);
+				bool larger = value > best[b];
+				best[b] = larger ? value : best[b];
+				pivot[b] = larger ? r : pivot[b];
+			}
+		}
+		int32_t* saved = _pivots.data() + (int64_t) k * count + lo;
+		for (int32_t b = 0; b < width; ++b) {
+			saved[b] = pivot[b];
+		}
+
+		// swap row k with the pivot row, per matrix
+		for (int32_t r = k + 1; r < n; ++r) {
+			for (int32_t j = 0; j < n; ++j) {
+				T* rowK = _LU.element(k, j) + lo;
+				T* rowR = _LU.element(r, j) + lo;
+				for (int32_t b = 0; b < width; ++b) {
+					bool swap = pivot[b] == r;
+					T valueK = rowK[b];
+					T valueR = rowR[b];
+					rowK[b] = swap ? valueR : valueK;
+					rowR[b] = swap ? valueK : valueR;
+				}
+			}
+		}
+
+		for (int32_t b = 0; b < width; ++b) {
+			inv[b] = T(1) / diag[b];
+		}
+
+		// eliminate below the pivot
+		for (int32_t r = k + 1; r < n; ++r) {
+			T* l = _LU.element(r, k) + lo;
+			for (int32_t b = 0; b < width; ++b) {
+				l[b] *= inv[b];
+			}
+			for (int32_t j = k + 1; j < n; ++j) {
+				T* out = _LU.element(r, j) + lo;
+				const T* u = _LU.element(k, j) + lo;
+				for (int32_t b = 0; b < width; ++b) {
+					out[b] -= l[b] * u[b];
+				}
+			}
+		}
+	}
+}
+
+template <class T>
+bool MatrixBatchLU<T>::singular(int32_t matrix) const {
+	for (int32_t k = 0; k < _LU.rows(); ++k) {
+		if (_LU(matrix, k, k) == T(0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <class T>
+void MatrixBatchLU<T>::solve(const MatrixBatch<T>& b, MatrixBatch<T>& x) const {
+	assert(b.count() == _LU.count());
+	assert(b.rows() == _LU.rows());
+
+	if (&x != &b) {
+		x = b;
+	}
+	int64_t n = _LU.rows();
+	x.forEachTile(n * n * x.cols(), [&](int32_t lo, int32_t hi) {
+		solveTile(x, lo, hi);
+	});
+}
+
+template <class T>
+void MatrixBatchLU<T>::solveTile(MatrixBatch<T>& x, int32_t lo, int32_t hi) const {
+	const int32_t n = _LU.rows();
+	const int32_t m = x.cols();
+	const int32_t count = _LU.count();
+
+	// apply the row swaps in order
+	for (int32_t k = 0; k < n; ++k) {
+		const int32_t* pivot = _pivots.data() + (int64_t) k * count;
+		for (int32_t r = k + 1; r < n; ++r) {
+			for (int32_t j = 0; j < m; ++j) {
+				T* rowK = x.element(k, j);
+				T* rowR = x.element(r, j);
+				for (int32_t b = lo; b < hi; ++b) {
+					bool swap = pivot[b] == r;
+					T valueK = rowK[b];
+					T valueR = rowR[b];
+					rowK[b] = swap ? valueR : valueK;
+					rowR[b] = swap ? valueK : valueR;
+				}
+			}
+		}
+	}
+
+	// L * y = P * b
+	for (int32_t k = 0; k < n; ++k) {
+		for (int32_t r = k + 1; r < n; ++r) {
+			const T* l = _LU.element(r, k);
+			for (int32_t j = 0; j < m; ++j) {
+				T* out = x.element(r, j);
+				const T* y = x.element(k, j);
+				for (int32_t b = lo; b < hi; ++b) {
+					out[b] -= l[b] * y[b];
+				}
+			}
+		}
+	}
+
+	// U * x = y
+	T inv[MatrixBatch<T>::TileSize];
+	for (int32_t k = n - 1; k >= 0; --k) {
+		const T* diag = _LU.element(k, k);
+		for (int32_t b = lo; b < hi; ++b) {
+			inv[b - lo] = T(1) / diag[b];
+		}
+		for (int32_t j = 0; j < m; ++j) {
+			T* out = x.element(k, j);
+			for (int32_t b = lo; b < hi; ++b) {
+				out[b] *= inv[b - lo];
+			}
+		}
+		for (int32_t r = 0; r < k; ++r) {
+			const T* u = _LU.element(r, k);
+			for (int32_t j = 0; j < m; ++j) {
+				T* out = x.element(r, j);
+				const T* y = x.element(k, j);
+				for (int32_t b = lo; b < hi; ++b) {
+					out[b] -= u[b] * y[b];
+				}
+			}
+		}
+	}
+}
+
+template <class T>
+void MatrixBatchLU<T>::inverse(MatrixBatch<T>& dest) const {
+	assert(dest.count() == _LU.count());
+	assert(dest.rows() == _LU.rows());
+	assert(dest.cols() == _LU.cols());
+
+	for (int32_t i = 0; i < dest.rows(); ++i) {
+		for (int32_t j = 0; j < dest.cols(); ++j) {
+			T* out = dest.element(i, j);
+			T value = (i == j) ? T(1) : T(0);
+			for (int32_t b = 0; b < dest.count(); ++b) {
+				out[b] = value;
+			}
+		}
+	}
+	solve(dest, dest);
+}
+
+template <class T>
+const MatrixBatch<T>& MatrixBatchLU<T>::packed() const {
+	return _LU;
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_BATCH_HPP */
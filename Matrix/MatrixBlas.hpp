@@ -0,0 +1,391 @@
+#ifndef _MATRIX_BLAS_HPP
+#define _MATRIX_BLAS_HPP
+
+/**
+ * Optional BLAS / LAPACK backend for Matrix
+ * Define MATRIX_USE_BLAS and link a CBLAS and LAPACK (OpenBLAS has both,
+ * -lopenblas) to send large float and double products, solves, inverses
+ * and least squares problems to the vendor library. Without the define,
+ * or below threshold(), Matrix uses its own kernels.
+ * LAPACK is column major, so a row major matrix is handed over as its
+ * transpose and the transposed problem is solved.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef MATRIX_USE_BLAS
+#include <cblas.h>
+
+extern "C" {
+// Fortran LAPACK, the trailing size_t is the hidden length of character arguments
+void sgetrf_(const int* m, const int* n, float* a, const int* lda, int* ipiv, int* info);
+void dgetrf_(const int* m, const int* n, double* a, const int* lda, int* ipiv, int* info);
+void sgetrs_(const char* trans, const int* n, const int* nrhs, const float* a, const int* lda,
+	const int* ipiv, float* b, const int* ldb, int* info, size_t);
+void dgetrs_(const char* trans, const int* n, const int* nrhs, const double* a, const int* lda,
+	const int* ipiv, double* b, const int* ldb, int* info, size_t);
+void sgetri_(const int* n, float* a, const int* lda, const int* ipiv, float* work,
+	const int* lwork, int* info);
+void dgetri_(const int* n, double* a, const int* lda, const int* ipiv, double* work,
+	const int* lwork, int* info);
+void sgels_(const char* trans, const int* m, const int* n, const int* nrhs, float* a, const int* lda,
+	float* b, const int* ldb, float* work, const int* lwork, int* info, size_t);
+void dgels_(const char* trans, const int* m, const int* n, const int* nrhs, double* a, const int* lda,
+	double* b, const int* ldb, double* work, const int* lwork, int* info, size_t);
+}
+#endif
+
+namespace Alectryon {
+
+/**
+ * @brief Settings and entry points of the BLAS / LAPACK backend
+ * @details Settings must not be changed while matrix operations are running.
+ * The entry points may only be called when applies() is true
+ */
+class MatrixBlas {
+public:
+	/**
+	 * @brief returns true if built with MATRIX_USE_BLAS
+	 */
+	static bool available();
+
+	/**
+	 * @brief Turns the backend on or off at runtime, on by default when available
+	 */
+	static void setEnabled(bool enabled);
+
+	static bool enabled();
+
+	/**
+	 * @brief Sets the minimum amount of work (roughly multiply-adds)
+	 * before an operation goes to the backend
+	 * @details small problems are faster without the library call and
+	 * the copies LAPACK's column major layout needs
+	 */
+	static void setThreshold(int64_t work);
+
+	static int64_t threshold();
+
+	/**
+	 * @brief returns true if an operation on T with this much work goes to the backend
+	 */
+	template <class T>
+	static bool applies(int64_t work);
+
+	/**
+	 * @brief computes C = alpha * A * B + beta * C, as MatrixKernels::gemm()
+	 */
+	static void gemm(int32_t m, int32_t n, int32_t k, float alpha, const float* A, int32_t lda,
+		const float* B, int32_t ldb, float beta, float* C, int32_t ldc);
+	static void gemm(int32_t m, int32_t n, int32_t k, double alpha, const double* A, int32_t lda,
+		const double* B, int32_t ldb, double beta, double* C, int32_t ldc);
+
+	/**
+	 * @brief Solves A * X = B with getrf / getrs
+	 * @details A is n x n and overwritten with its factors, B is n x k and
+	 * overwritten with X. returns false if A is singular
+	 */
+	static bool solve(int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb);
+	static bool solve(int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb);
+
+	/**
+	 * @brief Inverts the n x n matrix A in place with getrf / getri
+	 * @details returns false if A is singular
+	 */
+	static bool inverse(int32_t n, float* A, int32_t lda);
+	static bool inverse(int32_t n, double* A, int32_t lda);
+
+	/**
+	 * @brief Solves min ||A * X - B|| with gels
+	 * @details A is m x n with m >= n and full rank, it is overwritten.
+	 * B is m x k, afterwards its first n rows hold X.
+	 * returns false if A is rank deficient
+	 */
+	static bool leastSquares(int32_t m, int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb);
+	static bool leastSquares(int32_t m, int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb);
+
+	/**
+	 * @brief other types never reach the backend, applies() is false for them
+	 */
+	template <class T>
+	static void gemm(int32_t m, int32_t n, int32_t k, T alpha, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T beta, T* C, int32_t ldc);
+	template <class T>
+	static bool solve(int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb);
+	template <class T>
+	static bool inverse(int32_t n, T* A, int32_t lda);
+	template <class T>
+	static bool leastSquares(int32_t m, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb);
+
+private:
+	struct State {
+		bool enabled;
+		int64_t threshold;
+	};
+
+	static State& state();
+
+	template <class T>
+	struct Supported { static const bool value = false; };
+
+#ifdef MATRIX_USE_BLAS
+	/**
+	 * @brief copies the rows x cols row major src into column major dest
+	 */
+	template <class T>
+	static void toColumnMajor(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd);
+
+	/**
+	 * @brief copies the rows x cols column major src into row major dest
+	 */
+	template <class T>
+	static void fromColumnMajor(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd);
+
+	template <class T, class Getrf, class Getrs>
+	static bool solveWith(Getrf getrf, Getrs getrs, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb);
+
+	template <class T, class Getrf, class Getri>
+	static bool inverseWith(Getrf getrf, Getri getri, int32_t n, T* A, int32_t lda);
+
+	template <class T, class Gels>
+	static bool leastSquaresWith(Gels gels, int32_t m, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb);
+#endif
+};
+
+template <>
+struct MatrixBlas::Supported<float> { static const bool value = true; };
+
+template <>
+struct MatrixBlas::Supported<double> { static const bool value = true; };
+
+inline MatrixBlas::State& MatrixBlas::state() {
+	static State s = { true, (int64_t) 1 << 18 };
+	return s;
+}
+
+inline bool MatrixBlas::available() {
+#ifdef MATRIX_USE_BLAS
+	return true;
+#else
+	return false;
+#endif
+}
+
+inline void MatrixBlas::setEnabled(bool enabled) {
+	state().enabled = enabled;
+}
+
+inline bool MatrixBlas::enabled() {
+	return available() && state().enabled;
+}
+
+inline void MatrixBlas::setThreshold(int64_t work) {
+	state().threshold = work;
+}
+
+inline int64_t MatrixBlas::threshold() {
+	return state().threshold;
+}
+
+template <class T>
+bool MatrixBlas::applies(int64_t work) {
+	return Supported<T>::value && enabled() && work >= state().threshold;
+}
+
+template <class T>
+void MatrixBlas::gemm(int32_t m, int32_t n, int32_t k, T alpha, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T beta, T* C, int32_t ldc) {
+	assert(false);
+}
+
+template <class T>
+bool MatrixBlas::solve(int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+template <class T>
+bool MatrixBlas::inverse(int32_t n, T* A, int32_t lda) {
+	assert(false);
+	return false;
+}
+
+template <class T>
+bool MatrixBlas::leastSquares(int32_t m, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+#ifdef MATRIX_USE_BLAS
+
+inline void MatrixBlas::gemm(int32_t m, int32_t n, int32_t k, float alpha, const float* A, int32_t lda,
+		const float* B, int32_t ldb, float beta, float* C, int32_t ldc) {
+	cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+inline void MatrixBlas::gemm(int32_t m, int32_t n, int32_t k, double alpha, const double* A, int32_t lda,
+		const double* B, int32_t ldb, double beta, double* C, int32_t ldc) {
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+inline bool MatrixBlas::solve(int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb) {
+	return solveWith(sgetrf_, sgetrs_, n, k, A, lda, B, ldb);
+}
+
+inline bool MatrixBlas::solve(int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb) {
+	return solveWith(dgetrf_, dgetrs_, n, k, A, lda, B, ldb);
+}
+
+inline bool MatrixBlas::inverse(int32_t n, float* A, int32_t lda) {
+	return inverseWith(sgetrf_, sgetri_, n, A, lda);
+}
+
+inline bool MatrixBlas::inverse(int32_t n, double* A, int32_t lda) {
+	return inverseWith(dgetrf_, dgetri_, n, A, lda);
+}
+
+inline bool MatrixBlas::leastSquares(int32_t m, int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb) {
+	return leastSquaresWith(sgels_, m, n, k, A, lda, B, ldb);
+}
+
+inline bool MatrixBlas::leastSquares(int32_t m, int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb) {
+	return leastSquaresWith(dgels_, m, n, k, A, lda, B, ldb);
+}
+
+template <class T>
+void MatrixBlas::toColumnMajor(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd) {
+	for (int32_t i = 0; i < rows; ++i) {
+		const T* row = src + (int64_t) i * lds;
+		for (int32_t j = 0; j < cols; ++j) {
+			dest[(int64_t) j * ldd + i] = row[j];
+		}
+	}
+}
+
+template <class T>
+void MatrixBlas::fromColumnMajor(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd) {
+	for (int32_t i = 0; i < rows; ++i) {
+		T* row = dest + (int64_t) i * ldd;
+		for (int32_t j = 0; j < cols; ++j) {
+			row[j] = src[(int64_t) j * lds + i];
+		}
+	}
+}
+
+template <class T, class Getrf, class Getrs>
+bool MatrixBlas::solveWith(Getrf getrf, Getrs getrs, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb) {
+	// the row major A is A^T to LAPACK, so factor A^T and solve (A^T)^T * X = B
+	int N = n;
+	int K = k;
+	int LDA = lda;
+	int info = 0;
+	std::vector<int> pivots(n);
+	getrf(&N, &N, A, &LDA, pivots.data(), &info);
+	if (info != 0) {
+		return false;
+	}
+
+	std::vector<T> columns((size_t) n * k);
+	toColumnMajor(n, k, B, ldb, columns.data(), n);
+	const char trans = 'T';
+	getrs(&trans, &N, &K, A, &LDA, pivots.data(), columns.data(), &N, &info, 1);
+	fromColumnMajor(n, k, columns.data(), n, B, ldb);
+	return info == 0;
+}
+
+template <class T, class Getrf, class Getri>
+bool MatrixBlas::inverseWith(Getrf getrf, Getri getri, int32_t n, T* A, int32_t lda) {
+	// inverting A^T in place leaves (A^-1)^T, which read row major is A^-1
+	int N = n;
+	int LDA = lda;
+	int info = 0;
+	std::vector<int> pivots(n);
+	getrf(&N, &N, A, &LDA, pivots.data(), &info);
+	if (info != 0) {
+		return false;
+	}
+
+	T query = 0;
+	int lwork = -1;
+	getri(&N, A, &LDA, pivots.data(), &query, &lwork, &info);
+	lwork = (int) query;
+	std::vector<T> work(lwork > 1 ? lwork : 1);
+	getri(&N, A, &LDA, pivots.data(), work.data(), &lwork, &info);
+	return info == 0;
+}
+
+template <class T, class Gels>
+bool MatrixBlas::leastSquaresWith(Gels gels, int32_t m, int32_t n, int32_t k, T* A, int32_t lda, T* B, int32_t ldb) {
+	// LAPACK sees the n x m matrix A^T, and gels with 'T' solves
+	// the overdetermined (A^T)^T * X = B in the least squares sense
+	int M = n;
+	int N = m;
+	int K = k;
+	int LDA = lda;
+	int LDB = m;
+	int info = 0;
+	std::vector<T> columns((size_t) m * k);
+	toColumnMajor(m, k, B, ldb, columns.data(), m);
+
+	const char trans = 'T';
+	T query = 0;
+	int lwork = -1;
+	gels(&trans, &M, &N, &K, A, &LDA, columns.data(), &LDB, &query, &lwork, &info, 1);
+	lwork = (int) query;
+	std::vector<T> work(lwork > 1 ? lwork : 1);
+	gels(&trans, &M, &N, &K, A, &LDA, columns.data(), &LDB, work.data(), &lwork, &info, 1);
+
+	fromColumnMajor(n, k, columns.data(), m, B, ldb);
+	return info == 0;
+}
+
+#else
+
+inline void MatrixBlas::gemm(int32_t m, int32_t n, int32_t k, float alpha, const float* A, int32_t lda,
+		const float* B, int32_t ldb, float beta, float* C, int32_t ldc) {
+	assert(false);
+}
+
+inline void MatrixBlas::gemm(int32_t m, int32_t n, int32_t k, double alpha, const double* A, int32_t lda,
+		const double* B, int32_t ldb, double beta, double* C, int32_t ldc) {
+	assert(false);
+}
+
+inline bool MatrixBlas::solve(int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+inline bool MatrixBlas::solve(int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+inline bool MatrixBlas::inverse(int32_t n, float* A, int32_t lda) {
+	assert(false);
+	return false;
+}
+
+inline bool MatrixBlas::inverse(int32_t n, double* A, int32_t lda) {
+	assert(false);
+	return false;
+}
+
+inline bool MatrixBlas::leastSquares(int32_t m, int32_t n, int32_t k, float* A, int32_t lda, float* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+inline bool MatrixBlas::leastSquares(int32_t m, int32_t n, int32_t k, double* A, int32_t lda, double* B, int32_t ldb) {
+	assert(false);
+	return false;
+}
+
+#endif
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_BLAS_HPP */
@@ -0,0 +1,442 @@
+#ifndef _MATRIX_EXPRESSION_HPP
+#define _MATRIX_EXPRESSION_HPP
+
+/**
+ * Expression templates for Matrix arithmetic
+ * The arithmetic operators build lightweight expression objects instead of
+ * new matrices. An expression is evaluated in one fused loop when it is
+ * assigned to a Matrix, so D = A + B * 2 - C allocates nothing and makes
+ * one pass over memory. Products are evaluated with gemm, and
+ * D = alpha * A * B + beta * C is done as one gemm into D.
+ *
+ * Expressions hold references to the matrices they use, so they should be
+ * assigned to a Matrix before those matrices go out of scope
+ * (avoid auto x = A + B;).
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "MatrixParallel.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class Matrix;
+
+/**
+ * @brief Base of every matrix expression, including Matrix itself
+ * @details E is the derived expression type. Expressions provide
+ * rows(), cols(), coeff(row, col) and prepare(), which evaluates any
+ * products in the expression before coeff() is used.
+ */
+template <class E, class T>
+class MatrixExpression {
+public:
+	typedef T Scalar;
+
+	const E& derived() const {
+		return static_cast<const E&>(*this);
+	}
+
+	/**
+	 * @brief evaluates the expression into dest in one fused loop
+	 * @details dest must already have the right size
+	 */
+	void evaluateInto(Matrix<T>& dest) const;
+};
+
+/**
+ * @brief how expressions store their operands: matrices by reference,
+ * other expressions by value
+ */
+template <class E>
+struct MatrixOperand { typedef const E type; };
+
+template <class T>
+struct MatrixOperand<Matrix<T>> { typedef const Matrix<T>& type; };
+
+/**
+ * @brief keeps scalar arguments out of template argument deduction,
+ * so A * 2 works for Matrix<double>
+ */
+template <class T>
+struct MatrixScalarArg { typedef T type; };
+
+/**
+ * @brief returns true if the expression is the matrix m itself
+ */
+template <class E, class T>
+bool isSameMatrix(const E& expr, const Matrix<T>& m) {
+	return false;
+}
+
+template <class T>
+bool isSameMatrix(const Matrix<T>& expr, const Matrix<T>& m) {
+	return &expr == &m;
+}
+
+struct MatrixAddOp {
+	template <class T>
+	static T apply(T a, T b) { return a + b; }
+};
+
+struct MatrixSubtractOp {
+	template <class T>
+	static T apply(T a, T b) { return a - b; }
+};
+
+struct MatrixMultiplyOp {
+	template <class T>
+	static T apply(T a, T b) { return a * b; }
+};
+
+/**
+ * @brief element-wise Op(lhs, rhs)
+ */
+template <class Op, class L, class R, class T>
+class MatrixBinaryExpression : public MatrixExpression<MatrixBinaryExpression<Op, L, R, T>, T> {
+public:
+	MatrixBinaryExpression(const L& lhs, const R& rhs) :
+		_lhs(lhs), _rhs(rhs) {
+		assert(lhs.rows() == rhs.rows());
+		assert(lhs.cols() == rhs.cols());
+	}
+
+	int32_t rows() const { return _lhs.rows(); }
+	int32_t cols() const { return _lhs.cols(); }
+
+	T coeff(int32_t row, int32_t col) const {
+		return Op::apply(_lhs.coeff(row, col), _rhs.coeff(row, col));
+	}
+
+	void prepare() const {
+		_lhs.prepare();
+		_rhs.prepare();
+	}
+
+private:
+	typename MatrixOperand<L>::type _lhs;
+	typename MatrixOperand<R>::type _rhs;
+};
+
+/**
+ * @brief element-wise Op(expr, scalar)
+ */
+template <class Op, class E, class T>
+class MatrixScalarExpression : public MatrixExpression<MatrixScalarExpression<Op, E, T>, T> {
+public:
+	MatrixScalarExpression(const E& expr, T scalar) :
+		_expr(expr), _scalar(scalar) { }
+
+	int32_t rows() const { return _expr.rows(); }
+	int32_t cols() const { return _expr.cols(); }
+
+	T coeff(int32_t row, int32_t col) const {
+		return Op::apply(_expr.coeff(row, col), _scalar);
+	}
+
+	void prepare() const {
+		_expr.prepare();
+	}
+
+	const E& expression() const { return _expr; }
+	T scalar() const { return _scalar; }
+
+private:
+	typename MatrixOperand<E>::type _expr;
+	T _scalar;
+};
+
+/**
+ * @brief alpha * A * B
+ * @details assigned on its own it is computed with gemm straight into the
+ * destination. Inside a larger expression it is computed into a temporary
+ * by prepare(). Scaled matrix operands fold into alpha, other operands
+ * that are expressions are evaluated when the product is built.
+ */
+template <class T>
+class MatrixProduct : public MatrixExpression<MatrixProduct<T>, T> {
+public:
+	template <class L, class R>
+	MatrixProduct(const L& A, const R& B, T alpha) :
+		_alpha(alpha) {
+		_A = operand(A, _ownedA, _alpha);
+		_B = operand(B, _ownedB, _alpha);
+		assert(_A->cols() == _B->rows());
+	}
+
+	int32_t rows() const { return _A->rows(); }
+	int32_t cols() const { return _B->cols(); }
+
+	T coeff(int32_t row, int32_t col) const {
+		return (*_result)(row, col);
+	}
+
+	void prepare() const;
+
+	/**
+	 * @brief computes the product into dest with gemm
+	 */
+	void evaluateInto(Matrix<T>& dest) const;
+
+	/**
+	 * @brief computes dest = alpha * A * B + beta * dest
+	 */
+	void multiplyAddInto(Matrix<T>& dest, T beta) const;
+
+	/**
+	 * @brief returns true if dest is one of the operands
+	 */
+	bool aliases(const Matrix<T>& dest) const {
+		return _A == &dest || _B == &dest;
+	}
+
+	/**
+	 * @brief returns the same product scaled by scalar
+	 */
+	MatrixProduct<T> scaled(T scalar) const {
+		MatrixProduct<T> ret(*this);
+		ret._alpha *= scalar;
+		ret._result.reset();
+		return ret;
+	}
+
+private:
+	const Matrix<T>* _A;
+	const Matrix<T>* _B;
+	T _alpha;
+	std::shared_ptr<Matrix<T>> _ownedA;
+	std::shared_ptr<Matrix<T>> _ownedB;
+	mutable std::shared_ptr<Matrix<T>> _result;
+
+	static const Matrix<T>* operand(const Matrix<T>& mat, std::shared_ptr<Matrix<T>>& owned, T& alpha) {
+		return &mat;
+	}
+
+	static const Matrix<T>* operand(const MatrixScalarExpression<MatrixMultiplyOp, Matrix<T>, T>& expr,
+		std::shared_ptr<Matrix<T>>& owned, T& alpha) {
+		alpha *= expr.scalar();
+		return &expr.expression();
+	}
+
+	template <class E>
+	static const Matrix<T>* operand(const MatrixExpression<E, T>& expr, std::shared_ptr<Matrix<T>>& owned, T& alpha) {
+		owned = std::make_shared<Matrix<T>>(expr);
+		return owned.get();
+	}
+};
+
+/**
+ * @brief alpha * A * B + beta * C
+ * @details assigned on its own C is written into the destination
+ * and the product is accumulated on top with one gemm
+ */
+template <class E, class T>
+class MatrixGemmExpression : public MatrixExpression<MatrixGemmExpression<E, T>, T> {
+public:
+	MatrixGemmExpression(const MatrixProduct<T>& product, const E& C, T beta) :
+		_product(product), _C(C), _beta(beta) {
+		assert(product.rows() == C.rows());
+		assert(product.cols() == C.cols());
+	}
+
+	int32_t rows() const { return _product.rows(); }
+	int32_t cols() const { return _product.cols(); }
+
+	T coeff(int32_t row, int32_t col) const {
+		return _product.coeff(row, col) + _beta * _C.coeff(row, col);
+	}
+
+	void prepare() const {
+		_product.prepare();
+		_C.prepare();
+	}
+
+	void evaluateInto(Matrix<T>& dest) const;
+
+private:
+	MatrixProduct<T> _product;
+	typename MatrixOperand<E>::type _C;
+	T _beta;
+};
+
+template <class E, class T>
+void MatrixExpression<E, T>::evaluateInto(Matrix<T>& dest) const {
+	const E& expr = derived();
+	assert(dest.rows() == expr.rows());
+	assert(dest.cols() == expr.cols());
+
+	expr.prepare();
+	int32_t cols = expr.cols();
+	MatrixParallel::run(0, expr.rows(), (int64_t) expr.rows() * cols, [&](int64_t lo, int64_t hi) {
+		for (int32_t i = (int32_t) lo; i < (int32_t) hi; ++i) {
+			T* row = &dest(i, 0);
+			for (int32_t j = 0; j < cols; ++j) {
+				row[j] = expr.coeff(i, j);
+			}
+		}
+	});
+}
+
+template <class T>
+void MatrixProduct<T>::prepare() const {
+	if (!_result) {
+		_result = std::make_shared<Matrix<T>>(rows(), cols());
+		Matrix<T>::multiplyAdd(*_result, _alpha, *_A, *_B, T(0));
+	}
+}
+
+template <class T>
+void MatrixProduct<T>::evaluateInto(Matrix<T>& dest) const {
+	multiplyAddInto(dest, T(0));
+}
+
+template <class T>
+void MatrixProduct<T>::multiplyAddInto(Matrix<T>& dest, T beta) const {
+	assert(dest.rows() == rows());
+	assert(dest.cols() == cols());
+
+	if (aliases(dest)) {
+		Matrix<T> temp(rows(), cols());
+		Matrix<T>::multiplyAdd(temp, _alpha, *_A, *_B, T(0));
+		if (beta == T(0)) {
+			dest = std::move(temp);
+		} else {
+			dest = temp + dest * beta;
+		}
+		return;
+	}
+	Matrix<T>::multiplyAdd(dest, _alpha, *_A, *_B, beta);
+}
+
+template <class E, class T>
+void MatrixGemmExpression<E, T>::evaluateInto(Matrix<T>& dest) const {
+	assert(dest.rows() == rows());
+	assert(dest.cols() == cols());
+
+	if (_product.aliases(dest)) {
+		MatrixExpression<MatrixGemmExpression<E, T>, T>::evaluateInto(dest);
+		return;
+	}
+
+	// dest = C, then dest = alpha * A * B + beta * dest
+	if (!isSameMatrix(_C, dest)) {
+		_C.evaluateInto(dest);
+	}
+	_product.multiplyAddInto(dest, _beta);
+}
+
+///////////////////////////////////
+// OPERATORS
+///////////////////////////////////
+
+template <class L, class R, class T>
+MatrixBinaryExpression<MatrixAddOp, L, R, T>
+operator+(const MatrixExpression<L, T>& A, const MatrixExpression<R, T>& B) {
+	return MatrixBinaryExpression<MatrixAddOp, L, R, T>(A.derived(), B.derived());
+}
+
+template <class L, class R, class T>
+MatrixBinaryExpression<MatrixSubtractOp, L, R, T>
+operator-(const MatrixExpression<L, T>& A, const MatrixExpression<R, T>& B) {
+	return MatrixBinaryExpression<MatrixSubtractOp, L, R, T>(A.derived(), B.derived());
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixAddOp, E, T>
+operator+(const MatrixExpression<E, T>& A, typename MatrixScalarArg<T>::type scalar) {
+	return MatrixScalarExpression<MatrixAddOp, E, T>(A.derived(), scalar);
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixAddOp, E, T>
+operator+(typename MatrixScalarArg<T>::type scalar, const MatrixExpression<E, T>& A) {
+	return MatrixScalarExpression<MatrixAddOp, E, T>(A.derived(), scalar);
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixAddOp, E, T>
+operator-(const MatrixExpression<E, T>& A, typename MatrixScalarArg<T>::type scalar) {
+	return MatrixScalarExpression<MatrixAddOp, E, T>(A.derived(), -scalar);
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixMultiplyOp, E, T>
+operator*(const MatrixExpression<E, T>& A, typename MatrixScalarArg<T>::type scalar) {
+	return MatrixScalarExpression<MatrixMultiplyOp, E, T>(A.derived(), scalar);
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixMultiplyOp, E, T>
+operator*(typename MatrixScalarArg<T>::type scalar, const MatrixExpression<E, T>& A) {
+	return MatrixScalarExpression<MatrixMultiplyOp, E, T>(A.derived(), scalar);
+}
+
+template <class E, class T>
+MatrixScalarExpression<MatrixMultiplyOp, E, T>
+operator-(const MatrixExpression<E, T>& A) {
+	return MatrixScalarExpression<MatrixMultiplyOp, E, T>(A.derived(), T(-1));
+}
+
+/**
+ * @brief matrix product A * B
+ */
+template <class L, class R, class T>
+MatrixProduct<T> operator*(const MatrixExpression<L, T>& A, const MatrixExpression<R, T>& B) {
+	return MatrixProduct<T>(A.derived(), B.derived(), T(1));
+}
+
+// scaling a product folds the scalar into alpha
+
+template <class T>
+MatrixProduct<T> operator*(const MatrixProduct<T>& P, typename MatrixScalarArg<T>::type scalar) {
+	return P.scaled(scalar);
+}
+
+template <class T>
+MatrixProduct<T> operator*(typename MatrixScalarArg<T>::type scalar, const MatrixProduct<T>& P) {
+	return P.scaled(scalar);
+}
+
+template <class T>
+MatrixProduct<T> operator-(const MatrixProduct<T>& P) {
+	return P.scaled(T(-1));
+}
+
+// a product plus or minus another term becomes one gemm with beta
+
+template <class E, class T>
+MatrixGemmExpression<E, T> operator+(const MatrixProduct<T>& P, const MatrixExpression<E, T>& C) {
+	return MatrixGemmExpression<E, T>(P, C.derived(), T(1));
+}
+
+template <class E, class T>
+MatrixGemmExpression<E, T> operator+(const MatrixExpression<E, T>& C, const MatrixProduct<T>& P) {
+	return MatrixGemmExpression<E, T>(P, C.derived(), T(1));
+}
+
+template <class E, class T>
+MatrixGemmExpression<E, T> operator-(const MatrixProduct<T>& P, const MatrixExpression<E, T>& C) {
+	return MatrixGemmExpression<E, T>(P, C.derived(), T(-1));
+}
+
+template <class E, class T>
+MatrixGemmExpression<E, T> operator-(const MatrixExpression<E, T>& C, const MatrixProduct<T>& P) {
+	return MatrixGemmExpression<E, T>(P.scaled(T(-1)), C.derived(), T(1));
+}
+
+template <class T>
+MatrixGemmExpression<MatrixProduct<T>, T> operator+(const MatrixProduct<T>& P, const MatrixProduct<T>& Q) {
+	return MatrixGemmExpression<MatrixProduct<T>, T>(P, Q, T(1));
+}
+
+template <class T>
+MatrixGemmExpression<MatrixProduct<T>, T> operator-(const MatrixProduct<T>& P, const MatrixProduct<T>& Q) {
+	return MatrixGemmExpression<MatrixProduct<T>, T>(P, Q, T(-1));
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_EXPRESSION_HPP */
@@ -0,0 +1,392 @@
+#ifndef _MATRIX_GEMM_HPP
+#define _MATRIX_GEMM_HPP
+
+/**
+ * Cache blocked general matrix multiply used by Matrix
+ * Operates on raw row major arrays with leading dimensions
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "MatrixParallel.hpp"
+#include "MatrixSimd.hpp"
+
+namespace Alectryon {
+
+/**
+ * @brief Type used to accumulate sums of products of T
+ */
+template <class T>
+struct MatrixAccumulator { typedef T type; };
+
+template <>
+struct MatrixAccumulator<int8_t> { typedef int32_t type; };
+
+template <>
+struct MatrixAccumulator<uint8_t> { typedef int32_t type; };
+
+template <>
+struct MatrixAccumulator<int16_t> { typedef int32_t type; };
+
+template <>
+struct MatrixAccumulator<uint16_t> { typedef int32_t type; };
+
+template <>
+struct MatrixAccumulator<int32_t> { typedef int64_t type; };
+
+/**
+ * @brief Block sizes for gemm
+ * @details MR x NR is the register tile computed by the micro kernel,
+ * a KC x NR panel of B should stay in L1, an MC x KC panel of A in L2
+ * and a KC x NC panel of B in L3.
+ */
+template <class T>
+struct GemmBlocking {
+	static const int32_t MR = 4;
+	static const int32_t NR = 4;
+	static const int32_t MC = 64;
+	static const int32_t KC = 256;
+	static const int32_t NC = 1024;
+};
+
+template <>
+struct GemmBlocking<float> {
+	static const int32_t MR = 6;
+	static const int32_t NR = 8;
+	static const int32_t MC = 144;
+	static const int32_t KC = 256;
+	static const int32_t NC = 2048;
+};
+
+template <>
+struct GemmBlocking<double> {
+	static const int32_t MR = 4;
+	static const int32_t NR = 4;
+	static const int32_t MC = 96;
+	static const int32_t KC = 256;
+	static const int32_t NC = 1024;
+};
+
+namespace MatrixKernels {
+
+/**
+ * @brief below this many multiply-adds gemm skips packing
+ */
+const int64_t GemmSmallSize = 16 * 16 * 16;
+
+/**
+ * @brief scales an m x n block of C by beta
+ * @details a beta of 0 overwrites C, so NaNs in C don't propagate
+ */
+template <class T>
+void scaleBlock(int32_t m, int32_t n, T beta, T* C, int32_t ldc) {
+	if (beta == T(1)) {
+		return;
+	}
+	for (int32_t i = 0; i < m; ++i) {
+		T* row = C + (int64_t) i * ldc;
+		if (beta == T(0)) {
+			for (int32_t j = 0; j < n; ++j) {
+				row[j] = 0;
+			}
+		} else {
+			for (int32_t j = 0; j < n; ++j) {
+				row[j] *= beta;
+			}
+		}
+	}
+}
+
+/**
+ * @brief packs an mc x kc block of A into micro panels of MR rows
+ * @details each micro panel is stored column by column, MR values per column.
+ * rows past mc are zero padded
+ */
+template <class T>
+void packA(int32_t mc, int32_t kc, const T* A, int32_t lda, T* packed) {
+	const int32_t MR = GemmBlocking<T>::MR;
+	for (int32_t i = 0; i < mc; i += MR) {
+		int32_t rows = (mc - i < MR) ? mc - i : MR;
+		const T* src = A + (int64_t) i * lda;
+		for (int32_t p = 0; p < kc; ++p) {
+			int32_t r = 0;
+			for (; r < rows; ++r) {
+				packed[r] = src[(int64_t) r * lda + p];
+			}
+			for (; r < MR; ++r) {
+				packed[r] = 0;
+			}
+			packed += MR;
+		}
+	}
+}
+
+/**
+ * @brief packs a kc x nc block of B into micro panels of NR columns
+ * @details each micro panel is stored row by row, NR values per row.
+ * columns past nc are zero padded
+ */
+template <class T>
+void packB(int32_t kc, int32_t nc, const T* B, int32_t ldb, T* packed) {
+	const int32_t NR = GemmBlocking<T>::NR;
+	for (int32_t j = 0; j < nc; j += NR) {
+		int32_t cols = (nc - j < NR) ? nc - j : NR;
+		const T* src = B + j;
+		for (int32_t p = 0; p < kc; ++p) {
+			const T* row = src + (int64_t) p * ldb;
+			int32_t c = 0;
+			for (; c < cols; ++c) {
+				packed[c] = row[c];
+			}
+			for (; c < NR; ++c) {
+				packed[c] = 0;
+			}
+			packed += NR;
+		}
+	}
+}
+
+/**
+ * @brief computes the MR x NR tile C += alpha * a * b
+ * from packed micro panels of A and B
+ * @details only the top left m x n of the tile is written back
+ */
+template <class T>
+void gemmMicroKernel(int32_t kc, T alpha, const T* a, const T* b,
+	T* C, int32_t ldc, int32_t m, int32_t n) {
+	typedef typename MatrixAccumulator<T>::type Acc;
+	const int32_t MR = GemmBlocking<T>::MR;
+	const int32_t NR = GemmBlocking<T>::NR;
+
+	Acc acc[MR][NR];
+	for (int32_t i = 0; i < MR; ++i) {
+		for (int32_t j = 0; j < NR; ++j) {
+			acc[i][j] = 0;
+		}
+	}
+
+	for (int32_t p = 0; p < kc; ++p) {
+		for (int32_t i = 0; i < MR; ++i) {
+			Acc ai = a[i];
+			for (int32_t j = 0; j < NR; ++j) {
+				acc[i][j] += ai * (Acc) b[j];
+			}
+		}
+		a += MR;
+		b += NR;
+	}
+
+	for (int32_t i = 0; i < m; ++i) {
+		T* row = C + (int64_t) i * ldc;
+		for (int32_t j = 0; j < n; ++j) {
+			row[j] += (T) (alpha * acc[i][j]);
+		}
+	}
+}
+
+/**
+ * @brief unblocked C = alpha * A * B + beta * C for small sizes
+ */
+template <class T>
+void gemmSmall(int32_t m, int32_t n, int32_t k, T alpha, const T* A, int32_t lda,
+	const T* B, int32_t ldb, T beta, T* C, int32_t ldc) {
+	typedef typename MatrixAccumulator<T>::type Acc;
+	for (int32_t i = 0; i < m; ++i) {
+		const T* rowA = A + (int64_t) i * lda;
+		T* rowC = C + (int64_t) i * ldc;
+		for (int32_t j = 0; j < n; ++j) {
+			Acc sum = 0;
+			const T* colB = B + j;
+			for (int32_t p = 0; p < k; ++p) {
+				sum += (Acc) rowA[p] * (Acc) colB[(int64_t) p * ldb];
+			}
+			T prev = (beta == T(0)) ? T(0) : beta * rowC[j];
+			rowC[j] = (T) (alpha * sum) + prev;
+		}
+	}
+}
+
+/**
+ * @brief computes the block of C for one packed panel of A and B
+ */
+template <class T>
+void gemmMacroKernel(int32_t mc, int32_t nc, int32_t kc, T alpha,
+	const T* packedA, const T* packedB, T* C, int32_t ldc) {
+	const int32_t MR = GemmBlocking<T>::MR;
+	const int32_t NR = GemmBlocking<T>::NR;
+
+	for (int32_t j = 0; j < nc; j += NR) {
+		int32_t n = (nc - j < NR) ? nc - j : NR;
+		const T* b = packedB + (int64_t) j * kc;
+		for (int32_t i = 0; i < mc; i += MR) {
+			int32_t m = (mc - i < MR) ? mc - i : MR;
+			const T* a = packedA + (int64_t) i * kc;
+			gemmMicroKernel(kc, alpha, a, b, C + (int64_t) i * ldc + j, ldc, m, n);
+		}
+	}
+}
+
+/**
+ * @brief single threaded gemm()
+ */
+template <class T>
+void gemmSerial(int32_t m, int32_t n, int32_t k, T alpha, const T* A, int32_t lda,
+	const T* B, int32_t ldb, T beta, T* C, int32_t ldc) {
+	assert(m >= 0 && n >= 0 && k >= 0);
+	if (m == 0 || n == 0) {
+		return;
+	}
+	if (k == 0 || alpha == T(0)) {
+		scaleBlock(m, n, beta, C, ldc);
+		return;
+	}
+	if ((int64_t) m * n * k <= GemmSmallSize) {
+		gemmSmall(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+		return;
+	}
+
+	const int32_t MR = GemmBlocking<T>::MR;
+	const int32_t NR = GemmBlocking<T>::NR;
+	const int32_t MC = GemmBlocking<T>::MC;
+	const int32_t KC = GemmBlocking<T>::KC;
+	const int32_t NC = GemmBlocking<T>::NC;
+
+	// packing buffers are kept per thread so repeated calls don't allocate
+	static thread_local std::vector<T> bufferA;
+	static thread_local std::vector<T> bufferB;
+	size_t sizeA = (size_t) ((MC + MR - 1) / MR) * MR * KC;
+	size_t sizeB = (size_t) ((NC + NR - 1) / NR) * NR * KC;
+	if (bufferA.size() < sizeA) bufferA.resize(sizeA);
+	if (bufferB.size() < sizeB) bufferB.resize(sizeB);
+
+	scaleBlock(m, n, beta, C, ldc);
+
+	for (int32_t jc = 0; jc < n; jc += NC) {
+		int32_t nc = (n - jc < NC) ? n - jc : NC;
+		for (int32_t pc = 0; pc < k; pc += KC) {
+			int32_t kc = (k - pc < KC) ? k - pc : KC;
+			packB(kc, nc, B + (int64_t) pc * ldb + jc, ldb, bufferB.data());
+			for (int32_t ic = 0; ic < m; ic += MC) {
+				int32_t mc = (m - ic < MC) ? m - ic : MC;
+				packA(mc, kc, A + (int64_t) ic * lda + pc, lda, bufferA.data());
+				gemmMacroKernel(mc, nc, kc, alpha, bufferA.data(), bufferB.data(),
+					C + (int64_t) ic * ldc + jc, ldc);
+			}
+		}
+	}
+}
+
+/**
+ * @brief computes C = alpha * A * B + beta * C
+ * @details A is m x k, B is k x n and C is m x n, all row major
+ * with leading dimensions lda, ldb and ldc.
+ * C can not overlap A or B.
+ * Large products are split into independent blocks of C across MatrixParallel threads.
+ */
+template <class T>
+void gemm(int32_t m, int32_t n, int32_t k, T alpha, const T* A, int32_t lda,
+	const T* B, int32_t ldb, T beta, T* C, int32_t ldc) {
+	int64_t work = (int64_t) m * n * k;
+	if (MatrixParallel::threads() <= 1 || work < MatrixParallel::threshold()) {
+		gemmSerial(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+		return;
+	}
+
+	// split the longer side of C, in whole register tiles
+	if (m >= n) {
+		const int32_t MR = GemmBlocking<T>::MR;
+		MatrixParallel::run(0, (m + MR - 1) / MR, work, [=](int64_t lo, int64_t hi) {
+			int32_t row = (int32_t) lo * MR;
+			int32_t rows = ((int32_t) hi * MR < m) ? (int32_t) hi * MR - row : m - row;
+			gemmSerial(rows, n, k, alpha, A + (int64_t) row * lda, lda,
+				B, ldb, beta, C + (int64_t) row * ldc, ldc);
+		});
+	} else {
+		const int32_t NR = GemmBlocking<T>::NR;
+		MatrixParallel::run(0, (n + NR - 1) / NR, work, [=](int64_t lo, int64_t hi) {
+			int32_t col = (int32_t) lo * NR;
+			int32_t cols = ((int32_t) hi * NR < n) ? (int32_t) hi * NR - col : n - col;
+			gemmSerial(m, cols, k, alpha, A, lda, B + col, ldb, beta, C + col, ldc);
+		});
+	}
+}
+
+/**
+ * @brief rows of the triangular matrix per block in trsmLower() and trsmUpper()
+ */
+const int32_t TrsmBlockSize = 64;
+
+/**
+ * @brief solves L * X = B for X in place of B
+ * @details L is n x n lower triangular, B is n x k. if unitDiagonal
+ * the diagonal of L is taken as ones and not read.
+ * everything off the diagonal blocks is done with gemm
+ */
+template <class T>
+void trsmLower(int32_t n, int32_t k, const T* L, int32_t ldl, bool unitDiagonal, T* B, int32_t ldb) {
+	for (int32_t i0 = 0; i0 < n; i0 += TrsmBlockSize) {
+		int32_t i1 = (n - i0 < TrsmBlockSize) ? n : i0 + TrsmBlockSize;
+
+		// B_I -= L(I, 0:i0) * X(0:i0)
+		if (i0 > 0) {
+			gemm(i1 - i0, k, i0, T(-1), L + (int64_t) i0 * ldl, ldl,
+				B, ldb, T(1), B + (int64_t) i0 * ldb, ldb);
+		}
+
+		// forward substitution within the diagonal block
+		for (int32_t i = i0; i < i1; ++i) {
+			T* row = B + (int64_t) i * ldb;
+			const T* rowL = L + (int64_t) i * ldl;
+			for (int32_t p = i0; p < i; ++p) {
+				if (rowL[p] != T(0)) {
+					vectorAxpy(k, -rowL[p], B + (int64_t) p * ldb, row);
+				}
+			}
+			if (!unitDiagonal) {
+				vectorScale(k, row, T(1) / rowL[i], row);
+			}
+		}
+	}
+}
+
+/**
+ * @brief solves U * X = B for X in place of B
+ * @details U is n x n upper triangular, B is n x k. if unitDiagonal
+ * the diagonal of U is taken as ones and not read.
+ * everything off the diagonal blocks is done with gemm
+ */
+template <class T>
+void trsmUpper(int32_t n, int32_t k, const T* U, int32_t ldu, bool unitDiagonal, T* B, int32_t ldb) {
+	int32_t last = ((n - 1) / TrsmBlockSize) * TrsmBlockSize;
+	for (int32_t i0 = last; i0 >= 0; i0 -= TrsmBlockSize) {
+		int32_t i1 = (n - i0 < TrsmBlockSize) ? n : i0 + TrsmBlockSize;
+
+		// B_I -= U(I, i1:n) * X(i1:n)
+		if (i1 < n) {
+			gemm(i1 - i0, k, n - i1, T(-1), U + (int64_t) i0 * ldu + i1, ldu,
+				B + (int64_t) i1 * ldb, ldb, T(1), B + (int64_t) i0 * ldb, ldb);
+		}
+
+		// back substitution within the diagonal block
+		for (int32_t i = i1 - 1; i >= i0; --i) {
+			T* row = B + (int64_t) i * ldb;
+			const T* rowU = U + (int64_t) i * ldu;
+			for (int32_t p = i + 1; p < i1; ++p) {
+				if (rowU[p] != T(0)) {
+					vectorAxpy(k, -rowU[p], B + (int64_t) p * ldb, row);
+				}
+			}
+			if (!unitDiagonal) {
+				vectorScale(k, row, T(1) / rowU[i], row);
+			}
+		}
+	}
+}
+
+} // namespace MatrixKernels
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_GEMM_HPP */
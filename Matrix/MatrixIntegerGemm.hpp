@@ -0,0 +1,313 @@
+#ifndef _MATRIX_INTEGER_GEMM_HPP
+#define _MATRIX_INTEGER_GEMM_HPP
+
+/**
+ * int8 and int16 matrix multiply with int32 sums, used by QuantizedMatrix
+ * B is packed transposed so every output is a dot product of two contiguous
+ * rows. int8 uses AVX-512 VNNI (vpdpbusd, 64 products per instruction) or
+ * AVX2 (sign extend to int16 and vpmaddwd), int16 uses vpmaddwd,
+ * picked at runtime like the vector kernels in MatrixSimd.hpp
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "MatrixParallel.hpp"
+#include "MatrixSimd.hpp"
+
+namespace Alectryon {
+
+namespace MatrixKernels {
+
+/**
+ * @brief rows of A and of B^T per integer micro tile
+ */
+const int32_t IntegerTileRows = 2;
+const int32_t IntegerTileCols = 4;
+
+/**
+ * @brief packed rows are padded with zeros to a multiple of this many elements
+ */
+const int32_t IntegerPadding = 64;
+
+/**
+ * @brief rows of B^T kept in cache while the rows of A go past
+ */
+const int32_t IntegerBlockCols = 128;
+
+/**
+ * @brief integer micro tile for one instruction set
+ */
+template <class Q>
+struct IntegerKernels {
+	// C[r * 4 + c] = dot(a + r * lda, b + c * ldb) over k elements, k is a multiple
+	// of IntegerPadding. the sums come out as dot(a + offset, b)
+	void (*tile)(int32_t k, const Q* a, int32_t lda, const Q* b, int32_t ldb, int32_t* C);
+	// added to every element of A by the tile, the caller takes offset * sum(b) back out
+	int32_t offset;
+	const char* name;
+};
+
+template <class Q>
+void integerTileScalar(int32_t k, const Q* a, int32_t lda, const Q* b, int32_t ldb, int32_t* C) {
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			const Q* rowA = a + (int64_t) r * lda;
+			const Q* rowB = b + (int64_t) c * ldb;
+			int32_t sum = 0;
+			for (int32_t p = 0; p < k; ++p) {
+				sum += (int32_t) rowA[p] * (int32_t) rowB[p];
+			}
+			C[r * IntegerTileCols + c] = sum;
+		}
+	}
+}
+
+template <class Q>
+IntegerKernels<Q> scalarIntegerKernels() {
+	IntegerKernels<Q> kernels = { integerTileScalar<Q>, 0, "scalar" };
+	return kernels;
+}
+
+#ifdef MATRIX_SIMD_X86
+
+__attribute__((target("avx2"))) inline
+int32_t integerHorizontalSum(__m256i v) {
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+// int8: sign extend 16 values at a time to int16, then multiply and add pairs
+__attribute__((target("avx2"))) inline
+void integerTileAvx2Int8(int32_t k, const int8_t* a, int32_t lda, const int8_t* b, int32_t ldb, int32_t* C) {
+	__m256i acc[IntegerTileRows][IntegerTileCols];
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			acc[r][c] = _mm256_setzero_si256();
+		}
+	}
+	for (int32_t p = 0; p < k; p += 16) {
+		__m256i va[IntegerTileRows];
+		for (int32_t r = 0; r < IntegerTileRows; ++r) {
+			va[r] = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (a + (int64_t) r * lda + p)));
+		}
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			__m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (b + (int64_t) c * ldb + p)));
+			for (int32_t r = 0; r < IntegerTileRows; ++r) {
+				acc[r][c] = _mm256_add_epi32(acc[r][c], _mm256_madd_epi16(va[r], vb));
+			}
+		}
+	}
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			C[r * IntegerTileCols + c] = integerHorizontalSum(acc[r][c]);
+		}
+	}
+}
+
+__attribute__((target("avx2"))) inline
+void integerTileAvx2Int16(int32_t k, const int16_t* a, int32_t lda, const int16_t* b, int32_t ldb, int32_t* C) {
+	__m256i acc[IntegerTileRows][IntegerTileCols];
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			acc[r][c] = _mm256_setzero_si256();
+		}
+	}
+	for (int32_t p = 0; p < k; p += 16) {
+		__m256i va[IntegerTileRows];
+		for (int32_t r = 0; r < IntegerTileRows; ++r) {
+			va[r] = _mm256_loadu_si256((const __m256i*) (a + (int64_t) r * lda + p));
+		}
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			__m256i vb = _mm256_loadu_si256((const __m256i*) (b + (int64_t) c * ldb + p));
+			for (int32_t r = 0; r < IntegerTileRows; ++r) {
+				acc[r][c] = _mm256_add_epi32(acc[r][c], _mm256_madd_epi16(va[r], vb));
+			}
+		}
+	}
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			C[r * IntegerTileCols + c] = integerHorizontalSum(acc[r][c]);
+		}
+	}
+}
+
+// through memory, _mm512_reduce_add_epi32 trips -Wuninitialized inside gcc 12's headers
+__attribute__((target("avx512f"))) inline
+int32_t integerHorizontalSum512(__m512i v) {
+	alignas(64) int32_t lanes[16];
+	_mm512_store_si512((void*) lanes, v);
+	int32_t sum = 0;
+	for (int32_t i = 0; i < 16; ++i) {
+		sum += lanes[i];
+	}
+	return sum;
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline
+void integerTileAvx512Int16(int32_t k, const int16_t* a, int32_t lda, const int16_t* b, int32_t ldb, int32_t* C) {
+	__m512i acc[IntegerTileRows][IntegerTileCols];
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			acc[r][c] = _mm512_setzero_si512();
+		}
+	}
+	for (int32_t p = 0; p < k; p += 32) {
+		__m512i va[IntegerTileRows];
+		for (int32_t r = 0; r < IntegerTileRows; ++r) {
+			va[r] = _mm512_loadu_si512((const void*) (a + (int64_t) r * lda + p));
+		}
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			__m512i vb = _mm512_loadu_si512((const void*) (b + (int64_t) c * ldb + p));
+			for (int32_t r = 0; r < IntegerTileRows; ++r) {
+				acc[r][c] = _mm512_add_epi32(acc[r][c], _mm512_madd_epi16(va[r], vb));
+			}
+		}
+	}
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			C[r * IntegerTileCols + c] = integerHorizontalSum512(acc[r][c]);
+		}
+	}
+}
+
+// int8 with VNNI: vpdpbusd multiplies unsigned by signed bytes, so A is
+// flipped to a + 128 and the caller removes 128 * sum(b)
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) inline
+void integerTileVnniInt8(int32_t k, const int8_t* a, int32_t lda, const int8_t* b, int32_t ldb, int32_t* C) {
+	const __m512i flip = _mm512_set1_epi8((char) 0x80);
+	__m512i acc[IntegerTileRows][IntegerTileCols];
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			acc[r][c] = _mm512_setzero_si512();
+		}
+	}
+	for (int32_t p = 0; p < k; p += 64) {
+		__m512i va[IntegerTileRows];
+		for (int32_t r = 0; r < IntegerTileRows; ++r) {
+			va[r] = _mm512_xor_si512(_mm512_loadu_si512((const void*) (a + (int64_t) r * lda + p)), flip);
+		}
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			__m512i vb = _mm512_loadu_si512((const void*) (b + (int64_t) c * ldb + p));
+			for (int32_t r = 0; r < IntegerTileRows; ++r) {
+				acc[r][c] = _mm512_dpbusd_epi32(acc[r][c], va[r], vb);
+			}
+		}
+	}
+	for (int32_t r = 0; r < IntegerTileRows; ++r) {
+		for (int32_t c = 0; c < IntegerTileCols; ++c) {
+			C[r * IntegerTileCols + c] = integerHorizontalSum512(acc[r][c]);
+		}
+	}
+}
+
+inline IntegerKernels<int8_t> detectIntegerKernels(int8_t*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+		IntegerKernels<int8_t> kernels = { integerTileVnniInt8, 128, "avx512vnni" };
+		return kernels;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		IntegerKernels<int8_t> kernels = { integerTileAvx2Int8, 0, "avx2" };
+		return kernels;
+	}
+	return scalarIntegerKernels<int8_t>();
+}
+
+inline IntegerKernels<int16_t> detectIntegerKernels(int16_t*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw")) {
+		IntegerKernels<int16_t> kernels = { integerTileAvx512Int16, 0, "avx512bw" };
+		return kernels;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		IntegerKernels<int16_t> kernels = { integerTileAvx2Int16, 0, "avx2" };
+		return kernels;
+	}
+	return scalarIntegerKernels<int16_t>();
+}
+
+#endif /* MATRIX_SIMD_X86 */
+
+template <class Q>
+IntegerKernels<Q> detectIntegerKernels(Q*) {
+	return scalarIntegerKernels<Q>();
+}
+
+/**
+ * @brief Gets the integer kernels selected for this cpu
+ * @details detection runs once, on first use
+ */
+template <class Q>
+const IntegerKernels<Q>& integerKernels() {
+	static const IntegerKernels<Q> kernels = detectIntegerKernels((Q*) nullptr);
+	return kernels;
+}
+
+/**
+ * @brief computes C = A * B with int32 sums, and the sums of every column of B
+ * @details A is m x k, B is k x n and C is m x n, all row major with leading
+ * dimensions lda, ldb and ldc. columnSums holds n elements.
+ * the caller has to keep every sum within int32
+ */
+template <class Q>
+void integerGemm(int32_t m, int32_t n, int32_t k, const Q* A, int32_t lda,
+	const Q* B, int32_t ldb, int32_t* C, int32_t ldc, int32_t* columnSums) {
+	const IntegerKernels<Q>& kernels = integerKernels<Q>();
+	const int32_t R = IntegerTileRows;
+	const int32_t S = IntegerTileCols;
+	const int32_t kp = (k + IntegerPadding - 1) / IntegerPadding * IntegerPadding;
+	const int32_t mp = (m + R - 1) / R * R;
+	const int32_t np = (n + S - 1) / S * S;
+
+	// zero padded copies, B transposed so its columns are contiguous
+	std::vector<Q> packedA((size_t) mp * kp, Q(0));
+	std::vector<Q> packedB((size_t) np * kp, Q(0));
+	for (int32_t i = 0; i < m; ++i) {
+		memcpy(packedA.data() + (int64_t) i * kp, A + (int64_t) i * lda, (size_t) k * sizeof(Q));
+	}
+	for (int32_t p = 0; p < k; ++p) {
+		const Q* row = B + (int64_t) p * ldb;
+		for (int32_t j = 0; j < n; ++j) {
+			packedB[(size_t) j * kp + p] = row[j];
+		}
+	}
+	for (int32_t j = 0; j < n; ++j) {
+		const Q* col = packedB.data() + (int64_t) j * kp;
+		int32_t sum = 0;
+		for (int32_t p = 0; p < k; ++p) {
+			sum += col[p];
+		}
+		columnSums[j] = sum;
+	}
+
+	const int32_t offset = kernels.offset;
+	MatrixParallel::run(0, mp / R, (int64_t) m * n * k, [&](int64_t lo, int64_t hi) {
+		int32_t tile[R * S];
+		for (int32_t jc = 0; jc < np; jc += IntegerBlockCols) {
+			int32_t jEnd = (np - jc < IntegerBlockCols) ? np : jc + IntegerBlockCols;
+			for (int64_t ib = lo; ib < hi; ++ib) {
+				int32_t i = (int32_t) ib * R;
+				const Q* a = packedA.data() + (int64_t) i * kp;
+				for (int32_t j = jc; j < jEnd; j += S) {
+					kernels.tile(kp, a, kp, packedB.data() + (int64_t) j * kp, kp, tile);
+					for (int32_t r = 0; r < R && i + r < m; ++r) {
+						int32_t* row = C + (int64_t) (i + r) * ldc;
+						for (int32_t c = 0; c < S && j + c < n; ++c) {
+							row[j + c] = tile[r * S + c] - offset * columnSums[j + c];
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+} // namespace MatrixKernels
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_INTEGER_GEMM_HPP */
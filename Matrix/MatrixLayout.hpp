@@ -0,0 +1,136 @@
+#ifndef _MATRIX_LAYOUT_HPP
+#define _MATRIX_LAYOUT_HPP
+
+/**
+ * Storage layout settings used by Matrix
+ * Matrix data starts on a 64 byte boundary and every row is padded to a
+ * leading dimension, so rows start aligned and vector kernels need no
+ * unaligned loads or peeled loops
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace Alectryon {
+
+/**
+ * @brief Row padding settings for Matrix
+ * @details Settings only apply to matrices allocated after the change,
+ * existing matrices keep their leading dimension.
+ * Settings must not be changed while matrix operations are running.
+ */
+class MatrixLayout {
+public:
+	/**
+	 * @brief alignment in bytes of the start of every matrix's data
+	 */
+	static const size_t Alignment = 64;
+
+	/**
+	 * @brief Sets the multiple in bytes that rows are padded to
+	 * @details must be a power of two no larger than Alignment.
+	 * 0 stores rows packed, with ld() == cols(). rows shorter than
+	 * this are always packed, padding them would multiply their size
+	 */
+	static void setRowAlignment(size_t bytes);
+
+	static size_t rowAlignment();
+
+	/**
+	 * @brief Sets the row length in bytes to avoid multiples of
+	 * @details rows that are a multiple of this far apart map to the same
+	 * cache sets, so column walks evict each other. such rows get one more
+	 * rowAlignment() of padding. 0 turns this off
+	 */
+	static void setAliasingStride(size_t bytes);
+
+	static size_t aliasingStride();
+
+	/**
+	 * @brief Returns the leading dimension for a row of cols elements
+	 */
+	template <class T>
+	static int32_t leadingDimension(int32_t cols);
+
+	/**
+	 * @brief Returns uninitialized storage for count elements, aligned to Alignment
+	 */
+	template <class T>
+	static T* allocate(int64_t count);
+
+	/**
+	 * @brief Frees storage from allocate(), ptr can be nullptr
+	 */
+	template <class T>
+	static void release(T* ptr);
+
+private:
+	struct State {
+		size_t rowAlignment;
+		size_t aliasingStride;
+	};
+
+	static State& state();
+};
+
+inline MatrixLayout::State& MatrixLayout::state() {
+	static State s = { Alignment, 4096 };
+	return s;
+}
+
+inline void MatrixLayout::setRowAlignment(size_t bytes) {
+	assert(bytes <= Alignment);
+	assert((bytes & (bytes - 1)) == 0);
+	state().rowAlignment = bytes;
+}
+
+inline size_t MatrixLayout::rowAlignment() {
+	return state().rowAlignment;
+}
+
+inline void MatrixLayout::setAliasingStride(size_t bytes) {
+	state().aliasingStride = bytes;
+}
+
+inline size_t MatrixLayout::aliasingStride() {
+	return state().aliasingStride;
+}
+
+template <class T>
+int32_t MatrixLayout::leadingDimension(int32_t cols) {
+	const State& s = state();
+	int64_t unit = (int64_t) (s.rowAlignment / sizeof(T));
+	if (unit <= 1 || cols < unit || s.rowAlignment % sizeof(T) != 0) {
+		return cols;
+	}
+
+	int64_t ld = (cols + unit - 1) / unit * unit;
+	if (s.aliasingStride != 0 && (ld * sizeof(T)) % s.aliasingStride == 0) {
+		ld += unit;
+	}
+	return (int32_t) ld;
+}
+
+template <class T>
+T* MatrixLayout::allocate(int64_t count) {
+	// over allocate through operator new, and keep the pointer it
+	// returned just before the aligned block for release()
+	size_t bytes = (size_t) count * sizeof(T) + Alignment + sizeof(void*);
+	char* raw = static_cast<char*>(::operator new(bytes));
+	uintptr_t aligned = ((uintptr_t) raw + sizeof(void*) + Alignment - 1) & ~(uintptr_t) (Alignment - 1);
+	reinterpret_cast<void**>(aligned)[-1] = raw;
+	return reinterpret_cast<T*>(aligned);
+}
+
+template <class T>
+void MatrixLayout::release(T* ptr) {
+	if (ptr != nullptr) {
+		::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+	}
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_LAYOUT_HPP */
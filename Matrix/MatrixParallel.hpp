@@ -0,0 +1,326 @@
+#ifndef _MATRIX_PARALLEL_HPP
+#define _MATRIX_PARALLEL_HPP
+
+/**
+ * Thread pool and parallel execution settings used by Matrix
+ * Matrix operations stay on the calling thread until
+ * MatrixParallel::setThreads() is called with more than one thread
+ */
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Alectryon {
+
+/**
+ * @brief Work stealing thread pool
+ * @details Every worker has its own task queue. Workers take tasks from the
+ * back of their own queue and steal from the front of the others when it
+ * runs empty. Threads that call parallelFor() run tasks while they wait,
+ * so parallelFor() can be called from inside a task.
+ */
+class ThreadPool {
+public:
+	/**
+	 * @param numWorkers number of threads to start, can be 0
+	 */
+	explicit ThreadPool(size_t numWorkers);
+
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	/**
+	 * @brief Destructor
+	 * @details waits for the workers to finish queued tasks
+	 */
+	~ThreadPool();
+
+	/**
+	 * @brief Returns number of worker threads
+	 */
+	size_t numWorkers() const;
+
+	/**
+	 * @brief Calls fn(lo, hi) over chunks of [begin, end) in parallel
+	 * @details chunks are grain long, except possibly the last.
+	 * returns after every chunk is done
+	 */
+	template <class Fn>
+	void parallelFor(int64_t begin, int64_t end, int64_t grain, const Fn& fn);
+
+private:
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	// one queue per worker, plus one shared by threads outside the pool
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+	std::vector<std::thread> _threads;
+
+	std::mutex _sleepMutex;
+	std::condition_variable _wake;
+	std::atomic<int64_t> _queued;
+	bool _stop;
+
+	/**
+	 * @brief Returns index of the queue owned by the calling thread
+	 */
+	size_t currentQueue() const;
+
+	void push(size_t queue, std::function<void()>&& task);
+
+	/**
+	 * @brief Runs one task, from queue self first, then stolen from another
+	 * @return false if there was nothing to run
+	 */
+	bool runOne(size_t self);
+
+	void workerLoop(size_t idx);
+
+	static std::pair<const ThreadPool*, size_t>& currentWorker();
+};
+
+/**
+ * @brief Parallel execution settings for Matrix operations
+ * @details Opt in: operations run on the calling thread until setThreads()
+ * is called with more than one thread. Operations with less work than
+ * threshold() also stay on the calling thread.
+ * Settings must not be changed while matrix operations are running.
+ */
+class MatrixParallel {
+public:
+	/**
+	 * @brief Sets number of threads, including the calling thread
+	 * @details 0 uses the number of hardware threads, 1 turns threading off
+	 */
+	static void setThreads(size_t numThreads);
+
+	/**
+	 * @brief Returns number of threads used for large operations
+	 */
+	static size_t threads();
+
+	/**
+	 * @brief Sets the minimum amount of work (roughly multiply-adds or elements
+	 * touched) before an operation is split across threads
+	 */
+	static void setThreshold(int64_t work);
+
+	static int64_t threshold();
+
+	/**
+	 * @brief Calls fn(lo, hi) over chunks of [begin, end)
+	 * @details runs on the calling thread as fn(begin, end) when threading is
+	 * off or work is below threshold(), otherwise splits the range into
+	 * a few chunks per thread, each at least minGrain long
+	 */
+	template <class Fn>
+	static void run(int64_t begin, int64_t end, int64_t work, const Fn& fn, int64_t minGrain = 1);
+
+private:
+	struct State {
+		size_t threads;
+		int64_t threshold;
+		std::unique_ptr<ThreadPool> pool;
+	};
+
+	static State& state();
+};
+
+inline ThreadPool::ThreadPool(size_t numWorkers) :
+	_queued(0),
+	_stop(false) {
+	for (size_t i = 0; i < numWorkers + 1; i++) {
+		_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	for (size_t i = 0; i < numWorkers; i++) {
+		_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (size_t i = 0; i < _threads.size(); i++) {
+		_threads[i].join();
+	}
+}
+
+inline size_t ThreadPool::numWorkers() const {
+	return _threads.size();
+}
+
+template <class Fn>
+void ThreadPool::parallelFor(int64_t begin, int64_t end, int64_t grain, const Fn& fn) {
+	if (end <= begin) {
+		return;
+	}
+	if (grain < 1) {
+		grain = 1;
+	}
+	int64_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1 || _threads.empty()) {
+		fn(begin, end);
+		return;
+	}
+
+	std::atomic<int64_t> remaining(chunks - 1);
+	size_t self = currentQueue();
+
+	// spread the chunks over the queues, the calling thread keeps the first one
+	for (int64_t c = 1; c < chunks; c++) {
+		int64_t lo = begin + c * grain;
+		int64_t hi = (lo + grain < end) ? lo + grain : end;
+		push((self + c) % _queues.size(), [&fn, &remaining, lo, hi]() {
+			fn(lo, hi);
+			remaining.fetch_sub(1, std::memory_order_release);
+		});
+	}
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_wake.notify_all();
+
+	fn(begin, begin + grain);
+
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (!runOne(self)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+inline size_t ThreadPool::currentQueue() const {
+	const std::pair<const ThreadPool*, size_t>& worker = currentWorker();
+	if (worker.first == this) {
+		return worker.second;
+	}
+	return _queues.size() - 1;
+}
+
+inline void ThreadPool::push(size_t queue, std::function<void()>&& task) {
+	std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+	_queues[queue]->tasks.push_back(std::move(task));
+	_queued.fetch_add(1, std::memory_order_release);
+}
+
+inline bool ThreadPool::runOne(size_t self) {
+	std::function<void()> task;
+	for (size_t i = 0; i < _queues.size() && !task; i++) {
+		size_t idx = (self + i) % _queues.size();
+		WorkQueue& queue = *_queues[idx];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			// own queue is used as a stack for locality
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		} else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+	if (!task) {
+		return false;
+	}
+
+	_queued.fetch_sub(1, std::memory_order_acq_rel);
+	task();
+	return true;
+}
+
+inline void ThreadPool::workerLoop(size_t idx) {
+	currentWorker() = std::make_pair(this, idx);
+	while (true) {
+		if (runOne(idx)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_wake.wait(lock, [this]() {
+			return _stop || _queued.load(std::memory_order_acquire) > 0;
+		});
+		if (_stop && _queued.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+	}
+}
+
+inline std::pair<const ThreadPool*, size_t>& ThreadPool::currentWorker() {
+	static thread_local std::pair<const ThreadPool*, size_t> worker(nullptr, 0);
+	return worker;
+}
+
+inline MatrixParallel::State& MatrixParallel::state() {
+	static State s = { 1, (int64_t) 1 << 18, nullptr };
+	return s;
+}
+
+inline void MatrixParallel::setThreads(size_t numThreads) {
+	if (numThreads == 0) {
+		numThreads = std::thread::hardware_concurrency();
+		if (numThreads == 0) {
+			numThreads = 1;
+		}
+	}
+
+	State& s = state();
+	if (numThreads == s.threads) {
+		return;
+	}
+	s.pool.reset();
+	s.threads = numThreads;
+	if (numThreads > 1) {
+		s.pool.reset(new ThreadPool(numThreads - 1));
+	}
+}
+
+inline size_t MatrixParallel::threads() {
+	return state().threads;
+}
+
+inline void MatrixParallel::setThreshold(int64_t work) {
+	state().threshold = work;
+}
+
+inline int64_t MatrixParallel::threshold() {
+	return state().threshold;
+}
+
+template <class Fn>
+void MatrixParallel::run(int64_t begin, int64_t end, int64_t work, const Fn& fn, int64_t minGrain) {
+	State& s = state();
+	if (s.threads <= 1 || work < s.threshold || end - begin <= minGrain) {
+		if (end > begin) {
+			fn(begin, end);
+		}
+		return;
+	}
+
+	// a few chunks per thread so stealing can even out the load
+	int64_t chunks = (int64_t) s.threads * 4;
+	int64_t grain = (end - begin + chunks - 1) / chunks;
+	if (grain < minGrain) {
+		grain = minGrain;
+	}
+	s.pool->parallelFor(begin, end, grain, fn);
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_PARALLEL_HPP */
@@ -0,0 +1,331 @@
+#ifndef _MATRIX_SIMD_HPP
+#define _MATRIX_SIMD_HPP
+
+/**
+ * Element-wise vector kernels used by Matrix
+ * float and double versions use SSE2, AVX2 or AVX-512, picked at runtime
+ * from what the cpu supports. Every other type uses the scalar versions.
+ * define MATRIX_NO_SIMD to always use the scalar versions
+ */
+
+#include <cstdint>
+
+#if !defined(MATRIX_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace Alectryon {
+
+namespace MatrixKernels {
+
+///////////////////////////////////
+// SCALAR KERNELS
+///////////////////////////////////
+
+/**
+ * @brief dest[i] = a[i] + b[i]
+ */
+template <class T>
+void vectorAdd(int64_t n, const T* a, const T* b, T* dest) {
+	for (int64_t i = 0; i < n; ++i) {
+		dest[i] = a[i] + b[i];
+	}
+}
+
+/**
+ * @brief dest[i] = a[i] - b[i]
+ */
+template <class T>
+void vectorSubtract(int64_t n, const T* a, const T* b, T* dest) {
+	for (int64_t i = 0; i < n; ++i) {
+		dest[i] = a[i] - b[i];
+	}
+}
+
+/**
+ * @brief dest[i] = src[i] + scalar
+ */
+template <class T>
+void vectorAddScalar(int64_t n, const T* src, T scalar, T* dest) {
+	for (int64_t i = 0; i < n; ++i) {
+		dest[i] = src[i] + scalar;
+	}
+}
+
+/**
+ * @brief dest[i] = src[i] * scalar
+ */
+template <class T>
+void vectorScale(int64_t n, const T* src, T scalar, T* dest) {
+	for (int64_t i = 0; i < n; ++i) {
+		dest[i] = src[i] * scalar;
+	}
+}
+
+/**
+ * @brief dest[i] = value
+ */
+template <class T>
+void vectorFill(int64_t n, T value, T* dest) {
+	for (int64_t i = 0; i < n; ++i) {
+		dest[i] = value;
+	}
+}
+
+/**
+ * @brief y[i] += alpha * x[i]
+ */
+template <class T>
+void vectorAxpy(int64_t n, T alpha, const T* x, T* y) {
+	for (int64_t i = 0; i < n; ++i) {
+		y[i] += alpha * x[i];
+	}
+}
+
+/**
+ * @brief table of vector kernels for one instruction set
+ */
+template <class T>
+struct VectorKernels {
+	void (*add)(int64_t, const T*, const T*, T*);
+	void (*subtract)(int64_t, const T*, const T*, T*);
+	void (*addScalar)(int64_t, const T*, T, T*);
+	void (*scale)(int64_t, const T*, T, T*);
+	void (*fill)(int64_t, T, T*);
+	void (*axpy)(int64_t, T, const T*, T*);
+	const char* name;
+};
+
+template <class T>
+VectorKernels<T> scalarVectorKernels() {
+	VectorKernels<T> kernels = {
+		vectorAdd<T>, vectorSubtract<T>, vectorAddScalar<T>,
+		vectorScale<T>, vectorFill<T>, vectorAxpy<T>, "scalar"
+	};
+	return kernels;
+}
+
+#ifdef MATRIX_SIMD_X86
+
+///////////////////////////////////
+// SIMD KERNELS
+///////////////////////////////////
+
+// generates the six kernels for one instruction set and type
+// V is the register type, W the number of elements per register
+#define MATRIX_SIMD_KERNELS(ISA, TARGET, T, V, W, LOAD, STORE, SET1, ADD, SUB, MUL, FMADD) \
+__attribute__((target(TARGET))) inline \
+void vectorAdd##ISA(int64_t n, const T* a, const T* b, T* dest) { \
+	int64_t i = 0; \
+	for (; i + W <= n; i += W) { \
+		STORE(dest + i, ADD(LOAD(a + i), LOAD(b + i))); \
+	} \
+	for (; i < n; ++i) { \
+		dest[i] = a[i] + b[i]; \
+	} \
+} \
+__attribute__((target(TARGET))) inline \
+void vectorSubtract##ISA(int64_t n, const T* a, const T* b, T* dest) { \
+	int64_t i = 0; \
+	for (; i + W <= n; i += W) { \
+		STORE(dest + i, SUB(LOAD(a + i), LOAD(b + i))); \
+	} \
+	for (; i < n; ++i) { \
+		dest[i] = a[i] - b[i]; \
+	} \
+} \
+__attribute__((target(TARGET))) inline \
+void vectorAddScalar##ISA(int64_t n, const T* src, T scalar, T* dest) { \
+	V s = SET1(scalar); \
+	int64_t i = 0; \
+	for (; i + W <= n; i += W) { \
+		STORE(dest + i, ADD(LOAD(src + i), s)); \
+	} \
+	for (; i < n; ++i) { \
+		dest[i] = src[i] + scalar; \
+	} \
+} \
+__attribute__((target(TARGET))) inline \
+void vectorScale##ISA(int64_t n, const T* src, T scalar, T* dest) { \
+	V s = SET1(scalar); \
+	int64_t i = 0; \
+	for (; i + W <= n; i += W) { \
+		STORE(dest + i, MUL(LOAD(src + i), s)); \
+	} \
+	for (; i < n; ++i) { \
+		dest[i] = src[i] * scalar; \
+	} \
+} \
+__attribute__((target(TARGET))) inline \
+void vectorFill##ISA(int64_t n, T value, T* dest) { \
+	V v = SET1(value); \
+	int64_t i = 0; \
+	for (; i + W <= n; i += W) { \
+		STORE(dest + i, v); \
+	} \
+	for (; i < n; ++i) { \
+		dest[i] = value; \
+	} \
+} \
+__attribute__((target(TARGET))) inline \
+void vectorAxpy##ISA(int64_t n, T alpha, const T* x, T* y) { \
+	V a = SET1(alpha); \
+	int64_t i = 0; \
+	for (; i + 2 * W <= n; i += 2 * W) { \
+		STORE(y + i, FMADD(a, LOAD(x + i), LOAD(y + i))); \
+		STORE(y + i + W, FMADD(a, LOAD(x + i + W), LOAD(y + i + W))); \
+	} \
+	for (; i + W <= n; i += W) { \
+		STORE(y + i, FMADD(a, LOAD(x + i), LOAD(y + i))); \
+	} \
+	for (; i < n; ++i) { \
+		y[i] += alpha * x[i]; \
+	} \
+}
+
+#define MATRIX_SSE_FMADD_PS(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#define MATRIX_SSE_FMADD_PD(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+
+MATRIX_SIMD_KERNELS(Sse2Float, "sse2", float, __m128, 4,
+	_mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+	_mm_add_ps, _mm_sub_ps, _mm_mul_ps, MATRIX_SSE_FMADD_PS)
+MATRIX_SIMD_KERNELS(Sse2Double, "sse2", double, __m128d, 2,
+	_mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,
+	_mm_add_pd, _mm_sub_pd, _mm_mul_pd, MATRIX_SSE_FMADD_PD)
+MATRIX_SIMD_KERNELS(Avx2Float, "avx2,fma", float, __m256, 8,
+	_mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+	_mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_fmadd_ps)
+MATRIX_SIMD_KERNELS(Avx2Double, "avx2,fma", double, __m256d, 4,
+	_mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+	_mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_fmadd_pd)
+MATRIX_SIMD_KERNELS(Avx512Float, "avx512f", float, __m512, 16,
+	_mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps,
+	_mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_fmadd_ps)
+MATRIX_SIMD_KERNELS(Avx512Double, "avx512f", double, __m512d, 8,
+	_mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd,
+	_mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_fmadd_pd)
+
+#undef MATRIX_SSE_FMADD_PS
+#undef MATRIX_SSE_FMADD_PD
+#undef MATRIX_SIMD_KERNELS
+
+#define MATRIX_SIMD_TABLE(ISA, NAME) { \
+	vectorAdd##ISA, vectorSubtract##ISA, vectorAddScalar##ISA, \
+	vectorScale##ISA, vectorFill##ISA, vectorAxpy##ISA, NAME }
+
+/**
+ * @brief picks the widest instruction set the cpu supports
+ */
+inline VectorKernels<float> detectVectorKernels(float*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		VectorKernels<float> kernels = MATRIX_SIMD_TABLE(Avx512Float, "avx512f");
+		return kernels;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		VectorKernels<float> kernels = MATRIX_SIMD_TABLE(Avx2Float, "avx2");
+		return kernels;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		VectorKernels<float> kernels = MATRIX_SIMD_TABLE(Sse2Float, "sse2");
+		return kernels;
+	}
+	return scalarVectorKernels<float>();
+}
+
+inline VectorKernels<double> detectVectorKernels(double*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		VectorKernels<double> kernels = MATRIX_SIMD_TABLE(Avx512Double, "avx512f");
+		return kernels;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		VectorKernels<double> kernels = MATRIX_SIMD_TABLE(Avx2Double, "avx2");
+		return kernels;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		VectorKernels<double> kernels = MATRIX_SIMD_TABLE(Sse2Double, "sse2");
+		return kernels;
+	}
+	return scalarVectorKernels<double>();
+}
+
+#undef MATRIX_SIMD_TABLE
+
+#endif /* MATRIX_SIMD_X86 */
+
+template <class T>
+VectorKernels<T> detectVectorKernels(T*) {
+	return scalarVectorKernels<T>();
+}
+
+/**
+ * @brief Gets the kernels selected for this cpu
+ * @details detection runs once, on first use
+ */
+template <class T>
+const VectorKernels<T>& vectorKernels() {
+	static const VectorKernels<T> kernels = detectVectorKernels((T*) nullptr);
+	return kernels;
+}
+
+///////////////////////////////////
+// DISPATCHING OVERLOADS
+///////////////////////////////////
+
+// float and double overloads are preferred over the scalar templates
+
+inline void vectorAdd(int64_t n, const float* a, const float* b, float* dest) {
+	vectorKernels<float>().add(n, a, b, dest);
+}
+
+inline void vectorAdd(int64_t n, const double* a, const double* b, double* dest) {
+	vectorKernels<double>().add(n, a, b, dest);
+}
+
+inline void vectorSubtract(int64_t n, const float* a, const float* b, float* dest) {
+	vectorKernels<float>().subtract(n, a, b, dest);
+}
+
+inline void vectorSubtract(int64_t n, const double* a, const double* b, double* dest) {
+	vectorKernels<double>().subtract(n, a, b, dest);
+}
+
+inline void vectorAddScalar(int64_t n, const float* src, float scalar, float* dest) {
+	vectorKernels<float>().addScalar(n, src, scalar, dest);
+}
+
+inline void vectorAddScalar(int64_t n, const double* src, double scalar, double* dest) {
+	vectorKernels<double>().addScalar(n, src, scalar, dest);
+}
+
+inline void vectorScale(int64_t n, const float* src, float scalar, float* dest) {
+	vectorKernels<float>().scale(n, src, scalar, dest);
+}
+
+inline void vectorScale(int64_t n, const double* src, double scalar, double* dest) {
+	vectorKernels<double>().scale(n, src, scalar, dest);
+}
+
+inline void vectorFill(int64_t n, float value, float* dest) {
+	vectorKernels<float>().fill(n, value, dest);
+}
+
+inline void vectorFill(int64_t n, double value, double* dest) {
+	vectorKernels<double>().fill(n, value, dest);
+}
+
+inline void vectorAxpy(int64_t n, float alpha, const float* x, float* y) {
+	vectorKernels<float>().axpy(n, alpha, x, y);
+}
+
+inline void vectorAxpy(int64_t n, double alpha, const double* x, double* y) {
+	vectorKernels<double>().axpy(n, alpha, x, y);
+}
+
+} // namespace MatrixKernels
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_SIMD_HPP */
@@ -0,0 +1,379 @@
+#ifndef _MATRIX_STRASSEN_HPP
+#define _MATRIX_STRASSEN_HPP
+
+/**
+ * Strassen-Winograd multiply used by Matrix for very large products
+ * Each level splits A, B and C into quadrants and forms C from 7 products
+ * of quadrant sums instead of 8, with 15 additions. Below the crossover
+ * the products go to gemm. Odd sides are peeled off and fixed up with gemm.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include "MatrixGemm.hpp"
+#include "MatrixLayout.hpp"
+#include "MatrixParallel.hpp"
+#include "MatrixSimd.hpp"
+
+namespace Alectryon {
+
+/**
+ * @brief When Matrix::multiply uses Strassen-Winograd
+ * @details Opt in: it is off until setCrossover() is called, since it rounds
+ * differently (slightly worse) than the classical product.
+ * Only float and double products use it.
+ * Settings must not be changed while matrix operations are running.
+ */
+class MatrixStrassen {
+public:
+	/**
+	 * @brief Sets the smallest side a Strassen sub-product can have
+	 * @details products with every side at least 2 * n are split, and the
+	 * split repeats until a side would go below n. 0 turns Strassen off.
+	 * around 1024 is a good start, tune it against gemm on the target machine
+	 */
+	static void setCrossover(int32_t n);
+
+	static int32_t crossover();
+
+	/**
+	 * @brief returns true if an m x k times k x n product of T is split
+	 */
+	template <class T>
+	static bool applies(int32_t m, int32_t n, int32_t k);
+
+	/**
+	 * @brief returns number of scratch elements multiply() needs
+	 * @details sums and products of every level share one buffer, each level
+	 * uses it after the levels above. when MatrixParallel has threads the top
+	 * level keeps all 7 products' operands at once, (m * k + k * n + 3 * m * n) / 4
+	 * more than the serial schedule's (m * k + k * n + m * n) / 3 or so
+	 */
+	template <class T>
+	static int64_t scratchSize(int32_t m, int32_t n, int32_t k);
+
+	/**
+	 * @brief computes C = A * B
+	 * @details A is m x k, B is k x n and C is m x n, all row major with
+	 * leading dimensions lda, ldb and ldc. C can not overlap A or B.
+	 * scratch holds scratchSize(m, n, k) elements
+	 */
+	template <class T>
+	static void multiply(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch);
+
+private:
+	static int32_t& state();
+
+	/**
+	 * @brief returns true if the top level runs its 7 products in parallel
+	 */
+	static bool parallel(int32_t m, int32_t n, int32_t k);
+
+	/**
+	 * @brief scratch elements of the serial schedule
+	 */
+	template <class T>
+	static int64_t serialScratchSize(int32_t m, int32_t n, int32_t k);
+
+	/**
+	 * @brief computes C = A * B for even m, n and k with 3 temporaries
+	 */
+	template <class T>
+	static void serialLevel(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch);
+
+	/**
+	 * @brief computes C = A * B for even m, n and k, with the 7 products in parallel
+	 */
+	template <class T>
+	static void parallelLevel(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch);
+
+	/**
+	 * @brief recurses on the even part, fixes up the odd row, column and k
+	 */
+	template <class T>
+	static void recurse(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch, bool top);
+
+	/**
+	 * @brief C = A + B over an m x n block
+	 */
+	template <class T>
+	static void add(int32_t m, int32_t n, const T* A, int32_t lda, const T* B, int32_t ldb,
+		T* C, int32_t ldc);
+
+	/**
+	 * @brief C = A - B over an m x n block
+	 */
+	template <class T>
+	static void subtract(int32_t m, int32_t n, const T* A, int32_t lda, const T* B, int32_t ldb,
+		T* C, int32_t ldc);
+};
+
+inline int32_t& MatrixStrassen::state() {
+	static int32_t crossover = 0;
+	return crossover;
+}
+
+inline void MatrixStrassen::setCrossover(int32_t n) {
+	assert(n >= 0);
+	state() = n;
+}
+
+inline int32_t MatrixStrassen::crossover() {
+	return state();
+}
+
+template <class T>
+bool MatrixStrassen::applies(int32_t m, int32_t n, int32_t k) {
+	int32_t c = crossover();
+	if (!std::is_floating_point<T>::value || c == 0) {
+		return false;
+	}
+	int32_t smallest = (m < n) ? m : n;
+	smallest = (smallest < k) ? smallest : k;
+	return smallest / 2 >= c;
+}
+
+inline bool MatrixStrassen::parallel(int32_t m, int32_t n, int32_t k) {
+	return MatrixParallel::threads() > 1 && (int64_t) m * n * k >= MatrixParallel::threshold();
+}
+
+template <class T>
+int64_t MatrixStrassen::scratchSize(int32_t m, int32_t n, int32_t k) {
+	if (!applies<T>(m, n, k)) {
+		return 0;
+	}
+	if (!parallel(m, n, k)) {
+		return serialScratchSize<T>(m, n, k);
+	}
+	int64_t mh = m / 2;
+	int64_t nh = n / 2;
+	int64_t kh = k / 2;
+	return 4 * mh * kh + 4 * kh * nh + 3 * mh * nh + 7 * serialScratchSize<T>(mh, nh, kh);
+}
+
+template <class T>
+int64_t MatrixStrassen::serialScratchSize(int32_t m, int32_t n, int32_t k) {
+	if (!applies<T>(m, n, k)) {
+		return 0;
+	}
+	int64_t mh = m / 2;
+	int64_t nh = n / 2;
+	int64_t kh = k / 2;
+	return mh * kh + kh * nh + mh * nh + serialScratchSize<T>(mh, nh, kh);
+}
+
+template <class T>
+void MatrixStrassen::multiply(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch) {
+	recurse(m, n, k, A, lda, B, ldb, C, ldc, scratch, true);
+}
+
+template <class T>
+void MatrixStrassen::recurse(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch, bool top) {
+	if (!applies<T>(m, n, k)) {
+		MatrixKernels::gemm(m, n, k, T(1), A, lda, B, ldb, T(0), C, ldc);
+		return;
+	}
+
+	int32_t me = m & ~1;
+	int32_t ne = n & ~1;
+	int32_t ke = k & ~1;
+	if (top && parallel(m, n, k)) {
+		parallelLevel(me, ne, ke, A, lda, B, ldb, C, ldc, scratch);
+	} else {
+		serialLevel(me, ne, ke, A, lda, B, ldb, C, ldc, scratch);
+	}
+
+	// the last column of A times the last row of B
+	if (ke < k) {
+		MatrixKernels::gemm(me, ne, 1, T(1), A + ke, lda, B + (int64_t) ke * ldb, ldb,
+			T(1), C, ldc);
+	}
+	// the last column of C
+	if (ne < n) {
+		MatrixKernels::gemm(m, 1, k, T(1), A, lda, B + ne, ldb, T(0), C + ne, ldc);
+	}
+	// the last row of C
+	if (me < m) {
+		MatrixKernels::gemm(1, ne, k, T(1), A + (int64_t) me * lda, lda, B, ldb,
+			T(0), C + (int64_t) me * ldc, ldc);
+	}
+}
+
+template <class T>
+void MatrixStrassen::serialLevel(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch) {
+	const int32_t mh = m / 2;
+	const int32_t nh = n / 2;
+	const int32_t kh = k / 2;
+
+	const T* A11 = A;
+	const T* A12 = A + kh;
+	const T* A21 = A + (int64_t) mh * lda;
+	const T* A22 = A21 + kh;
+	const T* B11 = B;
+	const T* B12 = B + nh;
+	const T* B21 = B + (int64_t) kh * ldb;
+	const T* B22 = B21 + nh;
+	T* C11 = C;
+	T* C12 = C + nh;
+	T* C21 = C + (int64_t) mh * ldc;
+	T* C22 = C21 + nh;
+
+	// X is mh x kh, Y is kh x nh and Z is mh x nh, the rest is for the level below
+	T* X = scratch;
+	T* Y = X + (int64_t) mh * kh;
+	T* Z = Y + (int64_t) kh * nh;
+	T* below = Z + (int64_t) mh * nh;
+
+	// P7 = (A11 - A21) * (B22 - B12) into C21
+	subtract(mh, kh, A11, lda, A21, lda, X, kh);
+	subtract(kh, nh, B22, ldb, B12, ldb, Y, nh);
+	recurse(mh, nh, kh, X, kh, Y, nh, C21, ldc, below, false);
+
+	// P5 = S1 * T1 into C22, S1 = A21 + A22, T1 = B12 - B11
+	add(mh, kh, A21, lda, A22, lda, X, kh);
+	subtract(kh, nh, B12, ldb, B11, ldb, Y, nh);
+	recurse(mh, nh, kh, X, kh, Y, nh, C22, ldc, below, false);
+
+	// P6 = S2 * T2 into C12, S2 = S1 - A11, T2 = B22 - T1
+	subtract(mh, kh, X, kh, A11, lda, X, kh);
+	subtract(kh, nh, B22, ldb, Y, nh, Y, nh);
+	recurse(mh, nh, kh, X, kh, Y, nh, C12, ldc, below, false);
+
+	// P3 = S4 * B22 into C11, S4 = A12 - S2
+	subtract(mh, kh, A12, lda, X, kh, X, kh);
+	recurse(mh, nh, kh, X, kh, B22, ldb, C11, ldc, below, false);
+
+	// P1 = A11 * B11 into Z
+	recurse(mh, nh, kh, A11, lda, B11, ldb, Z, nh, below, false);
+
+	// U2 = P1 + P6, U3 = U2 + P7, U4 = U2 + P5
+	add(mh, nh, Z, nh, C12, ldc, C12, ldc);
+	add(mh, nh, C12, ldc, C21, ldc, C21, ldc);
+	add(mh, nh, C12, ldc, C22, ldc, C12, ldc);
+	// C22 = U3 + P5, C12 = U4 + P3
+	add(mh, nh, C21, ldc, C22, ldc, C22, ldc);
+	add(mh, nh, C12, ldc, C11, ldc, C12, ldc);
+
+	// P4 = A22 * T4 into C11, T4 = T2 - B21, then C21 = U3 - P4
+	subtract(kh, nh, Y, nh, B21, ldb, Y, nh);
+	recurse(mh, nh, kh, A22, lda, Y, nh, C11, ldc, below, false);
+	subtract(mh, nh, C21, ldc, C11, ldc, C21, ldc);
+
+	// C11 = P1 + P2, P2 = A12 * B21
+	recurse(mh, nh, kh, A12, lda, B21, ldb, C11, ldc, below, false);
+	add(mh, nh, Z, nh, C11, ldc, C11, ldc);
+}
+
+template <class T>
+void MatrixStrassen::parallelLevel(int32_t m, int32_t n, int32_t k, const T* A, int32_t lda,
+		const T* B, int32_t ldb, T* C, int32_t ldc, T* scratch) {
+	const int32_t mh = m / 2;
+	const int32_t nh = n / 2;
+	const int32_t kh = k / 2;
+	const int64_t sizeA = (int64_t) mh * kh;
+	const int64_t sizeB = (int64_t) kh * nh;
+	const int64_t sizeC = (int64_t) mh * nh;
+
+	const T* A11 = A;
+	const T* A12 = A + kh;
+	const T* A21 = A + (int64_t) mh * lda;
+	const T* A22 = A21 + kh;
+	const T* B11 = B;
+	const T* B12 = B + nh;
+	const T* B21 = B + (int64_t) kh * ldb;
+	const T* B22 = B21 + nh;
+	T* C11 = C;
+	T* C12 = C + nh;
+	T* C21 = C + (int64_t) mh * ldc;
+	T* C22 = C21 + nh;
+
+	T* S1 = scratch;
+	T* S2 = S1 + sizeA;
+	T* S3 = S2 + sizeA;
+	T* S4 = S3 + sizeA;
+	T* T1 = S4 + sizeA;
+	T* T2 = T1 + sizeB;
+	T* T3 = T2 + sizeB;
+	T* T4 = T3 + sizeB;
+	T* P1 = T4 + sizeB;
+	T* P2 = P1 + sizeC;
+	T* P6 = P2 + sizeC;
+	T* below = P6 + sizeC;
+	const int64_t belowSize = serialScratchSize<T>(mh, nh, kh);
+
+	add(mh, kh, A21, lda, A22, lda, S1, kh);
+	subtract(mh, kh, S1, kh, A11, lda, S2, kh);
+	subtract(mh, kh, A11, lda, A21, lda, S3, kh);
+	subtract(mh, kh, A12, lda, S2, kh, S4, kh);
+	subtract(kh, nh, B12, ldb, B11, ldb, T1, nh);
+	subtract(kh, nh, B22, ldb, T1, nh, T2, nh);
+	subtract(kh, nh, B22, ldb, B12, ldb, T3, nh);
+	subtract(kh, nh, T2, nh, B21, ldb, T4, nh);
+
+	// P3, P4, P5 and P7 go straight into quadrants of C
+	struct Product {
+		const T* A;
+		int32_t lda;
+		const T* B;
+		int32_t ldb;
+		T* C;
+		int32_t ldc;
+	};
+	const Product products[7] = {
+		{ A11, lda, B11, ldb, P1, nh },
+		{ A12, lda, B21, ldb, P2, nh },
+		{ S4, kh, B22, ldb, C12, ldc },
+		{ A22, lda, T4, nh, C21, ldc },
+		{ S1, kh, T1, nh, C22, ldc },
+		{ S2, kh, T2, nh, P6, nh },
+		{ S3, kh, T3, nh, C11, ldc }
+	};
+	MatrixParallel::run(0, 7, (int64_t) m * n * k, [&](int64_t lo, int64_t hi) {
+		for (int64_t i = lo; i < hi; ++i) {
+			const Product& p = products[i];
+			recurse(mh, nh, kh, p.A, p.lda, p.B, p.ldb, p.C, p.ldc, below + i * belowSize, false);
+		}
+	});
+
+	// U2 = P1 + P6 into P6
+	add(mh, nh, P1, nh, P6, nh, P6, nh);
+	// C12 = U2 + P5 + P3
+	add(mh, nh, C12, ldc, P6, nh, C12, ldc);
+	add(mh, nh, C12, ldc, C22, ldc, C12, ldc);
+	// C22 = U2 + P7 + P5
+	add(mh, nh, C22, ldc, P6, nh, C22, ldc);
+	add(mh, nh, C22, ldc, C11, ldc, C22, ldc);
+	// C21 = U2 + P7 - P4
+	subtract(mh, nh, C11, ldc, C21, ldc, C21, ldc);
+	add(mh, nh, C21, ldc, P6, nh, C21, ldc);
+	// C11 = P1 + P2
+	add(mh, nh, P1, nh, P2, nh, C11, ldc);
+}
+
+template <class T>
+void MatrixStrassen::add(int32_t m, int32_t n, const T* A, int32_t lda, const T* B, int32_t ldb,
+		T* C, int32_t ldc) {
+	for (int32_t i = 0; i < m; ++i) {
+		MatrixKernels::vectorAdd(n, A + (int64_t) i * lda, B + (int64_t) i * ldb, C + (int64_t) i * ldc);
+	}
+}
+
+template <class T>
+void MatrixStrassen::subtract(int32_t m, int32_t n, const T* A, int32_t lda, const T* B, int32_t ldb,
+		T* C, int32_t ldc) {
+	for (int32_t i = 0; i < m; ++i) {
+		MatrixKernels::vectorSubtract(n, A + (int64_t) i * lda, B + (int64_t) i * ldb, C + (int64_t) i * ldc);
+	}
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_STRASSEN_HPP */
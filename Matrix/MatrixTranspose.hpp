@@ -0,0 +1,303 @@
+#ifndef _MATRIX_TRANSPOSE_HPP
+#define _MATRIX_TRANSPOSE_HPP
+
+/**
+ * Transpose kernels used by Matrix
+ * Out of place transposes split the matrix in half recursively until a
+ * block fits in L1, then move small square tiles through registers so both
+ * the reads and the writes are contiguous. float and double tiles use SSE2
+ * or AVX, picked at runtime like the vector kernels in MatrixSimd.hpp
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "MatrixParallel.hpp"
+#include "MatrixSimd.hpp"
+
+namespace Alectryon {
+
+namespace MatrixKernels {
+
+/**
+ * @brief largest block transposed without splitting it further,
+ * 32 x 32 doubles in and out fit in L1
+ */
+const int32_t TransposeBlockSize = 32;
+
+/**
+ * @brief square register tile transpose for one instruction set
+ */
+template <class T>
+struct TransposeKernels {
+	// the tile is width x width
+	int32_t width;
+	void (*tile)(const T* src, int32_t lds, T* dest, int32_t ldd);
+	const char* name;
+};
+
+template <class T>
+void transposeTileScalar(const T* src, int32_t lds, T* dest, int32_t ldd) {
+	for (int32_t i = 0; i < 4; ++i) {
+		for (int32_t j = 0; j < 4; ++j) {
+			dest[(int64_t) j * ldd + i] = src[(int64_t) i * lds + j];
+		}
+	}
+}
+
+template <class T>
+TransposeKernels<T> scalarTransposeKernels() {
+	TransposeKernels<T> kernels = { 4, transposeTileScalar<T>, "scalar" };
+	return kernels;
+}
+
+#ifdef MATRIX_SIMD_X86
+
+__attribute__((target("sse2"))) inline
+void transposeTileSse2Float(const float* src, int32_t lds, float* dest, int32_t ldd) {
+	__m128 r0 = _mm_loadu_ps(src);
+	__m128 r1 = _mm_loadu_ps(src + lds);
+	__m128 r2 = _mm_loadu_ps(src + 2 * (int64_t) lds);
+	__m128 r3 = _mm_loadu_ps(src + 3 * (int64_t) lds);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(dest, r0);
+	_mm_storeu_ps(dest + ldd, r1);
+	_mm_storeu_ps(dest + 2 * (int64_t) ldd, r2);
+	_mm_storeu_ps(dest + 3 * (int64_t) ldd, r3);
+}
+
+__attribute__((target("sse2"))) inline
+void transposeTileSse2Double(const double* src, int32_t lds, double* dest, int32_t ldd) {
+	// four 2 x 2 transposes
+	for (int32_t i = 0; i < 4; i += 2) {
+		for (int32_t j = 0; j < 4; j += 2) {
+			const double* in = src + (int64_t) i * lds + j;
+			__m128d r0 = _mm_loadu_pd(in);
+			__m128d r1 = _mm_loadu_pd(in + lds);
+			double* out = dest + (int64_t) j * ldd + i;
+			_mm_storeu_pd(out, _mm_unpacklo_pd(r0, r1));
+			_mm_storeu_pd(out + ldd, _mm_unpackhi_pd(r0, r1));
+		}
+	}
+}
+
+__attribute__((target("avx"))) inline
+void transposeTileAvxFloat(const float* src, int32_t lds, float* dest, int32_t ldd) {
+	__m256 r[8];
+	for (int32_t i = 0; i < 8; ++i) {
+		r[i] = _mm256_loadu_ps(src + (int64_t) i * lds);
+	}
+
+	// interleave pairs of rows, then pairs of pairs, then swap 128 bit halves
+	__m256 t[8];
+	for (int32_t i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+	}
+	for (int32_t i = 0; i < 8; i += 4) {
+		r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+		r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+		r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+		r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+	}
+	for (int32_t i = 0; i < 4; ++i) {
+		_mm256_storeu_ps(dest + (int64_t) i * ldd, _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+		_mm256_storeu_ps(dest + (int64_t) (i + 4) * ldd, _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+	}
+}
+
+__attribute__((target("avx"))) inline
+void transposeTileAvxDouble(const double* src, int32_t lds, double* dest, int32_t ldd) {
+	__m256d r0 = _mm256_loadu_pd(src);
+	__m256d r1 = _mm256_loadu_pd(src + lds);
+	__m256d r2 = _mm256_loadu_pd(src + 2 * (int64_t) lds);
+	__m256d r3 = _mm256_loadu_pd(src + 3 * (int64_t) lds);
+
+	__m256d t0 = _mm256_unpacklo_pd(r0, r1);
+	__m256d t1 = _mm256_unpackhi_pd(r0, r1);
+	__m256d t2 = _mm256_unpacklo_pd(r2, r3);
+	__m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+	_mm256_storeu_pd(dest, _mm256_permute2f128_pd(t0, t2, 0x20));
+	_mm256_storeu_pd(dest + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+	_mm256_storeu_pd(dest + 2 * (int64_t) ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+	_mm256_storeu_pd(dest + 3 * (int64_t) ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+inline TransposeKernels<float> detectTransposeKernels(float*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx")) {
+		TransposeKernels<float> kernels = { 8, transposeTileAvxFloat, "avx" };
+		return kernels;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		TransposeKernels<float> kernels = { 4, transposeTileSse2Float, "sse2" };
+		return kernels;
+	}
+	return scalarTransposeKernels<float>();
+}
+
+inline TransposeKernels<double> detectTransposeKernels(double*) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx")) {
+		TransposeKernels<double> kernels = { 4, transposeTileAvxDouble, "avx" };
+		return kernels;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		TransposeKernels<double> kernels = { 4, transposeTileSse2Double, "sse2" };
+		return kernels;
+	}
+	return scalarTransposeKernels<double>();
+}
+
+#endif /* MATRIX_SIMD_X86 */
+
+template <class T>
+TransposeKernels<T> detectTransposeKernels(T*) {
+	return scalarTransposeKernels<T>();
+}
+
+/**
+ * @brief Gets the transpose tile selected for this cpu
+ */
+template <class T>
+const TransposeKernels<T>& transposeKernels() {
+	static const TransposeKernels<T> kernels = detectTransposeKernels((T*) nullptr);
+	return kernels;
+}
+
+/**
+ * @brief transposes a block of at most TransposeBlockSize x TransposeBlockSize
+ * @details full tiles go through registers, the ragged edges are scalar
+ */
+template <class T>
+void transposeBlock(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd,
+		const TransposeKernels<T>& kernels) {
+	const int32_t w = kernels.width;
+	int32_t fullRows = rows - rows % w;
+	int32_t fullCols = cols - cols % w;
+	for (int32_t i = 0; i < fullRows; i += w) {
+		for (int32_t j = 0; j < fullCols; j += w) {
+			kernels.tile(src + (int64_t) i * lds + j, lds, dest + (int64_t) j * ldd + i, ldd);
+		}
+	}
+	for (int32_t i = 0; i < rows; ++i) {
+		const T* row = src + (int64_t) i * lds;
+		int32_t start = (i < fullRows) ? fullCols : 0;
+		for (int32_t j = start; j < cols; ++j) {
+			dest[(int64_t) j * ldd + i] = row[j];
+		}
+	}
+}
+
+/**
+ * @brief cache oblivious transpose, halves the longer side until a block fits
+ */
+template <class T>
+void transposeRecursive(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd,
+		const TransposeKernels<T>& kernels) {
+	if (rows <= TransposeBlockSize && cols <= TransposeBlockSize) {
+		transposeBlock(rows, cols, src, lds, dest, ldd, kernels);
+		return;
+	}
+
+	// split on a multiple of 8 so tiles stay whole
+	if (rows >= cols) {
+		int32_t half = ((rows / 2) + 7) & ~7;
+		transposeRecursive(half, cols, src, lds, dest, ldd, kernels);
+		transposeRecursive(rows - half, cols, src + (int64_t) half * lds, lds, dest + half, ldd, kernels);
+	} else {
+		int32_t half = ((cols / 2) + 7) & ~7;
+		transposeRecursive(rows, half, src, lds, dest, ldd, kernels);
+		transposeRecursive(rows, cols - half, src + half, lds, dest + (int64_t) half * ldd, ldd, kernels);
+	}
+}
+
+/**
+ * @brief dest = src^T, src is rows x cols
+ * @details src and dest can NOT overlap. bands of rows run on separate threads
+ */
+template <class T>
+void transpose(int32_t rows, int32_t cols, const T* src, int32_t lds, T* dest, int32_t ldd) {
+	const TransposeKernels<T>& kernels = transposeKernels<T>();
+	MatrixParallel::run(0, rows, (int64_t) rows * cols, [&](int64_t lo, int64_t hi) {
+		transposeRecursive((int32_t) (hi - lo), cols, src + lo * lds, lds, dest + lo, ldd, kernels);
+	}, TransposeBlockSize);
+}
+
+/**
+ * @brief transposes the n x n matrix in place
+ * @details pairs of blocks on either side of the diagonal are swapped
+ * through a block sized buffer on the stack
+ */
+template <class T>
+void transposeSquare(int32_t n, T* data, int32_t ld) {
+	const int32_t B = TransposeBlockSize;
+	const TransposeKernels<T>& kernels = transposeKernels<T>();
+	int32_t blocks = (n + B - 1) / B;
+
+	MatrixParallel::run(0, blocks, (int64_t) n * n / 2, [&](int64_t lo, int64_t hi) {
+		T buffer[TransposeBlockSize * TransposeBlockSize];
+		for (int32_t bi = (int32_t) lo; bi < (int32_t) hi; ++bi) {
+			int32_t i0 = bi * B;
+			int32_t mb = (n - i0 < B) ? n - i0 : B;
+
+			// diagonal block
+			for (int32_t i = 0; i < mb; ++i) {
+				for (int32_t j = i + 1; j < mb; ++j) {
+					std::swap(data[(int64_t) (i0 + i) * ld + i0 + j], data[(int64_t) (i0 + j) * ld + i0 + i]);
+				}
+			}
+
+			// A_ij <-> A_ji^T for the blocks right of the diagonal
+			for (int32_t j0 = i0 + B; j0 < n; j0 += B) {
+				int32_t nb = (n - j0 < B) ? n - j0 : B;
+				T* upper = data + (int64_t) i0 * ld + j0;
+				T* lower = data + (int64_t) j0 * ld + i0;
+				transposeBlock(mb, nb, upper, ld, buffer, B, kernels);
+				transposeBlock(nb, mb, lower, ld, upper, ld, kernels);
+				for (int32_t j = 0; j < nb; ++j) {
+					memcpy(lower + (int64_t) j * ld, buffer + (int64_t) j * B, mb * sizeof(T));
+				}
+			}
+		}
+	});
+}
+
+/**
+ * @brief transposes a contiguous rows x cols matrix in place, leaving it cols x rows
+ * @details follows the permutation cycles, one bit per element marks what
+ * has moved. much slower than transpose() since every move is a cache
+ * miss, it only saves memory
+ */
+template <class T>
+void transposeInPlace(int32_t rows, int32_t cols, T* data) {
+	if (rows == cols) {
+		transposeSquare(rows, data, cols);
+		return;
+	}
+
+	// element k = i * cols + j moves to j * rows + i
+	const int64_t size = (int64_t) rows * cols;
+	std::vector<bool> moved(size, false);
+	for (int64_t start = 1; start < size - 1; ++start) {
+		if (moved[start]) {
+			continue;
+		}
+		T value = data[start];
+		int64_t k = start;
+		do {
+			int64_t next = (k % cols) * rows + k / cols;
+			std::swap(value, data[next]);
+			moved[next] = true;
+			k = next;
+		} while (k != start);
+	}
+}
+
+} // namespace MatrixKernels
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_TRANSPOSE_HPP */
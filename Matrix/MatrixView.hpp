@@ -0,0 +1,378 @@
+#ifndef _MATRIX_VIEW_HPP
+#define _MATRIX_VIEW_HPP
+
+/**
+ * Non-owning views of row major data with a leading dimension (the distance
+ * between the starts of two rows), so a block, a row or a column of a
+ * Matrix, or an outside buffer, can be worked on without copying it.
+ * A view is only valid while the data it points to is.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class ConstMatrixView {
+public:
+	/**
+	 * @brief views rows x cols elements starting at data, rows are ld apart
+	 */
+	ConstMatrixView(const T* data, int32_t rows, int32_t cols, int32_t ld);
+
+	/**
+	 * @brief views a whole matrix
+	 */
+	ConstMatrixView(const Matrix<T>& mat);
+
+	ConstMatrixView(const MatrixView<T>& view);
+
+	int32_t rows() const;
+	int32_t cols() const;
+
+	/**
+	 * @brief returns the leading dimension, elements between the start of two rows
+	 */
+	int32_t ld() const;
+
+	const T* data() const;
+
+	T operator()(int32_t row, int32_t col) const;
+
+	/**
+	 * @brief returns the rows x cols block starting at (row, col)
+	 */
+	ConstMatrixView<T> block(int32_t row, int32_t col, int32_t rows, int32_t cols) const;
+	ConstMatrixView<T> row(int32_t row) const;
+	ConstMatrixView<T> col(int32_t col) const;
+
+private:
+	const T* _data;
+	int32_t _rows;
+	int32_t _cols;
+	int32_t _ld;
+};
+
+template <class T>
+class MatrixView {
+public:
+	/**
+	 * @brief views rows x cols elements starting at data, rows are ld apart
+	 */
+	MatrixView(T* data, int32_t rows, int32_t cols, int32_t ld);
+
+	/**
+	 * @brief views a whole matrix
+	 */
+	MatrixView(Matrix<T>& mat);
+
+	int32_t rows() const;
+	int32_t cols() const;
+	int32_t ld() const;
+	T* data() const;
+
+	/**
+	 * @brief gets reference to an element of the viewed data
+	 */
+	T& operator()(int32_t row, int32_t col) const;
+
+	MatrixView<T> block(int32_t row, int32_t col, int32_t rows, int32_t cols) const;
+	MatrixView<T> row(int32_t row) const;
+	MatrixView<T> col(int32_t col) const;
+
+	/**
+	 * @brief copies src into the viewed elements
+	 * @details src must be the same size and must not overlap
+	 */
+	void assign(const ConstMatrixView<T>& src) const;
+
+	void fill(T value) const;
+
+	/**
+	 * @brief computes dest = A + B
+	 * @details dest can be the same as A or B
+	 */
+	static void add(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B);
+
+	/**
+	 * @brief computes dest = src + scalar
+	 * @details dest can be the same as src
+	 */
+	static void add(const MatrixView<T>& dest, const ConstMatrixView<T>& src, T scalar);
+
+	/**
+	 * @brief computes dest = A - B
+	 * @details dest can be the same as A or B
+	 */
+	static void subtract(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B);
+
+	/**
+	 * @brief computes dest = src * scalar
+	 * @details dest can be the same as src
+	 */
+	static void multiply(const MatrixView<T>& dest, const ConstMatrixView<T>& src, T scalar);
+
+	/**
+	 * @brief computes dest = A * B
+	 * @details dest can NOT overlap A or B
+	 */
+	static void multiply(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B);
+
+	/**
+	 * @brief computes dest = alpha * A * B + beta * dest
+	 * @details dest can NOT overlap A or B
+	 */
+	static void multiplyAdd(const MatrixView<T>& dest, T alpha,
+		const ConstMatrixView<T>& A, const ConstMatrixView<T>& B, T beta);
+
+	/**
+	 * @brief stores the transpose of src into dest
+	 * @details dest can NOT overlap src
+	 */
+	static void transpose(const MatrixView<T>& dest, const ConstMatrixView<T>& src);
+
+	/**
+	 * @brief solves A * x = b with LUFactorization
+	 * @details x can be the same as b. A is copied for the factorization,
+	 * b and x are not
+	 */
+	static void solve(const ConstMatrixView<T>& A, const ConstMatrixView<T>& b, const MatrixView<T>& x);
+
+private:
+	T* _data;
+	int32_t _rows;
+	int32_t _cols;
+	int32_t _ld;
+
+	/**
+	 * @brief calls fn(dest, a, b) on each row, across threads for large views
+	 */
+	template <class Fn>
+	static void forEachRow(const MatrixView<T>& dest, const ConstMatrixView<T>& A,
+		const ConstMatrixView<T>& B, const Fn& fn);
+};
+
+template <class T>
+ConstMatrixView<T>::ConstMatrixView(const T* data, int32_t rows, int32_t cols, int32_t ld) :
+	_data(data), _rows(rows), _cols(cols), _ld(ld) {
+	assert(rows > 0);
+	assert(cols > 0);
+	assert(ld >= cols || rows == 1);
+}
+
+template <class T>
+ConstMatrixView<T>::ConstMatrixView(const Matrix<T>& mat) :
+	_data(mat.data()), _rows(mat.rows()), _cols(mat.cols()), _ld(mat.ld()) { }
+
+template <class T>
+ConstMatrixView<T>::ConstMatrixView(const MatrixView<T>& view) :
+	_data(view.data()), _rows(view.rows()), _cols(view.cols()), _ld(view.ld()) { }
+
+template <class T>
+int32_t ConstMatrixView<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t ConstMatrixView<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+int32_t ConstMatrixView<T>::ld() const {
+	return _ld;
+}
+
+template <class T>
+const T* ConstMatrixView<T>::data() const {
+	return _data;
+}
+
+template <class T>
+T ConstMatrixView<T>::operator()(int32_t row, int32_t col) const {
+	assert(row >= 0 && row < _rows);
+	assert(col >= 0 && col < _cols);
+	return _data[(int64_t) row * _ld + col];
+}
+
+template <class T>
+ConstMatrixView<T> ConstMatrixView<T>::block(int32_t row, int32_t col, int32_t rows, int32_t cols) const {
+	assert(row >= 0 && row + rows <= _rows);
+	assert(col >= 0 && col + cols <= _cols);
+	return ConstMatrixView<T>(_data + (int64_t) row * _ld + col, rows, cols, _ld);
+}
+
+template <class T>
+ConstMatrixView<T> ConstMatrixView<T>::row(int32_t row) const {
+	return block(row, 0, 1, _cols);
+}
+
+template <class T>
+ConstMatrixView<T> ConstMatrixView<T>::col(int32_t col) const {
+	return block(0, col, _rows, 1);
+}
+
+template <class T>
+MatrixView<T>::MatrixView(T* data, int32_t rows, int32_t cols, int32_t ld) :
+	_data(data), _rows(rows), _cols(cols), _ld(ld) {
+	assert(rows > 0);
+	assert(cols > 0);
+	assert(ld >= cols || rows == 1);
+}
+
+template <class T>
+MatrixView<T>::MatrixView(Matrix<T>& mat) :
+	_data(mat.data()), _rows(mat.rows()), _cols(mat.cols()), _ld(mat.ld()) { }
+
+template <class T>
+int32_t MatrixView<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t MatrixView<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+int32_t MatrixView<T>::ld() const {
+	return _ld;
+}
+
+template <class T>
+T* MatrixView<T>::data() const {
+	return _data;
+}
+
+template <class T>
+T& MatrixView<T>::operator()(int32_t row, int32_t col) const {
+	assert(row >= 0 && row < _rows);
+	assert(col >= 0 && col < _cols);
+	return _data[(int64_t) row * _ld + col];
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::block(int32_t row, int32_t col, int32_t rows, int32_t cols) const {
+	assert(row >= 0 && row + rows <= _rows);
+	assert(col >= 0 && col + cols <= _cols);
+	return MatrixView<T>(_data + (int64_t) row * _ld + col, rows, cols, _ld);
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::row(int32_t row) const {
+	return block(row, 0, 1, _cols);
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::col(int32_t col) const {
+	return block(0, col, _rows, 1);
+}
+
+template <class T>
+template <class Fn>
+void MatrixView<T>::forEachRow(const MatrixView<T>& dest, const ConstMatrixView<T>& A,
+		const ConstMatrixView<T>& B, const Fn& fn) {
+	assert(A.rows() == dest._rows && A.cols() == dest._cols);
+	assert(B.rows() == dest._rows && B.cols() == dest._cols);
+
+	int64_t size = (int64_t) dest._rows * dest._cols;
+	int64_t grain = MatrixElementwiseGrain / dest._cols + 1;
+	MatrixParallel::run(0, dest._rows, size, [&](int64_t lo, int64_t hi) {
+		for (int64_t i = lo; i < hi; ++i) {
+			fn(dest._data + i * dest._ld, A.data() + i * A.ld(), B.data() + i * B.ld());
+		}
+	}, grain);
+}
+
+template <class T>
+void MatrixView<T>::assign(const ConstMatrixView<T>& src) const {
+	assert(src.rows() == _rows);
+	assert(src.cols() == _cols);
+	for (int32_t i = 0; i < _rows; ++i) {
+		memcpy(_data + (int64_t) i * _ld, src.data() + (int64_t) i * src.ld(), _cols * sizeof(T));
+	}
+}
+
+template <class T>
+void MatrixView<T>::fill(T value) const {
+	for (int32_t i = 0; i < _rows; ++i) {
+		MatrixKernels::vectorFill(_cols, value, _data + (int64_t) i * _ld);
+	}
+}
+
+template <class T>
+void MatrixView<T>::add(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B) {
+	const int32_t n = dest._cols;
+	forEachRow(dest, A, B, [n](T* out, const T* a, const T* b) {
+		MatrixKernels::vectorAdd(n, a, b, out);
+	});
+}
+
+template <class T>
+void MatrixView<T>::add(const MatrixView<T>& dest, const ConstMatrixView<T>& src, T scalar) {
+	const int32_t n = dest._cols;
+	forEachRow(dest, src, src, [n, scalar](T* out, const T* a, const T*) {
+		MatrixKernels::vectorAddScalar(n, a, scalar, out);
+	});
+}
+
+template <class T>
+void MatrixView<T>::subtract(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B) {
+	const int32_t n = dest._cols;
+	forEachRow(dest, A, B, [n](T* out, const T* a, const T* b) {
+		MatrixKernels::vectorSubtract(n, a, b, out);
+	});
+}
+
+template <class T>
+void MatrixView<T>::multiply(const MatrixView<T>& dest, const ConstMatrixView<T>& src, T scalar) {
+	const int32_t n = dest._cols;
+	forEachRow(dest, src, src, [n, scalar](T* out, const T* a, const T*) {
+		MatrixKernels::vectorScale(n, a, scalar, out);
+	});
+}
+
+template <class T>
+void MatrixView<T>::multiply(const MatrixView<T>& dest, const ConstMatrixView<T>& A, const ConstMatrixView<T>& B) {
+	multiplyAdd(dest, T(1), A, B, T(0));
+}
+
+template <class T>
+void MatrixView<T>::multiplyAdd(const MatrixView<T>& dest, T alpha,
+		const ConstMatrixView<T>& A, const ConstMatrixView<T>& B, T beta) {
+	assert(A.cols() == B.rows());
+	assert(dest._rows == A.rows());
+	assert(dest._cols == B.cols());
+
+	MatrixKernels::gemm(A.rows(), B.cols(), A.cols(), alpha, A.data(), A.ld(),
+		B.data(), B.ld(), beta, dest._data, dest._ld);
+}
+
+template <class T>
+void MatrixView<T>::transpose(const MatrixView<T>& dest, const ConstMatrixView<T>& src) {
+	assert(dest._rows == src.cols());
+	assert(dest._cols == src.rows());
+
+	MatrixKernels::transpose(src.rows(), src.cols(), src.data(), src.ld(), dest._data, dest._ld);
+}
+
+template <class T>
+void MatrixView<T>::solve(const ConstMatrixView<T>& A, const ConstMatrixView<T>& b, const MatrixView<T>& x) {
+	assert(A.rows() == A.cols());
+
+	Matrix<T> copy(A.rows(), A.cols());
+	MatrixView<T>(copy).assign(A);
+	LUFactorization<T> lu(std::move(copy));
+	if (x.data() != b.data()) {
+		x.assign(b);
+	}
+	lu.solveInPlace(x);
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_VIEW_HPP */
@@ -0,0 +1,166 @@
+#ifndef _MATRIX_WORKSPACE_HPP
+#define _MATRIX_WORKSPACE_HPP
+
+/**
+ * Scratch memory for the solvers, so repeated solves don't allocate
+ * Reserve once with the size the solver reports, then pass the workspace
+ * to Matrix::solve(), solveLU(), inverse() or leastSquares().
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include "MatrixLayout.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class MatrixView;
+
+class MatrixWorkspace {
+public:
+	/**
+	 * @brief Constructs an empty workspace, reserve() before use
+	 */
+	MatrixWorkspace();
+
+	/**
+	 * @brief Constructs a workspace of bytes
+	 */
+	explicit MatrixWorkspace(size_t bytes);
+
+	MatrixWorkspace(const MatrixWorkspace& other) = delete;
+	MatrixWorkspace& operator=(const MatrixWorkspace& other) = delete;
+
+	/**
+	 * @brief Destructor
+	 */
+	~MatrixWorkspace();
+
+	/**
+	 * @brief makes room for at least bytes
+	 * @details only allocates if the workspace is smaller,
+	 * nothing may be in use when it does
+	 */
+	void reserve(size_t bytes);
+
+	size_t capacity() const;
+
+	/**
+	 * @brief returns bytes handed out and not yet given back
+	 */
+	size_t used() const;
+
+	/**
+	 * @brief returns count elements of U, aligned to MatrixLayout::Alignment
+	 * @details there must be room left, the workspace never grows here
+	 */
+	template <class U>
+	U* allocate(int64_t count);
+
+	/**
+	 * @brief returns a rows x cols view padded like a Matrix
+	 */
+	template <class T>
+	MatrixView<T> allocateMatrix(int32_t rows, int32_t cols);
+
+	/**
+	 * @brief gives back everything allocated after it was made when it goes out of scope
+	 */
+	class Frame {
+	public:
+		explicit Frame(MatrixWorkspace& workspace);
+		~Frame();
+
+		Frame(const Frame& other) = delete;
+		Frame& operator=(const Frame& other) = delete;
+
+	private:
+		MatrixWorkspace& _workspace;
+		size_t _mark;
+	};
+
+	/**
+	 * @brief returns the bytes allocate<U>(count) takes
+	 */
+	template <class U>
+	static size_t arrayBytes(int64_t count);
+
+	/**
+	 * @brief returns the bytes allocateMatrix<T>(rows, cols) takes
+	 */
+	template <class T>
+	static size_t matrixBytes(int32_t rows, int32_t cols);
+
+private:
+	char* _data;
+	size_t _capacity;
+	size_t _used;
+};
+
+inline MatrixWorkspace::MatrixWorkspace() :
+	_data(nullptr), _capacity(0), _used(0) { }
+
+inline MatrixWorkspace::MatrixWorkspace(size_t bytes) :
+	_data(nullptr), _capacity(0), _used(0) {
+	reserve(bytes);
+}
+
+inline MatrixWorkspace::~MatrixWorkspace() {
+	MatrixLayout::release(_data);
+}
+
+inline void MatrixWorkspace::reserve(size_t bytes) {
+	if (bytes <= _capacity) {
+		return;
+	}
+	assert(_used == 0);
+	MatrixLayout::release(_data);
+	_data = MatrixLayout::allocate<char>(bytes);
+	_capacity = bytes;
+}
+
+inline size_t MatrixWorkspace::capacity() const {
+	return _capacity;
+}
+
+inline size_t MatrixWorkspace::used() const {
+	return _used;
+}
+
+template <class U>
+U* MatrixWorkspace::allocate(int64_t count) {
+	size_t bytes = arrayBytes<U>(count);
+	assert(_used + bytes <= _capacity);
+	U* ptr = reinterpret_cast<U*>(_data + _used);
+	_used += bytes;
+	return ptr;
+}
+
+template <class T>
+MatrixView<T> MatrixWorkspace::allocateMatrix(int32_t rows, int32_t cols) {
+	int32_t ld = MatrixLayout::leadingDimension<T>(cols);
+	return MatrixView<T>(allocate<T>((int64_t) rows * ld), rows, cols, ld);
+}
+
+template <class U>
+size_t MatrixWorkspace::arrayBytes(int64_t count) {
+	const size_t align = MatrixLayout::Alignment;
+	return ((size_t) count * sizeof(U) + align - 1) / align * align;
+}
+
+template <class T>
+size_t MatrixWorkspace::matrixBytes(int32_t rows, int32_t cols) {
+	return arrayBytes<T>((int64_t) rows * MatrixLayout::leadingDimension<T>(cols));
+}
+
+inline MatrixWorkspace::Frame::Frame(MatrixWorkspace& workspace) :
+	_workspace(workspace), _mark(workspace._used) { }
+
+inline MatrixWorkspace::Frame::~Frame() {
+	_workspace._used = _mark;
+}
+
+} // namespace Alectryon
+
+#endif /* _MATRIX_WORKSPACE_HPP */
@@ -0,0 +1,309 @@
+#ifndef _MIXED_PRECISION_SOLVER_HPP
+#define _MIXED_PRECISION_SOLVER_HPP
+
+/**
+ * Solves A * x = b in T (double) accuracy with the factorization done in a
+ * lower precision L (float), which has twice the SIMD width and half the
+ * memory traffic. The low precision solution is improved by iterative
+ * refinement: r = b - A * x in T, then x += A^-1 * r with the low precision
+ * factors. If refinement stalls, A is factored in T instead.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include "Matrix.hpp"
+#include "IterativeSolvers.hpp"
+
+namespace Alectryon {
+
+enum MixedFactorization {
+	MIXED_LU,      // partial pivoting LU, any nonsingular A
+	MIXED_CHOLESKY // A must be symmetric positive definite
+};
+
+/**
+ * @brief stopping criteria for iterative refinement
+ */
+template <class T>
+struct RefinementControl {
+	// converged once max|b - A * x| <= tolerance * ||A||_inf * max|x|.
+	// 0 uses sqrt(n) * epsilon of T
+	T tolerance;
+	int32_t maxIterations;
+	// falls back to factoring in T once an iteration shrinks the
+	// residual by less than this factor
+	T stallRatio;
+
+	RefinementControl(T tolerance = 0, int32_t maxIterations = 30, T stallRatio = T(0.5)) :
+		tolerance(tolerance), maxIterations(maxIterations), stallRatio(stallRatio) { }
+};
+
+template <class T = double, class L = float>
+class MixedPrecisionSolver {
+public:
+	/**
+	 * @brief Factors A in L
+	 * @details A is copied, the residuals need it in T
+	 */
+	explicit MixedPrecisionSolver(const Matrix<T>& A, MixedFactorization type = MIXED_LU,
+		const RefinementControl<T>& control = RefinementControl<T>());
+
+	/**
+	 * @brief Factors a new matrix
+	 * @details the next solve starts in L again
+	 */
+	void factor(const Matrix<T>& A);
+
+	/**
+	 * @brief Solves A * x = b
+	 * @details b and x are size() x k, every column is a right hand side.
+	 * result.iterations counts refinement steps and result.residual is the
+	 * last max|b - A * x| / (||A||_inf * max|x|).
+	 * converged is false only if the fallback in T was needed and failed
+	 */
+	SolverResult<T> solve(const Matrix<T>& b, Matrix<T>& x);
+
+	int32_t size() const;
+
+	/**
+	 * @brief returns true once refinement has stalled and A was factored in T
+	 * @details later solves use that factorization directly
+	 */
+	bool fellBack() const;
+
+private:
+	Matrix<T> _A;
+	MixedFactorization _type;
+	RefinementControl<T> _control;
+	T _normA;
+
+	std::unique_ptr<LUFactorization<L>> _lowLU;
+	std::unique_ptr<CholeskyFactorization<L>> _lowCholesky;
+	std::unique_ptr<LUFactorization<T>> _highLU;
+	std::unique_ptr<CholeskyFactorization<T>> _highCholesky;
+
+	// right hand sides in L, kept between solves with the same number of columns
+	Matrix<L> _lowWork;
+	Matrix<T> _residual;
+
+	/**
+	 * @brief factors _A in L, returns false if that failed
+	 */
+	bool factorLow();
+
+	/**
+	 * @brief factors _A in T, for when refinement can't converge
+	 */
+	void factorHigh();
+
+	/**
+	 * @brief solves in place of b with whichever factors are in use
+	 */
+	template <class U>
+	static void solveWith(const std::unique_ptr<LUFactorization<U>>& lu,
+		const std::unique_ptr<CholeskyFactorization<U>>& cholesky, Matrix<U>& b);
+
+	template <class From, class To>
+	static void convert(const Matrix<From>& src, Matrix<To>& dest);
+
+	static T maxAbs(const Matrix<T>& mat);
+};
+
+template <class T, class L>
+MixedPrecisionSolver<T, L>::MixedPrecisionSolver(const Matrix<T>& A, MixedFactorization type,
+		const RefinementControl<T>& control) :
+	_A(A), _type(type), _control(control), _normA(0),
+	_lowWork(A.rows(), 1), _residual(A.rows(), 1) {
+	assert(A.rows() == A.cols());
+	factor(A);
+}
+
+template <class T, class L>
+void MixedPrecisionSolver<T, L>::factor(const Matrix<T>& A) {
+	assert(A.rows() == A.cols());
+	if (&A != &_A) {
+		_A = A;
+	}
+	_highLU.reset();
+	_highCholesky.reset();
+
+	_normA = 0;
+	for (int32_t i = 0; i < _A.rows(); ++i) {
+		T sum = 0;
+		for (int32_t j = 0; j < _A.cols(); ++j) {
+			sum += std::fabs(_A(i, j));
+		}
+		_normA = (sum > _normA) ? sum : _normA;
+	}
+
+	if (!factorLow()) {
+		factorHigh();
+	}
+}
+
+template <class T, class L>
+bool MixedPrecisionSolver<T, L>::factorLow() {
+	_lowLU.reset();
+	_lowCholesky.reset();
+
+	// elements past the range of L would turn into infinities
+	if (_normA > (T) std::numeric_limits<L>::max()) {
+		return false;
+	}
+
+	Matrix<L> low(_A.rows(), _A.cols());
+	convert(_A, low);
+	if (_type == MIXED_CHOLESKY) {
+		_lowCholesky.reset(new CholeskyFactorization<L>(low));
+		return _lowCholesky->success();
+	}
+	_lowLU.reset(new LUFactorization<L>(std::move(low)));
+	return !_lowLU->singular();
+}
+
+template <class T, class L>
+void MixedPrecisionSolver<T, L>::factorHigh() {
+	if (_highLU || _highCholesky) {
+		return;
+	}
+	_lowLU.reset();
+	_lowCholesky.reset();
+
+	if (_type == MIXED_CHOLESKY) {
+		_highCholesky.reset(new CholeskyFactorization<T>(_A));
+		if (_highCholesky->success()) {
+			return;
+		}
+		// not positive definite after all
+		_highCholesky.reset();
+	}
+	_highLU.reset(new LUFactorization<T>(_A));
+}
+
+template <class T, class L>
+SolverResult<T> MixedPrecisionSolver<T, L>::solve(const Matrix<T>& b, Matrix<T>& x) {
+	assert(b.rows() == size());
+	assert(x.rows() == size());
+	assert(x.cols() == b.cols());
+
+	SolverResult<T> result;
+	result.converged = false;
+	result.iterations = 0;
+	result.residual = 0;
+
+	const int32_t n = size();
+	T tolerance = _control.tolerance;
+	if (tolerance <= T(0)) {
+		tolerance = std::sqrt((T) n) * std::numeric_limits<T>::epsilon();
+	}
+	if (_residual.rows() != n || _residual.cols() != b.cols()) {
+		_residual = Matrix<T>(n, b.cols());
+		_lowWork = Matrix<L>(n, b.cols());
+	}
+
+	if (!fellBack()) {
+		// x = A^-1 * b in L
+		convert(b, _lowWork);
+		solveWith(_lowLU, _lowCholesky, _lowWork);
+		convert(_lowWork, x);
+
+		T previous = std::numeric_limits<T>::infinity();
+		while (true) {
+			// r = b - A * x, in T
+			_residual = b;
+			Matrix<T>::multiplyAdd(_residual, T(-1), _A, x, T(1));
+
+			T normR = maxAbs(_residual);
+			T scale = _normA * maxAbs(x);
+			result.residual = (scale > T(0)) ? normR / scale : normR;
+			result.history.push_back(result.residual);
+			if (!std::isfinite(normR)) {
+				break;
+			}
+			if (normR <= tolerance * scale) {
+				result.converged = true;
+				return result;
+			}
+			if (result.iterations >= _control.maxIterations || normR > _control.stallRatio * previous) {
+				break;
+			}
+			previous = normR;
+
+			// x += A^-1 * r, the correction only needs L accuracy
+			convert(_residual, _lowWork);
+			solveWith(_lowLU, _lowCholesky, _lowWork);
+			for (int32_t i = 0; i < n; ++i) {
+				for (int32_t j = 0; j < x.cols(); ++j) {
+					x(i, j) += (T) _lowWork(i, j);
+				}
+			}
+			++result.iterations;
+		}
+		factorHigh();
+	}
+
+	x = b;
+	solveWith(_highLU, _highCholesky, x);
+	_residual = b;
+	Matrix<T>::multiplyAdd(_residual, T(-1), _A, x, T(1));
+	T scale = _normA * maxAbs(x);
+	T normR = maxAbs(_residual);
+	result.residual = (scale > T(0)) ? normR / scale : normR;
+	result.history.push_back(result.residual);
+	result.converged = std::isfinite(normR) && (_highCholesky || !_highLU->singular());
+	return result;
+}
+
+template <class T, class L>
+int32_t MixedPrecisionSolver<T, L>::size() const {
+	return _A.rows();
+}
+
+template <class T, class L>
+bool MixedPrecisionSolver<T, L>::fellBack() const {
+	return _highLU || _highCholesky;
+}
+
+template <class T, class L>
+template <class U>
+void MixedPrecisionSolver<T, L>::solveWith(const std::unique_ptr<LUFactorization<U>>& lu,
+		const std::unique_ptr<CholeskyFactorization<U>>& cholesky, Matrix<U>& b) {
+	if (cholesky) {
+		cholesky->solveInPlace(b);
+	} else {
+		lu->solveInPlace(b);
+	}
+}
+
+template <class T, class L>
+template <class From, class To>
+void MixedPrecisionSolver<T, L>::convert(const Matrix<From>& src, Matrix<To>& dest) {
+	assert(dest.rows() == src.rows());
+	assert(dest.cols() == src.cols());
+	for (int32_t i = 0; i < src.rows(); ++i) {
+		const From* in = src.data() + (int64_t) i * src.ld();
+		To* out = dest.data() + (int64_t) i * dest.ld();
+		for (int32_t j = 0; j < src.cols(); ++j) {
+			out[j] = (To) in[j];
+		}
+	}
+}
+
+template <class T, class L>
+T MixedPrecisionSolver<T, L>::maxAbs(const Matrix<T>& mat) {
+	T largest = 0;
+	for (int32_t i = 0; i < mat.rows(); ++i) {
+		for (int32_t j = 0; j < mat.cols(); ++j) {
+			T value = std::fabs(mat(i, j));
+			largest = (value > largest) ? value : largest;
+		}
+	}
+	return largest;
+}
+
+} // namespace Alectryon
+
+#endif /* _MIXED_PRECISION_SOLVER_HPP */
@@ -0,0 +1,524 @@
+#ifndef _QR_FACTORIZATION_HPP
+#define _QR_FACTORIZATION_HPP
+
+/**
+ * Householder QR factorization, A = Q * R
+ * Used for least squares without forming A^T * A, which would square
+ * the condition number of A.
+ * Reflectors are applied in blocks with the compact WY representation
+ * Q_block = I - V * T * V^T, so the bulk of the work is done by gemm.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class QRFactorization {
+public:
+	/**
+	 * @brief reflectors per block
+	 */
+	static const int32_t BlockSize = 32;
+
+	/**
+	 * @brief Factors A
+	 * @details A is m x n with m >= n
+	 */
+	explicit QRFactorization(const Matrix<T>& A);
+
+	/**
+	 * @brief Factors A in its own storage, without a copy
+	 */
+	explicit QRFactorization(Matrix<T>&& A);
+
+	/**
+	 * @brief Factors a new matrix
+	 * @details storage is reused if A is the same size as the last one
+	 */
+	void factor(const Matrix<T>& A);
+
+	int32_t rows() const;
+	int32_t cols() const;
+
+	/**
+	 * @brief returns false if R has a zero on its diagonal
+	 * @details solve() is undefined if A is rank deficient
+	 */
+	bool fullRank() const;
+
+	/**
+	 * @brief computes b = Q^T * b in place
+	 * @details b is rows() x k
+	 */
+	void applyQT(Matrix<T>& b) const;
+
+	/**
+	 * @brief computes b = Q * b in place
+	 * @details b is rows() x k
+	 */
+	void applyQ(Matrix<T>& b) const;
+
+	/**
+	 * @brief Solves the least squares problem min ||A * x - b||
+	 * @details b is rows() x k and x is cols() x k,
+	 * every column is a separate problem
+	 */
+	void solve(const Matrix<T>& b, Matrix<T>& x) const;
+
+	/**
+	 * @brief Solves min ||A * x - b|| overwriting b
+	 * @details afterwards the first cols() rows of b hold x and
+	 * the norms of the remaining rows of each column are the residual norms
+	 */
+	void solveInPlace(Matrix<T>& b) const;
+
+	/**
+	 * @brief stores the cols() x cols() upper triangular R into dest
+	 */
+	void R(Matrix<T>& dest) const;
+
+	/**
+	 * @brief stores the first cols() columns of Q into dest (rows() x cols())
+	 */
+	void Q(Matrix<T>& dest) const;
+
+	/**
+	 * @brief returns R on and above the diagonal and the Householder
+	 * vectors below it (their leading ones are not stored)
+	 */
+	const Matrix<T>& packed() const;
+
+	/**
+	 * @brief returns the Householder scalars, H_i = I - tau_i * v_i * v_i^T
+	 */
+	const std::vector<T>& tau() const;
+
+	/**
+	 * @brief returns number of elements in the T factors of an m x cols matrix
+	 */
+	static int64_t blockTSize(int32_t cols);
+
+	/**
+	 * @brief returns number of scratch elements factorInPlace() and
+	 * solveFactored() need, for a matrix with cols columns and k right hand sides
+	 */
+	static int64_t scratchSize(int32_t cols, int32_t k);
+
+	/**
+	 * @brief factors A in place, packed as in packed()
+	 * @details for callers that provide their own storage, nothing is allocated.
+	 * tau holds A.cols() elements, blockT holds blockTSize(A.cols())
+	 * and scratch holds scratchSize(A.cols(), A.cols())
+	 */
+	static void factorInPlace(const MatrixView<T>& A, T* tau, T* blockT, T* scratch);
+
+	/**
+	 * @brief Solves min ||A * x - b|| against factors from factorInPlace(), as solveInPlace()
+	 * @details scratch holds scratchSize(QR.cols(), b.cols())
+	 */
+	static void solveFactored(const ConstMatrixView<T>& QR, const T* blockT,
+		const MatrixView<T>& b, T* scratch);
+
+private:
+	Matrix<T> _QR;
+	std::vector<T> _tau;
+
+	// T factor of every block, BlockSize x BlockSize each
+	std::vector<T> _blockT;
+
+	// rows of V handled at once when applying a block
+	static const int32_t ChunkRows = 512;
+
+	void decompose();
+
+	/**
+	 * @brief unblocked factorization of columns [col, col + width)
+	 * @details scratch holds width elements
+	 */
+	static void factorPanel(const MatrixView<T>& A, T* tau, int32_t col, int32_t width, T* scratch);
+
+	/**
+	 * @brief builds the T factor of the block starting at col
+	 */
+	static void formT(const ConstMatrixView<T>& QR, const T* tau, int32_t col, int32_t width,
+		T* blockT, T* scratch);
+
+	/**
+	 * @brief applies the block reflector starting at col to rows [col, QR.rows())
+	 * of the ncols columns of C
+	 * @details applies (I - V * T^T * V^T) if transpose, otherwise (I - V * T * V^T)
+	 */
+	static void applyBlock(const ConstMatrixView<T>& QR, int32_t col, int32_t width,
+		const T* blockT, bool transpose, T* C, int32_t ldc, int32_t ncols, T* scratch);
+
+	/**
+	 * @brief applies Q^T or Q to the rows x k matrix b
+	 */
+	static void applyQ(const ConstMatrixView<T>& QR, const T* blockT, bool transpose,
+		const MatrixView<T>& b, T* scratch);
+
+	/**
+	 * @brief copies rows [row, row + count) of the block's V, including
+	 * its unit diagonal and the zeros above it, into dest (count x width)
+	 */
+	static void copyV(const ConstMatrixView<T>& QR, int32_t col, int32_t width,
+		int32_t row, int32_t count, T* dest);
+};
+
+template <class T>
+QRFactorization<T>::QRFactorization(const Matrix<T>& A) :
+	_QR(A) {
+	assert(A.rows() >= A.cols());
+	decompose();
+}
+
+template <class T>
+QRFactorization<T>::QRFactorization(Matrix<T>&& A) :
+	_QR(std::move(A)) {
+	assert(_QR.rows() >= _QR.cols());
+	decompose();
+}
+
+template <class T>
+void QRFactorization<T>::factor(const Matrix<T>& A) {
+	assert(A.rows() >= A.cols());
+
+	_QR = A;
+	decompose();
+}
+
+template <class T>
+void QRFactorization<T>::decompose() {
+	const int32_t n = _QR.cols();
+	_tau.resize(n);
+	_blockT.resize(blockTSize(n));
+	std::vector<T> scratch(scratchSize(n, n));
+	factorInPlace(_QR, _tau.data(), _blockT.data(), scratch.data());
+}
+
+template <class T>
+int64_t QRFactorization<T>::blockTSize(int32_t cols) {
+	int64_t blocks = (cols + BlockSize - 1) / BlockSize;
+	return blocks * BlockSize * BlockSize;
+}
+
+template <class T>
+int64_t QRFactorization<T>::scratchSize(int32_t cols, int32_t k) {
+	// V and VT chunks, then G (width x width) or W (width x ncols)
+	int64_t widest = (cols > k) ? cols : k;
+	if (widest < BlockSize) {
+		widest = BlockSize;
+	}
+	return (int64_t) 2 * ChunkRows * BlockSize + (int64_t) BlockSize * widest;
+}
+
+template <class T>
+void QRFactorization<T>::factorInPlace(const MatrixView<T>& A, T* tau, T* blockT, T* scratch) {
+	assert(A.rows() >= A.cols());
+	const int32_t n = A.cols();
+	memset(blockT, 0, blockTSize(n) * sizeof(T));
+
+	for (int32_t k = 0; k < n; k += BlockSize) {
+		int32_t nb = (n - k < BlockSize) ? n - k : BlockSize;
+		T* block = blockT + (int64_t) (k / BlockSize) * BlockSize * BlockSize;
+
+		factorPanel(A, tau, k, nb, scratch);
+		formT(A, tau, k, nb, block, scratch);
+
+		// trailing columns get Q_block^T
+		if (k + nb < n) {
+			applyBlock(A, k, nb, block, true, A.data() + k + nb, A.ld(), n - k - nb, scratch);
+		}
+	}
+}
+
+template <class T>
+void QRFactorization<T>::factorPanel(const MatrixView<T>& A, T* tau, int32_t col, int32_t width, T* scratch) {
+	const int32_t m = A.rows();
+	const int32_t ld = A.ld();
+	const int32_t end = col + width;
+	T* data = A.data();
+	T* w = scratch;
+
+	for (int32_t j = col; j < end; ++j) {
+		T alpha = data[(int64_t) j * ld + j];
+		T norm2 = 0;
+		for (int32_t i = j + 1; i < m; ++i) {
+			T value = data[(int64_t) i * ld + j];
+			norm2 += value * value;
+		}
+		if (norm2 == T(0)) {
+			// already zero below the diagonal, H = I
+			tau[j] = 0;
+			continue;
+		}
+
+		T beta = std::sqrt(alpha * alpha + norm2);
+		if (alpha > T(0)) {
+			beta = -beta;
+		}
+		tau[j] = (beta - alpha) / beta;
+		T scale = T(1) / (alpha - beta);
+		for (int32_t i = j + 1; i < m; ++i) {
+			data[(int64_t) i * ld + j] *= scale;
+		}
+		data[(int64_t) j * ld + j] = beta;
+
+		// apply H_j to the rest of the panel, row by row:
+		// w = v^T * A, A -= tau * v * w
+		int32_t rest = end - j - 1;
+		if (rest == 0) {
+			continue;
+		}
+		T* rowJ = data + (int64_t) j * ld + j + 1;
+		memcpy(w, rowJ, rest * sizeof(T));
+		for (int32_t i = j + 1; i < m; ++i) {
+			const T* row = data + (int64_t) i * ld;
+			MatrixKernels::vectorAxpy(rest, row[j], row + j + 1, w);
+		}
+		T t = tau[j];
+		MatrixKernels::vectorAxpy(rest, -t, w, rowJ);
+		for (int32_t i = j + 1; i < m; ++i) {
+			T* row = data + (int64_t) i * ld;
+			MatrixKernels::vectorAxpy(rest, -t * row[j], w, row + j + 1);
+		}
+	}
+}
+
+template <class T>
+void QRFactorization<T>::copyV(const ConstMatrixView<T>& QR, int32_t col, int32_t width,
+		int32_t row, int32_t count, T* dest) {
+	const int32_t ld = QR.ld();
+	const T* data = QR.data();
+	for (int32_t r = 0; r < count; ++r) {
+		int32_t g = row + r;
+		const T* src = data + (int64_t) g * ld + col;
+		T* out = dest + (int64_t) r * width;
+		for (int32_t p = 0; p < width; ++p) {
+			int32_t diag = col + p;
+			out[p] = (g > diag) ? src[p] : ((g == diag) ? T(1) : T(0));
+		}
+	}
+}
+
+template <class T>
+void QRFactorization<T>::formT(const ConstMatrixView<T>& QR, const T* tau, int32_t col, int32_t width,
+		T* blockT, T* scratch) {
+	const int32_t m = QR.rows();
+	T* V = scratch;
+	T* VT = V + (int64_t) ChunkRows * width;
+	T* G = VT + (int64_t) ChunkRows * width;
+
+	// G = V^T * V, accumulated over chunks of rows
+	MatrixKernels::vectorFill((int64_t) width * width, T(0), G);
+	for (int32_t r = col; r < m; r += ChunkRows) {
+		int32_t count = (m - r < ChunkRows) ? m - r : ChunkRows;
+		copyV(QR, col, width, r, count, V);
+		for (int32_t i = 0; i < count; ++i) {
+			for (int32_t p = 0; p < width; ++p) {
+				VT[(int64_t) p * count + i] = V[(int64_t) i * width + p];
+			}
+		}
+		MatrixKernels::gemm(width, width, count, T(1), VT, count,
+			V, width, T(1), G, width);
+	}
+
+	// T(0:i, i) = -tau_i * T(0:i, 0:i) * G(0:i, i), T(i, i) = tau_i
+	for (int32_t i = 0; i < width; ++i) {
+		T t = tau[col + i];
+		for (int32_t p = 0; p < i; ++p) {
+			T sum = 0;
+			for (int32_t q = p; q < i; ++q) {
+				sum += blockT[p * BlockSize + q] * G[(int64_t) q * width + i];
+			}
+			blockT[p * BlockSize + i] = -t * sum;
+		}
+		blockT[i * BlockSize + i] = t;
+	}
+}
+
+template <class T>
+void QRFactorization<T>::applyBlock(const ConstMatrixView<T>& QR, int32_t col, int32_t width,
+		const T* blockT, bool transpose, T* C, int32_t ldc, int32_t ncols, T* scratch) {
+	const int32_t m = QR.rows();
+	T* V = scratch;
+	T* VT = V + (int64_t) ChunkRows * width;
+	T* W = VT + (int64_t) ChunkRows * width;
+
+	// W = V^T * C
+	MatrixKernels::vectorFill((int64_t) width * ncols, T(0), W);
+	for (int32_t r = col; r < m; r += ChunkRows) {
+		int32_t count = (m - r < ChunkRows) ? m - r : ChunkRows;
+		copyV(QR, col, width, r, count, V);
+		for (int32_t i = 0; i < count; ++i) {
+			for (int32_t p = 0; p < width; ++p) {
+				VT[(int64_t) p * count + i] = V[(int64_t) i * width + p];
+			}
+		}
+		MatrixKernels::gemm(width, ncols, count, T(1), VT, count,
+			C + (int64_t) r * ldc, ldc, T(1), W, ncols);
+	}
+
+	// W = T^T * W or T * W, in place
+	if (transpose) {
+		for (int32_t i = width - 1; i >= 0; --i) {
+			T* row = W + (int64_t) i * ncols;
+			MatrixKernels::vectorScale(ncols, row, blockT[i * BlockSize + i], row);
+			for (int32_t p = 0; p < i; ++p) {
+				MatrixKernels::vectorAxpy(ncols, blockT[p * BlockSize + i],
+					W + (int64_t) p * ncols, row);
+			}
+		}
+	} else {
+		for (int32_t i = 0; i < width; ++i) {
+			T* row = W + (int64_t) i * ncols;
+			MatrixKernels::vectorScale(ncols, row, blockT[i * BlockSize + i], row);
+			for (int32_t p = i + 1; p < width; ++p) {
+				MatrixKernels::vectorAxpy(ncols, blockT[i * BlockSize + p],
+					W + (int64_t) p * ncols, row);
+			}
+		}
+	}
+
+	// C -= V * W
+	for (int32_t r = col; r < m; r += ChunkRows) {
+		int32_t count = (m - r < ChunkRows) ? m - r : ChunkRows;
+		copyV(QR, col, width, r, count, V);
+		MatrixKernels::gemm(count, ncols, width, T(-1), V, width,
+			W, ncols, T(1), C + (int64_t) r * ldc, ldc);
+	}
+}
+
+template <class T>
+void QRFactorization<T>::applyQ(const ConstMatrixView<T>& QR, const T* blockT, bool transpose,
+		const MatrixView<T>& b, T* scratch) {
+	assert(b.rows() == QR.rows());
+	const int32_t n = QR.cols();
+
+	// Q^T = Q_last^T * ... * Q_first^T, Q goes the other way
+	int32_t last = ((n - 1) / BlockSize) * BlockSize;
+	for (int32_t i = 0; i <= last; i += BlockSize) {
+		int32_t k = transpose ? i : last - i;
+		int32_t nb = (n - k < BlockSize) ? n - k : BlockSize;
+		const T* block = blockT + (int64_t) (k / BlockSize) * BlockSize * BlockSize;
+		applyBlock(QR, k, nb, block, transpose, b.data(), b.ld(), b.cols(), scratch);
+	}
+}
+
+template <class T>
+void QRFactorization<T>::solveFactored(const ConstMatrixView<T>& QR, const T* blockT,
+		const MatrixView<T>& b, T* scratch) {
+	applyQ(QR, blockT, true, b, scratch);
+
+	// R * x = (Q^T * b)[0:n]
+	const int32_t n = QR.cols();
+	const int32_t k = b.cols();
+	const int32_t ldb = b.ld();
+	T* data = b.data();
+	for (int32_t i = n - 1; i >= 0; --i) {
+		T* row = data + (int64_t) i * ldb;
+		for (int32_t p = i + 1; p < n; ++p) {
+			T r = QR(i, p);
+			if (r != T(0)) {
+				MatrixKernels::vectorAxpy(k, -r, data + (int64_t) p * ldb, row);
+			}
+		}
+		MatrixKernels::vectorScale(k, row, T(1) / QR(i, i), row);
+	}
+}
+
+template <class T>
+int32_t QRFactorization<T>::rows() const {
+	return _QR.rows();
+}
+
+template <class T>
+int32_t QRFactorization<T>::cols() const {
+	return _QR.cols();
+}
+
+template <class T>
+bool QRFactorization<T>::fullRank() const {
+	for (int32_t i = 0; i < cols(); ++i) {
+		if (_QR(i, i) == T(0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class T>
+void QRFactorization<T>::applyQT(Matrix<T>& b) const {
+	std::vector<T> scratch(scratchSize(cols(), b.cols()));
+	applyQ(_QR, _blockT.data(), true, b, scratch.data());
+}
+
+template <class T>
+void QRFactorization<T>::applyQ(Matrix<T>& b) const {
+	std::vector<T> scratch(scratchSize(cols(), b.cols()));
+	applyQ(_QR, _blockT.data(), false, b, scratch.data());
+}
+
+template <class T>
+void QRFactorization<T>::solve(const Matrix<T>& b, Matrix<T>& x) const {
+	assert(b.rows() == rows());
+	assert(x.rows() == cols());
+	assert(x.cols() == b.cols());
+
+	Matrix<T> work(b);
+	solveInPlace(work);
+	MatrixView<T>(x).assign(ConstMatrixView<T>(work).block(0, 0, cols(), b.cols()));
+}
+
+template <class T>
+void QRFactorization<T>::solveInPlace(Matrix<T>& b) const {
+	assert(b.rows() == rows());
+
+	std::vector<T> scratch(scratchSize(cols(), b.cols()));
+	solveFactored(_QR, _blockT.data(), b, scratch.data());
+}
+
+template <class T>
+void QRFactorization<T>::R(Matrix<T>& dest) const {
+	assert(dest.rows() == cols());
+	assert(dest.cols() == cols());
+
+	for (int32_t i = 0; i < cols(); ++i) {
+		for (int32_t j = 0; j < cols(); ++j) {
+			dest(i, j) = (j >= i) ? _QR(i, j) : T(0);
+		}
+	}
+}
+
+template <class T>
+void QRFactorization<T>::Q(Matrix<T>& dest) const {
+	assert(dest.rows() == rows());
+	assert(dest.cols() == cols());
+
+	dest.fill(0);
+	for (int32_t i = 0; i < cols(); ++i) {
+		dest(i, i) = 1;
+	}
+	applyQ(dest);
+}
+
+template <class T>
+const Matrix<T>& QRFactorization<T>::packed() const {
+	return _QR;
+}
+
+template <class T>
+const std::vector<T>& QRFactorization<T>::tau() const {
+	return _tau;
+}
+
+} // namespace Alectryon
+
+#endif /* _QR_FACTORIZATION_HPP */
@@ -0,0 +1,316 @@
+#ifndef _QUANTIZED_MATRIX_HPP
+#define _QUANTIZED_MATRIX_HPP
+
+/**
+ * int8 / int16 matrices for inference style products.
+ * real value = scale * (q - zeroPoint), with one scale and zero point for
+ * the whole matrix or one per row. Products sum in int32 with the kernels in
+ * MatrixIntegerGemm.hpp and come out as int32, float or requantized
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Matrix.hpp"
+#include "MatrixIntegerGemm.hpp"
+
+namespace Alectryon {
+
+enum QuantizationScheme {
+	QUANTIZE_PER_TENSOR, // one scale and zero point for the whole matrix
+	QUANTIZE_PER_ROW     // one scale and zero point per row
+};
+
+/**
+ * @brief scale and zero point of a quantized matrix or row
+ */
+struct QuantizationParameters {
+	float scale;
+	int32_t zeroPoint;
+
+	QuantizationParameters(float scale = 1.0f, int32_t zeroPoint = 0) :
+		scale(scale), zeroPoint(zeroPoint) { }
+};
+
+/**
+ * @brief Matrix of Q = int8_t or int16_t quantized values
+ * @details products sum in int32 without overflow checks. with int8 that holds
+ * for inner dimensions up to about 32000; int16 values should be kept small
+ * enough that k * max|a - zeroPoint| * max|b - zeroPoint| stays below 2^31
+ */
+template <class Q = int8_t>
+class QuantizedMatrix {
+public:
+	/**
+	 * @brief zero quantized values, every scale 1 and zero point 0
+	 */
+	QuantizedMatrix(int32_t rows, int32_t cols, QuantizationScheme scheme = QUANTIZE_PER_TENSOR);
+
+	/**
+	 * @brief quantizes src with parameters from its range
+	 */
+	explicit QuantizedMatrix(const Matrix<float>& src, QuantizationScheme scheme = QUANTIZE_PER_TENSOR);
+
+	int32_t rows() const;
+	int32_t cols() const;
+	QuantizationScheme scheme() const;
+
+	/**
+	 * @brief the quantized values
+	 */
+	Matrix<Q>& values();
+	const Matrix<Q>& values() const;
+
+	/**
+	 * @brief parameters of row i, the same for every row with QUANTIZE_PER_TENSOR
+	 */
+	const QuantizationParameters& parameters(int32_t row = 0) const;
+
+	/**
+	 * @brief Sets the parameters used by the next quantize or requantizing multiply
+	 * @details with QUANTIZE_PER_TENSOR row is ignored
+	 */
+	void setParameters(const QuantizationParameters& params, int32_t row = 0);
+
+	/**
+	 * @brief Chooses parameters so that [min, max] of src (and 0) maps onto the
+	 * whole range of Q, then quantizes src
+	 * @details src must be rows() x cols()
+	 */
+	void quantize(const Matrix<float>& src);
+
+	/**
+	 * @brief Quantizes src with the current parameters, rounding and saturating
+	 */
+	void quantizeWith(const Matrix<float>& src);
+
+	/**
+	 * @brief dest = scale * (q - zeroPoint)
+	 */
+	void dequantize(Matrix<float>& dest) const;
+
+	/**
+	 * @brief parameters mapping [min, max] onto the range of Q
+	 * @details the range is widened to hold 0 so that zero is exact
+	 */
+	static QuantizationParameters chooseParameters(float min, float max);
+
+	/**
+	 * @brief dest = (A - zeroPointA) * (B - zeroPointB), summed in int32
+	 * @details B must be QUANTIZE_PER_TENSOR, A may be either
+	 */
+	static void multiply(Matrix<int32_t>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B);
+
+	/**
+	 * @brief dest = dequantize(A) * dequantize(B)
+	 */
+	static void multiply(Matrix<float>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B);
+
+	/**
+	 * @brief Requantizes A * B into dest with the parameters already set on dest
+	 */
+	static void multiply(QuantizedMatrix<Q>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B);
+
+private:
+	Matrix<Q> _values;
+	QuantizationScheme _scheme;
+	std::vector<QuantizationParameters> _params;
+
+	static Q saturate(float value);
+};
+
+template <class Q>
+QuantizedMatrix<Q>::QuantizedMatrix(int32_t rows, int32_t cols, QuantizationScheme scheme) :
+	_values(rows, cols), _scheme(scheme),
+	_params(scheme == QUANTIZE_PER_ROW ? rows : 1) {
+	_values.fill(Q(0));
+}
+
+template <class Q>
+QuantizedMatrix<Q>::QuantizedMatrix(const Matrix<float>& src, QuantizationScheme scheme) :
+	_values(src.rows(), src.cols()), _scheme(scheme),
+	_params(scheme == QUANTIZE_PER_ROW ? src.rows() : 1) {
+	quantize(src);
+}
+
+template <class Q>
+int32_t QuantizedMatrix<Q>::rows() const {
+	return _values.rows();
+}
+
+template <class Q>
+int32_t QuantizedMatrix<Q>::cols() const {
+	return _values.cols();
+}
+
+template <class Q>
+QuantizationScheme QuantizedMatrix<Q>::scheme() const {
+	return _scheme;
+}
+
+template <class Q>
+Matrix<Q>& QuantizedMatrix<Q>::values() {
+	return _values;
+}
+
+template <class Q>
+const Matrix<Q>& QuantizedMatrix<Q>::values() const {
+	return _values;
+}
+
+template <class Q>
+const QuantizationParameters& QuantizedMatrix<Q>::parameters(int32_t row) const {
+	assert(row >= 0 && row < rows());
+	return _scheme == QUANTIZE_PER_ROW ? _params[row] : _params[0];
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::setParameters(const QuantizationParameters& params, int32_t row) {
+	assert(row >= 0 && row < rows());
+	assert(params.scale > 0);
+	_params[_scheme == QUANTIZE_PER_ROW ? row : 0] = params;
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::quantize(const Matrix<float>& src) {
+	assert(src.rows() == rows() && src.cols() == cols());
+	int32_t m = rows();
+	int32_t n = cols();
+	if (_scheme == QUANTIZE_PER_ROW) {
+		for (int32_t i = 0; i < m; ++i) {
+			const float* row = src.data() + (int64_t) i * src.ld();
+			auto range = std::minmax_element(row, row + n);
+			_params[i] = chooseParameters(*range.first, *range.second);
+		}
+	} else {
+		float min = src(0, 0);
+		float max = min;
+		for (int32_t i = 0; i < m; ++i) {
+			const float* row = src.data() + (int64_t) i * src.ld();
+			auto range = std::minmax_element(row, row + n);
+			min = std::min(min, *range.first);
+			max = std::max(max, *range.second);
+		}
+		_params[0] = chooseParameters(min, max);
+	}
+	quantizeWith(src);
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::quantizeWith(const Matrix<float>& src) {
+	assert(src.rows() == rows() && src.cols() == cols());
+	for (int32_t i = 0; i < rows(); ++i) {
+		const QuantizationParameters& params = parameters(i);
+		const float* in = src.data() + (int64_t) i * src.ld();
+		Q* out = _values.data() + (int64_t) i * _values.ld();
+		float inverse = 1.0f / params.scale;
+		for (int32_t j = 0; j < cols(); ++j) {
+			out[j] = saturate(in[j] * inverse + (float) params.zeroPoint);
+		}
+	}
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::dequantize(Matrix<float>& dest) const {
+	assert(dest.rows() == rows() && dest.cols() == cols());
+	for (int32_t i = 0; i < rows(); ++i) {
+		const QuantizationParameters& params = parameters(i);
+		const Q* in = _values.data() + (int64_t) i * _values.ld();
+		float* out = dest.data() + (int64_t) i * dest.ld();
+		for (int32_t j = 0; j < cols(); ++j) {
+			out[j] = params.scale * (float) ((int32_t) in[j] - params.zeroPoint);
+		}
+	}
+}
+
+template <class Q>
+QuantizationParameters QuantizedMatrix<Q>::chooseParameters(float min, float max) {
+	const float qmin = (float) std::numeric_limits<Q>::min();
+	const float qmax = (float) std::numeric_limits<Q>::max();
+	min = std::min(min, 0.0f);
+	max = std::max(max, 0.0f);
+	if (max - min <= 0) {
+		return QuantizationParameters();
+	}
+	float scale = (max - min) / (qmax - qmin);
+	float zeroPoint = std::round(qmin - min / scale);
+	zeroPoint = std::max(qmin, std::min(qmax, zeroPoint));
+	return QuantizationParameters(scale, (int32_t) zeroPoint);
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::multiply(Matrix<int32_t>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B) {
+	assert(A.cols() == B.rows());
+	assert(dest.rows() == A.rows() && dest.cols() == B.cols());
+	assert(B.scheme() == QUANTIZE_PER_TENSOR);
+	int32_t m = A.rows();
+	int32_t n = B.cols();
+	int32_t k = A.cols();
+	std::vector<int32_t> columnSums(n);
+	MatrixKernels::integerGemm(m, n, k, A.values().data(), A.values().ld(),
+		B.values().data(), B.values().ld(), dest.data(), dest.ld(), columnSums.data());
+
+	// sum (a - za)(b - zb) = sum ab - zb * sum a - za * sum b + k * za * zb
+	int32_t zb = B.parameters().zeroPoint;
+	for (int32_t i = 0; i < m; ++i) {
+		int32_t za = A.parameters(i).zeroPoint;
+		const Q* a = A.values().data() + (int64_t) i * A.values().ld();
+		int32_t rowSum = 0;
+		for (int32_t p = 0; p < k; ++p) {
+			rowSum += a[p];
+		}
+		int32_t rowCorrection = k * za * zb - zb * rowSum;
+		int32_t* out = dest.data() + (int64_t) i * dest.ld();
+		for (int32_t j = 0; j < n; ++j) {
+			out[j] += rowCorrection - za * columnSums[j];
+		}
+	}
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::multiply(Matrix<float>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B) {
+	assert(dest.rows() == A.rows() && dest.cols() == B.cols());
+	Matrix<int32_t> sums(A.rows(), B.cols());
+	multiply(sums, A, B);
+	float scaleB = B.parameters().scale;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		float scale = A.parameters(i).scale * scaleB;
+		const int32_t* in = sums.data() + (int64_t) i * sums.ld();
+		float* out = dest.data() + (int64_t) i * dest.ld();
+		for (int32_t j = 0; j < B.cols(); ++j) {
+			out[j] = scale * (float) in[j];
+		}
+	}
+}
+
+template <class Q>
+void QuantizedMatrix<Q>::multiply(QuantizedMatrix<Q>& dest, const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B) {
+	assert(dest.rows() == A.rows() && dest.cols() == B.cols());
+	Matrix<int32_t> sums(A.rows(), B.cols());
+	multiply(sums, A, B);
+	float scaleB = B.parameters().scale;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		const QuantizationParameters& params = dest.parameters(i);
+		float scale = A.parameters(i).scale * scaleB / params.scale;
+		const int32_t* in = sums.data() + (int64_t) i * sums.ld();
+		Q* out = dest._values.data() + (int64_t) i * dest._values.ld();
+		for (int32_t j = 0; j < B.cols(); ++j) {
+			out[j] = saturate(scale * (float) in[j] + (float) params.zeroPoint);
+		}
+	}
+}
+
+template <class Q>
+Q QuantizedMatrix<Q>::saturate(float value) {
+	const float qmin = (float) std::numeric_limits<Q>::min();
+	const float qmax = (float) std::numeric_limits<Q>::max();
+	value = std::round(value);
+	return (Q) std::max(qmin, std::min(qmax, value));
+}
+
+} // namespace Alectryon
+
+#endif /* _QUANTIZED_MATRIX_HPP */
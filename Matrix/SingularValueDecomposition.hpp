@@ -0,0 +1,401 @@
+#ifndef _SINGULAR_VALUE_DECOMPOSITION_HPP
+#define _SINGULAR_VALUE_DECOMPOSITION_HPP
+
+/**
+ * Singular value decomposition, A = U * diag(values) * V^T
+ * Computed with one-sided Jacobi: columns of A are rotated in pairs until
+ * they are all orthogonal, their norms are then the singular values.
+ * Tall matrices are first reduced to their square R factor with
+ * QRFactorization. Pairs are processed in round robin order, so each
+ * round's rotations touch disjoint columns and run in parallel.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+template <class T>
+class SingularValueDecomposition {
+public:
+	/**
+	 * @brief pass as vectors to compute every singular vector
+	 */
+	static const int32_t AllVectors = -1;
+
+	/**
+	 * @brief sweeps over all column pairs before giving up
+	 */
+	static const int32_t MaxSweeps = 60;
+
+	/**
+	 * @brief Decomposes the m x n matrix A
+	 * @details vectors is how many left and right singular vectors to keep,
+	 * for the largest singular values. 0 computes singular values only
+	 */
+	explicit SingularValueDecomposition(const Matrix<T>& A, int32_t vectors = AllVectors);
+
+	/**
+	 * @brief Decomposes a new matrix
+	 */
+	void compute(const Matrix<T>& A, int32_t vectors = AllVectors);
+
+	int32_t rows() const;
+	int32_t cols() const;
+
+	/**
+	 * @brief returns false if the Jacobi sweeps did not converge
+	 */
+	bool success() const;
+
+	/**
+	 * @brief returns the singular values, min(rows(), cols()) x 1, largest first
+	 */
+	const Matrix<T>& values() const;
+
+	/**
+	 * @brief returns number of singular vector pairs computed
+	 */
+	int32_t vectorCount() const;
+
+	/**
+	 * @brief returns the left singular vectors, rows() x vectorCount()
+	 * @details columns for zero singular values are zero
+	 */
+	const Matrix<T>& U() const;
+
+	/**
+	 * @brief returns the right singular vectors, cols() x vectorCount()
+	 */
+	const Matrix<T>& V() const;
+
+	/**
+	 * @brief returns number of singular values above tolerance
+	 * @details a negative tolerance uses max(rows(), cols()) * epsilon * largest value
+	 */
+	int32_t rank(T tolerance = T(-1)) const;
+
+	/**
+	 * @brief stores the Moore-Penrose pseudo-inverse into dest (cols() x rows())
+	 * @details singular values up to tolerance are treated as zero, as in rank().
+	 * vectorCount() must be at least rank(tolerance)
+	 */
+	void pseudoInverse(Matrix<T>& dest, T tolerance = T(-1)) const;
+
+private:
+	int32_t _rows;
+	int32_t _cols;
+	Matrix<T> _values;
+	Matrix<T> _U;
+	Matrix<T> _V;
+	int32_t _vectorCount;
+	bool _success;
+
+	/**
+	 * @brief orthogonalizes the rows of G (the columns of B^T)
+	 * @details rows of Vt, if not nullptr, get the same rotations.
+	 * returns false if it didn't converge
+	 */
+	static bool orthogonalize(Matrix<T>& G, Matrix<T>* Vt);
+
+	/**
+	 * @brief returns the dot product of a and b, n elements
+	 */
+	static T dot(int32_t n, const T* a, const T* b);
+};
+
+template <class T>
+SingularValueDecomposition<T>::SingularValueDecomposition(const Matrix<T>& A, int32_t vectors) :
+	_rows(A.rows()), _cols(A.cols()), _values(1, 1), _U(1, 1), _V(1, 1),
+	_vectorCount(0), _success(false) {
+	compute(A, vectors);
+}
+
+template <class T>
+void SingularValueDecomposition<T>::compute(const Matrix<T>& A, int32_t vectors) {
+	_rows = A.rows();
+	_cols = A.cols();
+
+	// work on B = A or A^T, whichever is p x q with p >= q
+	const bool transposed = _rows < _cols;
+	const int32_t p = transposed ? _cols : _rows;
+	const int32_t q = transposed ? _rows : _cols;
+	if (vectors < 0 || vectors > q) {
+		vectors = q;
+	}
+	const bool wantVectors = vectors > 0;
+
+	// G holds the columns of B (or of R) as rows, so rotations are contiguous
+	Matrix<T> Q(1, 1);
+	Matrix<T> G(q, q);
+	const bool reduced = p > q;
+	if (reduced) {
+		Matrix<T> B(p, q);
+		if (transposed) {
+			Matrix<T>::transpose(B, A);
+		} else {
+			B = A;
+		}
+		QRFactorization<T> qr(std::move(B));
+		Matrix<T> R(q, q);
+		qr.R(R);
+		Matrix<T>::transpose(G, R);
+		if (wantVectors) {
+			Q = Matrix<T>(p, q);
+			qr.Q(Q);
+		}
+	} else {
+		Matrix<T>::transpose(G, A);
+	}
+
+	Matrix<T> Vt(wantVectors ? q : 1, q);
+	if (wantVectors) {
+		Vt.fill(T(0));
+		for (int32_t i = 0; i < q; ++i) {
+			Vt(i, i) = T(1);
+		}
+	}
+	_vectorCount = 0;
+	_success = orthogonalize(G, wantVectors ? &Vt : nullptr);
+
+	std::vector<T> norms(q);
+	for (int32_t j = 0; j < q; ++j) {
+		const T* row = G.data() + (int64_t) j * G.ld();
+		norms[j] = std::sqrt(dot(G.cols(), row, row));
+	}
+	std::vector<int32_t> order(q);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) { return norms[a] > norms[b]; });
+
+	_values = Matrix<T>(q, 1);
+	for (int32_t j = 0; j < q; ++j) {
+		_values(j, 0) = norms[order[j]];
+	}
+	if (!wantVectors) {
+		return;
+	}
+
+	// left vectors of B (or R) are the normalized rows of G
+	const int32_t g = G.cols();
+	Matrix<T> left(g, vectors);
+	Matrix<T> right(q, vectors);
+	for (int32_t c = 0; c < vectors; ++c) {
+		int32_t j = order[c];
+		const T* row = G.data() + (int64_t) j * G.ld();
+		T scale = (norms[j] > T(0)) ? T(1) / norms[j] : T(0);
+		for (int32_t i = 0; i < g; ++i) {
+			left(i, c) = row[i] * scale;
+		}
+		const T* vrow = Vt.data() + (int64_t) j * Vt.ld();
+		for (int32_t i = 0; i < q; ++i) {
+			right(i, c) = vrow[i];
+		}
+	}
+	if (reduced) {
+		// B = Q * R = (Q * U_R) * S * V^T
+		Matrix<T> full(p, vectors);
+		Matrix<T>::multiply(full, Q, left);
+		left = std::move(full);
+	}
+
+	if (transposed) {
+		_U = std::move(right);
+		_V = std::move(left);
+	} else {
+		_U = std::move(left);
+		_V = std::move(right);
+	}
+	_vectorCount = vectors;
+}
+
+template <class T>
+bool SingularValueDecomposition<T>::orthogonalize(Matrix<T>& G, Matrix<T>* Vt) {
+	const int32_t q = G.rows();
+	const int32_t m = G.cols();
+	const T tolerance = std::numeric_limits<T>::epsilon() * std::sqrt((T) m);
+	if (q < 2) {
+		return true;
+	}
+
+	// round robin pairing of an even number of slots, slots past q are idle
+	const int32_t slots = q + (q & 1);
+	const int32_t pairs = slots / 2;
+	std::vector<int32_t> first(pairs);
+	std::vector<int32_t> second(pairs);
+	std::vector<char> rotated(pairs);
+	std::vector<T> norms(q);
+	const int64_t work = (int64_t) pairs * m * (Vt != nullptr ? 2 : 1) * 6;
+
+	for (int32_t sweep = 0; sweep < MaxSweeps; ++sweep) {
+		// squared column norms, updated with each rotation and
+		// recomputed every sweep so rounding doesn't build up
+		for (int32_t j = 0; j < q; ++j) {
+			const T* row = G.data() + (int64_t) j * G.ld();
+			norms[j] = dot(m, row, row);
+		}
+		bool any = false;
+		for (int32_t round = 0; round < slots - 1; ++round) {
+			first[0] = round;
+			second[0] = slots - 1;
+			for (int32_t i = 1; i < pairs; ++i) {
+				first[i] = (round + i) % (slots - 1);
+				second[i] = (round + slots - 1 - i) % (slots - 1);
+			}
+
+			MatrixParallel::run(0, pairs, work, [&](int64_t lo, int64_t hi) {
+				for (int64_t i = lo; i < hi; ++i) {
+					rotated[i] = 0;
+					int32_t a = first[i];
+					int32_t b = second[i];
+					if (a >= q || b >= q) {
+						continue;
+					}
+					T* ga = G.data() + (int64_t) a * G.ld();
+					T* gb = G.data() + (int64_t) b * G.ld();
+					T alpha = norms[a];
+					T beta = norms[b];
+					T gamma = dot(m, ga, gb);
+					if (std::fabs(gamma) <= tolerance * std::sqrt(alpha * beta)) {
+						continue;
+					}
+
+					// rotation that zeroes the off diagonal of [alpha gamma; gamma beta]
+					T zeta = (beta - alpha) / (T(2) * gamma);
+					T t = T(1) / (std::fabs(zeta) + std::sqrt(T(1) + zeta * zeta));
+					t = (zeta < T(0)) ? -t : t;
+					T c = T(1) / std::sqrt(T(1) + t * t);
+					T s = c * t;
+					for (int32_t k = 0; k < m; ++k) {
+						T x = ga[k];
+						ga[k] = c * x - s * gb[k];
+						gb[k] = s * x + c * gb[k];
+					}
+					if (Vt != nullptr) {
+						T* va = Vt->data() + (int64_t) a * Vt->ld();
+						T* vb = Vt->data() + (int64_t) b * Vt->ld();
+						for (int32_t k = 0; k < q; ++k) {
+							T x = va[k];
+							va[k] = c * x - s * vb[k];
+							vb[k] = s * x + c * vb[k];
+						}
+					}
+					norms[a] = alpha - t * gamma;
+					norms[b] = beta + t * gamma;
+					rotated[i] = 1;
+				}
+			});
+
+			for (int32_t i = 0; i < pairs; ++i) {
+				any = any || rotated[i];
+			}
+		}
+		if (!any) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <class T>
+T SingularValueDecomposition<T>::dot(int32_t n, const T* a, const T* b) {
+	// separate partial sums so the loop vectorizes
+	T sums[4] = { 0, 0, 0, 0 };
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		sums[0] += a[i] * b[i];
+		sums[1] += a[i + 1] * b[i + 1];
+		sums[2] += a[i + 2] * b[i + 2];
+		sums[3] += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; ++i) {
+		sums[0] += a[i] * b[i];
+	}
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+template <class T>
+int32_t SingularValueDecomposition<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t SingularValueDecomposition<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+bool SingularValueDecomposition<T>::success() const {
+	return _success;
+}
+
+template <class T>
+const Matrix<T>& SingularValueDecomposition<T>::values() const {
+	return _values;
+}
+
+template <class T>
+int32_t SingularValueDecomposition<T>::vectorCount() const {
+	return _vectorCount;
+}
+
+template <class T>
+const Matrix<T>& SingularValueDecomposition<T>::U() const {
+	assert(_vectorCount > 0);
+	return _U;
+}
+
+template <class T>
+const Matrix<T>& SingularValueDecomposition<T>::V() const {
+	assert(_vectorCount > 0);
+	return _V;
+}
+
+template <class T>
+int32_t SingularValueDecomposition<T>::rank(T tolerance) const {
+	if (tolerance < T(0)) {
+		int32_t larger = (_rows > _cols) ? _rows : _cols;
+		tolerance = larger * std::numeric_limits<T>::epsilon() * _values(0, 0);
+	}
+	int32_t count = 0;
+	while (count < _values.rows() && _values(count, 0) > tolerance) {
+		++count;
+	}
+	return count;
+}
+
+template <class T>
+void SingularValueDecomposition<T>::pseudoInverse(Matrix<T>& dest, T tolerance) const {
+	assert(dest.rows() == _cols);
+	assert(dest.cols() == _rows);
+	int32_t r = rank(tolerance);
+	if (r == 0) {
+		dest.fill(T(0));
+		return;
+	}
+	assert(r <= _vectorCount);
+
+	// A^+ = V_r * S_r^-1 * U_r^T
+	Matrix<T> scaled(_cols, r);
+	for (int32_t i = 0; i < _cols; ++i) {
+		for (int32_t j = 0; j < r; ++j) {
+			scaled(i, j) = _V(i, j) / _values(j, 0);
+		}
+	}
+	Matrix<T> Ut(r, _rows);
+	for (int32_t i = 0; i < _rows; ++i) {
+		for (int32_t j = 0; j < r; ++j) {
+			Ut(j, i) = _U(i, j);
+		}
+	}
+	Matrix<T>::multiply(dest, scaled, Ut);
+}
+
+} // namespace Alectryon
+
+#endif /* _SINGULAR_VALUE_DECOMPOSITION_HPP */
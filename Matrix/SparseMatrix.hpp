@@ -0,0 +1,568 @@
+#ifndef _SPARSE_MATRIX_HPP
+#define _SPARSE_MATRIX_HPP
+
+/**
+ * Sparse matrices in compressed row (CSR) or compressed column (CSC) form
+ * Memory is proportional to the number of nonzeros, so systems that are
+ * mostly zero can be far larger than a dense Matrix allows.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+
+enum SparseFormat {
+	SPARSE_CSR, // rows are compressed, fast row access and multiply
+	SPARSE_CSC  // columns are compressed, fast column access
+};
+
+/**
+ * @brief one nonzero for building a SparseMatrix
+ */
+template <class T>
+struct SparseTriplet {
+	int32_t row;
+	int32_t col;
+	T value;
+};
+
+template <class T>
+class SparseMatrix {
+public:
+	/**
+	 * @brief Constructs a rows x cols matrix with no nonzeros
+	 */
+	SparseMatrix(int32_t rows, int32_t cols, SparseFormat format = SPARSE_CSR);
+
+	/**
+	 * @brief Constructs a rows x cols matrix from triplets in any order
+	 * @details duplicate entries are summed
+	 */
+	SparseMatrix(int32_t rows, int32_t cols, const std::vector<SparseTriplet<T>>& triplets,
+		SparseFormat format = SPARSE_CSR);
+
+	/**
+	 * @brief Constructs from the elements of mat with magnitude above dropTolerance
+	 */
+	explicit SparseMatrix(const Matrix<T>& mat, SparseFormat format = SPARSE_CSR, T dropTolerance = 0);
+
+	int32_t rows() const;
+	int32_t cols() const;
+	SparseFormat format() const;
+
+	/**
+	 * @brief returns number of stored elements
+	 */
+	int64_t nonZeros() const;
+
+	/**
+	 * @brief returns where each row (CSR) or column (CSC) starts in
+	 * indices() and values(), one longer than the number of rows or columns
+	 */
+	const std::vector<int64_t>& offsets() const;
+
+	/**
+	 * @brief returns the column (CSR) or row (CSC) of every stored element,
+	 * sorted within each row or column
+	 */
+	const std::vector<int32_t>& indices() const;
+
+	const std::vector<T>& values() const;
+
+	/**
+	 * @brief returns values() for changing elements without changing the pattern
+	 */
+	std::vector<T>& values();
+
+	/**
+	 * @brief returns element (row, col), zero if it is not stored
+	 * @details binary search of the row or column
+	 */
+	T coeff(int32_t row, int32_t col) const;
+
+	/**
+	 * @brief returns the matrix as a dense Matrix
+	 */
+	Matrix<T> toMatrix() const;
+
+	/**
+	 * @brief stores src into dest in the given format
+	 */
+	static void convert(SparseMatrix<T>& dest, const SparseMatrix<T>& src, SparseFormat format);
+
+	/**
+	 * @brief stores the transpose of src into dest, in the format of src
+	 * @details dest can NOT be the same as src
+	 */
+	static void transpose(SparseMatrix<T>& dest, const SparseMatrix<T>& src);
+
+	/**
+	 * @brief computes dest = A * B for a dense B
+	 * @details B can have one column (SpMV) or several (SpMM).
+	 * CSR splits rows across threads, CSC splits the columns of B.
+	 * dest can NOT be the same as B
+	 */
+	static void multiply(Matrix<T>& dest, const SparseMatrix<T>& A, const Matrix<T>& B);
+
+	/**
+	 * @brief computes dest = alpha * A * B + beta * dest for a dense B
+	 */
+	static void multiplyAdd(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta);
+
+	/**
+	 * @brief Solves L * x = b in place, L is the lower triangle of this matrix
+	 * @details elements above the diagonal are ignored. with unitDiagonal the
+	 * diagonal is taken as ones, otherwise every diagonal element must be stored
+	 */
+	void solveLower(Matrix<T>& b, bool unitDiagonal = false) const;
+
+	/**
+	 * @brief Solves U * x = b in place, U is the upper triangle of this matrix
+	 */
+	void solveUpper(Matrix<T>& b, bool unitDiagonal = false) const;
+
+private:
+	int32_t _rows;
+	int32_t _cols;
+	SparseFormat _format;
+
+	std::vector<int64_t> _offsets;
+	std::vector<int32_t> _indices;
+	std::vector<T> _values;
+
+	/**
+	 * @brief returns number of compressed rows or columns
+	 */
+	int32_t outer() const;
+	int32_t inner() const;
+
+	/**
+	 * @brief counting sort of the elements by their inner index, giving the
+	 * other format (or the transpose) with indices still sorted
+	 */
+	static void compress(int32_t outer, int32_t inner,
+		const std::vector<int64_t>& offsets, const std::vector<int32_t>& indices, const std::vector<T>& values,
+		std::vector<int64_t>& outOffsets, std::vector<int32_t>& outIndices, std::vector<T>& outValues);
+
+	static void multiplyRows(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta);
+	static void multiplyCols(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta);
+};
+
+template <class T>
+SparseMatrix<T>::SparseMatrix(int32_t rows, int32_t cols, SparseFormat format) :
+	_rows(rows), _cols(cols), _format(format), _offsets(outer() + 1, 0) {
+	assert(rows > 0);
+	assert(cols > 0);
+}
+
+template <class T>
+SparseMatrix<T>::SparseMatrix(int32_t rows, int32_t cols, const std::vector<SparseTriplet<T>>& triplets,
+		SparseFormat format) :
+	_rows(rows), _cols(cols), _format(format) {
+	assert(rows > 0);
+	assert(cols > 0);
+
+	// bucket the triplets by inner index, then compress() sorts them by outer
+	const bool csr = (format == SPARSE_CSR);
+	std::vector<int64_t> offsets(inner() + 1, 0);
+	for (const SparseTriplet<T>& t : triplets) {
+		assert(t.row >= 0 && t.row < rows);
+		assert(t.col >= 0 && t.col < cols);
+		++offsets[(csr ? t.col : t.row) + 1];
+	}
+	for (int32_t i = 0; i < inner(); ++i) {
+		offsets[i + 1] += offsets[i];
+	}
+	std::vector<int32_t> indices(triplets.size());
+	std::vector<T> values(triplets.size());
+	std::vector<int64_t> next(offsets.begin(), offsets.end() - 1);
+	for (const SparseTriplet<T>& t : triplets) {
+		int64_t p = next[csr ? t.col : t.row]++;
+		indices[p] = csr ? t.row : t.col;
+		values[p] = t.value;
+	}
+	compress(inner(), outer(), offsets, indices, values, _offsets, _indices, _values);
+
+	// sum the duplicates, which are now next to each other
+	int64_t out = 0;
+	int64_t start = 0;
+	for (int32_t i = 0; i < outer(); ++i) {
+		int64_t end = _offsets[i + 1];
+		for (int64_t p = start; p < end; ++p) {
+			if (out > _offsets[i] && _indices[out - 1] == _indices[p]) {
+				_values[out - 1] += _values[p];
+			} else {
+				_indices[out] = _indices[p];
+				_values[out] = _values[p];
+				++out;
+			}
+		}
+		start = end;
+		_offsets[i + 1] = out;
+	}
+	_indices.resize(out);
+	_values.resize(out);
+}
+
+template <class T>
+SparseMatrix<T>::SparseMatrix(const Matrix<T>& mat, SparseFormat format, T dropTolerance) :
+	_rows(mat.rows()), _cols(mat.cols()), _format(format), _offsets(outer() + 1, 0) {
+	const bool csr = (format == SPARSE_CSR);
+	for (int32_t i = 0; i < outer(); ++i) {
+		for (int32_t j = 0; j < inner(); ++j) {
+			T value = csr ? mat(i, j) : mat(j, i);
+			if (std::abs(value) > dropTolerance) {
+				_indices.push_back(j);
+				_values.push_back(value);
+			}
+		}
+		_offsets[i + 1] = (int64_t) _indices.size();
+	}
+}
+
+template <class T>
+int32_t SparseMatrix<T>::rows() const {
+	return _rows;
+}
+
+template <class T>
+int32_t SparseMatrix<T>::cols() const {
+	return _cols;
+}
+
+template <class T>
+SparseFormat SparseMatrix<T>::format() const {
+	return _format;
+}
+
+template <class T>
+int64_t SparseMatrix<T>::nonZeros() const {
+	return (int64_t) _values.size();
+}
+
+template <class T>
+const std::vector<int64_t>& SparseMatrix<T>::offsets() const {
+	return _offsets;
+}
+
+template <class T>
+const std::vector<int32_t>& SparseMatrix<T>::indices() const {
+	return _indices;
+}
+
+template <class T>
+const std::vector<T>& SparseMatrix<T>::values() const {
+	return _values;
+}
+
+template <class T>
+std::vector<T>& SparseMatrix<T>::values() {
+	return _values;
+}
+
+template <class T>
+int32_t SparseMatrix<T>::outer() const {
+	return (_format == SPARSE_CSR) ? _rows : _cols;
+}
+
+template <class T>
+int32_t SparseMatrix<T>::inner() const {
+	return (_format == SPARSE_CSR) ? _cols : _rows;
+}
+
+template <class T>
+T SparseMatrix<T>::coeff(int32_t row, int32_t col) const {
+	assert(row >= 0 && row < _rows);
+	assert(col >= 0 && col < _cols);
+
+	int32_t i = (_format == SPARSE_CSR) ? row : col;
+	int32_t j = (_format == SPARSE_CSR) ? col : row;
+	int64_t lo = _offsets[i];
+	int64_t hi = _offsets[i + 1];
+	while (lo < hi) {
+		int64_t mid = lo + (hi - lo) / 2;
+		if (_indices[mid] < j) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return (lo < _offsets[i + 1] && _indices[lo] == j) ? _values[lo] : T(0);
+}
+
+template <class T>
+Matrix<T> SparseMatrix<T>::toMatrix() const {
+	Matrix<T> mat(_rows, _cols);
+	mat.fill(0);
+	for (int32_t i = 0; i < outer(); ++i) {
+		for (int64_t p = _offsets[i]; p < _offsets[i + 1]; ++p) {
+			if (_format == SPARSE_CSR) {
+				mat(i, _indices[p]) = _values[p];
+			} else {
+				mat(_indices[p], i) = _values[p];
+			}
+		}
+	}
+	return mat;
+}
+
+template <class T>
+void SparseMatrix<T>::compress(int32_t outer, int32_t inner,
+		const std::vector<int64_t>& offsets, const std::vector<int32_t>& indices, const std::vector<T>& values,
+		std::vector<int64_t>& outOffsets, std::vector<int32_t>& outIndices, std::vector<T>& outValues) {
+	int64_t nnz = offsets[outer];
+	outOffsets.assign(inner + 1, 0);
+	for (int64_t p = 0; p < nnz; ++p) {
+		++outOffsets[indices[p] + 1];
+	}
+	for (int32_t j = 0; j < inner; ++j) {
+		outOffsets[j + 1] += outOffsets[j];
+	}
+
+	// walking the input in order keeps every output row or column sorted
+	outIndices.resize(nnz);
+	outValues.resize(nnz);
+	std::vector<int64_t> next(outOffsets.begin(), outOffsets.end() - 1);
+	for (int32_t i = 0; i < outer; ++i) {
+		for (int64_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+			int64_t q = next[indices[p]]++;
+			outIndices[q] = i;
+			outValues[q] = values[p];
+		}
+	}
+}
+
+template <class T>
+void SparseMatrix<T>::convert(SparseMatrix<T>& dest, const SparseMatrix<T>& src, SparseFormat format) {
+	if (&dest == &src && src._format == format) {
+		return;
+	}
+	if (src._format == format) {
+		dest = src;
+		return;
+	}
+
+	// the CSC arrays of A are the CSR arrays of A^T, and the other way around
+	std::vector<int64_t> offsets;
+	std::vector<int32_t> indices;
+	std::vector<T> values;
+	compress(src.outer(), src.inner(), src._offsets, src._indices, src._values, offsets, indices, values);
+	dest._rows = src._rows;
+	dest._cols = src._cols;
+	dest._format = format;
+	dest._offsets.swap(offsets);
+	dest._indices.swap(indices);
+	dest._values.swap(values);
+}
+
+template <class T>
+void SparseMatrix<T>::transpose(SparseMatrix<T>& dest, const SparseMatrix<T>& src) {
+	assert(&dest != &src);
+
+	compress(src.outer(), src.inner(), src._offsets, src._indices, src._values,
+		dest._offsets, dest._indices, dest._values);
+	dest._rows = src._cols;
+	dest._cols = src._rows;
+	dest._format = src._format;
+}
+
+template <class T>
+void SparseMatrix<T>::multiply(Matrix<T>& dest, const SparseMatrix<T>& A, const Matrix<T>& B) {
+	multiplyAdd(dest, T(1), A, B, T(0));
+}
+
+template <class T>
+void SparseMatrix<T>::multiplyAdd(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta) {
+	assert(A._cols == B.rows());
+	assert(dest.rows() == A._rows);
+	assert(dest.cols() == B.cols());
+	assert(&dest != &B);
+
+	if (A._format == SPARSE_CSR) {
+		multiplyRows(dest, alpha, A, B, beta);
+	} else {
+		multiplyCols(dest, alpha, A, B, beta);
+	}
+}
+
+template <class T>
+void SparseMatrix<T>::multiplyRows(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta) {
+	const int32_t k = B.cols();
+	const int32_t ldb = B.ld();
+	const int32_t ldd = dest.ld();
+	const T* b = B.data();
+	T* d = dest.data();
+
+	// every row of dest only reads its own row of A
+	MatrixParallel::run(0, A._rows, A.nonZeros() * k, [&](int64_t lo, int64_t hi) {
+		for (int64_t i = lo; i < hi; ++i) {
+			T* out = d + i * ldd;
+			if (k == 1) {
+				T sum = 0;
+				for (int64_t p = A._offsets[i]; p < A._offsets[i + 1]; ++p) {
+					sum += A._values[p] * b[(int64_t) A._indices[p] * ldb];
+				}
+				out[0] = (beta == T(0)) ? alpha * sum : alpha * sum + beta * out[0];
+				continue;
+			}
+
+			if (beta == T(0)) {
+				MatrixKernels::vectorFill(k, T(0), out);
+			} else if (beta != T(1)) {
+				MatrixKernels::vectorScale(k, out, beta, out);
+			}
+			for (int64_t p = A._offsets[i]; p < A._offsets[i + 1]; ++p) {
+				MatrixKernels::vectorAxpy(k, alpha * A._values[p], b + (int64_t) A._indices[p] * ldb, out);
+			}
+		}
+	}, 64);
+}
+
+template <class T>
+void SparseMatrix<T>::multiplyCols(Matrix<T>& dest, T alpha, const SparseMatrix<T>& A, const Matrix<T>& B, T beta) {
+	const int32_t k = B.cols();
+	const int32_t ldb = B.ld();
+	const int32_t ldd = dest.ld();
+	const T* b = B.data();
+	T* d = dest.data();
+
+	// columns of A scatter into every row of dest, so only the
+	// columns of B can be split between threads
+	MatrixParallel::run(0, k, A.nonZeros() * k, [&](int64_t lo, int64_t hi) {
+		const int64_t width = hi - lo;
+		for (int32_t i = 0; i < A._rows; ++i) {
+			T* out = d + (int64_t) i * ldd + lo;
+			if (beta == T(0)) {
+				MatrixKernels::vectorFill(width, T(0), out);
+			} else if (beta != T(1)) {
+				MatrixKernels::vectorScale(width, out, beta, out);
+			}
+		}
+		for (int32_t j = 0; j < A._cols; ++j) {
+			const T* in = b + (int64_t) j * ldb + lo;
+			for (int64_t p = A._offsets[j]; p < A._offsets[j + 1]; ++p) {
+				T* out = d + (int64_t) A._indices[p] * ldd + lo;
+				T scale = alpha * A._values[p];
+				for (int64_t c = 0; c < width; ++c) {
+					out[c] += scale * in[c];
+				}
+			}
+		}
+	});
+}
+
+template <class T>
+void SparseMatrix<T>::solveLower(Matrix<T>& b, bool unitDiagonal) const {
+	assert(_rows == _cols);
+	assert(b.rows() == _rows);
+
+	const int32_t n = _rows;
+	const int32_t k = b.cols();
+	const int32_t ld = b.ld();
+	T* x = b.data();
+
+	if (_format == SPARSE_CSR) {
+		// x_i = (b_i - sum L_ij x_j) / L_ii, going down the rows
+		for (int32_t i = 0; i < n; ++i) {
+			T* row = x + (int64_t) i * ld;
+			T diag = 1;
+			bool found = unitDiagonal;
+			for (int64_t p = _offsets[i]; p < _offsets[i + 1] && _indices[p] <= i; ++p) {
+				if (_indices[p] == i) {
+					diag = unitDiagonal ? T(1) : _values[p];
+					found = true;
+				} else {
+					MatrixKernels::vectorAxpy(k, -_values[p], x + (int64_t) _indices[p] * ld, row);
+				}
+			}
+			assert(found);
+			if (diag != T(1)) {
+				MatrixKernels::vectorScale(k, row, T(1) / diag, row);
+			}
+		}
+		return;
+	}
+
+	// column j is final once it is divided by L_jj, then it is
+	// subtracted from the rows below it
+	for (int32_t j = 0; j < n; ++j) {
+		T* row = x + (int64_t) j * ld;
+		int64_t p = _offsets[j];
+		int64_t end = _offsets[j + 1];
+		while (p < end && _indices[p] < j) {
+			++p;
+		}
+		if (p < end && _indices[p] == j) {
+			if (!unitDiagonal) {
+				MatrixKernels::vectorScale(k, row, T(1) / _values[p], row);
+			}
+			++p;
+		} else {
+			assert(unitDiagonal);
+		}
+		for (; p < end; ++p) {
+			MatrixKernels::vectorAxpy(k, -_values[p], row, x + (int64_t) _indices[p] * ld);
+		}
+	}
+}
+
+template <class T>
+void SparseMatrix<T>::solveUpper(Matrix<T>& b, bool unitDiagonal) const {
+	assert(_rows == _cols);
+	assert(b.rows() == _rows);
+
+	const int32_t n = _rows;
+	const int32_t k = b.cols();
+	const int32_t ld = b.ld();
+	T* x = b.data();
+
+	if (_format == SPARSE_CSR) {
+		// going up the rows, reading each row from the end back to the diagonal
+		for (int32_t i = n - 1; i >= 0; --i) {
+			T* row = x + (int64_t) i * ld;
+			T diag = 1;
+			bool found = unitDiagonal;
+			for (int64_t p = _offsets[i + 1] - 1; p >= _offsets[i] && _indices[p] >= i; --p) {
+				if (_indices[p] == i) {
+					diag = unitDiagonal ? T(1) : _values[p];
+					found = true;
+				} else {
+					MatrixKernels::vectorAxpy(k, -_values[p], x + (int64_t) _indices[p] * ld, row);
+				}
+			}
+			assert(found);
+			if (diag != T(1)) {
+				MatrixKernels::vectorScale(k, row, T(1) / diag, row);
+			}
+		}
+		return;
+	}
+
+	for (int32_t j = n - 1; j >= 0; --j) {
+		T* row = x + (int64_t) j * ld;
+		int64_t begin = _offsets[j];
+		int64_t p = _offsets[j + 1] - 1;
+		while (p >= begin && _indices[p] > j) {
+			--p;
+		}
+		if (p >= begin && _indices[p] == j) {
+			if (!unitDiagonal) {
+				MatrixKernels::vectorScale(k, row, T(1) / _values[p], row);
+			}
+			--p;
+		} else {
+			assert(unitDiagonal);
+		}
+		for (; p >= begin; --p) {
+			MatrixKernels::vectorAxpy(k, -_values[p], row, x + (int64_t) _indices[p] * ld);
+		}
+	}
+}
+
+} // namespace Alectryon
+
+#endif /* _SPARSE_MATRIX_HPP */
@@ -0,0 +1,95 @@
+#define BOOST_TEST_MODULE BatchTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "MatrixBatch.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+template <class T>
+static void checkSolve(int32_t count, int32_t n, int32_t k, T tolerance) {
+	MatrixBatch<T> A(count, n, n), b(count, n, k), x(count, n, k);
+	randomFill(A);
+	randomFill(b);
+	for (int32_t m = 0; m < count; ++m) {
+		for (int32_t i = 0; i < n; ++i) {
+			A(m, i, i) += (T) n;
+		}
+	}
+
+	MatrixBatch<T>::solve(A, b, x);
+	MatrixBatch<T> Ax(count, n, k);
+	MatrixBatch<T>::multiply(Ax, A, x);
+	T diff = 0;
+	for (int32_t m = 0; m < count; ++m) {
+		for (int32_t i = 0; i < n; ++i) {
+			for (int32_t j = 0; j < k; ++j) {
+				diff = std::max(diff, (T) std::fabs(Ax(m, i, j) - b(m, i, j)));
+			}
+		}
+	}
+	BOOST_CHECK(diff < tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(matches_matrix) {
+	// not a multiple of the tile size
+	const int32_t count = 150;
+	MatrixBatch<double> A(count, 3, 4), B(count, 4, 2), C(count, 3, 2);
+	randomFill(A);
+	randomFill(B);
+	MatrixBatch<double>::multiply(C, A, B);
+
+	Matrix<double> a(3, 4), b(4, 2), c(3, 2);
+	for (int32_t m = 0; m < count; ++m) {
+		A.get(m, a);
+		B.get(m, b);
+		Matrix<double>::multiply(c, a, b);
+		for (int32_t i = 0; i < 3; ++i) {
+			for (int32_t j = 0; j < 2; ++j) {
+				BOOST_CHECK(std::fabs(c(i, j) - C(m, i, j)) < 1e-14);
+			}
+		}
+	}
+
+	Matrix<double> d(3, 2);
+	d.fill(7);
+	C.set(5, d);
+	BOOST_CHECK(C(5, 2, 1) == 7);
+	BOOST_CHECK(C.element(2, 1)[5] == 7);
+}
+
+BOOST_AUTO_TEST_CASE(solve_and_inverse) {
+	checkSolve<float>(1000, 4, 1, 1e-4f);
+	checkSolve<float>(333, 8, 3, 1e-4f);
+	checkSolve<double>(200, 6, 6, 1e-12);
+
+	// every matrix needs a different row swap
+	const int32_t count = 3;
+	MatrixBatch<double> P(count, 3, 3), inv(count, 3, 3), I(count, 3, 3);
+	for (int32_t m = 0; m < count; ++m) {
+		P(m, m, 0) = 2;
+		P(m, (m + 1) % 3, 1) = 3;
+		P(m, (m + 2) % 3, 2) = 4;
+	}
+	MatrixBatchLU<double> lu(P);
+	for (int32_t m = 0; m < count; ++m) {
+		BOOST_CHECK(!lu.singular(m));
+	}
+	lu.inverse(inv);
+	MatrixBatch<double>::multiply(I, P, inv);
+	for (int32_t m = 0; m < count; ++m) {
+		for (int32_t i = 0; i < 3; ++i) {
+			for (int32_t j = 0; j < 3; ++j) {
+				BOOST_CHECK(std::fabs(I(m, i, j) - (i == j ? 1 : 0)) < 1e-15);
+			}
+		}
+	}
+
+	MatrixBatch<double> S(2, 2, 2);
+	S(0, 0, 0) = 1;
+	S(0, 1, 1) = 1;
+	MatrixBatchLU<double> singular(S);
+	BOOST_CHECK(!singular.singular(0));
+	BOOST_CHECK(singular.singular(1));
+}
@@ -0,0 +1,175 @@
+#define BOOST_TEST_MODULE BlasTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * Runs every operation through the built-in kernels and through the backend
+ * and checks they agree. Built without MATRIX_USE_BLAS both runs use the
+ * built-in kernels, make BLAS=1 tests the backend
+ */
+
+template <class T>
+static Matrix<T> wellConditioned(int32_t n) {
+	Matrix<T> A = randomMatrix<T>(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		A(i, i) += (T) n;
+	}
+	return A;
+}
+
+/**
+ * @brief true if A and B hold the same values, NaN matching NaN
+ */
+template <class T>
+static bool identical(const Matrix<T>& A, const Matrix<T>& B) {
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < A.cols(); ++j) {
+			bool bothNan = std::isnan(A(i, j)) && std::isnan(B(i, j));
+			if (!bothNan && A(i, j) != B(i, j)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief calls fn with the backend off, then on, and checks both runs give the same result
+ */
+template <class T, class Fn>
+static bool sameAsBuiltIn(int32_t rows, int32_t cols, const Fn& fn) {
+	Matrix<T> builtIn(rows, cols);
+	Matrix<T> backend(rows, cols);
+	MatrixBlas::setEnabled(false);
+	fn(builtIn);
+	MatrixBlas::setEnabled(true);
+	fn(backend);
+	return identical(builtIn, backend);
+}
+
+/**
+ * @brief calls fn(result) with the backend off, then on, and returns the largest difference
+ */
+template <class T, class Fn>
+static T compare(int32_t rows, int32_t cols, const Fn& fn) {
+	Matrix<T> builtIn(rows, cols);
+	Matrix<T> backend(rows, cols);
+	MatrixBlas::setEnabled(false);
+	fn(builtIn);
+	MatrixBlas::setEnabled(true);
+	fn(backend);
+	return maxDifference(builtIn, backend);
+}
+
+BOOST_AUTO_TEST_CASE(settings) {
+#ifdef MATRIX_USE_BLAS
+	BOOST_CHECK(MatrixBlas::available());
+	BOOST_CHECK(MatrixBlas::enabled());
+	BOOST_CHECK(MatrixBlas::applies<double>(MatrixBlas::threshold()));
+#else
+	BOOST_CHECK(!MatrixBlas::available());
+	BOOST_CHECK(!MatrixBlas::enabled());
+#endif
+	BOOST_CHECK(!MatrixBlas::applies<double>(MatrixBlas::threshold() - 1));
+	BOOST_CHECK(!MatrixBlas::applies<int32_t>(MatrixBlas::threshold()));
+	MatrixBlas::setEnabled(false);
+	BOOST_CHECK(!MatrixBlas::applies<double>(MatrixBlas::threshold()));
+	MatrixBlas::setEnabled(true);
+}
+
+BOOST_AUTO_TEST_CASE(multiply) {
+	MatrixBlas::setThreshold(0);
+	Matrix<double> A = randomMatrix<double>(70, 45);
+	Matrix<double> B = randomMatrix<double>(45, 33);
+	BOOST_CHECK(compare<double>(70, 33, [&](Matrix<double>& C) {
+		Matrix<double>::multiply(C, A, B);
+	}) < 1e-12);
+
+	Matrix<double> C0 = randomMatrix<double>(70, 33);
+	BOOST_CHECK(compare<double>(70, 33, [&](Matrix<double>& C) {
+		C = C0;
+		Matrix<double>::multiplyAdd(C, 0.5, A, B, -2.0);
+	}) < 1e-12);
+
+	Matrix<float> Af = randomMatrix<float>(40, 50);
+	Matrix<float> Bf = randomMatrix<float>(50, 60);
+	BOOST_CHECK(compare<float>(40, 60, [&](Matrix<float>& C) {
+		Matrix<float>::multiply(C, Af, Bf);
+	}) < 1e-4f);
+	MatrixBlas::setThreshold((int64_t) 1 << 18);
+}
+
+BOOST_AUTO_TEST_CASE(solve_and_inverse) {
+	MatrixBlas::setThreshold(0);
+	const int32_t n = 60;
+	Matrix<double> A = wellConditioned<double>(n);
+	Matrix<double> b = randomMatrix<double>(n, 4);
+	BOOST_CHECK(compare<double>(n, 4, [&](Matrix<double>& x) {
+		Matrix<double>::solve(A, b, x);
+	}) < 1e-12);
+	BOOST_CHECK(compare<double>(n, 4, [&](Matrix<double>& x) {
+		Matrix<double>::solveLU(A, b, x);
+	}) < 1e-12);
+	BOOST_CHECK(compare<double>(n, n, [&](Matrix<double>& inv) {
+		Matrix<double>::inverse(inv, A);
+	}) < 1e-12);
+
+	Matrix<float> Af = wellConditioned<float>(n);
+	Matrix<float> bf = randomMatrix<float>(n, 1);
+	BOOST_CHECK(compare<float>(n, 1, [&](Matrix<float>& x) {
+		Matrix<float>::solve(Af, bf, x);
+	}) < 1e-5f);
+	MatrixBlas::setThreshold((int64_t) 1 << 18);
+}
+
+BOOST_AUTO_TEST_CASE(least_squares) {
+	MatrixBlas::setThreshold(0);
+	Matrix<double> A = randomMatrix<double>(90, 25);
+	Matrix<double> b = randomMatrix<double>(90, 3);
+	BOOST_CHECK(compare<double>(25, 3, [&](Matrix<double>& x) {
+		Matrix<double>::leastSquares(A, b, x);
+	}) < 1e-11);
+
+	// square systems too
+	Matrix<double> S = wellConditioned<double>(30);
+	Matrix<double> c = randomMatrix<double>(30, 1);
+	BOOST_CHECK(compare<double>(30, 1, [&](Matrix<double>& x) {
+		Matrix<double>::leastSquares(S, c, x);
+	}) < 1e-12);
+	MatrixBlas::setThreshold((int64_t) 1 << 18);
+}
+
+BOOST_AUTO_TEST_CASE(singular_falls_back) {
+	// LAPACK reports these as singular / rank deficient, the built-in
+	// code has to run instead of handing back half factored results
+	MatrixBlas::setThreshold(0);
+	const int32_t n = 20;
+	Matrix<double> A = wellConditioned<double>(n);
+	for (int32_t j = 0; j < n; ++j) {
+		A(7, j) = 0;
+	}
+	Matrix<double> b = randomMatrix<double>(n, 2);
+	BOOST_CHECK(sameAsBuiltIn<double>(n, n, [&](Matrix<double>& dest) {
+		Matrix<double>::inverse(dest, A);
+	}));
+	BOOST_CHECK(sameAsBuiltIn<double>(n, 2, [&](Matrix<double>& x) {
+		Matrix<double>::solveLU(A, b, x);
+	}));
+
+	Matrix<double> tall = randomMatrix<double>(40, 10);
+	for (int32_t i = 0; i < 40; ++i) {
+		tall(i, 4) = 0;
+	}
+	Matrix<double> c = randomMatrix<double>(40, 1);
+	BOOST_CHECK(sameAsBuiltIn<double>(10, 1, [&](Matrix<double>& x) {
+		Matrix<double>::leastSquares(tall, c, x);
+	}));
+	MatrixBlas::setThreshold((int64_t) 1 << 18);
+}
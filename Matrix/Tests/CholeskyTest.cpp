@@ -0,0 +1,108 @@
+#define BOOST_TEST_MODULE CholeskyTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+// M^T * M + n * I
+static Matrix<double> randomSPD(int32_t n) {
+	Matrix<double> M(n, n), MT(n, n);
+	randomFill(M);
+	Matrix<double>::transpose(MT, M);
+	Matrix<double> A = MT * M;
+	for (int32_t i = 0; i < n; ++i) {
+		A(i, i) += n;
+	}
+	return A;
+}
+
+static double luLogDeterminant(const Matrix<double>& A) {
+	LUFactorization<double> lu(A);
+	double logDet = 0;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		logDet += std::log(std::fabs(lu.packed()(i, i)));
+	}
+	return logDet;
+}
+
+BOOST_AUTO_TEST_CASE(spd_solve) {
+	// several blocks
+	const int32_t n = 150;
+	Matrix<double> A = randomSPD(n);
+	Matrix<double> b(n, 3), x(n, 3);
+	randomFill(b);
+	double logDet = luLogDeterminant(A);
+
+	// only the lower triangle is read
+	Matrix<double> lowerA = A;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = i + 1; j < n; ++j) {
+			lowerA(i, j) = std::numeric_limits<double>::quiet_NaN();
+		}
+	}
+
+	CholeskyType types[] = { CHOLESKY_LLT, CHOLESKY_LDLT };
+	for (CholeskyType type : types) {
+		CholeskyFactorization<double> chol(lowerA, type);
+		BOOST_CHECK(chol.success());
+		chol.solve(b, x);
+		BOOST_CHECK(residual(A, x, b) < 1e-9);
+		BOOST_CHECK(std::fabs(chol.logDeterminant() - logDet) < 1e-9 * std::fabs(logDet));
+
+		Matrix<double> inv(n, n);
+		chol.inverse(inv);
+		Matrix<double> I = A * inv;
+		double diff = 0;
+		for (int32_t i = 0; i < n; ++i) {
+			for (int32_t j = 0; j < n; ++j) {
+				diff = std::max(diff, std::fabs(I(i, j) - (i == j ? 1 : 0)));
+			}
+		}
+		BOOST_CHECK(diff < 1e-12);
+	}
+
+	// L * L^T reproduces A
+	CholeskyFactorization<double> chol(A);
+	Matrix<double> LT(n, n);
+	Matrix<double>::transpose(LT, chol.packed());
+	BOOST_CHECK(residual(chol.packed(), LT, A) < 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(indefinite) {
+	double data[] = { 4,  2, 0,
+	                  2, -3, 1,
+	                  0,  1, 2 };
+	Matrix<double> A(3, 3, data);
+	double bData[] = { 1, 2, 3 };
+	Matrix<double> b(3, 1, bData), x(3, 1);
+
+	CholeskyFactorization<double> chol(A);
+	BOOST_CHECK(!chol.success());
+
+	CholeskyFactorization<double> ldlt(A, CHOLESKY_LDLT);
+	BOOST_CHECK(ldlt.success());
+	ldlt.solve(b, x);
+	BOOST_CHECK(residual(A, x, b) < 1e-12);
+	BOOST_CHECK(std::fabs(ldlt.logDeterminant() - std::log(36.0)) < 1e-12);
+
+	chol.factor(randomSPD(5));
+	BOOST_CHECK(chol.success());
+}
+
+BOOST_AUTO_TEST_CASE(least_squares) {
+	// fits y = 2 + 3 t exactly
+	const int32_t m = 20;
+	Matrix<double> A(m, 2), b(m, 1), x(2, 1);
+	for (int32_t i = 0; i < m; ++i) {
+		A(i, 0) = 1;
+		A(i, 1) = i;
+		b(i, 0) = 2 + 3 * i;
+	}
+	Matrix<double>::leastSquares(A, b, x);
+	BOOST_CHECK(std::fabs(x(0, 0) - 2) < 1e-10);
+	BOOST_CHECK(std::fabs(x(1, 0) - 3) < 1e-10);
+}
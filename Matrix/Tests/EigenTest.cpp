@@ -0,0 +1,156 @@
+#define BOOST_TEST_MODULE EigenTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "EigenDecomposition.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+static Matrix<double> randomSymmetric(int32_t n) {
+	Matrix<double> A(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j <= i; ++j) {
+			A(i, j) = randomValue<double>();
+			A(j, i) = A(i, j);
+		}
+	}
+	return A;
+}
+
+/**
+ * @brief returns max |A * v_j - lambda_j * v_j| over the computed vectors
+ */
+static double eigenResidual(const Matrix<double>& A, const EigenDecomposition<double>& eig) {
+	const Matrix<double>& V = eig.vectors();
+	Matrix<double> AV(A.rows(), V.cols());
+	Matrix<double>::multiply(AV, A, V);
+	double largest = 0;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < V.cols(); ++j) {
+			largest = std::max(largest, std::fabs(AV(i, j) - eig.values()(j, 0) * V(i, j)));
+		}
+	}
+	return largest;
+}
+
+/**
+ * @brief returns max |V^T * V - I|
+ */
+static double orthogonality(const Matrix<double>& V) {
+	double largest = 0;
+	for (int32_t a = 0; a < V.cols(); ++a) {
+		for (int32_t b = 0; b < V.cols(); ++b) {
+			double sum = 0;
+			for (int32_t i = 0; i < V.rows(); ++i) {
+				sum += V(i, a) * V(i, b);
+			}
+			largest = std::max(largest, std::fabs(sum - (a == b ? 1.0 : 0.0)));
+		}
+	}
+	return largest;
+}
+
+BOOST_AUTO_TEST_CASE(all_vectors) {
+	const int32_t n = 80;
+	Matrix<double> A = randomSymmetric(n);
+	EigenDecomposition<double> eig(A);
+	BOOST_CHECK(eig.success());
+	BOOST_CHECK_EQUAL(eig.vectorCount(), n);
+	BOOST_CHECK(eigenResidual(A, eig) < 1e-10);
+	BOOST_CHECK(orthogonality(eig.vectors()) < 1e-10);
+	for (int32_t i = 1; i < n; ++i) {
+		BOOST_CHECK(eig.values()(i - 1, 0) >= eig.values()(i, 0));
+	}
+
+	// the trace is the sum of the eigenvalues
+	double trace = 0;
+	double sum = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		trace += A(i, i);
+		sum += eig.values()(i, 0);
+	}
+	BOOST_CHECK_CLOSE(trace, sum, 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(values_only) {
+	const int32_t n = 60;
+	Matrix<double> A = randomSymmetric(n);
+	EigenDecomposition<double> full(A);
+	EigenDecomposition<double> values(A, 0);
+	BOOST_CHECK(values.success());
+	BOOST_CHECK_EQUAL(values.vectorCount(), 0);
+	for (int32_t i = 0; i < n; ++i) {
+		BOOST_CHECK_SMALL(values.values()(i, 0) - full.values()(i, 0), 1e-10);
+	}
+
+	// only the lower triangle is read
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = i + 1; j < n; ++j) {
+			A(i, j) = 1e6;
+		}
+	}
+	values.compute(A, 0);
+	for (int32_t i = 0; i < n; ++i) {
+		BOOST_CHECK_SMALL(values.values()(i, 0) - full.values()(i, 0), 1e-10);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(top_vectors) {
+	const int32_t n = 100;
+	Matrix<double> A = randomSymmetric(n);
+	EigenDecomposition<double> top(A, 5);
+	BOOST_CHECK(top.success());
+	BOOST_CHECK_EQUAL(top.vectorCount(), 5);
+	BOOST_CHECK_EQUAL(top.vectors().cols(), 5);
+	BOOST_CHECK(eigenResidual(A, top) < 1e-10);
+	BOOST_CHECK(orthogonality(top.vectors()) < 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(repeated_eigenvalues) {
+	// projection onto a 3 dimensional subspace plus the identity:
+	// eigenvalues 2 (three times) and 1
+	const int32_t n = 30;
+	Matrix<double> basis = randomSymmetric(n);
+	EigenDecomposition<double> random(basis);
+	Matrix<double> A(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			double sum = (i == j) ? 1.0 : 0.0;
+			for (int32_t p = 0; p < 3; ++p) {
+				sum += random.vectors()(i, p) * random.vectors()(j, p);
+			}
+			A(i, j) = sum;
+		}
+	}
+
+	EigenDecomposition<double> top(A, 4);
+	BOOST_CHECK(top.success());
+	BOOST_CHECK_SMALL(top.values()(0, 0) - 2.0, 1e-12);
+	BOOST_CHECK_SMALL(top.values()(2, 0) - 2.0, 1e-12);
+	BOOST_CHECK_SMALL(top.values()(3, 0) - 1.0, 1e-12);
+	BOOST_CHECK(eigenResidual(A, top) < 1e-10);
+	BOOST_CHECK(orthogonality(top.vectors()) < 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(small_sizes) {
+	Matrix<double> one(1, 1);
+	one(0, 0) = 3.0;
+	EigenDecomposition<double> eig1(one);
+	BOOST_CHECK(eig1.success());
+	BOOST_CHECK_EQUAL(eig1.values()(0, 0), 3.0);
+	BOOST_CHECK_EQUAL(std::fabs(eig1.vectors()(0, 0)), 1.0);
+
+	Matrix<double> two(2, 2);
+	two(0, 0) = 2.0;
+	two(1, 0) = 1.0;
+	two(0, 1) = 1.0;
+	two(1, 1) = 2.0;
+	EigenDecomposition<double> eig2(two);
+	BOOST_CHECK(eig2.success());
+	BOOST_CHECK_SMALL(eig2.values()(0, 0) - 3.0, 1e-14);
+	BOOST_CHECK_SMALL(eig2.values()(1, 0) - 1.0, 1e-14);
+	BOOST_CHECK(eigenResidual(two, eig2) < 1e-14);
+}
@@ -0,0 +1,88 @@
+#define BOOST_TEST_MODULE ElementwiseTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+template <class T>
+static bool equal(const Matrix<T>& A, const Matrix<T>& B, T tolerance) {
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < A.cols(); ++j) {
+			if (std::fabs(A(i, j) - B(i, j)) > tolerance) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// compares the dispatched kernels against the scalar ones over lengths
+// that leave every possible tail
+template <class T>
+static void checkElementwise(T tolerance) {
+	for (int32_t cols = 1; cols < 70; cols += 3) {
+		Matrix<T> A(3, cols);
+		Matrix<T> B(3, cols);
+		Matrix<T> C(3, cols);
+		Matrix<T> ref(3, cols);
+		randomFill(A, 10);
+		randomFill(B, 10);
+		// the three rows and the padding between them
+		int64_t n = (int64_t) 2 * A.ld() + cols;
+		const T scalar = (T) 1.75;
+
+		Matrix<T>::add(C, A, B);
+		MatrixKernels::vectorAdd<T>(n, &A(0, 0), &B(0, 0), &ref(0, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		Matrix<T>::subtract(C, A, B);
+		MatrixKernels::vectorSubtract<T>(n, &A(0, 0), &B(0, 0), &ref(0, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		Matrix<T>::add(C, A, scalar);
+		MatrixKernels::vectorAddScalar<T>(n, &A(0, 0), scalar, &ref(0, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		Matrix<T>::multiply(C, A, scalar);
+		MatrixKernels::vectorScale<T>(n, &A(0, 0), scalar, &ref(0, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		C.fill(scalar);
+		MatrixKernels::vectorFill<T>(n, scalar, &ref(0, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		C = A;
+		ref = A;
+		C.rowAdd(2, 0, scalar);
+		MatrixKernels::vectorAxpy<T>(cols, scalar, &ref(0, 0), &ref(2, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+
+		C.rowMultiply(1, scalar);
+		MatrixKernels::vectorScale<T>(cols, &ref(1, 0), scalar, &ref(1, 0));
+		BOOST_CHECK(equal(C, ref, tolerance));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(float_kernels) {
+	BOOST_TEST_MESSAGE("float kernels: " << MatrixKernels::vectorKernels<float>().name);
+	checkElementwise<float>(1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(double_kernels) {
+	BOOST_TEST_MESSAGE("double kernels: " << MatrixKernels::vectorKernels<double>().name);
+	checkElementwise<double>(1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(generic_kernels) {
+	Matrix<int> A(2, 5);
+	Matrix<int> B(2, 5);
+	A.fill(3);
+	B.fill(4);
+	Matrix<int>::add(A, A, B);
+	A.rowAdd(1, 0, 2);
+	BOOST_CHECK(A(0, 4) == 7);
+	BOOST_CHECK(A(1, 4) == 21);
+}
@@ -0,0 +1,142 @@
+#define BOOST_TEST_MODULE ExpressionTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <new>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+// counts heap allocations so tests can check expressions don't make temporaries
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+	allocations++;
+	void* ptr = malloc(size);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size) {
+	allocations++;
+	void* ptr = malloc(size);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+static void naiveMultiply(Matrix<double>& dest, const Matrix<double>& A, const Matrix<double>& B) {
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < B.cols(); ++j) {
+			double sum = 0;
+			for (int32_t k = 0; k < A.cols(); ++k) {
+				sum += A(i, k) * B(k, j);
+			}
+			dest(i, j) = sum;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(fused_elementwise) {
+	const int32_t n = 20;
+	Matrix<double> A(n, n + 1), B(n, n + 1), C(n, n + 1), D(n, n + 1);
+	randomFill(A);
+	randomFill(B);
+	randomFill(C);
+
+	size_t before = allocations;
+	D = A + B * 2 - C;
+	D += 3.0 * A - 1;
+	BOOST_CHECK(allocations == before);
+
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n + 1; ++j) {
+			double expected = A(i, j) + B(i, j) * 2 - C(i, j) + 3.0 * A(i, j) - 1;
+			BOOST_CHECK(std::fabs(D(i, j) - expected) < 1e-12);
+		}
+	}
+
+	// integer scalars convert to the matrix type
+	Matrix<double> E = -(A * 2) + 1;
+	BOOST_CHECK(std::fabs(E(1, 2) - (1 - 2 * A(1, 2))) < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(products) {
+	const int32_t n = 30;
+	Matrix<double> A(n, n), B(n, n), C(n, n), D(n, n), ref(n, n), AB(n, n);
+	randomFill(A);
+	randomFill(B);
+	randomFill(C);
+	naiveMultiply(AB, A, B);
+
+	// gemm straight into D, with beta for the added term.
+	// the first product allocates gemm's packing buffers
+	D = A * B;
+	BOOST_CHECK(maxDifference(D, AB) < 1e-12);
+	size_t before = allocations;
+	D = 2.0 * A * B - C * 0.5;
+	BOOST_CHECK(allocations == before);
+	ref = AB * 2.0 - C * 0.5;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+
+	D = C;
+	D += A * B;
+	ref = AB + C;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+
+	D = C - A * B;
+	ref = C - AB;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+
+	// products inside larger expressions and of expressions
+	D = A * B + B * A;
+	Matrix<double> BA(n, n);
+	naiveMultiply(BA, B, A);
+	ref = AB + BA;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+
+	Matrix<double> sum = A + B;
+	naiveMultiply(ref, sum, C);
+	D = (A + B) * C;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+
+	D = (A * B) * 3.0 + C;
+	ref = AB * 3.0 + C;
+	BOOST_CHECK(maxDifference(D, ref) < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(aliasing_and_resize) {
+	const int32_t n = 12;
+	Matrix<double> A(n, n), B(n, n), ref(n, n);
+	randomFill(A);
+	randomFill(B);
+
+	naiveMultiply(ref, A, B);
+	A = A * B;
+	BOOST_CHECK(maxDifference(A, ref) < 1e-12);
+
+	Matrix<double> C = B;
+	naiveMultiply(ref, A, B);
+	ref = ref + C;
+	B += A * B;
+	BOOST_CHECK(maxDifference(B, ref) < 1e-12);
+
+	// assigning an expression of a different size resizes
+	Matrix<double> tall(n + 4, n);
+	randomFill(tall);
+	Matrix<double> small(2, 2);
+	small = tall * A;
+	BOOST_CHECK(small.rows() == n + 4 && small.cols() == n);
+}
@@ -0,0 +1,93 @@
+#define BOOST_TEST_MODULE FixedMatrixTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "FixedMatrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+// usable in constant expressions
+constexpr FixedMatrix<int32_t, 2, 2> A2(1, 2,
+                                        3, 4);
+static_assert((A2 * A2)(1, 0) == 15, "constexpr multiply");
+static_assert(A2.transpose()(0, 1) == 3, "constexpr transpose");
+static_assert(A2.determinant() == -2, "constexpr determinant");
+static_assert((A2 + FixedMatrix<int32_t, 2, 2>::identity())(1, 1) == 5, "constexpr add");
+static_assert(FixedMatrix<double, 3, 3>::identity().inverse() == FixedMatrix<double, 3, 3>::identity(),
+	"constexpr inverse");
+
+template <class T, int32_t N>
+static FixedMatrix<T, N, N> randomMatrix() {
+	FixedMatrix<T, N, N> ret;
+	for (int32_t i = 0; i < N; ++i) {
+		for (int32_t j = 0; j < N; ++j) {
+			ret(i, j) = randomValue<T>();
+		}
+		// diagonally dominant so it is well conditioned
+		ret(i, i) += N;
+	}
+	return ret;
+}
+
+template <int32_t N>
+static void checkInverse() {
+	FixedMatrix<double, N, N> A = randomMatrix<double, N>();
+	FixedMatrix<double, N, N> I = FixedMatrix<double, N, N>::identity();
+	BOOST_CHECK(maxDifference(A * A.inverse(), I) < 1e-12);
+	BOOST_CHECK(maxDifference(A.inverse() * A, I) < 1e-12);
+
+	// det(A * B) = det(A) * det(B) and det(A^-1) = 1 / det(A)
+	FixedMatrix<double, N, N> B = randomMatrix<double, N>();
+	double det = A.determinant() * B.determinant();
+	BOOST_CHECK(std::fabs((A * B).determinant() - det) < 1e-12 * std::fabs(det));
+	BOOST_CHECK(std::fabs(A.inverse().determinant() * A.determinant() - 1) < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(inverse_and_determinant) {
+	checkInverse<1>();
+	checkInverse<2>();
+	checkInverse<3>();
+	checkInverse<4>();
+	checkInverse<6>();
+	checkInverse<9>();
+	checkInverse<12>();
+
+	// needs pivoting
+	FixedMatrix<double, 5, 5> P(0, 1, 0, 0, 0,
+	                            1, 0, 0, 0, 0,
+	                            0, 0, 0, 0, 2,
+	                            0, 0, 3, 0, 0,
+	                            0, 0, 0, 4, 0);
+	BOOST_CHECK(maxDifference(P * P.inverse(), FixedMatrix<double, 5, 5>::identity()) < 1e-15);
+	BOOST_CHECK(std::fabs(P.determinant() + 24) < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(matches_dynamic_matrix) {
+	FixedMatrix<double, 6, 6> A = randomMatrix<double, 6>();
+	FixedMatrix<double, 6, 3> B;
+	for (int32_t i = 0; i < 6; ++i) {
+		for (int32_t j = 0; j < 3; ++j) {
+			B(i, j) = i - 2 * j;
+		}
+	}
+
+	Matrix<double> dynA = A.toMatrix();
+	Matrix<double> dynB = B.toMatrix();
+	Matrix<double> dynC = dynA * dynB;
+	FixedMatrix<double, 6, 3> C = A * B;
+	BOOST_CHECK(maxDifference(C, FixedMatrix<double, 6, 3>(dynC)) < 1e-12);
+
+	FixedMatrix<double, 3, 6> BT = B.transpose();
+	BOOST_CHECK(BT(2, 5) == B(5, 2));
+
+	FixedMatrix<double, 6, 3> X = A.solve(B);
+	BOOST_CHECK(maxDifference(A * X, B) < 1e-12);
+
+	FixedMatrix<double, 6, 3> D = 2.0 * B - B * 3 + 1;
+	BOOST_CHECK(D(4, 1) == -B(4, 1) + 1);
+	D += B;
+	D -= 1;
+	BOOST_CHECK((D == FixedMatrix<double, 6, 3>()));
+	BOOST_CHECK(D != B);
+}
@@ -0,0 +1,158 @@
+#define BOOST_TEST_MODULE IterativeTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "IterativeSolvers.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief 5 point Laplacian on a side x side grid, plus convection when
+ * wind is not zero (which makes it nonsymmetric)
+ */
+static SparseMatrix<double> laplacian(int32_t side, double wind) {
+	std::vector<SparseTriplet<double>> triplets;
+	for (int32_t y = 0; y < side; ++y) {
+		for (int32_t x = 0; x < side; ++x) {
+			int32_t i = y * side + x;
+			triplets.push_back({i, i, 4.0});
+			if (x > 0) {
+				triplets.push_back({i, i - 1, -1.0 - wind});
+			}
+			if (x < side - 1) {
+				triplets.push_back({i, i + 1, -1.0 + wind});
+			}
+			if (y > 0) {
+				triplets.push_back({i, i - side, -1.0});
+			}
+			if (y < side - 1) {
+				triplets.push_back({i, i + side, -1.0});
+			}
+		}
+	}
+	int32_t n = side * side;
+	return SparseMatrix<double>(n, n, triplets);
+}
+
+/**
+ * @brief returns ||b - A * x|| / ||b||
+ */
+static double relativeResidual(const SparseMatrix<double>& A, const Matrix<double>& b, const Matrix<double>& x) {
+	Matrix<double> Ax(b.rows(), 1);
+	SparseMatrix<double>::multiply(Ax, A, x);
+	double r = 0, nb = 0;
+	for (int32_t i = 0; i < b.rows(); ++i) {
+		r += (b(i, 0) - Ax(i, 0)) * (b(i, 0) - Ax(i, 0));
+		nb += b(i, 0) * b(i, 0);
+	}
+	return std::sqrt(r / nb);
+}
+
+BOOST_AUTO_TEST_CASE(conjugate_gradient) {
+	SparseMatrix<double> A = laplacian(30, 0.0);
+	Matrix<double> b = randomMatrix(A.rows(), 1);
+	SolverControl<double> control(1e-10, 2000);
+
+	Matrix<double> x(A.rows(), 1);
+	x.fill(0);
+	SolverResult<double> plain = conjugateGradient(A, b, x, control);
+	BOOST_CHECK(plain.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+	BOOST_CHECK_EQUAL((int32_t) plain.history.size(), plain.iterations + 1);
+
+	x.fill(0);
+	SolverResult<double> jacobi = conjugateGradient(A, b, x, JacobiPreconditioner<double>(A), control);
+	BOOST_CHECK(jacobi.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+
+	x.fill(0);
+	SolverResult<double> ilu = conjugateGradient(A, b, x, ILU0Preconditioner<double>(A), control);
+	BOOST_CHECK(ilu.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+	BOOST_CHECK(ilu.iterations < plain.iterations);
+
+	// a dense matrix and a callable give the same iterations
+	Matrix<double> dense = A.toMatrix();
+	x.fill(0);
+	SolverResult<double> fromDense = conjugateGradient(dense, b, x, control);
+	BOOST_CHECK(fromDense.converged);
+	BOOST_CHECK(std::abs(fromDense.iterations - plain.iterations) <= 1);
+
+	auto op = [&A](const Matrix<double>& in, Matrix<double>& out) {
+		SparseMatrix<double>::multiply(out, A, in);
+	};
+	x.fill(0);
+	SolverResult<double> fromCallable = conjugateGradient(op, b, x, control);
+	BOOST_CHECK_EQUAL(fromCallable.iterations, plain.iterations);
+
+	// stops at maxIterations without converging
+	x.fill(0);
+	SolverResult<double> limited = conjugateGradient(A, b, x, SolverControl<double>(1e-10, 5));
+	BOOST_CHECK(!limited.converged);
+	BOOST_CHECK_EQUAL(limited.iterations, 5);
+}
+
+BOOST_AUTO_TEST_CASE(nonsymmetric) {
+	SparseMatrix<double> A = laplacian(30, 0.4);
+	Matrix<double> b = randomMatrix(A.rows(), 1);
+	SolverControl<double> control(1e-10, 3000, 40);
+	ILU0Preconditioner<double> ilu(A);
+	Matrix<double> x(A.rows(), 1);
+
+	x.fill(0);
+	SolverResult<double> bicg = biCGStab(A, b, x, control);
+	BOOST_CHECK(bicg.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+
+	x.fill(0);
+	SolverResult<double> bicgILU = biCGStab(A, b, x, ilu, control);
+	BOOST_CHECK(bicgILU.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+	BOOST_CHECK(bicgILU.iterations < bicg.iterations);
+
+	x.fill(0);
+	SolverResult<double> restarted = gmres(A, b, x, control);
+	BOOST_CHECK(restarted.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+
+	x.fill(0);
+	SolverResult<double> gmresJacobi = gmres(A, b, x, JacobiPreconditioner<double>(A), control);
+	BOOST_CHECK(gmresJacobi.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+
+	x.fill(0);
+	SolverResult<double> gmresILU = gmres(A, b, x, ilu, control);
+	BOOST_CHECK(gmresILU.converged);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-9);
+	BOOST_CHECK(gmresILU.iterations < restarted.iterations);
+
+	// GMRES residuals never grow
+	for (size_t i = 1; i < restarted.history.size(); ++i) {
+		BOOST_CHECK(restarted.history[i] <= restarted.history[i - 1] * (1 + 1e-12));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ilu_of_tridiagonal_is_exact) {
+	// no fill in happens for a tridiagonal matrix, so ILU(0) is the full LU
+	const int32_t n = 50;
+	std::vector<SparseTriplet<double>> triplets;
+	for (int32_t i = 0; i < n; ++i) {
+		triplets.push_back({i, i, 3.0 + i % 4});
+		if (i > 0) {
+			triplets.push_back({i, i - 1, -1.5});
+		}
+		if (i < n - 1) {
+			triplets.push_back({i, i + 1, 0.7});
+		}
+	}
+	SparseMatrix<double> A(n, n, triplets, SPARSE_CSC);
+	Matrix<double> b = randomMatrix(n, 1);
+
+	Matrix<double> x(n, 1);
+	x.fill(0);
+	SolverResult<double> result = gmres(A, b, x, ILU0Preconditioner<double>(A), SolverControl<double>(1e-12));
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(result.iterations <= 2);
+	BOOST_CHECK(relativeResidual(A, b, x) < 1e-11);
+}
@@ -0,0 +1,124 @@
+#define BOOST_TEST_MODULE LUTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+BOOST_AUTO_TEST_CASE(blocked_solve) {
+	// larger than 255 rows and several blocks
+	const int32_t n = 300;
+	Matrix<double> A(n, n), b(n, 5), x(n, 5);
+	randomFill(A);
+	randomFill(b);
+
+	LUFactorization<double> lu(A);
+	BOOST_CHECK(!lu.singular());
+	lu.solve(b, x);
+	BOOST_CHECK(residual(A, x, b) < 1e-9);
+
+	// one column at a time against the same factorization
+	Matrix<double> b1(n, 1), x1(n, 1);
+	for (int32_t j = 0; j < 5; ++j) {
+		for (int32_t i = 0; i < n; ++i) {
+			b1(i, 0) = b(i, j);
+		}
+		lu.solve(b1, x1);
+		for (int32_t i = 0; i < n; ++i) {
+			BOOST_CHECK(std::fabs(x1(i, 0) - x(i, j)) < 1e-12);
+		}
+	}
+
+	// in place, and through Matrix::solveLU
+	Matrix<double> bx = b;
+	lu.solveInPlace(bx);
+	BOOST_CHECK(residual(A, bx, b) < 1e-9);
+	Matrix<double>::solveLU(A, b, x);
+	BOOST_CHECK(residual(A, x, b) < 1e-9);
+
+	// the packed factors reproduce P * A
+	const Matrix<double>& LU = lu.packed();
+	Matrix<double> L(n, n), U(n, n), PA = A;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			L(i, j) = (j < i) ? LU(i, j) : (i == j ? 1 : 0);
+			U(i, j) = (j >= i) ? LU(i, j) : 0;
+		}
+		PA.rowSwap(i, lu.pivots()[i]);
+	}
+	Matrix<double> prod = L * U;
+	double diff = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			diff = std::max(diff, std::fabs(prod(i, j) - PA(i, j)));
+		}
+	}
+	BOOST_CHECK(diff < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(pivoting_determinant_inverse) {
+	// the tiny leading entry would ruin the result without max magnitude pivoting
+	double data[] = { 1e-20, 1,
+	                  1,     1 };
+	Matrix<double> A(2, 2, data);
+	double bData[] = { 1, 2 };
+	Matrix<double> b(2, 1, bData), x(2, 1);
+	LUFactorization<double> lu(A);
+	lu.solve(b, x);
+	BOOST_CHECK(std::fabs(x(0, 0) - 1) < 1e-12);
+	BOOST_CHECK(std::fabs(x(1, 0) - 1) < 1e-12);
+	BOOST_CHECK(std::fabs(lu.determinant() + 1) < 1e-12);
+
+	double cData[] = { 2, 0, 1,
+	                   1, 3, 2,
+	                   1, 1, 2 };
+	Matrix<double> C(3, 3, cData), inv(3, 3);
+	lu.factor(C);
+	BOOST_CHECK(std::fabs(lu.determinant() - 6) < 1e-12);
+	lu.inverse(inv);
+	Matrix<double> I = C * inv;
+	for (int32_t i = 0; i < 3; ++i) {
+		for (int32_t j = 0; j < 3; ++j) {
+			BOOST_CHECK(std::fabs(I(i, j) - (i == j ? 1 : 0)) < 1e-12);
+		}
+	}
+
+	double sData[] = { 1, 2,
+	                   2, 4 };
+	lu.factor(Matrix<double>(2, 2, sData));
+	BOOST_CHECK(lu.singular());
+	BOOST_CHECK(lu.determinant() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(multiple_right_hand_sides) {
+	const int32_t n = 150;
+	const int32_t k = 500;
+	Matrix<double> A(n, n), b(n, k), x(n, k);
+	randomFill(A);
+	randomFill(b);
+
+	Matrix<double>::solve(A, b, x);
+	BOOST_CHECK(residual(A, x, b) < 1e-9);
+
+	Matrix<double> temp(n, n), y(n, k);
+	Matrix<double>::solve(A, b, y, temp);
+	BOOST_CHECK(residual(A, y, b) < 1e-9);
+
+	// blocked triangular solves against the unblocked definition
+	Matrix<double> L(n, n), X = b;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			L(i, j) = (j < i) ? A(i, j) : (i == j ? 2 + A(i, j) : 0);
+		}
+	}
+	MatrixKernels::trsmLower(n, k, L.data(), L.ld(), false, X.data(), X.ld());
+	BOOST_CHECK(residual(L, X, b) < 1e-9);
+
+	Matrix<double> U(n, n);
+	Matrix<double>::transpose(U, L);
+	X = b;
+	MatrixKernels::trsmUpper(n, k, U.data(), U.ld(), false, X.data(), X.ld());
+	BOOST_CHECK(residual(U, X, b) < 1e-9);
+}
@@ -0,0 +1,130 @@
+#define BOOST_TEST_MODULE LayoutTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+BOOST_AUTO_TEST_CASE(leading_dimension) {
+	const int32_t sizes[] = {1, 3, 7, 8, 9, 17, 100, 512, 1024};
+	for (int32_t cols : sizes) {
+		Matrix<double> A(5, cols);
+		BOOST_CHECK_EQUAL((uintptr_t) A.data() % MatrixLayout::Alignment, 0u);
+		BOOST_CHECK(A.ld() >= cols);
+		if (cols >= 8) {
+			// every row starts on a cache line, and never a multiple of 4K apart
+			BOOST_CHECK_EQUAL(A.ld() % 8, 0);
+			BOOST_CHECK((A.ld() * sizeof(double)) % 4096 != 0);
+		} else {
+			BOOST_CHECK_EQUAL(A.ld(), cols);
+		}
+	}
+	BOOST_CHECK_EQUAL(Matrix<float>(2, 1024).ld(), 1040);
+	BOOST_CHECK_EQUAL(Matrix<double>(2, 9).ld(), 16);
+
+	MatrixLayout::setRowAlignment(0);
+	BOOST_CHECK_EQUAL(Matrix<double>(2, 9).ld(), 9);
+	MatrixLayout::setRowAlignment(MatrixLayout::Alignment);
+}
+
+BOOST_AUTO_TEST_CASE(mixed_layouts) {
+	Matrix<double> padded = numbered<double>(20, 37);
+	MatrixLayout::setRowAlignment(0);
+	Matrix<double> packed = numbered<double>(20, 37);
+	Matrix<double> result(20, 37);
+	MatrixLayout::setRowAlignment(MatrixLayout::Alignment);
+	BOOST_CHECK(padded.ld() != packed.ld());
+	BOOST_CHECK(padded == packed);
+
+	Matrix<double>::add(result, padded, packed);
+	for (int32_t i = 0; i < 20; ++i) {
+		for (int32_t j = 0; j < 37; ++j) {
+			BOOST_CHECK_EQUAL(result(i, j), 2.0 * (i * 37 + j));
+		}
+	}
+
+	Matrix<double> product(20, 20), expected(20, 20);
+	Matrix<double> packedT(37, 20), paddedT(37, 20);
+	Matrix<double>::transpose(packedT, packed);
+	Matrix<double>::transpose(paddedT, padded);
+	Matrix<double>::multiply(product, packed, paddedT);
+	Matrix<double>::multiply(expected, padded, packedT);
+	BOOST_CHECK(product == expected);
+
+	// a copy takes the current layout
+	Matrix<double> copy(packed);
+	BOOST_CHECK_EQUAL(copy.ld(), padded.ld());
+	BOOST_CHECK(copy == packed);
+}
+
+BOOST_AUTO_TEST_CASE(operations) {
+	Matrix<double> A = numbered<double>(9, 9);
+	for (int32_t i = 0; i < 9; ++i) {
+		A(i, i) += 100;
+	}
+	Matrix<double> b = numbered<double>(9, 10);
+	Matrix<double> x(9, 10), Ax(9, 10);
+	Matrix<double>::solve(A, b, x);
+	Matrix<double>::multiply(Ax, A, x);
+	for (int32_t i = 0; i < 9; ++i) {
+		for (int32_t j = 0; j < 10; ++j) {
+			BOOST_CHECK_CLOSE(Ax(i, j) + 1, b(i, j) + 1, 1e-9);
+		}
+	}
+
+	// rectangular in place transposes leave the rows packed
+	Matrix<float> R = numbered<float>(13, 40);
+	Matrix<float> RT(40, 13);
+	Matrix<float>::transpose(RT, R);
+	R.transposeInPlace();
+	BOOST_CHECK_EQUAL(R.ld(), 13);
+	BOOST_CHECK(R == RT);
+
+	Matrix<double> I(17, 17);
+	I.identity();
+	BOOST_CHECK_EQUAL(I(16, 16), 1.0);
+	BOOST_CHECK_EQUAL(I(16, 0), 0.0);
+	BOOST_CHECK_EQUAL(I(0, 16), 0.0);
+}
+
+// first pivot of the LU decomposition of mat, upper is scaled to a pivot of 1
+static double firstPivot(const Matrix<double>& mat) {
+	Matrix<double> lower(2, 2);
+	Matrix<double> upper(2, 2);
+	mat.decompLU(lower, upper);
+	return lower(0, 0);
+}
+
+BOOST_AUTO_TEST_CASE(copies_keep_threshold) {
+	// with a threshold of 0.5, 0.1 is too small to pivot on
+	Matrix<double> A(2, 2, 0.5);
+	A(0, 0) = 0.1;
+	A(0, 1) = 1;
+	A(1, 0) = 1;
+	A(1, 1) = 1;
+
+	Matrix<double> copied(A);
+	BOOST_CHECK_EQUAL(firstPivot(copied), 1.0);
+
+	Matrix<double> assigned(2, 2);
+	assigned = A;
+	BOOST_CHECK_EQUAL(firstPivot(assigned), 1.0);
+
+	Matrix<double> resized(1, 1);
+	resized = A;
+	BOOST_CHECK_EQUAL(firstPivot(resized), 1.0);
+
+	Matrix<double> moved(1, 1);
+	moved = std::move(A);
+	BOOST_CHECK_EQUAL(firstPivot(moved), 1.0);
+
+	// assigning a matrix with the default threshold pivots on 0.1 again
+	Matrix<double> plain(2, 2);
+	plain(0, 0) = 0.1;
+	plain(0, 1) = 1;
+	plain(1, 0) = 1;
+	plain(1, 1) = 1;
+	copied = plain;
+	BOOST_CHECK_CLOSE(firstPivot(copied), 0.1, 1e-12);
+}
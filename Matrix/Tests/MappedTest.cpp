@@ -0,0 +1,141 @@
+#define BOOST_TEST_MODULE MappedTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include "MappedMatrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief returns a new path in the temp directory, removed when done
+ */
+struct TempFile {
+	std::string path;
+
+	TempFile() {
+		char name[] = "/tmp/MappedTestXXXXXX";
+		int fd = mkstemp(name);
+		BOOST_REQUIRE(fd >= 0);
+		::close(fd);
+		path = name;
+	}
+
+	~TempFile() {
+		remove(path.c_str());
+	}
+};
+
+BOOST_AUTO_TEST_CASE(create_open) {
+	TempFile file;
+	{
+		MappedMatrix<double> mat;
+		BOOST_REQUIRE(mat.create(file.path, 37, 21));
+		BOOST_CHECK_EQUAL(mat.rows(), 37);
+		BOOST_CHECK_EQUAL(mat.cols(), 21);
+		BOOST_CHECK_EQUAL((uintptr_t) mat.data() % MatrixLayout::Alignment, 0u);
+		BOOST_CHECK_EQUAL(mat(36, 20), 0.0);
+		for (int32_t i = 0; i < 37; ++i) {
+			for (int32_t j = 0; j < 21; ++j) {
+				mat(i, j) = i * 100 + j;
+			}
+		}
+	}
+
+	MappedMatrix<double> mat;
+	BOOST_REQUIRE(mat.open(file.path));
+	BOOST_CHECK(!mat.writable());
+	BOOST_CHECK_EQUAL(mat.rows(), 37);
+	const MappedMatrix<double>& readOnly = mat;
+	BOOST_CHECK_EQUAL(readOnly(12, 7), 1207.0);
+
+	Matrix<double> loaded = mat.load();
+	BOOST_CHECK_EQUAL(loaded(36, 20), 3620.0);
+
+	// the type is checked
+	MappedMatrix<float> wrongType;
+	BOOST_CHECK(!wrongType.open(file.path));
+	BOOST_CHECK(!wrongType.isOpen());
+
+	MappedMatrix<double> missing;
+	BOOST_CHECK(!missing.open(file.path + ".missing"));
+}
+
+/**
+ * @brief rewrites the header of a matrix file
+ */
+template <class Fn>
+static void editHeader(const std::string& path, const Fn& fn) {
+	FILE* file = fopen(path.c_str(), "r+b");
+	BOOST_REQUIRE(file != nullptr);
+	MappedMatrixHeader header;
+	BOOST_REQUIRE_EQUAL(fread(&header, sizeof(header), 1, file), 1u);
+	fn(header);
+	fseek(file, 0, SEEK_SET);
+	BOOST_REQUIRE_EQUAL(fwrite(&header, sizeof(header), 1, file), 1u);
+	fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_header) {
+	TempFile file;
+	{
+		MappedMatrix<double> mat;
+		BOOST_REQUIRE(mat.create(file.path, 300, 300));
+	}
+
+	// rows * ld * 8 wraps around to about half a megabyte, less than the file
+	editHeader(file.path, [](MappedMatrixHeader& header) {
+		header.rows = 2147437309;
+		header.ld = 1073764994;
+	});
+	MappedMatrix<double> overflow;
+	BOOST_CHECK(!overflow.open(file.path));
+
+	editHeader(file.path, [](MappedMatrixHeader& header) {
+		header.rows = 300;
+		header.ld = 299;
+	});
+	MappedMatrix<double> narrow;
+	BOOST_CHECK(!narrow.open(file.path));
+
+	editHeader(file.path, [](MappedMatrixHeader& header) {
+		header.ld = 300;
+	});
+	MappedMatrix<double> repaired;
+	BOOST_CHECK(repaired.open(file.path));
+}
+
+BOOST_AUTO_TEST_CASE(out_of_core_multiply) {
+	TempFile fileA, fileB, fileC;
+	MappedMatrix<double> A, B, C;
+	BOOST_REQUIRE(A.create(fileA.path, 150, 70));
+	BOOST_REQUIRE(B.create(fileB.path, 70, 90));
+	BOOST_REQUIRE(C.create(fileC.path, 150, 90));
+	randomFill(A, 10);
+	randomFill(B, 10);
+
+	Matrix<double> expected(150, 90);
+	Matrix<double>::multiply(expected, A.load(), B.load());
+
+	// budgets small enough to split both A and B, one where the last band of B
+	// is short, and one that holds everything
+	const int64_t budgets[] = {1, 8 * 1024, 10000, 1 << 20};
+	for (int64_t budget : budgets) {
+		C.view().fill(-1.0);
+		MappedMatrix<double>::multiply(C, A, B, budget);
+		bool equal = true;
+		for (int32_t i = 0; i < 150; ++i) {
+			for (int32_t j = 0; j < 90; ++j) {
+				equal = equal && std::fabs(C(i, j) - expected(i, j)) < 1e-9;
+			}
+		}
+		BOOST_CHECK_MESSAGE(equal, "budget " << budget);
+	}
+
+	C.flush();
+	MappedMatrix<double> reopened;
+	BOOST_REQUIRE(reopened.open(fileC.path));
+	const MappedMatrix<double>& result = reopened;
+	BOOST_CHECK_CLOSE(result.view()(149, 89), expected(149, 89), 1e-9);
+}
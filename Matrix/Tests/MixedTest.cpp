@@ -0,0 +1,154 @@
+#define BOOST_TEST_MODULE MixedTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include "MixedPrecisionSolver.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief random matrix with a heavy diagonal, well conditioned
+ */
+static Matrix<double> diagonallyDominant(int32_t n) {
+	Matrix<double> A = randomMatrix(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		A(i, i) += n;
+	}
+	return A;
+}
+
+BOOST_AUTO_TEST_CASE(lu_refinement) {
+	const int32_t n = 150;
+	Matrix<double> A = diagonallyDominant(n);
+	Matrix<double> expected = randomMatrix(n, 3);
+	Matrix<double> b(n, 3);
+	Matrix<double>::multiply(b, A, expected);
+
+	MixedPrecisionSolver<> solver(A);
+	Matrix<double> x(n, 3);
+	SolverResult<double> result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(!solver.fellBack());
+	BOOST_CHECK(result.iterations > 0);
+	BOOST_CHECK_EQUAL((int32_t) result.history.size(), result.iterations + 1);
+	BOOST_CHECK(maxDifference(x, expected) < 1e-12);
+
+	// float alone is nowhere near that
+	Matrix<float> low(n, n);
+	Matrix<float> lowB(n, 3);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			low(i, j) = (float) A(i, j);
+		}
+		for (int32_t j = 0; j < 3; ++j) {
+			lowB(i, j) = (float) b(i, j);
+		}
+	}
+	LUFactorization<float>(low).solveInPlace(lowB);
+	double lowError = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < 3; ++j) {
+			lowError = std::max(lowError, std::fabs(lowB(i, j) - expected(i, j)));
+		}
+	}
+	BOOST_CHECK(lowError > 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(cholesky_refinement) {
+	const int32_t n = 120;
+	Matrix<double> M = randomMatrix(n, n);
+	Matrix<double> MT(n, n);
+	Matrix<double>::transpose(MT, M);
+	Matrix<double> A(n, n);
+	Matrix<double>::multiply(A, MT, M);
+	for (int32_t i = 0; i < n; ++i) {
+		A(i, i) += n;
+	}
+	Matrix<double> expected = randomMatrix(n, 1);
+	Matrix<double> b(n, 1);
+	Matrix<double>::multiply(b, A, expected);
+
+	MixedPrecisionSolver<> solver(A, MIXED_CHOLESKY);
+	Matrix<double> x(n, 1);
+	SolverResult<double> result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(!solver.fellBack());
+	BOOST_CHECK(maxDifference(x, expected) < 1e-11);
+
+	// a second solve reuses the factors
+	Matrix<double> expected2 = randomMatrix(n, 1);
+	Matrix<double>::multiply(b, A, expected2);
+	result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(maxDifference(x, expected2) < 1e-11);
+}
+
+BOOST_AUTO_TEST_CASE(ill_conditioned_fallback) {
+	// Hilbert matrix, condition number far past 1 / float epsilon
+	const int32_t n = 10;
+	Matrix<double> A(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			A(i, j) = 1.0 / (i + j + 1);
+		}
+	}
+	Matrix<double> expected(n, 1);
+	for (int32_t i = 0; i < n; ++i) {
+		expected(i, 0) = 1.0;
+	}
+	Matrix<double> b(n, 1);
+	Matrix<double>::multiply(b, A, expected);
+
+	MixedPrecisionSolver<> solver(A);
+	Matrix<double> x(n, 1);
+	SolverResult<double> result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(solver.fellBack());
+
+	// same answer as solving in double directly
+	Matrix<double> direct(n, 1);
+	Matrix<double>::solveLU(A, b, direct);
+	BOOST_CHECK(maxDifference(x, direct) < 1e-12);
+
+	// factoring a new matrix starts in float again
+	solver.factor(diagonallyDominant(n));
+	BOOST_CHECK(!solver.fellBack());
+}
+
+BOOST_AUTO_TEST_CASE(out_of_float_range) {
+	const int32_t n = 20;
+	Matrix<double> A = diagonallyDominant(n);
+	A(0, 0) = 1e300;
+	Matrix<double> expected = randomMatrix(n, 1);
+	Matrix<double> b(n, 1);
+	Matrix<double>::multiply(b, A, expected);
+
+	MixedPrecisionSolver<> solver(A);
+	BOOST_CHECK(solver.fellBack());
+	Matrix<double> x(n, 1);
+	SolverResult<double> result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK_EQUAL(result.iterations, 0);
+}
+
+BOOST_AUTO_TEST_CASE(refactor_new_size) {
+	MixedPrecisionSolver<> solver(diagonallyDominant(4));
+	Matrix<double> x4(4, 1);
+	solver.solve(randomMatrix(4, 1), x4);
+
+	// the work buffers have to follow the new order
+	const int32_t n = 5;
+	Matrix<double> A = diagonallyDominant(n);
+	Matrix<double> expected = randomMatrix(n, 1);
+	Matrix<double> b(n, 1);
+	Matrix<double>::multiply(b, A, expected);
+	solver.factor(A);
+	BOOST_CHECK_EQUAL(solver.size(), n);
+
+	Matrix<double> x(n, 1);
+	SolverResult<double> result = solver.solve(b, x);
+	BOOST_CHECK(result.converged);
+	BOOST_CHECK(maxDifference(x, expected) < 1e-12);
+}
@@ -0,0 +1,71 @@
+#define BOOST_TEST_MODULE MultiplyTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+// reference dest = alpha * A * B + beta * dest, accumulated in double
+template <class T>
+static void naiveMultiplyAdd(Matrix<T>& dest, T alpha, const Matrix<T>& A, const Matrix<T>& B, T beta) {
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < B.cols(); ++j) {
+			double sum = 0;
+			for (int32_t k = 0; k < A.cols(); ++k) {
+				sum += (double) A(i, k) * (double) B(k, j);
+			}
+			dest(i, j) = (T) (alpha * sum + beta * dest(i, j));
+		}
+	}
+}
+
+template <class T>
+static void checkMultiply(int32_t m, int32_t n, int32_t k, T tolerance) {
+	Matrix<T> A(m, k);
+	Matrix<T> B(k, n);
+	Matrix<T> C(m, n);
+	Matrix<T> ref(m, n);
+	randomFill(A);
+	randomFill(B);
+
+	Matrix<T>::multiply(C, A, B);
+	ref.fill(0);
+	naiveMultiplyAdd(ref, T(1), A, B, T(0));
+	BOOST_CHECK(maxDifference(C, ref) < tolerance);
+
+	randomFill(C);
+	ref = C;
+	Matrix<T>::multiplyAdd(C, T(0.5), A, B, T(-2));
+	naiveMultiplyAdd(ref, T(0.5), A, B, T(-2));
+	BOOST_CHECK(maxDifference(C, ref) < tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(small_sizes) {
+	checkMultiply<double>(1, 1, 1, 1e-12);
+	checkMultiply<double>(3, 5, 2, 1e-12);
+	checkMultiply<float>(7, 4, 9, 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(blocked_sizes) {
+	// sizes straddle the register tile and cache block boundaries
+	checkMultiply<double>(97, 131, 300, 1e-10);
+	checkMultiply<double>(200, 17, 513, 1e-10);
+	checkMultiply<float>(150, 170, 260, 1e-3f);
+	checkMultiply<int>(37, 41, 43, 1);
+}
+
+BOOST_AUTO_TEST_CASE(double_accumulation) {
+	// a float accumulator loses the small terms
+	const int32_t n = 64;
+	Matrix<double> A(1, n);
+	Matrix<double> B(n, 1);
+	Matrix<double> C(1, 1);
+	for (int32_t i = 0; i < n; ++i) {
+		A(0, i) = (i == 0) ? 1.0e8 : 1.0e-3;
+		B(i, 0) = 1.0;
+	}
+	Matrix<double>::multiply(C, A, B);
+	BOOST_CHECK(std::fabs(C(0, 0) - (1.0e8 + 63.0e-3)) < 1e-6);
+}
@@ -0,0 +1,85 @@
+#define BOOST_TEST_MODULE ParallelTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+BOOST_AUTO_TEST_CASE(thread_pool) {
+	ThreadPool pool(3);
+	BOOST_CHECK(pool.numWorkers() == 3);
+
+	std::vector<int> hits(1000, 0);
+	pool.parallelFor(0, 1000, 7, [&](int64_t lo, int64_t hi) {
+		for (int64_t i = lo; i < hi; i++) {
+			hits[i]++;
+		}
+	});
+	bool once = true;
+	for (size_t i = 0; i < hits.size(); i++) {
+		once = once && (hits[i] == 1);
+	}
+	BOOST_CHECK(once);
+
+	// nested loops run on the waiting threads
+	std::atomic<int64_t> sum(0);
+	pool.parallelFor(0, 10, 1, [&](int64_t lo, int64_t hi) {
+		pool.parallelFor(0, 100, 10, [&](int64_t lo2, int64_t hi2) {
+			sum.fetch_add(hi2 - lo2);
+		});
+	});
+	BOOST_CHECK(sum.load() == 1000);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_matches_serial) {
+	const int32_t n = 150;
+	Matrix<double> A(n, n + 3);
+	Matrix<double> B(n + 3, n);
+	Matrix<double> C(n, n);
+	randomFill(A);
+	randomFill(B);
+
+	// serial results
+	MatrixParallel::setThreads(1);
+	Matrix<double> serialProduct(n, n);
+	Matrix<double>::multiply(serialProduct, A, B);
+	Matrix<double> serialSum = serialProduct + serialProduct;
+	Matrix<double> serialTranspose(n + 3, n);
+	Matrix<double>::transpose(serialTranspose, A);
+	Matrix<double> serialInverse(n, n);
+	Matrix<double>::inverse(serialInverse, serialProduct);
+
+	MatrixParallel::setThreads(4);
+	MatrixParallel::setThreshold(1);
+	BOOST_CHECK(MatrixParallel::threads() == 4);
+
+	Matrix<double>::multiply(C, A, B);
+	BOOST_CHECK(maxDifference(C, serialProduct) < 1e-12);
+
+	// wide products are split by columns
+	Matrix<double> wide(3, n);
+	Matrix<double> wideSerial(3, n);
+	Matrix<double> rows(3, n + 3);
+	randomFill(rows);
+	Matrix<double>::multiply(wide, rows, B);
+	MatrixParallel::setThreads(1);
+	Matrix<double>::multiply(wideSerial, rows, B);
+	MatrixParallel::setThreads(4);
+	BOOST_CHECK(maxDifference(wide, wideSerial) < 1e-12);
+
+	Matrix<double> sum = C + C;
+	BOOST_CHECK(maxDifference(sum, serialSum) < 1e-12);
+
+	Matrix<double> transpose(n + 3, n);
+	Matrix<double>::transpose(transpose, A);
+	BOOST_CHECK(maxDifference(transpose, serialTranspose) == 0);
+
+	Matrix<double> inverse(n, n);
+	Matrix<double>::inverse(inverse, C);
+	BOOST_CHECK(maxDifference(inverse, serialInverse) < 1e-9);
+
+	MatrixParallel::setThreads(1);
+	MatrixParallel::setThreshold((int64_t) 1 << 18);
+}
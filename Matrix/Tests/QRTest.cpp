@@ -0,0 +1,86 @@
+#define BOOST_TEST_MODULE QRTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+BOOST_AUTO_TEST_CASE(factors) {
+	// more rows than a chunk and several blocks of columns
+	const int32_t m = 1100;
+	const int32_t n = 70;
+	Matrix<double> A(m, n);
+	randomFill(A);
+
+	QRFactorization<double> qr(A);
+	BOOST_CHECK(qr.fullRank());
+	Matrix<double> Q(m, n), R(n, n), QT(n, m);
+	qr.Q(Q);
+	qr.R(R);
+
+	Matrix<double> QR = Q * R;
+	BOOST_CHECK(maxDifference(QR, A) < 1e-12);
+
+	Matrix<double>::transpose(QT, Q);
+	Matrix<double> I(n, n);
+	I.identity();
+	Matrix<double> QTQ = QT * Q;
+	BOOST_CHECK(maxDifference(QTQ, I) < 1e-12);
+
+	// applyQT undoes applyQ
+	Matrix<double> b(m, 3);
+	randomFill(b);
+	Matrix<double> c = b;
+	qr.applyQ(c);
+	qr.applyQT(c);
+	BOOST_CHECK(maxDifference(c, b) < 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(least_squares) {
+	const int32_t m = 600;
+	const int32_t n = 40;
+	Matrix<double> A(m, n), b(m, 2), x(n, 2);
+	randomFill(A);
+	randomFill(b);
+
+	QRFactorization<double> qr(A);
+	qr.solve(b, x);
+
+	// the residual is orthogonal to the columns of A
+	Matrix<double> r = A * x - b;
+	Matrix<double> AT(n, m);
+	Matrix<double>::transpose(AT, A);
+	Matrix<double> ATr = AT * r;
+	Matrix<double> zero(n, 2);
+	zero.fill(0);
+	BOOST_CHECK(maxDifference(ATr, zero) < 1e-10);
+
+	Matrix<double> y(n, 2);
+	Matrix<double>::leastSquares(A, b, y);
+	BOOST_CHECK(maxDifference(x, y) < 1e-14);
+
+	// moved in, factored without a copy
+	Matrix<double> copy = A;
+	QRFactorization<double> moved(std::move(copy));
+	moved.solve(b, y);
+	BOOST_CHECK(maxDifference(x, y) < 1e-14);
+}
+
+BOOST_AUTO_TEST_CASE(ill_conditioned) {
+	// Lauchli matrix: eps^2 vanishes next to 1 in A^T * A,
+	// so the normal equations are singular but QR is exact
+	const double eps = 1e-9;
+	double data[] = { 1,   1,   1,
+	                  eps, 0,   0,
+	                  0,   eps, 0,
+	                  0,   0,   eps };
+	Matrix<double> A(4, 3, data);
+	double bData[] = { 3, eps, eps, eps };
+	Matrix<double> b(4, 1, bData), x(3, 1);
+	Matrix<double>::leastSquares(A, b, x);
+	for (int32_t i = 0; i < 3; ++i) {
+		BOOST_CHECK(std::fabs(x(i, 0) - 1) < 1e-6);
+	}
+}
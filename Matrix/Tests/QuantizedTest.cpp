@@ -0,0 +1,172 @@
+#define BOOST_TEST_MODULE QuantizedTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include "QuantizedMatrix.hpp"
+
+using namespace Alectryon;
+
+static Matrix<float> randomMatrix(int32_t rows, int32_t cols, float low, float high) {
+	Matrix<float> mat(rows, cols);
+	for (int32_t i = 0; i < rows; ++i) {
+		for (int32_t j = 0; j < cols; ++j) {
+			mat(i, j) = low + (high - low) * (float) (rand() % 1001) / 1000.0f;
+		}
+	}
+	return mat;
+}
+
+template <class Q>
+static Matrix<Q> randomIntegers(int32_t rows, int32_t cols, int32_t low, int32_t high) {
+	Matrix<Q> mat(rows, cols);
+	for (int32_t i = 0; i < rows; ++i) {
+		for (int32_t j = 0; j < cols; ++j) {
+			mat(i, j) = (Q) (low + rand() % (high - low + 1));
+		}
+	}
+	return mat;
+}
+
+/**
+ * @brief (A - za) * (B - zb) summed directly in int64
+ */
+template <class Q>
+static int64_t reference(const QuantizedMatrix<Q>& A, const QuantizedMatrix<Q>& B, int32_t i, int32_t j) {
+	int64_t sum = 0;
+	for (int32_t p = 0; p < A.cols(); ++p) {
+		sum += (int64_t) (A.values()(i, p) - A.parameters(i).zeroPoint) *
+			(B.values()(p, j) - B.parameters().zeroPoint);
+	}
+	return sum;
+}
+
+template <class Q>
+static void checkGemm(int32_t m, int32_t n, int32_t k, int32_t low, int32_t high) {
+	Matrix<Q> A = randomIntegers<Q>(m, k, low, high);
+	Matrix<Q> B = randomIntegers<Q>(k, n, low, high);
+	Matrix<int32_t> C(m, n);
+	std::vector<int32_t> columnSums(n);
+	MatrixKernels::integerGemm(m, n, k, A.data(), A.ld(), B.data(), B.ld(), C.data(), C.ld(), columnSums.data());
+
+	for (int32_t j = 0; j < n; ++j) {
+		int32_t sum = 0;
+		for (int32_t p = 0; p < k; ++p) {
+			sum += B(p, j);
+		}
+		BOOST_CHECK_EQUAL(columnSums[j], sum);
+	}
+	for (int32_t i = 0; i < m; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			int32_t sum = 0;
+			for (int32_t p = 0; p < k; ++p) {
+				sum += (int32_t) A(i, p) * (int32_t) B(p, j);
+			}
+			BOOST_CHECK_EQUAL(C(i, j), sum);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(integer_gemm) {
+	BOOST_TEST_MESSAGE("int8 kernels: " << MatrixKernels::integerKernels<int8_t>().name);
+	BOOST_TEST_MESSAGE("int16 kernels: " << MatrixKernels::integerKernels<int16_t>().name);
+
+	// odd sizes exercise the zero padding of every tile
+	checkGemm<int8_t>(1, 1, 1, -128, 127);
+	checkGemm<int8_t>(37, 29, 131, -128, 127);
+	checkGemm<int8_t>(64, 200, 64, -128, 127);
+	checkGemm<int16_t>(37, 29, 131, -1000, 1000);
+	checkGemm<int16_t>(3, 150, 17, -32768, 32767);
+}
+
+BOOST_AUTO_TEST_CASE(quantize_round_trip) {
+	Matrix<float> src = randomMatrix(20, 33, -3.0f, 5.0f);
+	Matrix<float> back(20, 33);
+
+	QuantizedMatrix<int8_t> tensor(src);
+	BOOST_CHECK(tensor.parameters().scale > 0);
+	tensor.dequantize(back);
+	for (int32_t i = 0; i < src.rows(); ++i) {
+		for (int32_t j = 0; j < src.cols(); ++j) {
+			BOOST_CHECK_SMALL(back(i, j) - src(i, j), 0.51f * tensor.parameters().scale);
+		}
+	}
+
+	QuantizedMatrix<int16_t> rows(src, QUANTIZE_PER_ROW);
+	rows.dequantize(back);
+	for (int32_t i = 0; i < src.rows(); ++i) {
+		for (int32_t j = 0; j < src.cols(); ++j) {
+			BOOST_CHECK_SMALL(back(i, j) - src(i, j), 0.51f * rows.parameters(i).scale);
+		}
+	}
+
+	// zero is exact, and a constant matrix keeps the default parameters
+	QuantizationParameters params = QuantizedMatrix<int8_t>::chooseParameters(0.5f, 2.0f);
+	BOOST_CHECK_EQUAL(params.zeroPoint, -128);
+	Matrix<float> zeros(4, 4);
+	zeros.fill(0.0f);
+	QuantizedMatrix<int8_t> constant(zeros);
+	BOOST_CHECK_EQUAL(constant.parameters().scale, 1.0f);
+	BOOST_CHECK_EQUAL(constant.values()(2, 3), 0);
+}
+
+BOOST_AUTO_TEST_CASE(zero_point_correction) {
+	QuantizedMatrix<int8_t> A(randomMatrix(23, 70, -1.0f, 4.0f), QUANTIZE_PER_ROW);
+	QuantizedMatrix<int8_t> B(randomMatrix(70, 19, -2.0f, 0.5f));
+	BOOST_CHECK(B.parameters().zeroPoint != 0);
+
+	Matrix<int32_t> C(23, 19);
+	QuantizedMatrix<int8_t>::multiply(C, A, B);
+	for (int32_t i = 0; i < C.rows(); ++i) {
+		for (int32_t j = 0; j < C.cols(); ++j) {
+			BOOST_CHECK_EQUAL(C(i, j), reference(A, B, i, j));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(float_and_requantized_multiply) {
+	int32_t m = 30, k = 96, n = 41;
+	Matrix<float> a = randomMatrix(m, k, -1.0f, 1.0f);
+	Matrix<float> b = randomMatrix(k, n, -0.5f, 1.0f);
+	Matrix<float> expected(m, n);
+	Matrix<float>::multiply(expected, a, b);
+
+	QuantizedMatrix<int8_t> A(a, QUANTIZE_PER_ROW);
+	QuantizedMatrix<int8_t> B(b);
+	Matrix<float> C(m, n);
+	QuantizedMatrix<int8_t>::multiply(C, A, B);
+
+	// every product is off by at most about half a step in each factor
+	float bound = 0;
+	for (int32_t i = 0; i < m; ++i) {
+		bound = std::max(bound, A.parameters(i).scale);
+	}
+	bound = k * (bound * 1.0f + B.parameters().scale * 1.0f);
+	for (int32_t i = 0; i < m; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			BOOST_CHECK_SMALL(C(i, j) - expected(i, j), bound);
+		}
+	}
+
+	// requantized output, parameters from the float range
+	QuantizedMatrix<int8_t> D(expected);
+	QuantizedMatrix<int8_t>::multiply(D, A, B);
+	Matrix<float> back(m, n);
+	D.dequantize(back);
+	for (int32_t i = 0; i < m; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			BOOST_CHECK_SMALL(back(i, j) - C(i, j), 0.51f * D.parameters().scale);
+		}
+	}
+
+	// saturates instead of wrapping
+	QuantizedMatrix<int8_t> narrow(m, n);
+	narrow.setParameters(QuantizationParameters(1.0e-4f, 0));
+	QuantizedMatrix<int8_t>::multiply(narrow, A, B);
+	for (int32_t i = 0; i < m; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			int32_t q = narrow.values()(i, j);
+			BOOST_CHECK(C(i, j) > 0.0f ? q >= 0 : q <= 0);
+		}
+	}
+}
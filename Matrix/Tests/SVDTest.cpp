@@ -0,0 +1,146 @@
+#define BOOST_TEST_MODULE SVDTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "SingularValueDecomposition.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief returns max |A - U * S * V^T|
+ */
+static double reconstructionError(const Matrix<double>& A, const SingularValueDecomposition<double>& svd) {
+	const Matrix<double>& U = svd.U();
+	const Matrix<double>& V = svd.V();
+	double largest = 0;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < A.cols(); ++j) {
+			double sum = 0;
+			for (int32_t p = 0; p < svd.vectorCount(); ++p) {
+				sum += U(i, p) * svd.values()(p, 0) * V(j, p);
+			}
+			largest = std::max(largest, std::fabs(A(i, j) - sum));
+		}
+	}
+	return largest;
+}
+
+/**
+ * @brief returns max |M^T * M - I|
+ */
+static double orthogonality(const Matrix<double>& M) {
+	double largest = 0;
+	for (int32_t a = 0; a < M.cols(); ++a) {
+		for (int32_t b = 0; b < M.cols(); ++b) {
+			double sum = 0;
+			for (int32_t i = 0; i < M.rows(); ++i) {
+				sum += M(i, a) * M(i, b);
+			}
+			largest = std::max(largest, std::fabs(sum - (a == b ? 1.0 : 0.0)));
+		}
+	}
+	return largest;
+}
+
+BOOST_AUTO_TEST_CASE(square) {
+	Matrix<double> A = randomMatrix(50, 50);
+	SingularValueDecomposition<double> svd(A);
+	BOOST_CHECK(svd.success());
+	BOOST_CHECK_EQUAL(svd.vectorCount(), 50);
+	BOOST_CHECK(reconstructionError(A, svd) < 1e-11);
+	BOOST_CHECK(orthogonality(svd.U()) < 1e-11);
+	BOOST_CHECK(orthogonality(svd.V()) < 1e-11);
+	for (int32_t i = 1; i < 50; ++i) {
+		BOOST_CHECK(svd.values()(i - 1, 0) >= svd.values()(i, 0));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(tall_and_wide) {
+	Matrix<double> tall = randomMatrix(120, 30);
+	SingularValueDecomposition<double> svdTall(tall);
+	BOOST_CHECK(svdTall.success());
+	BOOST_CHECK_EQUAL(svdTall.U().rows(), 120);
+	BOOST_CHECK_EQUAL(svdTall.U().cols(), 30);
+	BOOST_CHECK_EQUAL(svdTall.V().rows(), 30);
+	BOOST_CHECK(reconstructionError(tall, svdTall) < 1e-11);
+	BOOST_CHECK(orthogonality(svdTall.U()) < 1e-11);
+
+	Matrix<double> wide(30, 120);
+	Matrix<double>::transpose(wide, tall);
+	SingularValueDecomposition<double> svdWide(wide);
+	BOOST_CHECK(svdWide.success());
+	BOOST_CHECK_EQUAL(svdWide.U().rows(), 30);
+	BOOST_CHECK_EQUAL(svdWide.V().rows(), 120);
+	BOOST_CHECK(reconstructionError(wide, svdWide) < 1e-11);
+	for (int32_t i = 0; i < 30; ++i) {
+		BOOST_CHECK_SMALL(svdWide.values()(i, 0) - svdTall.values()(i, 0), 1e-11);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(values_only_and_top) {
+	Matrix<double> A = randomMatrix(60, 40);
+	SingularValueDecomposition<double> full(A);
+	SingularValueDecomposition<double> values(A, 0);
+	BOOST_CHECK(values.success());
+	BOOST_CHECK_EQUAL(values.vectorCount(), 0);
+	for (int32_t i = 0; i < 40; ++i) {
+		BOOST_CHECK_SMALL(values.values()(i, 0) - full.values()(i, 0), 1e-11);
+	}
+
+	SingularValueDecomposition<double> top(A, 3);
+	BOOST_CHECK_EQUAL(top.U().cols(), 3);
+	BOOST_CHECK_EQUAL(top.V().cols(), 3);
+	// A * v = s * u for each kept pair
+	Matrix<double> AV(60, 3);
+	Matrix<double>::multiply(AV, A, top.V());
+	double largest = 0;
+	for (int32_t i = 0; i < 60; ++i) {
+		for (int32_t j = 0; j < 3; ++j) {
+			largest = std::max(largest, std::fabs(AV(i, j) - top.values()(j, 0) * top.U()(i, j)));
+		}
+	}
+	BOOST_CHECK(largest < 1e-11);
+}
+
+BOOST_AUTO_TEST_CASE(pseudo_inverse) {
+	// rank 2, 5 x 4
+	Matrix<double> left = randomMatrix(5, 2);
+	Matrix<double> right = randomMatrix(2, 4);
+	Matrix<double> A(5, 4);
+	Matrix<double>::multiply(A, left, right);
+
+	SingularValueDecomposition<double> svd(A);
+	BOOST_CHECK_EQUAL(svd.rank(), 2);
+
+	// A * A^+ * A = A and A^+ * A * A^+ = A^+
+	Matrix<double> pinv(4, 5);
+	svd.pseudoInverse(pinv);
+	Matrix<double> AP(5, 5);
+	Matrix<double>::multiply(AP, A, pinv);
+	Matrix<double> APA(5, 4);
+	Matrix<double>::multiply(APA, AP, A);
+	Matrix<double> PAP(4, 5);
+	Matrix<double>::multiply(PAP, pinv, AP);
+	for (int32_t i = 0; i < 5; ++i) {
+		for (int32_t j = 0; j < 4; ++j) {
+			BOOST_CHECK_SMALL(APA(i, j) - A(i, j), 1e-12);
+			BOOST_CHECK_SMALL(PAP(j, i) - pinv(j, i), 1e-12);
+		}
+	}
+
+	// full rank square is the inverse
+	Matrix<double> B = randomMatrix(6, 6);
+	SingularValueDecomposition<double> svdB(B);
+	Matrix<double> inv(6, 6);
+	svdB.pseudoInverse(inv);
+	Matrix<double> identity(6, 6);
+	Matrix<double>::multiply(identity, B, inv);
+	for (int32_t i = 0; i < 6; ++i) {
+		for (int32_t j = 0; j < 6; ++j) {
+			BOOST_CHECK_SMALL(identity(i, j) - (i == j ? 1.0 : 0.0), 1e-11);
+		}
+	}
+}
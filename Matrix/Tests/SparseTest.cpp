@@ -0,0 +1,124 @@
+#define BOOST_TEST_MODULE SparseTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include "SparseMatrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief random matrix with about one element in density set
+ */
+static Matrix<double> randomSparse(int32_t rows, int32_t cols, int32_t density) {
+	Matrix<double> mat(rows, cols);
+	mat.fill(0);
+	for (int32_t i = 0; i < rows; ++i) {
+		for (int32_t j = 0; j < cols; ++j) {
+			if (rand() % density == 0) {
+				mat(i, j) = randomValue(10.0);
+			}
+		}
+	}
+	return mat;
+}
+
+BOOST_AUTO_TEST_CASE(construction) {
+	// out of order, with a duplicate that is summed
+	std::vector<SparseTriplet<double>> triplets = {
+		{2, 1, 4.0}, {0, 0, 1.0}, {1, 2, 3.0}, {2, 1, 0.5}, {0, 2, 2.0}
+	};
+	double expected[] = {
+		1.0, 0.0, 2.0,
+		0.0, 0.0, 3.0,
+		0.0, 4.5, 0.0
+	};
+	Matrix<double> dense(3, 3, expected);
+
+	SparseMatrix<double> csr(3, 3, triplets, SPARSE_CSR);
+	SparseMatrix<double> csc(3, 3, triplets, SPARSE_CSC);
+	BOOST_CHECK_EQUAL(csr.nonZeros(), 4);
+	BOOST_CHECK_EQUAL(csc.nonZeros(), 4);
+	BOOST_CHECK_EQUAL(maxDifference(csr.toMatrix(), dense), 0.0);
+	BOOST_CHECK_EQUAL(maxDifference(csc.toMatrix(), dense), 0.0);
+	BOOST_CHECK_EQUAL(csr.coeff(2, 1), 4.5);
+	BOOST_CHECK_EQUAL(csc.coeff(1, 1), 0.0);
+
+	SparseMatrix<double> fromDense(dense, SPARSE_CSC);
+	BOOST_CHECK(fromDense.offsets() == csc.offsets());
+	BOOST_CHECK(fromDense.indices() == csc.indices());
+
+	// converting and transposing twice comes back to the same arrays
+	SparseMatrix<double> converted(1, 1), transposed(1, 1), back(1, 1);
+	SparseMatrix<double>::convert(converted, csr, SPARSE_CSC);
+	BOOST_CHECK(converted.indices() == csc.indices());
+	BOOST_CHECK(converted.values() == csc.values());
+	SparseMatrix<double>::transpose(transposed, csr);
+	SparseMatrix<double>::transpose(back, transposed);
+	BOOST_CHECK(back.offsets() == csr.offsets());
+	BOOST_CHECK(back.values() == csr.values());
+	BOOST_CHECK_EQUAL(transposed.coeff(1, 2), 4.5);
+}
+
+BOOST_AUTO_TEST_CASE(multiply) {
+	const int32_t rows = 300, cols = 200;
+	Matrix<double> dense = randomSparse(rows, cols, 20);
+	Matrix<double> vec = randomMatrix(cols, 1);
+	Matrix<double> block = randomMatrix(cols, 7);
+
+	MatrixParallel::setThreads(4);
+	MatrixParallel::setThreshold(1000);
+	for (SparseFormat format : {SPARSE_CSR, SPARSE_CSC}) {
+		SparseMatrix<double> A(dense, format);
+		for (const Matrix<double>* B : {&vec, &block}) {
+			Matrix<double> expected(rows, B->cols()), result(rows, B->cols());
+			Matrix<double>::multiply(expected, dense, *B);
+			SparseMatrix<double>::multiply(result, A, *B);
+			BOOST_CHECK(maxDifference(expected, result) < 1e-12);
+
+			// 2 * A * B - result = result
+			SparseMatrix<double>::multiplyAdd(result, 2.0, A, *B, -1.0);
+			BOOST_CHECK(maxDifference(expected, result) < 1e-12);
+		}
+	}
+	MatrixParallel::setThreads(1);
+}
+
+BOOST_AUTO_TEST_CASE(triangular_solve) {
+	const int32_t n = 150;
+	// small off diagonal elements so the unit triangle stays well conditioned
+	Matrix<double> dense = randomSparse(n, n, 10);
+	Matrix<double>::multiply(dense, dense, 0.01);
+	for (int32_t i = 0; i < n; ++i) {
+		dense(i, i) = 10.0 + i % 3;
+	}
+	Matrix<double> lower(n, n), upper(n, n), unitLower(n, n);
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			lower(i, j) = (j <= i) ? dense(i, j) : 0.0;
+			upper(i, j) = (j >= i) ? dense(i, j) : 0.0;
+			unitLower(i, j) = (j < i) ? dense(i, j) : (i == j) ? 1.0 : 0.0;
+		}
+	}
+	Matrix<double> b = randomMatrix(n, 3);
+
+	for (SparseFormat format : {SPARSE_CSR, SPARSE_CSC}) {
+		// the other triangle is ignored
+		SparseMatrix<double> A(dense, format);
+		Matrix<double> x(b), check(n, 3);
+
+		A.solveLower(x);
+		Matrix<double>::multiply(check, lower, x);
+		BOOST_CHECK(maxDifference(check, b) < 1e-10);
+
+		x = b;
+		A.solveUpper(x);
+		Matrix<double>::multiply(check, upper, x);
+		BOOST_CHECK(maxDifference(check, b) < 1e-10);
+
+		x = b;
+		A.solveLower(x, true);
+		Matrix<double>::multiply(check, unitLower, x);
+		BOOST_CHECK(maxDifference(check, b) < 1e-10);
+	}
+}
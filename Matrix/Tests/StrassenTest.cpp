@@ -0,0 +1,65 @@
+#define BOOST_TEST_MODULE StrassenTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief returns the largest difference between the Strassen and gemm products
+ */
+static double strassenError(int32_t m, int32_t n, int32_t k) {
+	Matrix<double> A = randomMatrix(m, k);
+	Matrix<double> B = randomMatrix(k, n);
+	Matrix<double> expected(m, n);
+	MatrixKernels::gemm(m, n, k, 1.0, A.data(), A.ld(), B.data(), B.ld(), 0.0, expected.data(), expected.ld());
+
+	Matrix<double> C(m, n);
+	Matrix<double>::multiply(C, A, B);
+	double largest = 0;
+	for (int32_t i = 0; i < m; ++i) {
+		for (int32_t j = 0; j < n; ++j) {
+			largest = std::max(largest, std::fabs(C(i, j) - expected(i, j)));
+		}
+	}
+	return largest;
+}
+
+BOOST_AUTO_TEST_CASE(settings) {
+	BOOST_CHECK_EQUAL(MatrixStrassen::crossover(), 0);
+	BOOST_CHECK(!MatrixStrassen::applies<double>(4096, 4096, 4096));
+
+	MatrixStrassen::setCrossover(16);
+	BOOST_CHECK(MatrixStrassen::applies<double>(32, 32, 32));
+	BOOST_CHECK(!MatrixStrassen::applies<double>(32, 31, 32));
+	BOOST_CHECK(!MatrixStrassen::applies<int32_t>(64, 64, 64));
+	BOOST_CHECK_EQUAL(MatrixStrassen::scratchSize<double>(20, 20, 20), 0);
+	// one level of 16 x 16 temporaries
+	BOOST_CHECK_EQUAL(MatrixStrassen::scratchSize<double>(32, 32, 32), 3 * 16 * 16);
+	MatrixStrassen::setCrossover(0);
+}
+
+BOOST_AUTO_TEST_CASE(serial) {
+	MatrixStrassen::setCrossover(8);
+	// several levels, square and rectangular
+	BOOST_CHECK(strassenError(128, 128, 128) < 1e-10);
+	BOOST_CHECK(strassenError(64, 96, 80) < 1e-10);
+	// odd sides at different levels get peeled
+	BOOST_CHECK(strassenError(67, 53, 71) < 1e-10);
+	BOOST_CHECK(strassenError(99, 99, 99) < 1e-10);
+	MatrixStrassen::setCrossover(0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel) {
+	MatrixParallel::setThreads(4);
+	MatrixParallel::setThreshold(1);
+	MatrixStrassen::setCrossover(8);
+	BOOST_CHECK(strassenError(128, 128, 128) < 1e-10);
+	BOOST_CHECK(strassenError(75, 66, 91) < 1e-10);
+	MatrixStrassen::setCrossover(0);
+	MatrixParallel::setThreads(1);
+}
@@ -0,0 +1,103 @@
+#ifndef _MATRIX_TEST_HELPERS_HPP
+#define _MATRIX_TEST_HELPERS_HPP
+
+/**
+ * Test data and comparisons shared by the Matrix tests
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include "Matrix.hpp"
+
+namespace Alectryon {
+template <class T>
+class MatrixBatch;
+}
+
+/**
+ * @brief random value in [-scale, scale], in steps of scale / 1000
+ */
+template <class T>
+T randomValue(T scale = T(1)) {
+	return (T) (rand() % 2001 - 1000) * scale / (T) 1000;
+}
+
+/**
+ * @brief fills mat with randomValue(scale)
+ * @details works for anything with rows(), cols() and a writable mat(i, j)
+ */
+template <class M>
+void randomFill(M& mat, double scale = 1) {
+	typedef typename std::decay<decltype(mat(0, 0))>::type T;
+	for (int32_t i = 0; i < mat.rows(); ++i) {
+		for (int32_t j = 0; j < mat.cols(); ++j) {
+			mat(i, j) = randomValue<T>((T) scale);
+		}
+	}
+}
+
+template <class T = double>
+Alectryon::Matrix<T> randomMatrix(int32_t rows, int32_t cols, double scale = 1) {
+	Alectryon::Matrix<T> mat(rows, cols);
+	randomFill(mat, scale);
+	return mat;
+}
+
+/**
+ * @brief fills every matrix of a batch with randomValue(scale)
+ */
+template <class T>
+void randomFill(Alectryon::MatrixBatch<T>& batch, double scale = 1) {
+	for (int32_t m = 0; m < batch.count(); ++m) {
+		for (int32_t i = 0; i < batch.rows(); ++i) {
+			for (int32_t j = 0; j < batch.cols(); ++j) {
+				batch(m, i, j) = randomValue<T>((T) scale);
+			}
+		}
+	}
+}
+
+/**
+ * @brief mat(i, j) = i * cols + j
+ */
+template <class T = double>
+Alectryon::Matrix<T> numbered(int32_t rows, int32_t cols) {
+	Alectryon::Matrix<T> mat(rows, cols);
+	for (int32_t i = 0; i < rows; ++i) {
+		for (int32_t j = 0; j < cols; ++j) {
+			mat(i, j) = (T) (i * cols + j);
+		}
+	}
+	return mat;
+}
+
+/**
+ * @brief max |A(i, j) - B(i, j)|
+ * @details works for Matrix, FixedMatrix and views
+ */
+template <class M>
+auto maxDifference(const M& A, const M& B) -> typename std::decay<decltype(A(0, 0))>::type {
+	typedef typename std::decay<decltype(A(0, 0))>::type T;
+	T largest = 0;
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < A.cols(); ++j) {
+			largest = std::max(largest, (T) std::fabs(A(i, j) - B(i, j)));
+		}
+	}
+	return largest;
+}
+
+/**
+ * @brief max |A * x - b|
+ */
+template <class T>
+T residual(const Alectryon::Matrix<T>& A, const Alectryon::Matrix<T>& x, const Alectryon::Matrix<T>& b) {
+	Alectryon::Matrix<T> r(b.rows(), b.cols());
+	Alectryon::Matrix<T>::multiply(r, A, x);
+	return maxDifference(r, b);
+}
+
+#endif /* _MATRIX_TEST_HELPERS_HPP */
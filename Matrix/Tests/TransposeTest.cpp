@@ -0,0 +1,71 @@
+#define BOOST_TEST_MODULE TransposeTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+/**
+ * @brief returns true if B is exactly A^T
+ */
+template <class T>
+static bool isTranspose(const Matrix<T>& A, const Matrix<T>& B) {
+	if (A.rows() != B.cols() || A.cols() != B.rows()) {
+		return false;
+	}
+	for (int32_t i = 0; i < A.rows(); ++i) {
+		for (int32_t j = 0; j < A.cols(); ++j) {
+			if (A(i, j) != B(j, i)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <class T>
+static void checkShapes() {
+	// tile edges, block edges and the recursive split
+	const int32_t sizes[] = {1, 3, 4, 7, 8, 9, 31, 32, 33, 65, 100, 257};
+	for (int32_t rows : sizes) {
+		for (int32_t cols : sizes) {
+			Matrix<T> A = numbered<T>(rows, cols);
+			Matrix<T> AT(cols, rows);
+			Matrix<T>::transpose(AT, A);
+			BOOST_CHECK_MESSAGE(isTranspose(A, AT), rows << " x " << cols);
+
+			Matrix<T> inPlace(A);
+			inPlace.transposeInPlace();
+			BOOST_CHECK_MESSAGE(isTranspose(A, inPlace), rows << " x " << cols << " in place");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(shapes) {
+	checkShapes<float>();
+	checkShapes<double>();
+	checkShapes<int32_t>();
+}
+
+BOOST_AUTO_TEST_CASE(parallel) {
+	MatrixParallel::setThreads(4);
+	MatrixParallel::setThreshold(1000);
+
+	Matrix<double> A = numbered<double>(515, 300);
+	Matrix<double> AT(300, 515);
+	Matrix<double>::transpose(AT, A);
+	BOOST_CHECK(isTranspose(A, AT));
+
+	Matrix<float> square = numbered<float>(301, 301);
+	Matrix<float> copy(square);
+	square.transposeInPlace();
+	BOOST_CHECK(isTranspose(copy, square));
+
+	// a rectangular one goes back to the original
+	AT.transposeInPlace();
+	BOOST_CHECK_EQUAL(AT.rows(), 515);
+	BOOST_CHECK(AT == A);
+
+	MatrixParallel::setThreads(1);
+}
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MODULE ViewTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+BOOST_AUTO_TEST_CASE(blocks) {
+	Matrix<double> A = numbered(6, 7);
+
+	ConstMatrixView<double> block = static_cast<const Matrix<double>&>(A).block(1, 2, 3, 4);
+	BOOST_CHECK_EQUAL(block.rows(), 3);
+	BOOST_CHECK_EQUAL(block.cols(), 4);
+	BOOST_CHECK_EQUAL(block.ld(), 7);
+	BOOST_CHECK_EQUAL(block(0, 0), A(1, 2));
+	BOOST_CHECK_EQUAL(block(2, 3), A(3, 5));
+	BOOST_CHECK_EQUAL(block.col(1)(2, 0), A(3, 3));
+
+	// writes through a view land in the matrix
+	A.row(4).fill(-1.0);
+	A.col(0)(5, 0) = 100.0;
+	for (int32_t j = 0; j < 7; ++j) {
+		BOOST_CHECK_EQUAL(A(4, j), -1.0);
+	}
+	BOOST_CHECK_EQUAL(A(5, 0), 100.0);
+
+	Matrix<double> copy(A.block(1, 2, 3, 4));
+	BOOST_CHECK_EQUAL(copy.rows(), 3);
+	BOOST_CHECK_EQUAL(copy(2, 3), A(3, 5));
+}
+
+BOOST_AUTO_TEST_CASE(external_buffer) {
+	// a 3 x 3 matrix stored with a padded row of 5
+	double buffer[15];
+	for (int32_t i = 0; i < 15; ++i) {
+		buffer[i] = i;
+	}
+	MatrixView<double> view(buffer, 3, 3, 5);
+	Matrix<double> ones(3, 3);
+	ones.fill(1.0);
+
+	MatrixView<double>::add(view, view, ones);
+	for (int32_t i = 0; i < 3; ++i) {
+		for (int32_t j = 0; j < 5; ++j) {
+			double expected = i * 5 + j + (j < 3 ? 1 : 0);
+			BOOST_CHECK_EQUAL(buffer[i * 5 + j], expected);
+		}
+	}
+
+	MatrixView<double>::multiply(view, view, 2.0);
+	MatrixView<double>::subtract(view, view, ones);
+	BOOST_CHECK_EQUAL(buffer[7], 2 * (7 + 1) - 1);
+	BOOST_CHECK_EQUAL(buffer[8], 8);
+}
+
+BOOST_AUTO_TEST_CASE(multiply_transpose) {
+	Matrix<double> big = numbered(40, 50);
+	ConstMatrixView<double> A = static_cast<const Matrix<double>&>(big).block(3, 5, 17, 11);
+	ConstMatrixView<double> B = static_cast<const Matrix<double>&>(big).block(20, 30, 11, 13);
+
+	Matrix<double> expected(17, 13);
+	Matrix<double>::multiply(expected, Matrix<double>(A), Matrix<double>(B));
+
+	Matrix<double> out(30, 30);
+	out.fill(0.0);
+	MatrixView<double> dest = out.block(2, 4, 17, 13);
+	MatrixView<double>::multiply(dest, A, B);
+	for (int32_t i = 0; i < 17; ++i) {
+		for (int32_t j = 0; j < 13; ++j) {
+			BOOST_CHECK_CLOSE(dest(i, j), expected(i, j), 1e-10);
+		}
+	}
+	BOOST_CHECK_EQUAL(out(0, 0), 0.0);
+	BOOST_CHECK_EQUAL(out(2, 3), 0.0);
+
+	// 2 * A * B - A * B is A * B again
+	MatrixView<double>::multiplyAdd(dest, 2.0, A, B, -1.0);
+	BOOST_CHECK_CLOSE(dest(16, 12), expected(16, 12), 1e-10);
+
+	Matrix<double> AT(11, 17);
+	MatrixView<double>::transpose(AT, A);
+	BOOST_CHECK_EQUAL(AT(4, 9), A(9, 4));
+}
+
+BOOST_AUTO_TEST_CASE(solve) {
+	double values[] = {
+		4, 1, 0, 2, 9, 9,
+		1, 5, 2, 0, 9, 9,
+		0, 2, 6, 1, 9, 9,
+		2, 0, 1, 7, 9, 9,
+		9, 9, 9, 9, 9, 9};
+	Matrix<double> M(5, 6, values);
+
+	// the leading 4 x 4 block is the system, column 4 is the right hand side
+	ConstMatrixView<double> A = static_cast<const Matrix<double>&>(M).block(0, 0, 4, 4);
+	Matrix<double> x(4, 1);
+	MatrixView<double>::solve(A, M.block(0, 4, 4, 1), x);
+
+	Matrix<double> b(4, 1);
+	MatrixView<double>::multiply(b, A, x);
+	for (int32_t i = 0; i < 4; ++i) {
+		BOOST_CHECK_CLOSE(b(i, 0), 9.0, 1e-9);
+	}
+
+	// in place over a strided column
+	MatrixView<double> rhs = M.block(0, 5, 4, 1);
+	MatrixView<double>::solve(A, rhs, rhs);
+	for (int32_t i = 0; i < 4; ++i) {
+		BOOST_CHECK_CLOSE(M(i, 5), x(i, 0), 1e-9);
+	}
+}
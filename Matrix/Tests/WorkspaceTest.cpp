@@ -0,0 +1,90 @@
+#define BOOST_TEST_MODULE WorkspaceTest
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <new>
+#include "Matrix.hpp"
+#include "TestHelpers.hpp"
+
+using namespace Alectryon;
+
+// counts heap allocations so tests can check the workspace paths don't allocate
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+	allocations++;
+	void* ptr = malloc(size);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+BOOST_AUTO_TEST_CASE(frames) {
+	MatrixWorkspace workspace(4096);
+	BOOST_CHECK_EQUAL(workspace.capacity(), 4096u);
+	{
+		MatrixWorkspace::Frame frame(workspace);
+		double* a = workspace.allocate<double>(3);
+		BOOST_CHECK_EQUAL((uintptr_t) a % MatrixLayout::Alignment, 0u);
+		MatrixView<double> view = workspace.allocateMatrix<double>(4, 9);
+		BOOST_CHECK_EQUAL((uintptr_t) view.data() % MatrixLayout::Alignment, 0u);
+		BOOST_CHECK_EQUAL(view.ld(), 16);
+		BOOST_CHECK_EQUAL(workspace.used(), MatrixWorkspace::arrayBytes<double>(3) +
+			MatrixWorkspace::matrixBytes<double>(4, 9));
+	}
+	BOOST_CHECK_EQUAL(workspace.used(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(solvers) {
+	// sizes on both sides of the LU and QR block sizes
+	const int32_t sizes[] = {1, 5, 33, 70};
+	for (int32_t n : sizes) {
+		Matrix<double> A(n, n), b(n, 3), x(n, 3), expected(n, 3);
+		randomFill(A);
+		randomFill(b);
+		for (int32_t i = 0; i < n; ++i) {
+			A(i, i) += n;
+		}
+		Matrix<double> inv(n, n), expectedInv(n, n);
+		Matrix<double> tall(n + 7, n), tallB(n + 7, 3);
+		randomFill(tall);
+		randomFill(tallB);
+
+		MatrixWorkspace workspace;
+		workspace.reserve(std::max(Matrix<double>::solveWorkspaceSize(n),
+			Matrix<double>::leastSquaresWorkspaceSize(n + 7, n, 3)));
+
+		// the first calls size the gemm packing buffers, which are kept per thread
+		for (int32_t pass = 0; pass < 2; ++pass) {
+			size_t before = allocations;
+			Matrix<double>::solve(A, b, x, workspace);
+			Matrix<double>::solveLU(A, b, x, workspace);
+			Matrix<double>::inverse(inv, A, workspace);
+			Matrix<double>::leastSquares(tall, tallB, x, workspace);
+			if (pass == 1) {
+				BOOST_CHECK_EQUAL(allocations, before);
+			}
+		}
+		BOOST_CHECK_EQUAL(workspace.used(), 0u);
+
+		Matrix<double>::leastSquares(tall, tallB, expected);
+		BOOST_CHECK_MESSAGE(maxDifference(x, expected) < 1e-10, "least squares n = " << n);
+
+		Matrix<double>::solveLU(A, b, x, workspace);
+		Matrix<double>::solveLU(A, b, expected);
+		BOOST_CHECK_MESSAGE(maxDifference(x, expected) < 1e-10, "solve n = " << n);
+
+		Matrix<double>::inverse(expectedInv, A);
+		BOOST_CHECK_MESSAGE(maxDifference(inv, expectedInv) < 1e-10, "inverse n = " << n);
+
+		// x can be b
+		Matrix<double> inPlace(b);
+		Matrix<double>::solve(A, inPlace, inPlace, workspace);
+		BOOST_CHECK(maxDifference(inPlace, expected) < 1e-10);
+	}
+}